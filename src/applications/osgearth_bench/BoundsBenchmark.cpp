@@ -0,0 +1,136 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmarks"
+#include <osgEarth/Map>
+#include <osgEarth/ElevationLayer>
+#include <osgEarthDrivers/gdal/GDALOptions>
+
+#define LC "[bench bounds] "
+
+using namespace osgEarth;
+using namespace osgEarth::Drivers;
+
+int
+benchmarkBounds(osg::ArgumentParser& args)
+{
+    std::string input;
+    if (!args.read("--in", input))
+    {
+        OE_WARN << LC << "Specify a local elevation GeoTIFF with --in <file>" << std::endl;
+        return -1;
+    }
+
+    unsigned lod = 10u;
+    args.read("--lod", lod);
+
+    unsigned maxTiles = 256u;
+    args.read("--tiles", maxTiles);
+
+    GDALOptions gdal;
+    gdal.url() = URI(input);
+
+    osg::ref_ptr<Map> map = new Map();
+    osg::ref_ptr<ElevationLayer> layer = new ElevationLayer(ElevationLayerOptions("bench", gdal));
+    map->addLayer(layer.get());
+
+    if (layer->getStatus().isError())
+    {
+        OE_WARN << LC << "Failed to open " << input << ": " << layer->getStatus().message() << std::endl;
+        return -1;
+    }
+
+    GeoExtent extent = layer->getDataExtents().empty() ?
+        layer->getProfile()->getExtent() :
+        layer->getDataExtentsUnion();
+
+    std::vector<TileKey> keys;
+    layer->getProfile()->getIntersectingTiles(extent, lod, keys);
+    if (keys.size() > maxTiles)
+        keys.resize(maxTiles);
+
+    if (keys.empty())
+    {
+        OE_WARN << LC << "No tiles at LOD " << lod << std::endl;
+        return -1;
+    }
+
+    // Without metadata: every bounds query decodes the heightfield and scans it.
+    // This pass also records the summaries.
+    unsigned decoded = 0u;
+    float decodedMax = -FLT_MAX;
+    osg::Timer_t t0 = osg::Timer::instance()->tick();
+    for (unsigned i = 0; i < keys.size(); ++i)
+    {
+        GeoHeightField geoHF = layer->createHeightField(keys[i]);
+        if (geoHF.valid())
+        {
+            ElevationTileSummary summary(geoHF.getHeightField());
+            decodedMax = osg::maximum(decodedMax, summary._maxHeight);
+            ++decoded;
+        }
+    }
+    osg::Timer_t t1 = osg::Timer::instance()->tick();
+
+    // Same again, with the heightfields in the layer's memory cache
+    for (unsigned i = 0; i < keys.size(); ++i)
+    {
+        GeoHeightField geoHF = layer->createHeightField(keys[i]);
+        if (geoHF.valid())
+        {
+            ElevationTileSummary summary(geoHF.getHeightField());
+            decodedMax = osg::maximum(decodedMax, summary._maxHeight);
+        }
+    }
+    osg::Timer_t t2 = osg::Timer::instance()->tick();
+
+    // With metadata: look up the recorded summaries.
+    unsigned found = 0u;
+    float minHeight = FLT_MAX, maxHeight = -FLT_MAX;
+    for (unsigned i = 0; i < keys.size(); ++i)
+    {
+        ElevationTileSummary summary;
+        if (layer->getTileSummary(keys[i], summary))
+        {
+            ++found;
+            minHeight = osg::minimum(minHeight, summary._minHeight);
+            maxHeight = osg::maximum(maxHeight, summary._maxHeight);
+        }
+    }
+    osg::Timer_t t3 = osg::Timer::instance()->tick();
+
+    double n = (double)keys.size();
+    double cold = osg::Timer::instance()->delta_u(t0, t1) / n;
+    double warm = osg::Timer::instance()->delta_u(t1, t2) / n;
+    double meta = osg::Timer::instance()->delta_u(t2, t3) / n;
+
+    OE_NOTICE << LC << keys.size() << " tiles at LOD " << lod << " (" << decoded << " with data):\n"
+        << "  decode, cold    = " << cold << " us/query\n"
+        << "  decode, cached  = " << warm << " us/query\n"
+        << "  tile summary    = " << meta << " us/query\n"
+        << "  speedup         = " << (meta > 0.0 ? cold / meta : 0.0) << "x cold, "
+        << (meta > 0.0 ? warm / meta : 0.0) << "x cached\n"
+        << "  summaries found = " << found << "\n"
+        << "  height range    = " << minHeight << " .. " << maxHeight << " (decoded max " << decodedMax << ")\n"
+        << std::endl;
+
+    return 0;
+}
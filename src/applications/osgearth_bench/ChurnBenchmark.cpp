@@ -0,0 +1,231 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmarks"
+#include <osgEarth/FrameScheduler>
+#include <osgEarth/Random>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <algorithm>
+
+#define LC "[bench churn] "
+
+using namespace osgEarth;
+
+namespace
+{
+    OpenThreads::Mutex s_workMutex;
+    double s_workDone   = 0.0;  // microseconds of simulated I/O completed
+    double s_workWasted = 0.0;  // microseconds spent on jobs that were then canceled
+
+    // Spins for a number of microseconds, standing in for scene graph work.
+    void spin(unsigned us)
+    {
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        while (osg::Timer::instance()->delta_u(start, osg::Timer::instance()->tick()) < (double)us);
+    }
+
+    // A simulated tile load: I/O in short slices, checking for cancelation between them.
+    struct TileJob : public FrameScheduler::Job
+    {
+        TileJob() : _sse(1.0f), _visible(false), _firstFrame(0u), _mergeFrame(0u) { }
+
+        void run(ProgressCallback* progress)
+        {
+            unsigned done = 0u;
+            while (done < _workUS && !progress->isCanceled())
+            {
+                OpenThreads::Thread::microSleep(100);
+                done += 100u;
+            }
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_workMutex);
+            s_workDone += (double)done;
+            if (progress->isCanceled())
+                s_workWasted += (double)done;
+        }
+
+        void merge()
+        {
+            spin(_mergeUS);
+            _mergeFrame = *_frame;
+        }
+
+        float     _sse;
+        bool      _visible;
+        unsigned  _firstFrame;
+        unsigned  _mergeFrame;
+        unsigned  _workUS;
+        unsigned  _mergeUS;
+        unsigned* _frame;
+    };
+}
+
+int
+benchmarkChurn(osg::ArgumentParser& args)
+{
+    unsigned numThreads = 4u;
+    args.read("--threads", numThreads);
+
+    unsigned numVisible = 400u;
+    args.read("--tiles", numVisible);
+
+    float churn = 0.05f;
+    args.read("--churn", churn);
+
+    unsigned numFrames = 600u;
+    args.read("--frames", numFrames);
+
+    unsigned workUS = 4000u;
+    args.read("--work", workUS);
+
+    unsigned mergeUS = 300u;
+    args.read("--merge", mergeUS);
+
+    unsigned budgetUS = 2000u;
+    args.read("--budget", budgetUS);
+
+    unsigned graceFrames = 2u;
+    args.read("--grace", graceFrames);
+
+    double fps = 60.0;
+    args.read("--fps", fps);
+
+    // Jobs come from a large pool; each frame a fraction of the visible set
+    // leaves the view and is replaced by tiles that were not visible.
+    unsigned poolSize = numVisible * 8u;
+    unsigned frame = 0u;
+    std::vector< osg::ref_ptr<TileJob> > pool;
+    for (unsigned i = 0; i < poolSize; ++i)
+    {
+        TileJob* job = new TileJob();
+        job->_workUS = workUS;
+        job->_mergeUS = mergeUS;
+        job->_frame = &frame;
+        pool.push_back(job);
+    }
+
+    Random prng(42);
+    std::vector<unsigned> visible;
+    while (visible.size() < numVisible)
+    {
+        unsigned i = prng.next(poolSize);
+        if (!pool[i]->_visible)
+        {
+            pool[i]->_visible = true;
+            pool[i]->_sse = (float)(1.0 + prng.next() * 100.0);
+            visible.push_back(i);
+        }
+    }
+
+    osg::ref_ptr<FrameScheduler> scheduler = new FrameScheduler(numThreads, "bench");
+    scheduler->setMergeBudget(budgetUS);
+    scheduler->setGraceFrames(graceFrames);
+
+    double frameUS = 1e6 / fps;
+    double maxMerge = 0.0, totalMerge = 0.0;
+    unsigned overBudget = 0u;
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    for (frame = 1u; frame <= numFrames; ++frame)
+    {
+        osg::Timer_t frameStart = osg::Timer::instance()->tick();
+
+        // replace part of the view
+        unsigned replace = (unsigned)(churn * (float)numVisible);
+        for (unsigned r = 0; r < replace; ++r)
+        {
+            unsigned slot = prng.next(visible.size());
+            unsigned i;
+            do { i = prng.next(poolSize); } while (pool[i]->_visible);
+
+            pool[visible[slot]]->_visible = false;
+            pool[i]->_visible = true;
+            pool[i]->_sse = (float)(1.0 + prng.next() * 100.0);
+            pool[i]->_firstFrame = 0u;
+            visible[slot] = i;
+        }
+
+        // "cull": renew every visible tile that still needs data, with drifting priorities
+        for (std::vector<unsigned>::const_iterator v = visible.begin(); v != visible.end(); ++v)
+        {
+            TileJob* job = pool[*v].get();
+            if (job->_mergeFrame >= job->_firstFrame && job->_firstFrame > 0u)
+                continue; // already loaded
+
+            job->_sse *= (float)(0.9 + 0.2 * prng.next());
+            if (job->_firstFrame == 0u)
+                job->_firstFrame = frame;
+            scheduler->request(job, job->_sse, frame);
+        }
+
+        // "update"
+        scheduler->update(frame);
+        double spent = scheduler->getStats()._lastMergeTime * 1e6;
+        maxMerge = std::max(maxMerge, spent);
+        totalMerge += spent;
+
+        // the budget is checked between merges, so one merge may overrun it
+        if (budgetUS > 0u && spent > (double)(budgetUS + mergeUS))
+            ++overBudget;
+
+        // wait out the rest of the frame
+        double used = osg::Timer::instance()->delta_u(frameStart, osg::Timer::instance()->tick());
+        if (used < frameUS)
+            OpenThreads::Thread::microSleep((unsigned)(frameUS - used));
+    }
+
+    double elapsed = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    // latency from first request to merge, for tiles loaded during the run
+    std::vector<unsigned> latency;
+    for (unsigned i = 0; i < poolSize; ++i)
+    {
+        if (pool[i]->_firstFrame > 0u && pool[i]->_mergeFrame >= pool[i]->_firstFrame)
+            latency.push_back(pool[i]->_mergeFrame - pool[i]->_firstFrame);
+    }
+    std::sort(latency.begin(), latency.end());
+
+    FrameScheduler::Stats stats = scheduler->getStats();
+    scheduler->cancelAll();
+    scheduler = 0L;
+
+    double done = s_workDone;
+    double wasted = s_workWasted;
+
+    OE_NOTICE << LC << numFrames << " frames, " << numVisible << " visible tiles, "
+        << (int)(churn * 100.0f) << "% replaced per frame, " << numThreads << " threads:\n"
+        << "  merged          = " << stats._merged << "\n"
+        << "  canceled queued = " << stats._canceledQueued << "\n"
+        << "  canceled active = " << stats._canceledRunning << "\n"
+        << "  wasted I/O      = " << (done > 0.0 ? 100.0 * wasted / done : 0.0) << " % of " << done / 1000.0 << " ms\n"
+        << "  merge budget    = " << budgetUS << " us\n"
+        << "  merge avg/max   = " << totalMerge / (double)numFrames << " / " << maxMerge << " us\n"
+        << "  over budget     = " << overBudget << " frames\n"
+        << "  latency p50/p90 = "
+        << (latency.empty() ? 0u : latency[latency.size() / 2]) << " / "
+        << (latency.empty() ? 0u : latency[(latency.size() * 9) / 10]) << " frames\n"
+        << "  achieved fps    = " << (double)numFrames / elapsed << "\n"
+        << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmarks"
+#include <osgEarth/Map>
+#include <osgEarth/ElevationLayer>
+#include <osgEarth/Random>
+#include <osgEarthFeatures/AltitudeFilter>
+#include <osgEarthFeatures/FilterContext>
+#include <osgEarthFeatures/Session>
+#include <osgEarthSymbology/AltitudeSymbol>
+#include <osgEarthDrivers/gdal/GDALOptions>
+
+#define LC "[bench clamp] "
+
+using namespace osgEarth;
+using namespace osgEarth::Features;
+using namespace osgEarth::Symbology;
+using namespace osgEarth::Drivers;
+
+int
+benchmarkClamp(osg::ArgumentParser& args)
+{
+    std::string input;
+    if (!args.read("--in", input))
+    {
+        OE_WARN << LC << "Specify a local elevation GeoTIFF with --in <file>" << std::endl;
+        return -1;
+    }
+
+    unsigned numBuildings = 50000u;
+    args.read("--buildings", numBuildings);
+
+    bool perVertex = args.read("--vertex");
+
+    GDALOptions gdal;
+    gdal.url() = URI(input);
+
+    osg::ref_ptr<Map> map = new Map();
+    osg::ref_ptr<ElevationLayer> elevation = new ElevationLayer(ElevationLayerOptions("bench", gdal));
+    map->addLayer(elevation.get());
+
+    if (elevation->getStatus().isError())
+    {
+        OE_WARN << LC << "Failed to open " << input << ": " << elevation->getStatus().message() << std::endl;
+        return -1;
+    }
+
+    // square building footprints scattered over the middle half of the data
+    const SpatialReference* geoSRS = map->getProfile()->getSRS()->getGeographicSRS();
+    GeoExtent extent = elevation->getProfile()->getExtent().transform(geoSRS);
+    extent.scale(0.5, 0.5);
+
+    Random prng(1234);
+    double size = extent.width() * 0.0005;
+    FeatureList features;
+    for (unsigned b = 0; b < numBuildings; ++b)
+    {
+        double x = extent.xMin() + prng.next() * extent.width();
+        double y = extent.yMin() + prng.next() * extent.height();
+
+        Polygon* footprint = new Polygon(4);
+        footprint->push_back(osg::Vec3d(x, y, 0.0));
+        footprint->push_back(osg::Vec3d(x + size, y, 0.0));
+        footprint->push_back(osg::Vec3d(x + size, y + size, 0.0));
+        footprint->push_back(osg::Vec3d(x, y + size, 0.0));
+        features.push_back(new Feature(footprint, geoSRS));
+    }
+
+    Style style;
+    AltitudeSymbol* alt = style.getOrCreate<AltitudeSymbol>();
+    alt->clamping() = AltitudeSymbol::CLAMP_TO_TERRAIN;
+    alt->technique() = AltitudeSymbol::TECHNIQUE_MAP;
+    alt->binding() = perVertex ? AltitudeSymbol::BINDING_VERTEX : AltitudeSymbol::BINDING_CENTROID;
+
+    AltitudeFilter filter;
+    filter.setPropertiesFromStyle(style);
+
+    osg::ref_ptr<Session> session = new Session(map.get());
+    FilterContext cx(session.get(), new FeatureProfile(extent));
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    filter.push(features, cx);
+
+    double seconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    unsigned points = perVertex ? numBuildings * 4u : numBuildings;
+
+    OE_NOTICE << LC << "clamped " << numBuildings << " buildings over " << input << ":\n"
+        << "  binding         = " << (perVertex ? "vertex" : "centroid") << "\n"
+        << "  points          = " << points << "\n"
+        << "  time            = " << seconds << " s\n"
+        << "  points/s        = " << (seconds > 0.0 ? (double)points / seconds : 0.0) << "\n"
+        << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmarks"
+#include <osgEarth/Config>
+#include <osgEarth/XmlUtils>
+#include <osgEarth/StringUtils>
+#include <sstream>
+
+#define LC "[bench earth] "
+
+using namespace osgEarth;
+
+namespace
+{
+    // Builds an earth file with many image and elevation layers, each
+    // carrying a handful of driver properties.
+    std::string makeSyntheticEarthFile(unsigned numLayers)
+    {
+        std::stringstream out;
+        out << "<?xml version=\"1.0\"?>\n"
+            << "<map name=\"synthetic\" type=\"geocentric\" version=\"2\">\n"
+            << "  <options>\n    <terrain lod_blending=\"true\" min_tile_range_factor=\"6\"/>\n  </options>\n";
+
+        for (unsigned i = 0; i < numLayers; ++i)
+        {
+            const char* type = (i % 4 == 0) ? "elevation" : "image";
+            out << "  <" << type << " name=\"layer" << i << "\" driver=\"gdal\" enabled=\"" << (i%2==0?"true":"false") << "\">\n"
+                << "    <url>data/layer_" << i << ".tif</url>\n"
+                << "    <tile_size>256</tile_size>\n"
+                << "    <min_level>0</min_level>\n"
+                << "    <max_level>" << (10 + i % 8) << "</max_level>\n"
+                << "    <cache_policy usage=\"read_write\"/>\n"
+                << "    <!-- layer " << i << " -->\n"
+                << "  </" << type << ">\n";
+        }
+
+        out << "</map>\n";
+        return out.str();
+    }
+
+    // Touches every layer's properties with keyed lookups, the way the
+    // options constructors do.
+    unsigned lookupAll(const Config& doc)
+    {
+        unsigned hits = 0;
+        const Config& map = doc.child("map");
+        const ConfigSet& layers = map.children();
+        for (ConfigSet::const_iterator i = layers.begin(); i != layers.end(); ++i)
+        {
+            if (i->hasValue("url"))        ++hits;
+            if (i->hasValue("tile_size"))  ++hits;
+            if (i->hasValue("max_level"))  ++hits;
+            if (i->hasChild("cache_policy")) ++hits;
+            if (i->hasValue("not_there"))  ++hits;
+        }
+        // top-level lookups scan thousands of siblings without the index
+        for (unsigned n = 0; n < 1000; ++n)
+        {
+            if (map.hasChild("options")) ++hits;
+            if (map.hasChild("extensions")) ++hits;
+        }
+        return hits;
+    }
+}
+
+int
+benchmarkEarth(osg::ArgumentParser& args)
+{
+    unsigned numLayers = 5000u;
+    args.read("--layers", numLayers);
+
+    unsigned iterations = 5u;
+    args.read("--iterations", iterations);
+
+    std::string xml = makeSyntheticEarthFile(numLayers);
+    OE_NOTICE << LC << numLayers << " layers, " << (xml.size()/1024) << " KB" << std::endl;
+
+    osg::Timer* timer = osg::Timer::instance();
+    double legacyParse = 0.0, fastParse = 0.0, legacyLookup = 0.0, fastLookup = 0.0;
+    unsigned legacyHits = 0, fastHits = 0;
+
+    for (unsigned it = 0; it < iterations; ++it)
+    {
+        // XmlDocument DOM followed by a conversion to Config
+        {
+            std::stringstream in(xml);
+            osg::Timer_t t0 = timer->tick();
+            osg::ref_ptr<XmlDocument> doc = XmlDocument::load(in);
+            Config conf = doc.valid() ? doc->getConfig() : Config();
+            osg::Timer_t t1 = timer->tick();
+            legacyHits = lookupAll(conf);
+            osg::Timer_t t2 = timer->tick();
+            legacyParse  += timer->delta_s(t0, t1);
+            legacyLookup += timer->delta_s(t1, t2);
+        }
+
+        // Direct to Config, with child indexes
+        {
+            std::stringstream in(xml);
+            osg::Timer_t t0 = timer->tick();
+            Config conf;
+            XmlDocument::loadConfig(in, URIContext(), conf);
+            osg::Timer_t t1 = timer->tick();
+            fastHits = lookupAll(conf);
+            osg::Timer_t t2 = timer->tick();
+            fastParse  += timer->delta_s(t0, t1);
+            fastLookup += timer->delta_s(t1, t2);
+        }
+    }
+
+    if (legacyHits != fastHits)
+    {
+        OE_WARN << LC << "Lookup mismatch: " << legacyHits << " vs " << fastHits << std::endl;
+        return -1;
+    }
+
+    double n = (double)iterations;
+    OE_NOTICE << LC << "average of " << iterations << " runs:\n"
+        << "  XmlDocument + getConfig : parse " << 1000.0*legacyParse/n << " ms, lookup " << 1000.0*legacyLookup/n << " ms\n"
+        << "  XmlDocument::loadConfig : parse " << 1000.0*fastParse/n   << " ms, lookup " << 1000.0*fastLookup/n   << " ms\n"
+        << std::endl;
+
+    return 0;
+}
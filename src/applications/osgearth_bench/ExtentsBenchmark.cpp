@@ -0,0 +1,155 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmarks"
+#include <osgEarth/DataExtentIndex>
+#include <osgEarth/Profile>
+#include <osgEarth/TileKey>
+#include <cstdlib>
+
+#define LC "[bench extents] "
+
+using namespace osgEarth;
+
+namespace
+{
+    double random01()
+    {
+        return (double)::rand() / ((double)RAND_MAX + 1.0);
+    }
+
+    // Same test TerrainLayer::getBestAvailableTileKey makes on each extent
+    bool hasData(const TileKey& key, const DataExtent& extent)
+    {
+        if (!key.getExtent().intersects(extent))
+            return false;
+        return !extent.minLevel().isSet() || key.getLOD() >= extent.minLevel().get();
+    }
+}
+
+int
+benchmarkExtents(osg::ArgumentParser& args)
+{
+    unsigned count = 10000u;
+    args.read("--count", count);
+
+    unsigned queries = 10000u;
+    args.read("--queries", queries);
+
+    unsigned lod = 10u;
+    args.read("--lod", lod);
+
+    ::srand(42);
+
+    // Scattered patches of data, a few degrees across, like a collection
+    // of local high-resolution surveys:
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+    const SpatialReference* srs = profile->getSRS();
+
+    DataExtentList extents;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        double w = -180.0 + 360.0 * random01();
+        double s = -85.0 + 170.0 * random01();
+        double width = 0.01 + 2.0 * random01();
+        double height = 0.01 + 2.0 * random01();
+        extents.push_back(DataExtent(GeoExtent(srs, w, s, w + width, s + height), 0u, 8u + (i % 12u)));
+    }
+
+    unsigned tx, ty;
+    profile->getNumTiles(lod, tx, ty);
+
+    std::vector<TileKey> keys;
+    keys.reserve(queries);
+    for (unsigned i = 0; i < queries; ++i)
+    {
+        unsigned x = osg::minimum((unsigned)(random01() * tx), tx - 1u);
+        unsigned y = osg::minimum((unsigned)(random01() * ty), ty - 1u);
+        keys.push_back(TileKey(lod, x, y, profile.get()));
+    }
+
+    // Linear scan over every extent:
+    std::vector<unsigned> linearHits(queries, 0u);
+    osg::Timer_t t0 = osg::Timer::instance()->tick();
+    for (unsigned q = 0; q < queries; ++q)
+    {
+        for (unsigned i = 0; i < extents.size(); ++i)
+        {
+            if (hasData(keys[q], extents[i]))
+                ++linearHits[q];
+        }
+    }
+    osg::Timer_t t1 = osg::Timer::instance()->tick();
+
+    // Index construction (the tree for the profile SRS is built by the first query):
+    osg::ref_ptr<DataExtentIndex> index = new DataExtentIndex(extents, profile.get());
+    std::vector<unsigned> candidates;
+    index->getCandidates(profile->getExtent(), candidates);
+    osg::Timer_t t2 = osg::Timer::instance()->tick();
+
+    // Bitmap reject, then exact tests on the R-tree candidates:
+    std::vector<unsigned> indexedHits(queries, 0u);
+    unsigned rejected = 0u;
+    unsigned numCandidates = 0u;
+    for (unsigned q = 0; q < queries; ++q)
+    {
+        if (!index->mayIntersect(keys[q]))
+        {
+            ++rejected;
+            continue;
+        }
+
+        candidates.clear();
+        numCandidates += index->getCandidates(keys[q].getExtent(), candidates);
+        for (unsigned i = 0; i < candidates.size(); ++i)
+        {
+            if (hasData(keys[q], extents[candidates[i]]))
+                ++indexedHits[q];
+        }
+    }
+    osg::Timer_t t3 = osg::Timer::instance()->tick();
+
+    unsigned mismatches = 0u, withData = 0u;
+    for (unsigned q = 0; q < queries; ++q)
+    {
+        if (linearHits[q] != indexedHits[q])
+            ++mismatches;
+        if (linearHits[q] > 0u)
+            ++withData;
+    }
+
+    double n = (double)queries;
+    double linear = osg::Timer::instance()->delta_u(t0, t1) / n;
+    double build = osg::Timer::instance()->delta_m(t1, t2);
+    double indexed = osg::Timer::instance()->delta_u(t2, t3) / n;
+
+    OE_NOTICE << LC << count << " extents, " << queries << " keys at LOD " << lod << " (" << withData << " with data):\n"
+        << "  linear scan     = " << linear << " us/query\n"
+        << "  indexed         = " << indexed << " us/query\n"
+        << "  index build     = " << build << " ms\n"
+        << "  speedup         = " << (indexed > 0.0 ? linear / indexed : 0.0) << "x\n"
+        << "  bitmap rejects  = " << rejected << "\n"
+        << "  candidates/key  = " << (queries > rejected ? (double)numCandidates / (double)(queries - rejected) : 0.0) << "\n"
+        << "  mismatches      = " << mismatches << "\n"
+        << std::endl;
+
+    return mismatches == 0u ? 0 : -1;
+}
@@ -0,0 +1,159 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmarks"
+#include <osgEarth/Map>
+#include <osgEarth/ElevationLayer>
+#include <osgEarth/Random>
+#include <osgEarthUtil/FlatteningLayer>
+#include <osgEarthDrivers/gdal/GDALOptions>
+#include <osgEarthDrivers/feature_ogr/OGRFeatureOptions>
+#include <fstream>
+#include <iomanip>
+
+#define LC "[bench flatten] "
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+using namespace osgEarth::Features;
+using namespace osgEarth::Drivers;
+
+namespace
+{
+    // Writes a synthetic road network: random-walk polylines around a center point.
+    void writeRoads(const std::string& filename, const osg::Vec3d& center, double size, unsigned numRoads)
+    {
+        Random prng(1234);
+        std::ofstream out(filename.c_str());
+        out << std::setprecision(10) << "{\"type\":\"FeatureCollection\",\"features\":[\n";
+        for (unsigned r = 0; r < numRoads; ++r)
+        {
+            double x = center.x() + (prng.next() - 0.5) * size;
+            double y = center.y() + (prng.next() - 0.5) * size;
+            double heading = prng.next() * 2.0 * osg::PI;
+
+            out << (r > 0 ? ",\n" : "")
+                << "{\"type\":\"Feature\",\"properties\":{},\"geometry\":{\"type\":\"LineString\",\"coordinates\":[";
+            for (unsigned v = 0; v < 20; ++v)
+            {
+                out << (v > 0 ? "," : "") << "[" << x << "," << y << "]";
+                heading += (prng.next() - 0.5) * 0.5;
+                x += cos(heading) * size * 0.005;
+                y += sin(heading) * size * 0.005;
+            }
+            out << "]}}";
+        }
+        out << "\n]}\n";
+    }
+}
+
+int
+benchmarkFlatten(osg::ArgumentParser& args)
+{
+    std::string input;
+    if (!args.read("--in", input))
+    {
+        OE_WARN << LC << "Specify a local elevation GeoTIFF with --in <file>" << std::endl;
+        return -1;
+    }
+
+    unsigned numRoads = 2000u;
+    args.read("--roads", numRoads);
+
+    unsigned lod = 14u;
+    args.read("--lod", lod);
+
+    unsigned numTiles = 4u;
+    args.read("--tiles", numTiles);
+
+    std::string roadsFile = "osgearth_bench_roads.geojson";
+    args.read("--out", roadsFile);
+
+    GDALOptions gdal;
+    gdal.url() = URI(input);
+
+    osg::ref_ptr<Map> map = new Map();
+    osg::ref_ptr<ElevationLayer> elevation = new ElevationLayer(ElevationLayerOptions("bench", gdal));
+    map->addLayer(elevation.get());
+
+    if (elevation->getStatus().isError())
+    {
+        OE_WARN << LC << "Failed to open " << input << ": " << elevation->getStatus().message() << std::endl;
+        return -1;
+    }
+
+    // roads cover a numTiles x numTiles block of tiles around the center of the data
+    const Profile* profile = map->getProfile();
+    GeoPoint center;
+    elevation->getProfile()->getExtent().getCentroid(center);
+    center = center.transform(profile->getSRS()->getGeographicSRS());
+
+    TileKey centerKey = profile->createTileKey(center.x(), center.y(), lod);
+    double size = centerKey.getExtent().width() * (double)numTiles;
+
+    writeRoads(roadsFile, center.vec3d(), size, numRoads);
+
+    OGRFeatureOptions ogr;
+    ogr.url() = URI(roadsFile);
+
+    FlatteningLayerOptions flatOptions;
+    flatOptions.name() = "flatten";
+    flatOptions.featureSource() = ogr;
+    flatOptions.lineWidth() = NumericExpression(8.0);
+    flatOptions.bufferWidth() = NumericExpression(12.0);
+    flatOptions.cachePolicy() = CachePolicy::NO_CACHE;
+
+    osg::ref_ptr<FlatteningLayer> flatten = new FlatteningLayer(flatOptions);
+    map->addLayer(flatten.get());
+
+    if (flatten->getStatus().isError())
+    {
+        OE_WARN << LC << "Failed to open flattening layer: " << flatten->getStatus().message() << std::endl;
+        return -1;
+    }
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    unsigned count = 0u;
+    int half = (int)numTiles / 2;
+    for (int dy = -half; dy < (int)numTiles - half; ++dy)
+    {
+        for (int dx = -half; dx < (int)numTiles - half; ++dx)
+        {
+            TileKey key(lod, centerKey.getTileX() + dx, centerKey.getTileY() + dy, profile);
+            GeoHeightField hf = flatten->createHeightField(key, 0L);
+            if (hf.valid())
+                ++count;
+        }
+    }
+
+    double seconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    OE_NOTICE << LC << "flattened " << numRoads << " roads over " << input << ":\n"
+        << "  lod             = " << lod << "\n"
+        << "  tiles           = " << count << " of " << numTiles*numTiles << "\n"
+        << "  time            = " << seconds << " s\n"
+        << "  ms/tile         = " << (numTiles > 0 ? 1000.0 * seconds / (double)(numTiles*numTiles) : 0.0) << "\n"
+        << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmarks"
+#include <osgEarth/ObjectIndex>
+#include <osgEarthFeatures/FeatureSourceIndexNode>
+#include <osg/Geometry>
+#include <OpenThreads/Thread>
+#include <fstream>
+
+#define LC "[bench index] "
+
+using namespace osgEarth;
+using namespace osgEarth::Features;
+
+namespace
+{
+    // Resident memory of this process in bytes, or 0 where unavailable.
+    double residentBytes()
+    {
+        std::ifstream statm("/proc/self/statm");
+        double pages = 0.0, resident = 0.0;
+        if (statm >> pages >> resident)
+            return resident * 4096.0;
+        return 0.0;
+    }
+
+    // A paging thread: tags its own features, one tile at a time, into its
+    // own FeatureSourceIndex over the shared master index, then pages them out.
+    struct TagThread : public OpenThreads::Thread
+    {
+        ObjectIndex* _master;
+        unsigned     _numFeatures;
+        unsigned     _perTile;
+        FeatureID    _firstFID;
+
+        void run()
+        {
+            osg::ref_ptr<osg::Geometry> geom = new osg::Geometry();
+            geom->setVertexArray(new osg::Vec3Array(1));
+
+            FeatureSourceIndexOptions options;
+            options.embedFeatures() = true;
+            osg::ref_ptr<FeatureSourceIndex> index = new FeatureSourceIndex(0L, _master, options);
+
+            std::vector< osg::ref_ptr<FeatureSourceIndexNode> > tiles;
+            for (unsigned i = 0; i < _numFeatures; ++i)
+            {
+                if (i % _perTile == 0u)
+                    tiles.push_back(new FeatureSourceIndexNode(index.get()));
+                osg::ref_ptr<Feature> feature = new Feature(0L, 0L);
+                feature->setFID(_firstFID + i);
+                tiles.back()->tagDrawable(geom.get(), feature.get());
+            }
+            tiles.clear();
+        }
+    };
+
+int
+benchmarkIndex(osg::ArgumentParser& args)
+{
+    unsigned numFeatures = 1000000u;
+    args.read("--features", numFeatures);
+
+    unsigned perTile = 5000u;
+    args.read("--per-tile", perTile);
+    if (perTile == 0u) perTile = 1u;
+
+    unsigned numThreads = 8u;
+    args.read("--threads", numThreads);
+    if (numThreads == 0u) numThreads = 1u;
+
+    // features and geometry exist before the index does, so only
+    // the index's own allocations show up in the measurement.
+    std::vector< osg::ref_ptr<Feature> > features(numFeatures);
+    for (unsigned i = 0; i < numFeatures; ++i)
+    {
+        features[i] = new Feature(0L, 0L);
+        features[i]->setFID(i);
+    }
+
+    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry();
+    geom->setVertexArray(new osg::Vec3Array(1));
+
+    osg::ref_ptr<ObjectIndex> master = new ObjectIndex();
+    FeatureSourceIndexOptions options;
+    options.embedFeatures() = true;
+
+    double before = residentBytes();
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    osg::ref_ptr<FeatureSourceIndex> index = new FeatureSourceIndex(0L, master.get(), options);
+
+    // one index node per "tile", as FeatureModelGraph builds them
+    std::vector< osg::ref_ptr<FeatureSourceIndexNode> > tiles;
+    for (unsigned i = 0; i < numFeatures; ++i)
+    {
+        if (i % perTile == 0u)
+            tiles.push_back(new FeatureSourceIndexNode(index.get()));
+        tiles.back()->tagDrawable(geom.get(), features[i].get());
+    }
+
+    double tagSeconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    double after = residentBytes();
+
+    // picking: ObjectID to Feature, through the master index
+    start = osg::Timer::instance()->tick();
+    unsigned found = 0u;
+    for (unsigned i = 0; i < numFeatures; ++i)
+    {
+        ObjectID oid = index->getObjectID(i);
+        osg::ref_ptr<FeatureIndex> fi = master->get<FeatureIndex>(oid);
+        if (fi.valid() && fi->getFeature(oid) == features[i].get())
+            ++found;
+    }
+    double pickSeconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    // paging out
+    start = osg::Timer::instance()->tick();
+    tiles.clear();
+    double removeSeconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    // many paging threads tagging into the same master index at once
+    std::vector<TagThread*> threads(numThreads);
+    start = osg::Timer::instance()->tick();
+    for (unsigned t = 0; t < numThreads; ++t)
+    {
+        threads[t] = new TagThread();
+        threads[t]->_master = master.get();
+        threads[t]->_numFeatures = numFeatures / numThreads;
+        threads[t]->_perTile = perTile;
+        threads[t]->_firstFID = t * (numFeatures / numThreads);
+        threads[t]->start();
+    }
+    for (unsigned t = 0; t < numThreads; ++t)
+    {
+        threads[t]->join();
+        delete threads[t];
+    }
+    double threadSeconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    unsigned threadTags = numThreads * (numFeatures / numThreads);
+
+    OE_NOTICE << LC << "indexed " << numFeatures << " features in tiles of " << perTile << ":\n"
+        << "  tag time        = " << tagSeconds << " s\n"
+        << "  lookups found   = " << found << " of " << numFeatures << "\n"
+        << "  us/lookup       = " << (numFeatures > 0 ? 1e6 * pickSeconds / (double)numFeatures : 0.0) << "\n"
+        << "  remove time     = " << removeSeconds << " s\n"
+        << "  bytes/feature   = " << (after > 0.0 && numFeatures > 0 ? (after - before) / (double)numFeatures : 0.0)
+        << " (resident, including the master index)\n"
+        << "  threads         = " << numThreads << "\n"
+        << "  threaded tags/s = " << (threadSeconds > 0.0 ? (double)threadTags / threadSeconds : 0.0)
+        << " (tag and page out)\n"
+        << std::endl;
+
+    return found == numFeatures ? 0 : -1;
+}
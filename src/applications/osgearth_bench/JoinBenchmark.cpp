@@ -0,0 +1,186 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmarks"
+#include <osgEarthFeatures/BoundaryIndex>
+#include <osgEarth/SpatialReference>
+#include <cmath>
+#include <cstdlib>
+
+#define LC "[bench join] "
+
+using namespace osgEarth;
+using namespace osgEarth::Features;
+
+namespace
+{
+    double random01()
+    {
+        return (double)::rand() / ((double)RAND_MAX + 1.0);
+    }
+
+    // Irregular 16-sided polygon around a center
+    Polygon* makeBoundary(double cx, double cy, double radius)
+    {
+        Polygon* poly = new Polygon();
+        for (unsigned i = 0; i < 16; ++i)
+        {
+            double a = 2.0 * osg::PI * (double)i / 16.0;
+            double r = radius * (0.6 + 0.4 * random01());
+            poly->push_back(osg::Vec3d(cx + r * cos(a), cy + r * sin(a), 0.0));
+        }
+        return poly;
+    }
+
+    // The old filters: every feature against every boundary.
+    const Feature* findContainingLinear(const FeatureList& boundaries, double x, double y)
+    {
+        for (FeatureList::const_iterator i = boundaries.begin(); i != boundaries.end(); ++i)
+        {
+            const Ring* ring = dynamic_cast<const Ring*>(i->get()->getGeometry());
+            if (ring && ring->contains2D(x, y))
+                return i->get();
+        }
+        return 0L;
+    }
+
+    const Feature* findIntersectingLinear(const FeatureList& boundaries, const Geometry* geom)
+    {
+        for (FeatureList::const_iterator i = boundaries.begin(); i != boundaries.end(); ++i)
+        {
+            if (i->get()->getGeometry()->intersects(geom))
+                return i->get();
+        }
+        return 0L;
+    }
+}
+
+int
+benchmarkJoin(osg::ArgumentParser& args)
+{
+    unsigned numPoints = 100000u;
+    args.read("--points", numPoints);
+
+    unsigned numPolygons = 5000u;
+    args.read("--polygons", numPolygons);
+
+    // the linear scans only run on the first few points; they are too slow for all of them
+    unsigned sample = 1000u;
+    args.read("--sample", sample);
+    sample = osg::minimum(sample, numPoints);
+
+    ::srand(7);
+
+    const SpatialReference* srs = SpatialReference::get("wgs84");
+
+    // Boundaries scattered over a 100 x 50 degree area, about 40% coverage:
+    FeatureList boundaries;
+    double radius = sqrt(0.4 * 100.0 * 50.0 / (osg::PI * 0.5 * (double)numPolygons));
+    for (unsigned i = 0; i < numPolygons; ++i)
+    {
+        Feature* f = new Feature(makeBoundary(100.0 * random01(), 50.0 * random01(), radius), srs);
+        f->set("zone", (int)i);
+        boundaries.push_back(f);
+    }
+
+    std::vector< osg::ref_ptr<PointSet> > points;
+    points.reserve(numPoints);
+    for (unsigned i = 0; i < numPoints; ++i)
+    {
+        PointSet* p = new PointSet();
+        p->push_back(osg::Vec3d(100.0 * random01(), 50.0 * random01(), 0.0));
+        points.push_back(p);
+    }
+
+    osg::Timer_t t0 = osg::Timer::instance()->tick();
+    osg::ref_ptr<BoundaryIndex> index = new BoundaryIndex(boundaries);
+    osg::Timer_t t1 = osg::Timer::instance()->tick();
+
+    // Intersect filter test (centroid in polygon):
+    unsigned linearContained = 0u;
+    for (unsigned i = 0; i < sample; ++i)
+    {
+        if (findContainingLinear(boundaries, points[i]->front().x(), points[i]->front().y()))
+            ++linearContained;
+    }
+    osg::Timer_t t2 = osg::Timer::instance()->tick();
+
+    unsigned indexedContained = 0u, sampleContained = 0u, mismatches = 0u;
+    for (unsigned i = 0; i < numPoints; ++i)
+    {
+        const osg::Vec3d& p = points[i]->front();
+        const Feature* hit = index->findContaining(p.x(), p.y());
+        if (hit)
+            ++indexedContained;
+        if (i < sample)
+        {
+            if (hit)
+                ++sampleContained;
+            if (hit != findContainingLinear(boundaries, p.x(), p.y()))
+                ++mismatches;
+        }
+    }
+    osg::Timer_t t3 = osg::Timer::instance()->tick();
+
+    // Join filter test (geometry intersection):
+    unsigned linearJoined = 0u;
+    for (unsigned i = 0; i < sample; ++i)
+    {
+        if (findIntersectingLinear(boundaries, points[i].get()))
+            ++linearJoined;
+    }
+    osg::Timer_t t4 = osg::Timer::instance()->tick();
+
+    unsigned indexedJoined = 0u, sampleJoined = 0u;
+    for (unsigned i = 0; i < numPoints; ++i)
+    {
+        if (index->findIntersecting(points[i].get()))
+        {
+            ++indexedJoined;
+            if (i < sample)
+                ++sampleJoined;
+        }
+    }
+    osg::Timer_t t5 = osg::Timer::instance()->tick();
+
+    const osg::Timer* timer = osg::Timer::instance();
+
+    // subtract the verification scan from the indexed containment time:
+    double containLinear  = timer->delta_u(t1, t2) / (double)sample;
+    double containIndexed = (timer->delta_u(t2, t3) - timer->delta_u(t1, t2)) / (double)numPoints;
+    double joinLinear     = timer->delta_u(t3, t4) / (double)sample;
+    double joinIndexed    = timer->delta_u(t4, t5) / (double)numPoints;
+
+    OE_NOTICE << LC << numPoints << " points, " << numPolygons << " polygons (linear scans on " << sample << " points):\n"
+        << "  index build         = " << timer->delta_m(t0, t1) << " ms\n"
+        << "  contains, linear    = " << containLinear << " us/feature\n"
+        << "  contains, indexed   = " << containIndexed << " us/feature\n"
+        << "  contains, speedup   = " << (containIndexed > 0.0 ? containLinear / containIndexed : 0.0) << "x\n"
+        << "  intersects, linear  = " << joinLinear << " us/feature\n"
+        << "  intersects, indexed = " << joinIndexed << " us/feature\n"
+        << "  intersects, speedup = " << (joinIndexed > 0.0 ? joinLinear / joinIndexed : 0.0) << "x\n"
+        << "  contained           = " << indexedContained << " (sample: " << sampleContained << " indexed, " << linearContained << " linear)\n"
+        << "  joined              = " << indexedJoined << " (sample: " << sampleJoined << " indexed, " << linearJoined << " linear)\n"
+        << "  mismatches          = " << mismatches << "\n"
+        << std::endl;
+
+    return mismatches == 0u && sampleJoined == linearJoined ? 0 : -1;
+}
@@ -0,0 +1,141 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmarks"
+#include <osgEarth/MapNode>
+#include <osgEarth/Memory>
+#include <osgEarth/StringUtils>
+#include <osgEarthDrivers/kml/KML>
+#include <osg/NodeVisitor>
+#include <fstream>
+
+#define LC "[bench kml] "
+
+using namespace osgEarth;
+using namespace osgEarth::Drivers;
+
+namespace
+{
+    // Writes a KML document with styles, folders, and a mix of point
+    // and line placemarks scattered over the globe.
+    void writeSyntheticKML(const std::string& path, unsigned numPlacemarks)
+    {
+        std::ofstream out(path.c_str());
+        out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            << "<kml xmlns=\"http://www.opengis.net/kml/2.2\">\n"
+            << "<Document>\n<name>synthetic</name>\n";
+
+        for (unsigned s = 0; s < 8; ++s)
+        {
+            out << "<Style id=\"s" << s << "\"><LineStyle><color>ff0000ff</color><width>2</width></LineStyle>"
+                << "<LabelStyle><scale>0." << (s+2) << "</scale></LabelStyle></Style>\n";
+        }
+
+        const unsigned perFolder = 1000u;
+        for (unsigned i = 0; i < numPlacemarks; ++i)
+        {
+            if (i % perFolder == 0)
+            {
+                if (i > 0) out << "</Folder>\n";
+                out << "<Folder><name>folder " << (i / perFolder) << "</name>\n";
+            }
+
+            double lon = -180.0 + 360.0 * (double)((i * 7919u) % 100000u) / 100000.0;
+            double lat =  -80.0 + 160.0 * (double)((i * 104729u) % 100000u) / 100000.0;
+
+            out << "<Placemark><name>pm" << i << "</name><styleUrl>#s" << (i % 8) << "</styleUrl>";
+            if (i % 10 == 0)
+            {
+                out << "<LineString><tessellate>1</tessellate><coordinates>"
+                    << lon << "," << lat << ",0 " << lon + 0.01 << "," << lat + 0.01 << ",0 "
+                    << lon + 0.02 << "," << lat << ",0</coordinates></LineString>";
+            }
+            else
+            {
+                out << "<Point><coordinates>" << lon << "," << lat << ",0</coordinates></Point>";
+            }
+            out << "</Placemark>\n";
+        }
+        if (numPlacemarks > 0) out << "</Folder>\n";
+
+        out << "</Document>\n</kml>\n";
+    }
+
+    struct CountNodes : public osg::NodeVisitor
+    {
+        unsigned _count;
+        CountNodes() : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN), _count(0) { }
+        void apply(osg::Node& node) { ++_count; traverse(node); }
+    };
+}
+
+int
+benchmarkKML(osg::ArgumentParser& args)
+{
+    unsigned numPlacemarks = 100000u;
+    args.read("--placemarks", numPlacemarks);
+
+    std::string path = "osgearth_bench.kml";
+    args.read("--file", path);
+
+    // Peak memory is process-wide, so only run one reader per invocation.
+    bool streaming = args.read("--streaming");
+
+    if (!args.read("--reuse"))
+    {
+        OE_NOTICE << LC << "Writing " << numPlacemarks << " placemarks to " << path << std::endl;
+        writeSyntheticKML(path, numPlacemarks);
+    }
+
+    osg::ref_ptr<MapNode> mapNode = new MapNode(new Map());
+
+    KMLOptions kmlOptions;
+    kmlOptions.declutter() = false;
+    kmlOptions.streaming() = streaming;
+    args.read("--batch-size", kmlOptions.streamingBatchSize().mutable_value());
+    args.read("--threads", kmlOptions.streamingNumThreads().mutable_value());
+
+    unsigned memBefore = Memory::getProcessPhysicalUsage();
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    osg::ref_ptr<osg::Node> node = KML::load(URI(path), mapNode.get(), kmlOptions);
+
+    double seconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    unsigned memPeak = Memory::getProcessPeakPhysicalUsage();
+
+    if (!node.valid())
+    {
+        OE_WARN << LC << "Failed to load " << path << std::endl;
+        return -1;
+    }
+
+    CountNodes counter;
+    node->accept(counter);
+
+    OE_NOTICE << LC << (streaming ? "streaming" : "DOM") << " reader:\n"
+        << "  time        = " << seconds << " s\n"
+        << "  nodes       = " << counter._count << "\n"
+        << "  memory      = " << (memBefore/1048576) << " MB before, " << (memPeak/1048576) << " MB peak\n"
+        << std::endl;
+
+    return 0;
+}
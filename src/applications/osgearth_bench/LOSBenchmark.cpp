@@ -0,0 +1,141 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmarks"
+#include <osgEarth/Map>
+#include <osgEarth/ElevationLayer>
+#include <osgEarth/ElevationPool>
+#include <osgEarthUtil/ElevationPyramid>
+#include <osgEarthDrivers/gdal/GDALOptions>
+#include <algorithm>
+
+#define LC "[bench los] "
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+using namespace osgEarth::Drivers;
+
+int
+benchmarkLOS(osg::ArgumentParser& args)
+{
+    std::string input;
+    if (!args.read("--in", input))
+    {
+        OE_WARN << LC << "Specify a local elevation GeoTIFF with --in <file>" << std::endl;
+        return -1;
+    }
+
+    unsigned rays = 3600u;
+    args.read("--rays", rays);
+
+    double radius = 5000.0;
+    args.read("--radius", radius);
+
+    unsigned lod = 14u;
+    args.read("--lod", lod);
+
+    double height = 2.0;
+    args.read("--height", height);
+
+    unsigned iterations = 10u;
+    args.read("--iterations", iterations);
+
+    GDALOptions gdal;
+    gdal.url() = URI(input);
+
+    osg::ref_ptr<Map> map = new Map();
+    osg::ref_ptr<ElevationLayer> layer = new ElevationLayer(ElevationLayerOptions("bench", gdal));
+    map->addLayer(layer.get());
+
+    if (layer->getStatus().isError())
+    {
+        OE_WARN << LC << "Failed to open " << input << ": " << layer->getStatus().message() << std::endl;
+        return -1;
+    }
+
+    // observer at the center of the data extent, standing on the terrain
+    GeoPoint centroid;
+    if (!layer->getDataExtents().empty())
+        layer->getDataExtentsUnion().getCentroid(centroid);
+    else
+        layer->getProfile()->getExtent().getCentroid(centroid);
+
+    GeoPoint center;
+    centroid.transform(map->getSRS()->getGeographicSRS(), center);
+    center.z() = height;
+    center.altitudeMode() = ALTMODE_RELATIVE;
+
+    osg::Timer_t t0 = osg::Timer::instance()->tick();
+
+    osg::ref_ptr<ElevationPyramid> pyramid = new ElevationPyramid();
+    if (!pyramid->build(map->getElevationPool(), center, radius, lod))
+    {
+        OE_WARN << LC << "Failed to sample elevation data around " << center.toString() << std::endl;
+        return -1;
+    }
+
+    osg::Timer_t t1 = osg::Timer::instance()->tick();
+
+    double elevation = 0.0;
+    pyramid->getElevation(center, elevation);
+
+    GeoPoint eye(center);
+    eye.z() += elevation;
+    eye.altitudeMode() = ALTMODE_ABSOLUTE;
+
+    osg::Vec3d eyeWorld;
+    eye.toWorld(eyeWorld);
+
+    // horizontal spokes in the tangent plane at the observer
+    osg::Matrixd local2world;
+    eye.createLocalToWorld(local2world);
+
+    std::vector<osg::Vec3d> ends(rays);
+    for (unsigned i = 0; i < rays; ++i)
+    {
+        double angle = osg::PI * 2.0 * (double)i / (double)rays;
+        ends[i] = osg::Vec3d(sin(angle)*radius, cos(angle)*radius, 0.0) * local2world;
+    }
+
+    std::vector<double> ratios;
+    unsigned blocked = 0u;
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        blocked = pyramid->intersect(eyeWorld, ends, ratios);
+    }
+
+    osg::Timer_t t2 = osg::Timer::instance()->tick();
+
+    double buildSeconds = osg::Timer::instance()->delta_s(t0, t1);
+    double querySeconds = osg::Timer::instance()->delta_s(t1, t2) / (double)std::max(iterations, 1u);
+
+    OE_NOTICE << LC << "radial line of sight over " << input << ":\n"
+        << "  samples      = " << pyramid->getNumSamples() << " x " << pyramid->getNumSamples()
+        << " (" << pyramid->getSpacing() << " m spacing)\n"
+        << "  build time   = " << buildSeconds << " s\n"
+        << "  rays         = " << rays << " (" << blocked << " blocked)\n"
+        << "  query time   = " << querySeconds * 1000.0 << " ms\n"
+        << "  rays/second  = " << (querySeconds > 0.0 ? (double)rays / querySeconds : 0.0) << "\n"
+        << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmarks"
+#include <osgEarth/Metrics>
+#include <osgEarth/TraceMetrics>
+#include <OpenThreads/Thread>
+#include <cstdio>
+#include <fstream>
+
+#define LC "[bench metrics] "
+
+using namespace osgEarth;
+
+namespace
+{
+    // Records scoped events as fast as it can and times itself.
+    struct EventThread : public OpenThreads::Thread
+    {
+        EventThread(unsigned events) : _events(events), _us(0.0), _sum(0u) { }
+
+        void run()
+        {
+            osg::Timer_t start = osg::Timer::instance()->tick();
+            for (unsigned i = 0; i < _events; ++i)
+            {
+                METRIC_SCOPED("bench.event");
+                _sum += i;
+            }
+            _us = osg::Timer::instance()->delta_u(start, osg::Timer::instance()->tick());
+        }
+
+        unsigned _events;
+        double   _us;
+        unsigned _sum;
+    };
+
+    // Average cost of one scoped event (begin + end) per thread, in nanoseconds.
+    double timeEvents(unsigned numThreads, unsigned events)
+    {
+        std::vector<EventThread*> threads;
+        for (unsigned i = 0; i < numThreads; ++i)
+            threads.push_back(new EventThread(events));
+        for (unsigned i = 0; i < numThreads; ++i)
+            threads[i]->start();
+
+        double total = 0.0;
+        for (unsigned i = 0; i < numThreads; ++i)
+        {
+            threads[i]->join();
+            total += threads[i]->_us;
+            delete threads[i];
+        }
+        return 1000.0 * total / ((double)numThreads * (double)events);
+    }
+
+    double fileSize(const std::string& name)
+    {
+        std::ifstream in(name.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+        return in.is_open() ? (double)in.tellg() : 0.0;
+    }
+}
+
+int
+benchmarkMetrics(osg::ArgumentParser& args)
+{
+    unsigned numThreads = 32u;
+    args.read("--threads", numThreads);
+
+    unsigned events = 100000u;
+    args.read("--events", events);
+
+    std::string prefix = "bench_metrics";
+    args.read("--out", prefix);
+
+    std::string chromeFile = prefix + ".json";
+    std::string traceFile = prefix + ".oetrace";
+
+    osg::ref_ptr<MetricsBackend> saved = Metrics::getMetricsBackend();
+
+    Metrics::setMetricsBackend(0L);
+    double disabled = timeEvents(numThreads, events);
+
+    Metrics::setMetricsBackend(new ChromeMetricsBackend(chromeFile));
+    double chrome = timeEvents(numThreads, events);
+    Metrics::setMetricsBackend(0L);
+
+    // enough room per thread that nothing is dropped between drains
+    osg::ref_ptr<TraceMetricsBackend> trace = new TraceMetricsBackend(traceFile, 1u << 20);
+    Metrics::setMetricsBackend(trace.get());
+    double binary = timeEvents(numThreads, events);
+    Metrics::setMetricsBackend(0L);
+    unsigned dropped = trace->getNumDropped();
+    trace = 0L;
+
+    Metrics::setMetricsBackend(saved.get());
+
+    OE_NOTICE << LC << numThreads << " threads x " << events << " scoped events:\n"
+        << "  disabled        = " << disabled << " ns/event\n"
+        << "  chrome json     = " << chrome << " ns/event, " << fileSize(chromeFile) / 1048576.0 << " MB\n"
+        << "  binary trace    = " << binary << " ns/event, " << fileSize(traceFile) / 1048576.0 << " MB\n"
+        << "  speedup         = " << (binary > 0.0 ? chrome / binary : 0.0) << "x\n"
+        << "  dropped         = " << dropped << "\n"
+        << std::endl;
+
+    ::remove(chromeFile.c_str());
+    ::remove(traceFile.c_str());
+
+    return 0;
+}
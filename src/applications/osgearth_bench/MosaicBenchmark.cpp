@@ -0,0 +1,131 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmarks"
+#include <osgEarth/Map>
+#include <osgEarth/ImageLayer>
+#include <osgEarth/Registry>
+#include <osgEarthDrivers/gdal/GDALOptions>
+
+#define LC "[bench mosaic] "
+
+using namespace osgEarth;
+using namespace osgEarth::Drivers;
+
+namespace
+{
+    // Reprojects every key from a fresh layer and returns the total time in ms,
+    // or a negative number if the layer failed to open.
+    double reprojectTiles(const std::string& input, unsigned cacheSize,
+                          const std::vector<TileKey>& keys, unsigned& out_images)
+    {
+        GDALOptions gdal;
+        gdal.url() = URI(input);
+
+        ImageLayerOptions options("bench", gdal);
+        options.mosaicCacheSize() = cacheSize;
+
+        osg::ref_ptr<Map> map = new Map();
+        osg::ref_ptr<ImageLayer> layer = new ImageLayer(options);
+        map->addLayer(layer.get());
+
+        if (layer->getStatus().isError())
+        {
+            OE_WARN << LC << "Failed to open " << input << ": " << layer->getStatus().message() << std::endl;
+            return -1.0;
+        }
+
+        out_images = 0u;
+        osg::Timer_t t0 = osg::Timer::instance()->tick();
+        for (unsigned i = 0; i < keys.size(); ++i)
+        {
+            GeoImage image = layer->createImage(keys[i]);
+            if (image.valid())
+                ++out_images;
+        }
+        return osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick());
+    }
+}
+
+int
+benchmarkMosaic(osg::ArgumentParser& args)
+{
+    std::string input;
+    if (!args.read("--in", input))
+    {
+        OE_WARN << LC << "Specify a local geographic GeoTIFF with --in <file>" << std::endl;
+        return -1;
+    }
+
+    unsigned lod = 6u;
+    args.read("--lod", lod);
+
+    unsigned maxTiles = 256u;
+    args.read("--tiles", maxTiles);
+
+    unsigned cacheSize = 16u;
+    args.read("--cache", cacheSize);
+
+    // Request the tiles in spherical mercator so that every one of them
+    // has to be mosaiced from the layer's own tiles and reprojected.
+    const Profile* mercator = Registry::instance()->getSphericalMercatorProfile();
+
+    GDALOptions gdal;
+    gdal.url() = URI(input);
+    osg::ref_ptr<Map> probeMap = new Map();
+    osg::ref_ptr<ImageLayer> probe = new ImageLayer(ImageLayerOptions("probe", gdal));
+    probeMap->addLayer(probe.get());
+    if (probe->getStatus().isError())
+    {
+        OE_WARN << LC << "Failed to open " << input << ": " << probe->getStatus().message() << std::endl;
+        return -1;
+    }
+
+    GeoExtent extent = probe->getDataExtents().empty() ?
+        probe->getProfile()->getExtent() :
+        probe->getDataExtentsUnion();
+
+    std::vector<TileKey> keys;
+    mercator->getIntersectingTiles(extent, lod, keys);
+    if (keys.size() > maxTiles)
+        keys.resize(maxTiles);
+
+    if (keys.empty())
+    {
+        OE_WARN << LC << "No tiles at LOD " << lod << std::endl;
+        return -1;
+    }
+
+    unsigned uncachedImages, cachedImages;
+    double uncached = reprojectTiles(input, 0u, keys, uncachedImages);
+    double cached = reprojectTiles(input, cacheSize, keys, cachedImages);
+    if (uncached < 0.0 || cached < 0.0)
+        return -1;
+
+    double n = (double)keys.size();
+    OE_NOTICE << LC << keys.size() << " spherical mercator tiles at LOD " << lod << ":\n"
+        << "  no source tile cache   = " << uncached / n << " ms/tile (" << uncachedImages << " images)\n"
+        << "  " << cacheSize << " tile source cache = " << cached / n << " ms/tile (" << cachedImages << " images)\n"
+        << "  speedup                = " << (cached > 0.0 ? uncached / cached : 0.0) << "x\n"
+        << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmarks"
+#include <osgEarth/HeightFieldUtils>
+#include <osgEarth/SpatialReference>
+#include <cstdlib>
+
+#define LC "[bench normals] "
+
+using namespace osgEarth;
+
+namespace
+{
+    osg::HeightField* makeTile(unsigned size)
+    {
+        osg::HeightField* hf = new osg::HeightField();
+        hf->allocate(size, size);
+        hf->setOrigin(osg::Vec3(-100.0f, 35.0f, 0.0f));
+        hf->setXInterval(0.25f / (float)(size - 1));
+        hf->setYInterval(0.25f / (float)(size - 1));
+        for (unsigned t = 0; t < size; ++t)
+            for (unsigned s = 0; s < size; ++s)
+                hf->setHeight(s, t, 1500.0f + 600.0f*sin(s*0.05)*cos(t*0.03) + 40.0f*sin(s*0.7 + t*0.4));
+        return hf;
+    }
+
+    // Builds the normal map "count" times and returns milliseconds per tile.
+    double timeNormalMaps(const HeightFieldNeighborhood& hood, const SpatialReference* srs, unsigned count, NormalMapStats& stats)
+    {
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        for (unsigned i = 0; i < count; ++i)
+        {
+            osg::ref_ptr<NormalMap> map = HeightFieldUtils::convertToNormalMap(hood, srs, &stats);
+        }
+        return osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick()) / (double)count;
+    }
+}
+
+int
+benchmarkNormals(osg::ArgumentParser& args)
+{
+    unsigned size = 257u;
+    args.read("--size", size);
+
+    unsigned numTiles = 200u;
+    args.read("--tiles", numTiles);
+
+    const SpatialReference* srs = SpatialReference::get("wgs84");
+
+    // A clean tile takes the row kernel; a single NO_DATA sample sends the
+    // whole tile through the per-sample neighborhood lookups.
+    HeightFieldNeighborhood clean;
+    clean._center = makeTile(size);
+
+    HeightFieldNeighborhood holed;
+    holed._center = makeTile(size);
+    holed._center->setHeight(0, 0, NO_DATA_VALUE);
+
+    NormalMapStats fastStats, slowStats;
+    double slow = timeNormalMaps(holed, srs, numTiles, slowStats);
+    double fast = timeNormalMaps(clean, srs, numTiles, fastStats);
+
+    // the hole is on the edge, so every interior sample should agree
+    osg::ref_ptr<NormalMap> a = HeightFieldUtils::convertToNormalMap(clean, srs);
+    osg::ref_ptr<NormalMap> b = HeightFieldUtils::convertToNormalMap(holed, srs);
+    int maxDiff = 0;
+    for (unsigned t = 1; t < size - 1; ++t)
+        for (unsigned s = 1; s < size - 1; ++s)
+            for (unsigned c = 0; c < 4; ++c)
+                maxDiff = osg::maximum(maxDiff, std::abs((int)a->data(s, t)[c] - (int)b->data(s, t)[c]));
+
+    OE_NOTICE << LC << numTiles << " tiles of " << size << "x" << size << ":\n"
+        << "  per-sample path = " << slow << " ms/tile\n"
+        << "  row kernel      = " << fast << " ms/tile\n"
+        << "  speedup         = " << (fast > 0.0 ? slow / fast : 0.0) << "x\n"
+        << "  max difference  = " << maxDiff << " (8-bit units)\n"
+        << "  heights         = " << fastStats._minHeight << " .. " << fastStats._maxHeight << "\n"
+        << "  curvature       = " << fastStats._minCurvature << " .. " << fastStats._maxCurvature << "\n"
+        << std::endl;
+
+    return 0;
+}
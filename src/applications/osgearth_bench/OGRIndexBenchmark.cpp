@@ -0,0 +1,148 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmarks"
+#include <osgEarth/Registry>
+#include <osgEarth/Random>
+#include <osgEarthFeatures/FeatureSource>
+#include <osgEarthFeatures/FeatureCursor>
+#include <osgEarthDrivers/feature_ogr/OGRFeatureOptions>
+#include <fstream>
+#include <iomanip>
+#include <stdio.h>
+
+#define LC "[bench ogrindex] "
+
+using namespace osgEarth;
+using namespace osgEarth::Features;
+using namespace osgEarth::Drivers;
+
+namespace
+{
+    // Writes a GeoJSON file of small random squares inside a 20 x 20 degree box.
+    void writeSquares(const std::string& filename, unsigned count)
+    {
+        Random prng(1234);
+        std::ofstream out(filename.c_str());
+        out << std::setprecision(10) << "{\"type\":\"FeatureCollection\",\"features\":[\n";
+        for (unsigned i = 0; i < count; ++i)
+        {
+            double x = (prng.next() - 0.5) * 20.0;
+            double y = (prng.next() - 0.5) * 20.0;
+            double s = 0.001 + prng.next() * 0.01;
+
+            out << (i > 0 ? ",\n" : "")
+                << "{\"type\":\"Feature\",\"properties\":{\"id\":" << i << "},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[["
+                << "[" << x << "," << y << "],[" << x+s << "," << y << "],[" << x+s << "," << y+s << "],["
+                << x << "," << y+s << "],[" << x << "," << y << "]]]}}";
+        }
+        out << "\n]}\n";
+    }
+
+    // Opens the file as an OGR source and returns the time in ms, or a negative number on failure.
+    double openSource(const std::string& filename, bool boundsIndex, osg::ref_ptr<FeatureSource>& out_source)
+    {
+        OGRFeatureOptions ogr;
+        ogr.url() = URI(filename);
+        ogr.ogrDriver() = "GeoJSON";
+        ogr.boundsIndex() = boundsIndex;
+
+        osg::Timer_t t0 = osg::Timer::instance()->tick();
+        out_source = FeatureSource::create(ogr);
+        if (!out_source.valid() || out_source->open().isError())
+        {
+            OE_WARN << LC << "Failed to open " << filename << std::endl;
+            return -1.0;
+        }
+        return osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick());
+    }
+
+    // Runs a query for every key and returns the average time in ms.
+    double queryTiles(FeatureSource* source, const std::vector<TileKey>& keys, unsigned& out_features)
+    {
+        out_features = 0u;
+        osg::Timer_t t0 = osg::Timer::instance()->tick();
+        for (unsigned i = 0; i < keys.size(); ++i)
+        {
+            Symbology::Query query;
+            query.tileKey() = keys[i];
+
+            osg::ref_ptr<FeatureCursor> cursor = source->createFeatureCursor(query);
+            while (cursor.valid() && cursor->hasMore())
+            {
+                cursor->nextFeature();
+                ++out_features;
+            }
+        }
+        return osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick()) / (double)keys.size();
+    }
+}
+
+int
+benchmarkOGRIndex(osg::ArgumentParser& args)
+{
+    unsigned count = 1000000u;
+    args.read("--features", count);
+
+    unsigned numQueries = 100u;
+    args.read("--queries", numQueries);
+
+    unsigned lod = 8u;
+    args.read("--lod", lod);
+
+    std::string filename = "osgearth_bench_ogrindex.geojson";
+    std::string sidecar = filename + ".oeidx";
+    writeSquares(filename, count);
+    ::remove(sidecar.c_str());
+
+    // random tiles over the data:
+    const Profile* profile = Registry::instance()->getGlobalGeodeticProfile();
+    Random prng(5678);
+    std::vector<TileKey> keys;
+    for (unsigned i = 0; i < numQueries; ++i)
+    {
+        double x = (prng.next() - 0.5) * 20.0;
+        double y = (prng.next() - 0.5) * 20.0;
+        keys.push_back(profile->createTileKey(x, y, lod));
+    }
+
+    osg::ref_ptr<FeatureSource> plain, built, reloaded;
+    double plainOpen = openSource(filename, false, plain);
+    double buildOpen = openSource(filename, true, built);
+    double reloadOpen = openSource(filename, true, reloaded);
+    if (plainOpen < 0.0 || buildOpen < 0.0 || reloadOpen < 0.0)
+        return -1;
+
+    unsigned plainFeatures, indexedFeatures;
+    double plainQuery = queryTiles(plain.get(), keys, plainFeatures);
+    double indexedQuery = queryTiles(reloaded.get(), keys, indexedFeatures);
+
+    OE_NOTICE << LC << count << " features, " << numQueries << " tiles at LOD " << lod << ":\n"
+        << "  open                      = " << plainOpen << " ms\n"
+        << "  open, building index      = " << buildOpen << " ms\n"
+        << "  open, reading index       = " << reloadOpen << " ms\n"
+        << "  OGR spatial filter        = " << plainQuery << " ms/tile (" << plainFeatures << " features)\n"
+        << "  bounds index              = " << indexedQuery << " ms/tile (" << indexedFeatures << " features)\n"
+        << "  speedup                   = " << (indexedQuery > 0.0 ? plainQuery / indexedQuery : 0.0) << "x\n"
+        << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,284 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmarks"
+#include <osgEarth/Registry>
+#include <osgEarth/Profile>
+#include <osgEarth/TileKey>
+#include <osgEarth/TrajectoryPredictor>
+#include <osg/CoordinateSystemNode>
+#include <fstream>
+#include <map>
+
+#define LC "[bench prefetch] "
+
+using namespace osgEarth;
+
+namespace
+{
+    // Range-based tile selection, following the rex engine's rule: a tile
+    // subdivides when any corner of a child is within the visibility range
+    // of the child's LOD. View frustum and horizon culling are not modeled.
+    struct Selector
+    {
+        const Profile*             _profile;
+        const osg::EllipsoidModel* _ellipsoid;
+        unsigned                   _maxLOD;
+        std::vector<double>        _range2;
+        std::vector<TileKey>       _roots;
+
+        typedef std::map<TileKey, std::vector<osg::Vec3d> > CornerCache;
+        CornerCache                _corners;
+
+        Selector(const Profile* profile, unsigned maxLOD, double rangeFactor) :
+            _profile(profile),
+            _ellipsoid(profile->getSRS()->getEllipsoid()),
+            _maxLOD(maxLOD)
+        {
+            for (unsigned lod = 0; lod <= maxLOD; ++lod)
+            {
+                TileKey key(lod, 0, 0, profile);
+                double range = key.getExtent().computeBoundingGeoCircle().getRadius() * rangeFactor * 2.0;
+                _range2.push_back(range*range);
+            }
+            profile->getAllKeysAtLOD(0, _roots);
+        }
+
+        osg::Vec3d toWorld(double lon, double lat, double alt) const
+        {
+            osg::Vec3d world;
+            _ellipsoid->convertLatLongHeightToXYZ(
+                osg::DegreesToRadians(lat), osg::DegreesToRadians(lon), alt,
+                world.x(), world.y(), world.z());
+            return world;
+        }
+
+        const std::vector<osg::Vec3d>& corners(const TileKey& key)
+        {
+            std::vector<osg::Vec3d>& c = _corners[key];
+            if (c.empty())
+            {
+                const GeoExtent& e = key.getExtent();
+                c.push_back(toWorld(e.xMin(), e.yMin(), 0.0));
+                c.push_back(toWorld(e.xMax(), e.yMin(), 0.0));
+                c.push_back(toWorld(e.xMin(), e.yMax(), 0.0));
+                c.push_back(toWorld(e.xMax(), e.yMax(), 0.0));
+            }
+            return c;
+        }
+
+        bool childrenInRange(const TileKey& key, const osg::Vec3d& eye)
+        {
+            unsigned lod = key.getLOD();
+            if (lod >= _maxLOD)
+                return false;
+
+            for (unsigned q = 0; q < 4; ++q)
+            {
+                const std::vector<osg::Vec3d>& c = corners(key.createChildKey(q));
+                for (unsigned i = 0; i < c.size(); ++i)
+                    if ((c[i] - eye).length2() < _range2[lod + 1])
+                        return true;
+            }
+            return false;
+        }
+
+        void select(const TileKey& key, const osg::Vec3d& eye, std::vector<TileKey>& out)
+        {
+            out.push_back(key);
+            if (childrenInRange(key, eye))
+            {
+                for (unsigned q = 0; q < 4; ++q)
+                    select(key.createChildKey(q), eye, out);
+            }
+        }
+
+        void select(const osg::Vec3d& eye, std::vector<TileKey>& out)
+        {
+            out.clear();
+            for (unsigned i = 0; i < _roots.size(); ++i)
+                select(_roots[i], eye, out);
+        }
+    };
+
+    // One tile's life in the replay.
+    struct TileState
+    {
+        TileState() : _readyTime(0.0), _prefetched(false), _demanded(false) { }
+        double _readyTime;   // when its data arrives
+        bool   _prefetched;  // requested ahead of demand
+        bool   _demanded;    // the view has needed it
+    };
+
+    // Reads "time lon lat alt" lines (seconds, degrees, meters).
+    bool readPath(const std::string& filename, const Selector& selector, TrajectoryPredictor::Path& path)
+    {
+        std::ifstream in(filename.c_str());
+        double t, lon, lat, alt;
+        while (in >> t >> lon >> lat >> alt)
+        {
+            path.push_back(TrajectoryPredictor::Sample(t, selector.toWorld(lon, lat, alt)));
+        }
+        return !path.empty();
+    }
+
+    // A low, fast flight that weaves left and right; one keyframe per second.
+    void makePath(const Selector& selector, double seconds, double speed, double alt, TrajectoryPredictor::Path& path)
+    {
+        const double metersPerDegree = 111320.0;
+        double lon = -100.0, lat = 35.0;
+        for (unsigned s = 0; s <= (unsigned)seconds; ++s)
+        {
+            path.push_back(TrajectoryPredictor::Sample((double)s, selector.toWorld(lon, lat, alt)));
+
+            double heading = osg::PI_4 + 0.6 * sin((double)s * 0.1);
+            lon += speed * sin(heading) / (metersPerDegree * cos(osg::DegreesToRadians(lat)));
+            lat += speed * cos(heading) / metersPerDegree;
+        }
+    }
+}
+
+int
+benchmarkPrefetch(osg::ArgumentParser& args)
+{
+    double ahead = 2.0;
+    args.read("--ahead", ahead);
+
+    double latency = 0.5;
+    args.read("--latency", latency);
+
+    double fps = 30.0;
+    args.read("--fps", fps);
+
+    unsigned maxLOD = 16u;
+    args.read("--max-lod", maxLOD);
+
+    double rangeFactor = 7.0;
+    args.read("--range-factor", rangeFactor);
+
+    double seconds = 60.0;
+    args.read("--seconds", seconds);
+
+    double speed = 1500.0;
+    args.read("--speed", speed);
+
+    double alt = 3000.0;
+    args.read("--alt", alt);
+
+    // --ideal hands the predictor the flight path itself (an upper bound)
+    bool ideal = args.read("--ideal");
+
+    Selector selector(Registry::instance()->getGlobalGeodeticProfile(), maxLOD, rangeFactor);
+
+    TrajectoryPredictor::Path path;
+    std::string pathFile;
+    if (args.read("--path", pathFile))
+    {
+        if (!readPath(pathFile, selector, path))
+        {
+            OE_WARN << LC << "No samples in " << pathFile << std::endl;
+            return -1;
+        }
+    }
+    else
+    {
+        makePath(selector, seconds, speed, alt, path);
+    }
+
+    TrajectoryPredictor predictor;
+    if (ideal)
+        predictor.setFlightPath(path);
+
+    typedef std::map<TileKey, TileState> Tiles;
+    Tiles tiles;
+
+    unsigned demanded = 0u, hits = 0u, late = 0u, misses = 0u, requests = 0u;
+    std::vector<TileKey> keys;
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    unsigned frames = 0u;
+    for (double t = path.front()._time; t <= path.back()._time; t += 1.0 / fps, ++frames)
+    {
+        osg::Vec3d eye = TrajectoryPredictor::interpolate(path, t);
+
+        // tiles the view needs right now
+        selector.select(eye, keys);
+        for (std::vector<TileKey>::const_iterator k = keys.begin(); k != keys.end(); ++k)
+        {
+            TileState& tile = tiles[*k];
+            if (tile._demanded)
+                continue;
+
+            tile._demanded = true;
+            ++demanded;
+            if (!tile._prefetched)
+            {
+                tile._readyTime = t + latency;
+                ++misses;
+            }
+            else if (tile._readyTime <= t)
+                ++hits;
+            else
+                ++late;
+        }
+
+        // tiles the predicted view will need
+        predictor.addSample(t, eye);
+        osg::Vec3d predicted;
+        if (ahead > 0.0 && predictor.predict(ahead, predicted))
+        {
+            selector.select(predicted, keys);
+            for (std::vector<TileKey>::const_iterator k = keys.begin(); k != keys.end(); ++k)
+            {
+                Tiles::iterator i = tiles.find(*k);
+                if (i == tiles.end())
+                {
+                    TileState& tile = tiles[*k];
+                    tile._prefetched = true;
+                    tile._readyTime = t + latency;
+                    ++requests;
+                }
+            }
+        }
+    }
+
+    double elapsed = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    unsigned wasted = 0u;
+    for (Tiles::const_iterator i = tiles.begin(); i != tiles.end(); ++i)
+        if (i->second._prefetched && !i->second._demanded)
+            ++wasted;
+
+    OE_NOTICE << LC << "replayed " << frames << " frames over " << (path.back()._time - path.front()._time) << " s:\n"
+        << "  predictor       = " << (ideal ? "flight path" : "extrapolated") << ", " << ahead << " s ahead\n"
+        << "  load latency    = " << latency << " s\n"
+        << "  tiles demanded  = " << demanded << "\n"
+        << "  prefetch hits   = " << hits << "\n"
+        << "  prefetch late   = " << late << "\n"
+        << "  not prefetched  = " << misses << "\n"
+        << "  hit rate        = " << (demanded > 0u ? 100.0 * (double)hits / (double)demanded : 0.0) << " %\n"
+        << "  prefetches      = " << requests << " (" << wasted << " never demanded)\n"
+        << "  ms/frame        = " << (frames > 0u ? 1000.0 * elapsed / (double)frames : 0.0) << "\n"
+        << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmarks"
+#include <osgEarth/SpatialReference>
+#include <OpenThreads/Thread>
+#include <algorithm>
+
+#define LC "[bench srs] "
+
+using namespace osgEarth;
+
+namespace
+{
+    struct TransformThread : public OpenThreads::Thread
+    {
+        TransformThread(const SpatialReference* from, const SpatialReference* to, unsigned points, unsigned iterations) :
+            _from(from), _to(to), _points(points), _iterations(iterations), _ok(true) { }
+
+        void run()
+        {
+            std::vector<osg::Vec3d> points(_points);
+            for (unsigned i = 0; i < _iterations && _ok; ++i)
+            {
+                for (unsigned p = 0; p < points.size(); ++p)
+                    points[p].set(6.0 + 6.0*(double)p/(double)points.size(), 40.0 + 0.01*(double)(p % 1000u), 0.0);
+                _ok = _from->transform(points, _to);
+            }
+        }
+
+        const SpatialReference* _from;
+        const SpatialReference* _to;
+        unsigned _points, _iterations;
+        bool _ok;
+    };
+
+    // Transforms on "numThreads" threads at once and returns points per second,
+    // or zero if any transform failed.
+    double measureThroughput(const SpatialReference* from, const SpatialReference* to, unsigned numThreads, unsigned points, unsigned iterations)
+    {
+        std::vector<TransformThread*> threads;
+        for (unsigned i = 0; i < numThreads; ++i)
+            threads.push_back(new TransformThread(from, to, points, iterations));
+
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        for (unsigned i = 0; i < numThreads; ++i)
+            threads[i]->start();
+        for (unsigned i = 0; i < numThreads; ++i)
+            threads[i]->join();
+        double seconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+        bool ok = true;
+        for (unsigned i = 0; i < numThreads; ++i)
+        {
+            ok = ok && threads[i]->_ok;
+            delete threads[i];
+        }
+
+        return ok && seconds > 0.0 ? (double)numThreads * (double)iterations * (double)points / seconds : 0.0;
+    }
+}
+
+int
+benchmarkSRS(osg::ArgumentParser& args)
+{
+    unsigned maxThreads = OpenThreads::GetNumberOfProcessors();
+    args.read("--threads", maxThreads);
+
+    unsigned points = 1000u;
+    args.read("--points", points);
+
+    unsigned iterations = 200u;
+    args.read("--iterations", iterations);
+
+    // Same projection twice; the null datum shift keeps the second one on OGR.
+    osg::ref_ptr<const SpatialReference> wgs84 = SpatialReference::create("wgs84");
+    osg::ref_ptr<const SpatialReference> utm = SpatialReference::create("epsg:32632");
+    osg::ref_ptr<const SpatialReference> utmOGR = SpatialReference::create("+proj=utm +zone=32 +ellps=WGS84 +towgs84=0,0,0 +units=m +no_defs");
+    if (!wgs84.valid() || !utm.valid() || !utmOGR.valid())
+    {
+        OE_WARN << LC << "Failed to create the spatial references" << std::endl;
+        return -1;
+    }
+
+    OE_NOTICE << LC << "wgs84 -> UTM 32N, " << points << " points x " << iterations << " iterations per thread:" << std::endl;
+
+    for (unsigned threads = 1u; threads <= std::max(maxThreads, 1u); threads *= 2u)
+    {
+        double native = measureThroughput(wgs84.get(), utm.get(), threads, points, iterations);
+        double ogr = measureThroughput(wgs84.get(), utmOGR.get(), threads, points, iterations);
+
+        OE_NOTICE << LC << "  threads = " << threads
+            << ", native = " << native << " pts/s"
+            << ", OGR = " << ogr << " pts/s"
+            << ", speedup = " << (ogr > 0.0 ? native / ogr : 0.0) << "x"
+            << std::endl;
+    }
+
+    return 0;
+}
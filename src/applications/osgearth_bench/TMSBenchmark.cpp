@@ -0,0 +1,111 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmarks"
+#include <osgEarth/Map>
+#include <osgEarth/ImageLayer>
+#include <osgEarth/TileVisitor>
+#include <osgEarthUtil/TMSPackager>
+#include <osgEarthDrivers/gdal/GDALOptions>
+
+#define LC "[bench tms] "
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+using namespace osgEarth::Drivers;
+
+int
+benchmarkTMS(osg::ArgumentParser& args)
+{
+    std::string input;
+    if (!args.read("--in", input))
+    {
+        OE_WARN << LC << "Specify a local GeoTIFF with --in <file>" << std::endl;
+        return -1;
+    }
+
+    std::string output = "osgearth_bench_tms";
+    args.read("--out", output);
+
+    unsigned maxLevel = 8u;
+    args.read("--max-level", maxLevel);
+
+    unsigned threads = 1u;
+    args.read("--threads", threads);
+
+    int encodeThreads = -1;
+    args.read("--encode-threads", encodeThreads);
+
+    std::string extension = "png";
+    args.read("--ext", extension);
+
+    GDALOptions gdal;
+    gdal.url() = URI(input);
+
+    osg::ref_ptr<Map> map = new Map();
+    osg::ref_ptr<ImageLayer> layer = new ImageLayer(ImageLayerOptions("bench", gdal));
+    map->addLayer(layer.get());
+
+    if (layer->getStatus().isError())
+    {
+        OE_WARN << LC << "Failed to open " << input << ": " << layer->getStatus().message() << std::endl;
+        return -1;
+    }
+
+    // generate tiles on one or more visitor threads
+    osg::ref_ptr<TileVisitor> visitor;
+    if (threads > 1)
+    {
+        MultithreadedTileVisitor* mt = new MultithreadedTileVisitor();
+        mt->setNumThreads(threads);
+        visitor = mt;
+    }
+    else
+    {
+        visitor = new TileVisitor();
+    }
+    visitor->setMaxLevel(maxLevel);
+
+    TMSPackager packager;
+    packager.setVisitor(visitor.get());
+    packager.setDestination(output);
+    packager.setExtension(extension);
+    packager.setOverwrite(true);
+    if (encodeThreads >= 0)
+        packager.setNumEncodeThreads(encodeThreads);
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    packager.run(layer.get(), map.get());
+    double seconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    unsigned tiles = packager.getNumTilesWritten();
+
+    OE_NOTICE << LC << "packaged " << input << " to level " << maxLevel << ":\n"
+        << "  generate threads = " << threads << "\n"
+        << "  encode threads   = " << packager.getNumEncodeThreads() << "\n"
+        << "  tiles written    = " << tiles << "\n"
+        << "  time             = " << seconds << " s\n"
+        << "  tiles/second     = " << (seconds > 0.0 ? (double)tiles/seconds : 0.0) << "\n"
+        << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmarks"
+#include <osgEarth/Registry>
+#include <osgEarth/SpatialReference>
+#include <osgEarthUtil/TileIndexBuilder>
+#include <osgDB/FileUtils>
+#include <OpenThreads/Thread>
+#include <gdal.h>
+#include <cmath>
+#include <sstream>
+#include <stdio.h>
+
+#define LC "[bench tileindex] "
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // Writes a grid of small geographic GeoTIFFs into "dir" and returns their names.
+    bool makeRasters(const std::string& dir, unsigned count, std::vector<std::string>& out_files)
+    {
+        GDALDriverH driver = GDALGetDriverByName("GTiff");
+        if (!driver)
+        {
+            OE_WARN << LC << "GDAL has no GTiff driver" << std::endl;
+            return false;
+        }
+
+        std::string wkt = SpatialReference::get("wgs84")->getWKT();
+        unsigned cols = (unsigned)ceil(sqrt((double)count));
+        double size = 180.0 / (double)cols;
+
+        for (unsigned i = 0; i < count; ++i)
+        {
+            std::stringstream buf;
+            buf << dir << "/r" << i << ".tif";
+            std::string name = buf.str();
+
+            GDALDatasetH ds = GDALCreate(driver, name.c_str(), 16, 16, 1, GDT_Byte, 0L);
+            if (!ds)
+            {
+                OE_WARN << LC << "Failed to create " << name << std::endl;
+                return false;
+            }
+
+            double gt[6] = { -180.0 + size*(double)(i % cols), size/16.0, 0.0, 90.0 - size*(double)(i / cols), 0.0, -size/16.0 };
+            GDALSetGeoTransform(ds, gt);
+            GDALSetProjection(ds, wkt.c_str());
+            GDALClose(ds);
+            out_files.push_back(name);
+        }
+        return true;
+    }
+
+    // Builds the index with the given number of threads and returns the time in ms.
+    double buildIndex(const std::string& dir, const std::string& index, unsigned numThreads, unsigned& out_scanned, unsigned& out_reused)
+    {
+        osg::ref_ptr<TileIndexBuilder> builder = new TileIndexBuilder();
+        builder->setNumThreads(numThreads);
+        builder->getFilenames().push_back(dir);
+
+        osg::Timer_t t0 = osg::Timer::instance()->tick();
+        builder->build(index);
+        double ms = osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick());
+
+        out_scanned = builder->getNumScanned();
+        out_reused = builder->getNumReused();
+        return ms;
+    }
+}
+
+int
+benchmarkTileIndex(osg::ArgumentParser& args)
+{
+    unsigned count = 2000u;
+    args.read("--files", count);
+
+    unsigned numThreads = OpenThreads::GetNumberOfProcessors();
+    args.read("--threads", numThreads);
+
+    std::string out = "osgearth_bench_tileindex";
+    args.read("--out", out);
+
+    // make sure GDAL is registered.
+    Registry::instance();
+
+    std::string dir = out + "/rasters";
+    if (!osgDB::makeDirectory(dir))
+    {
+        OE_WARN << LC << "Failed to create " << dir << std::endl;
+        return -1;
+    }
+
+    std::vector<std::string> files;
+    if (!makeRasters(dir, count, files))
+        return -1;
+
+    std::string index = out + "/index.idx";
+    ::remove(index.c_str());
+
+    unsigned serialScanned, serialReused;
+    double serial = buildIndex(dir, index, 1u, serialScanned, serialReused);
+    ::remove(index.c_str());
+
+    unsigned parallelScanned, parallelReused;
+    double parallel = buildIndex(dir, index, numThreads, parallelScanned, parallelReused);
+
+    // leave the index in place so the next build only checks modification times.
+    unsigned updateScanned, updateReused;
+    double update = buildIndex(dir, index, numThreads, updateScanned, updateReused);
+
+    OE_NOTICE << LC << count << " rasters:\n"
+        << "  1 thread       = " << serial << " ms (" << serialScanned << " read)\n"
+        << "  " << numThreads << " threads      = " << parallel << " ms (" << parallelScanned << " read)\n"
+        << "  speedup        = " << (parallel > 0.0 ? serial / parallel : 0.0) << "x\n"
+        << "  update         = " << update << " ms (" << updateScanned << " read, " << updateReused << " unchanged)\n"
+        << std::endl;
+
+    return 0;
+}
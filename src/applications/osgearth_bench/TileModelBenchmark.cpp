@@ -0,0 +1,169 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmarks"
+#include <osgEarth/Map>
+#include <osgEarth/MapFrame>
+#include <osgEarth/ImageLayer>
+#include <osgEarth/TerrainTileModelFactory>
+#include <osgEarth/StringUtils>
+#include <osgEarthDrivers/gdal/GDALOptions>
+#include <algorithm>
+
+#define LC "[bench tilemodel] "
+
+using namespace osgEarth;
+using namespace osgEarth::Drivers;
+
+namespace
+{
+    // Asks for color layers only.
+    struct ColorOnly : public TerrainEngineRequirements
+    {
+        bool elevationTexturesRequired() const { return false; }
+        bool normalTexturesRequired() const { return false; }
+        bool parentTexturesRequired() const { return false; }
+        bool elevationBorderRequired() const { return false; }
+        bool fullDataAtFirstLodRequired() const { return false; }
+    };
+
+    // Builds a model for each key against a fresh map, so every pass starts
+    // with cold layer caches, and returns the per-tile latencies in ms.
+    bool buildTiles(const std::string& input, unsigned numLayers, bool parallel, unsigned perSource,
+                    const std::vector<TileKey>& keys, std::vector<double>& out_latency, unsigned& out_layers)
+    {
+        GDALOptions gdal;
+        gdal.url() = URI(input);
+
+        osg::ref_ptr<Map> map = new Map();
+        for (unsigned i = 0; i < numLayers; ++i)
+        {
+            ImageLayer* layer = new ImageLayer(ImageLayerOptions(Stringify() << "bench" << i, gdal));
+            map->addLayer(layer);
+            if (layer->getStatus().isError())
+            {
+                OE_WARN << LC << "Failed to open " << input << ": " << layer->getStatus().message() << std::endl;
+                return false;
+            }
+        }
+
+        TerrainOptions options;
+        options.parallelLayerFetch() = parallel;
+        options.maxFetchesPerSource() = perSource;
+
+        osg::ref_ptr<TerrainTileModelFactory> factory = new TerrainTileModelFactory(options);
+        MapFrame frame(map.get());
+        ColorOnly reqs;
+
+        out_latency.clear();
+        out_layers = 0u;
+        for (unsigned i = 0; i < keys.size(); ++i)
+        {
+            osg::Timer_t t0 = osg::Timer::instance()->tick();
+            osg::ref_ptr<TerrainTileModel> model = factory->createTileModel(frame, keys[i], CreateTileModelFilter(), &reqs, 0L);
+            out_latency.push_back(osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick()));
+            out_layers += model->colorLayers().size();
+        }
+        return true;
+    }
+
+    void report(const char* label, std::vector<double> latency, unsigned layers)
+    {
+        std::sort(latency.begin(), latency.end());
+        double total = 0.0;
+        for (unsigned i = 0; i < latency.size(); ++i)
+            total += latency[i];
+
+        OE_NOTICE << LC << label << ": "
+            << "avg = " << total / (double)latency.size() << " ms, "
+            << "p50 = " << latency[latency.size() / 2] << " ms, "
+            << "p95 = " << latency[(latency.size() * 95) / 100] << " ms, "
+            << "total = " << total << " ms, "
+            << layers << " color layers built"
+            << std::endl;
+    }
+}
+
+int
+benchmarkTileModel(osg::ArgumentParser& args)
+{
+    std::string input;
+    if (!args.read("--in", input))
+    {
+        OE_WARN << LC << "Specify a local GeoTIFF with --in <file>" << std::endl;
+        return -1;
+    }
+
+    unsigned numLayers = 8u;
+    args.read("--layers", numLayers);
+
+    unsigned lod = 8u;
+    args.read("--lod", lod);
+
+    unsigned maxTiles = 64u;
+    args.read("--tiles", maxTiles);
+
+    unsigned perSource = 2u;
+    args.read("--per-source", perSource);
+
+    // Find the tiles to build from a throwaway layer.
+    GDALOptions gdal;
+    gdal.url() = URI(input);
+    osg::ref_ptr<Map> probeMap = new Map();
+    osg::ref_ptr<ImageLayer> probe = new ImageLayer(ImageLayerOptions("probe", gdal));
+    probeMap->addLayer(probe.get());
+    if (probe->getStatus().isError())
+    {
+        OE_WARN << LC << "Failed to open " << input << ": " << probe->getStatus().message() << std::endl;
+        return -1;
+    }
+
+    GeoExtent extent = probe->getDataExtents().empty() ?
+        probe->getProfile()->getExtent() :
+        probe->getDataExtentsUnion();
+
+    std::vector<TileKey> keys;
+    probeMap->getProfile()->getIntersectingTiles(extent, lod, keys);
+    if (keys.size() > maxTiles)
+        keys.resize(maxTiles);
+
+    if (keys.empty())
+    {
+        OE_WARN << LC << "No tiles at LOD " << lod << std::endl;
+        return -1;
+    }
+
+    OE_NOTICE << LC << keys.size() << " tiles at LOD " << lod << ", " << numLayers << " layers, "
+        << perSource << " fetches per source" << std::endl;
+
+    std::vector<double> serial, parallel;
+    unsigned serialLayers, parallelLayers;
+    if (!buildTiles(input, numLayers, false, perSource, keys, serial, serialLayers) ||
+        !buildTiles(input, numLayers, true, perSource, keys, parallel, parallelLayers))
+    {
+        return -1;
+    }
+
+    report("serial  ", serial, serialLayers);
+    report("parallel", parallel, parallelLayers);
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmarks"
+#include <osgEarth/Registry>
+
+#define LC "[bench] "
+
+using namespace osgEarth;
+
+int
+usage(osg::ArgumentParser& args)
+{
+    OE_NOTICE
+        << "\nUsage: " << args.getApplicationName() << " <benchmark> [options]\n"
+        << "\nBenchmarks:\n"
+        << "  --kml          Load a synthetic KML document (--placemarks N, --streaming)\n"
+        << "  --earth        Parse a synthetic earth file (--layers N, --iterations N)\n"
+        << "  --tms          Package a GeoTIFF as TMS (--in file, --max-level N, --threads N, --encode-threads N)\n"
+        << "  --los          Radial line of sight on elevation data (--in file, --rays N, --radius m, --lod N)\n"
+        << "  --srs          Transform points to UTM on many threads, native and OGR (--threads N, --points N, --iterations N)\n"
+        << "  --flatten      Flatten terrain around synthetic roads (--in file, --roads N, --tiles N, --lod N)\n"
+        << "  --clamp        Clamp synthetic buildings to elevation data (--in file, --buildings N, --vertex)\n"
+        << "  --index        Index synthetic features for picking (--features N, --per-tile N, --threads N)\n"
+        << "  --prefetch     Replay a camera path against tile prefetching (--path file, --ahead s, --latency s, --ideal)\n"
+        << "  --churn        Simulate tile request churn on the frame scheduler (--tiles N, --churn f, --threads N, --budget us)\n"
+        << "  --normals      Time normal map generation on synthetic elevation tiles (--tiles N, --size N)\n"
+        << "  --bounds       Query tile height ranges with and without summaries (--in file, --lod N, --tiles N)\n"
+        << "  --extents      Look up tiles in a large data extent list, linear and indexed (--count N, --queries N, --lod N)\n"
+        << "  --join         Join points against polygon boundaries, linear and indexed (--points N, --polygons N, --sample N)\n"
+        << "  --metrics      Time scoped metric events with the JSON and binary backends (--threads N, --events N, --out prefix)\n"
+        << "  --tilemodel    Build tile models from image layers, serial and parallel (--in file, --layers N, --lod N, --tiles N, --per-source N)\n"
+        << "  --mosaic       Reproject imagery into mercator tiles with and without the source tile cache (--in file, --lod N, --tiles N, --cache N)\n"
+        << "  --tileindex    Index synthetic rasters with one and many threads, then update the index (--files N, --threads N, --out dir)\n"
+        << "  --ogrindex     Query tiles of a large GeoJSON file, with and without the bounds index (--features N, --queries N, --lod N)\n"
+        << std::endl;
+    return -1;
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser args(&argc, argv);
+
+    if (args.read("--kml"))
+        return benchmarkKML(args);
+
+    if (args.read("--earth"))
+        return benchmarkEarth(args);
+
+    if (args.read("--tms"))
+        return benchmarkTMS(args);
+
+    if (args.read("--los"))
+        return benchmarkLOS(args);
+
+    if (args.read("--srs"))
+        return benchmarkSRS(args);
+
+    if (args.read("--flatten"))
+        return benchmarkFlatten(args);
+
+    if (args.read("--clamp"))
+        return benchmarkClamp(args);
+
+    if (args.read("--index"))
+        return benchmarkIndex(args);
+
+    if (args.read("--prefetch"))
+        return benchmarkPrefetch(args);
+
+    if (args.read("--churn"))
+        return benchmarkChurn(args);
+
+    if (args.read("--normals"))
+        return benchmarkNormals(args);
+
+    if (args.read("--bounds"))
+        return benchmarkBounds(args);
+
+    if (args.read("--extents"))
+        return benchmarkExtents(args);
+
+    if (args.read("--join"))
+        return benchmarkJoin(args);
+
+    if (args.read("--metrics"))
+        return benchmarkMetrics(args);
+
+    if (args.read("--tilemodel"))
+        return benchmarkTileModel(args);
+
+    if (args.read("--mosaic"))
+        return benchmarkMosaic(args);
+
+    if (args.read("--tileindex"))
+        return benchmarkTileIndex(args);
+
+    if (args.read("--ogrindex"))
+        return benchmarkOGRIndex(args);
+
+    return usage(args);
+}
@@ -29,6 +29,7 @@
 #include <osgEarth/StringUtils>
 #include <osgEarth/HTTPClient>
 #include <osgEarth/TileVisitor>
+#include <osgEarth/TileSource>
 #include <osgEarth/ImageLayer>
 #include <osgEarth/ElevationLayer>
 #include <osgEarthUtil/TMSPackager>
@@ -75,6 +76,8 @@ usage( const std::string& msg = "" )
         << "            [--mt]                          ; Use multithreading to process the tiles." << std::endl
         << "            [--concurrency]                 ; The number of threads or processes to use if --mp or --mt are provided." << std::endl
         << "            [--alpha-mask]                  ; Mask out imagery that isn't in the provided extents." << std::endl
+        << "            [--encode-threads <num>]        ; Number of threads that encode tiles (0 = encode on the generating thread)" << std::endl
+        << "            [--out-mbtiles <file>]          ; Write the tiles of a single layer (--image or --elevation) into one MBTiles file" << std::endl
         << std::endl
         << "            [--verbose]                     ; Displays progress of the operation" << std::endl;
 
@@ -150,6 +153,14 @@ makeTMS( osg::ArgumentParser& args )
 
     bool applyAlphaMask = args.read("--alpha-mask");
 
+    // Number of tile encoding threads
+    int encodeThreads = -1;
+    args.read("--encode-threads", encodeThreads);
+
+    // Single-file output
+    std::string outMBTiles;
+    args.read("--out-mbtiles", outMBTiles);
+
     bool writeXML = true;
 
     // load up the map
@@ -333,6 +344,36 @@ makeTMS( osg::ArgumentParser& args )
     packager.setOverwrite(overwrite);
     packager.setKeepEmpties(keepEmpties);
     packager.setApplyAlphaMask(applyAlphaMask);
+    if (encodeThreads >= 0)
+    {
+        packager.setNumEncodeThreads(encodeThreads);
+    }
+
+    // Send all tiles to a single MBTiles file instead of a TMS folder tree.
+    if (!outMBTiles.empty())
+    {
+        if (imageLayerIndex < 0 && elevationLayerIndex < 0)
+            return usage("--out-mbtiles requires --image or --elevation");
+
+        std::string format = imageLayerIndex >= 0 ? (extension.empty() ? "png" : extension) : "tif";
+
+        Config outConf;
+        outConf.set("driver", "mbtiles");
+        outConf.set("filename", outMBTiles);
+        outConf.set("format", format);
+        outConf.add("profile", map->getProfile()->toProfileOptions().getConfig());
+
+        osg::ref_ptr<TileSource> output = TileSourceFactory::create(TileSourceOptions(outConf));
+        if (!output.valid() || output->open(TileSource::MODE_WRITE | TileSource::MODE_CREATE).isError())
+            return usage("Failed to open MBTiles output");
+
+        packager.setExtension(format);
+        packager.setTileSource(output.get());
+
+        // no TMS repo to describe
+        writeXML = false;
+        outEarth.clear();
+    }
 
 
     // new map for an output earth file if necessary.
@@ -344,6 +385,9 @@ makeTMS( osg::ArgumentParser& args )
     }
 
     std::string outEarthFile = osgDB::concatPaths( rootFolder, osgDB::getSimpleFileName( outEarth ) );
+
+    // tiles that failed to encode or write, across all packaged layers
+    unsigned numFailed = 0;
     
 
     // Package an individual image layer
@@ -353,6 +397,7 @@ makeTMS( osg::ArgumentParser& args )
         if (layer)
         {
             packager.run(layer, map);
+            numFailed += packager.getNumTilesFailed();
             if (writeXML)
             {
                 packager.writeXML(layer, map);
@@ -371,6 +416,7 @@ makeTMS( osg::ArgumentParser& args )
         if (layer)
         {
             packager.run(layer, map);
+            numFailed += packager.getNumTilesFailed();
             if (writeXML)
             {
                 packager.writeXML(layer, map );
@@ -394,6 +440,7 @@ makeTMS( osg::ArgumentParser& args )
             OE_NOTICE << "Packaging " << layer->getName() << std::endl;
             osg::Timer_t start = osg::Timer::instance()->tick();
             packager.run(layer, map);
+            numFailed += packager.getNumTilesFailed();
             osg::Timer_t end = osg::Timer::instance()->tick();
             if (verbose)
             {
@@ -432,6 +479,7 @@ makeTMS( osg::ArgumentParser& args )
             OE_NOTICE << "Packaging " << layer->getName() << std::endl;
             osg::Timer_t start = osg::Timer::instance()->tick();
             packager.run(layer, map);
+            numFailed += packager.getNumTilesFailed();
             osg::Timer_t end = osg::Timer::instance()->tick();
             if (verbose)
             {
@@ -477,6 +525,12 @@ makeTMS( osg::ArgumentParser& args )
         }
     }
 
+    if (numFailed > 0)
+    {
+        OE_WARN << LC << numFailed << " tiles failed to write; run again to retry them" << std::endl;
+        return 1;
+    }
+
     return 0;
 }
 
@@ -35,6 +35,7 @@
 #include <osgEarth/FileUtils>
 #include <osgEarth/ImageLayer>
 #include <osgEarth/ElevationLayer>
+#include <osgEarth/PerformanceCounters>
 
 #include <osgEarth/TileVisitor>
 
@@ -93,6 +94,7 @@ int
         << "        [--mt]                          ; Use multithreading to process the tiles." << std::endl
         << "        [--concurrency]                 ; The number of threads or processes to use if --mp or --mt are provided." << std::endl
         << "        [--verbose]                     ; Displays progress of the seed operation" << std::endl
+        << "        [--counters file]               ; Writes per-layer performance counters when done (.json, or .prom for Prometheus text; not collected from --mp processes)" << std::endl
         << std::endl
         << "    --purge file.earth                  ; Purges a layer cache in a .earth file (interactive)" << std::endl
         << std::endl;
@@ -142,6 +144,9 @@ seed( osg::ArgumentParser& args )
 
     bool verbose = args.read("--verbose");
 
+    std::string countersFile;
+    args.read("--counters", countersFile);
+
     unsigned int batchSize = 0;
     args.read("--batchsize", batchSize);
 
@@ -391,6 +396,14 @@ seed( osg::ArgumentParser& args )
         //}        
     }    
 
+    if ( !countersFile.empty() )
+    {
+        if ( Registry::performanceCounters()->write(countersFile) )
+        {
+            OE_NOTICE << "Wrote performance counters to " << countersFile << std::endl;
+        }
+    }
+
     return 0;
 }
 
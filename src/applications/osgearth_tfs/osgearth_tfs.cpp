@@ -57,6 +57,8 @@ usage( const std::string& msg )
         << "    --crop             ; Crops features instead of doing a centroid check.  Features can be added to multiple tiles when cropping is enabled" << std::endl
         << "    --dest-srs         ; The destination SRS string in any format osgEarth can understand (wkt, proj4, epsg).  If none is specified the source data SRS will be used" << std::endl
         << "    --bounds minx miny maxx maxy ; The bounding box to use as Level 0.  Feature extent will be used by default" << std::endl
+        << "    --bulk             ; Place features by Morton code in one pass and write tiles in parallel (much faster for large datasets)" << std::endl
+        << "    --threads          ; The number of threads that write tiles in bulk mode" << std::endl
         << std::endl;
 
     return -1;
@@ -111,6 +113,11 @@ int main(int argc, char** argv)
     std::string destSRS;
     while(arguments.read("--dest-srs", destSRS));
 
+    bool bulk = arguments.read("--bulk");
+
+    unsigned int numThreads = OpenThreads::GetNumberOfProcessors();
+    while (arguments.read("--threads", numThreads));
+
     std::string grid;
     float gridSizeMeters = -1.0f;
     while (arguments.read("--grid", grid));
@@ -224,6 +231,7 @@ int main(int argc, char** argv)
         << "  OrderBy=" << queryOrderBy << std::endl
         << "  Method= " << method << std::endl
         << "  DestSRS= " << destSRS << std::endl
+        << "  Bulk=" << (bulk ? "yes" : "no") << std::endl
         << std::endl;
 
     //buildTFS( features.get(), firstLevel, maxLevel, maxFeatures, destination, layer, description, query, cropMethod);
@@ -235,6 +243,8 @@ int main(int argc, char** argv)
     packager.setMethod( cropMethod );    
     packager.setDestSRS( destSRS );
     packager.setLod0Extent(ext);
+    packager.setBulk( bulk );
+    packager.setNumThreads( numThreads );
 
     packager.package( features, destination, layer, description );
     osg::Timer_t endTime = osg::Timer::instance()->tick();
@@ -44,6 +44,9 @@ int main(int argc, char** argv)
     std::string indexFilename = "index.shp";
     while (arguments.read("--index", indexFilename));
 
+    unsigned numThreads = 0;
+    arguments.read("--threads", numThreads);
+
     OE_NOTICE << "index name = " << indexFilename << std::endl;
 
     std::vector< std::string > filenames;
@@ -63,8 +66,8 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
-    // Open or create the index file
-    if (osgDB::fileExists( indexFilename ) )
+    // Open or create the index file. Only compact indexes can be updated.
+    if (osgDB::fileExists( indexFilename ) && !TileIndex::isCompact( indexFilename ) )
     {
         OE_NOTICE << indexFilename << " exists, cannot update existing index" << std::endl;
         return 1;
@@ -74,6 +77,10 @@ int main(int argc, char** argv)
 
     TileIndexBuilder builder;
     builder.setProgressCallback( new ConsoleProgressCallback() );
+    if (numThreads > 0)
+    {
+        builder.setNumThreads( numThreads );
+    }
     for (unsigned int i = 0; i < filenames.size(); i++)
     {
         builder.getFilenames().push_back( filenames[i] );
@@ -82,6 +89,8 @@ int main(int argc, char** argv)
 
     osg::Timer_t end = osg::Timer::instance()->tick();
     OE_NOTICE << "Built index " << indexFilename << " in " << osg::Timer::instance()->delta_s( start, end) << "s" << std::endl;
+    OE_NOTICE << "  " << builder.getNumScanned() << " read, " << builder.getNumReused() << " unchanged, "
+        << builder.getNumSkipped() << " skipped" << std::endl;
 
 
     return 0;
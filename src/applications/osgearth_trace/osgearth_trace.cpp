@@ -0,0 +1,71 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osgEarth/TraceMetrics>
+#include <fstream>
+#include <iostream>
+
+using namespace osgEarth;
+
+// Converts a binary trace recorded with OSGEARTH_METRICS_FILE=<file>.oetrace
+// into JSON for chrome://tracing.
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName() + " <trace.oetrace> [output.json]");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help", "Display this information");
+
+    if (arguments.read("-h") || arguments.read("--help") || arguments.argc() < 2)
+    {
+        std::cout << arguments.getApplicationUsage()->getCommandLineUsage() << std::endl;
+        arguments.getApplicationUsage()->write(std::cout, arguments.getApplicationUsage()->getCommandLineOptions());
+        return 1;
+    }
+
+    std::string inputName = arguments[1];
+    std::ifstream input(inputName.c_str(), std::ios::in | std::ios::binary);
+    if (!input.is_open())
+    {
+        std::cerr << "Failed to open " << inputName << std::endl;
+        return 1;
+    }
+
+    bool ok;
+    if (arguments.argc() > 2)
+    {
+        std::ofstream output(arguments[2]);
+        ok = output.is_open() && TraceMetricsBackend::convertToChrome(input, output);
+    }
+    else
+    {
+        ok = TraceMetricsBackend::convertToChrome(input, std::cout);
+    }
+
+    if (!ok)
+    {
+        std::cerr << inputName << " is not a readable trace" << std::endl;
+        return 1;
+    }
+    return 0;
+}
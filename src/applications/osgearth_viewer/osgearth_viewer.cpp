@@ -27,6 +27,8 @@
 #include <osgEarth/MapNode>
 #include <osgEarth/ThreadingUtils>
 #include <osgEarth/Metrics>
+#include <osgEarth/Registry>
+#include <osgEarth/PerformanceCounters>
 #include <iostream>
 
 #define LC "[viewer] "
@@ -39,6 +41,7 @@ usage(const char* name)
 {
     OE_NOTICE 
         << "\nUsage: " << name << " file.earth" << std::endl
+        << "    --counters file : write per-layer performance counters on exit (.json, or .prom for Prometheus text)" << std::endl
         << MapNodeHelper().usage() << std::endl;
 
     return 0;
@@ -57,6 +60,9 @@ main(int argc, char** argv)
     float vfov = -1.0f;
     arguments.read("--vfov", vfov);
 
+    std::string countersFile;
+    arguments.read("--counters", countersFile);
+
     
 
     // create a viewer:
@@ -93,6 +99,11 @@ main(int argc, char** argv)
     {
         viewer.setSceneData( node );
         Metrics::run(viewer);
+
+        if ( !countersFile.empty() )
+        {
+            Registry::performanceCounters()->write(countersFile);
+        }
     }
     else
     {
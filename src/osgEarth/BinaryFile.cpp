@@ -0,0 +1,121 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/BinaryFile>
+#include <osgEarth/Endian>
+#include <fstream>
+#include <string.h>
+
+using namespace osgEarth;
+
+void
+BinaryFile::putHeader(char* buf, const char* magic, unsigned version)
+{
+    memcpy(buf, magic, MAGIC_SIZE);
+    putU32(buf + MAGIC_SIZE, version);
+}
+
+bool
+BinaryFile::getHeader(const std::vector<char>& buf, const char* magic, unsigned& out_version)
+{
+    if (buf.size() < HEADER_SIZE || memcmp(&buf[0], magic, MAGIC_SIZE) != 0)
+        return false;
+
+    out_version = getU32(&buf[MAGIC_SIZE]);
+    return true;
+}
+
+bool
+BinaryFile::hasMagic(const std::string& filename, const char* magic)
+{
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    char buf[MAGIC_SIZE];
+    return
+        in.read(buf, MAGIC_SIZE) &&
+        memcmp(buf, magic, MAGIC_SIZE) == 0;
+}
+
+void
+BinaryFile::putU32(char* ptr, unsigned value)
+{
+    uint32_t v = OE_ENCODE_INT((uint32_t)value);
+    memcpy(ptr, &v, 4);
+}
+
+void
+BinaryFile::putF64(char* ptr, double value)
+{
+    uint64_t v = OE_ENCODE_DOUBLE(value);
+    memcpy(ptr, &v, 8);
+}
+
+unsigned
+BinaryFile::getU32(const char* ptr)
+{
+    uint32_t v;
+    memcpy(&v, ptr, 4);
+    return OE_DECODE_INT(v);
+}
+
+double
+BinaryFile::getF64(const char* ptr)
+{
+    uint64_t v;
+    memcpy(&v, ptr, 8);
+    return OE_DECODE_DOUBLE(v);
+}
+
+bool
+BinaryFile::write(const std::string& filename, const std::vector<char>& buf)
+{
+    std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+
+    if (!buf.empty())
+        out.write(&buf[0], buf.size());
+    return out.good();
+}
+
+bool
+BinaryFile::read(const std::string& filename, std::vector<char>& out_buf, unsigned minSize)
+{
+    out_buf.clear();
+
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!in.is_open())
+        return false;
+
+    in.seekg(0, std::ios::end);
+    std::streamoff size = in.tellg();
+    in.seekg(0, std::ios::beg);
+
+    if (size < 0 || size < (std::streamoff)minSize)
+        return false;
+
+    out_buf.resize((size_t)size);
+    if (size > 0 && !in.read(&out_buf[0], out_buf.size()))
+    {
+        out_buf.clear();
+        return false;
+    }
+    return true;
+}
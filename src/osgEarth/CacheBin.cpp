@@ -320,6 +320,20 @@ CacheBin::writeNode(const std::string&    key,
     return true;
 }
 
+LayerCounters*
+CacheBin::getCounters()
+{
+    if (!_counters.valid())
+    {
+        Threading::ScopedMutexLock lock(_countersMutex);
+        if (!_counters.valid())
+        {
+            _counters = Registry::performanceCounters()->getOrCreate("CacheBin", _binID);
+        }
+    }
+    return _counters.get();
+}
+
 
 #undef  LC
 #define LC "[ReadImageFromCachePseudoLoader] "
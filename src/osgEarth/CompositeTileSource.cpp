@@ -22,6 +22,8 @@
 #include <osgEarth/Registry>
 #include <osgEarth/Progress>
 #include <osgEarth/HeightFieldUtils>
+#include <osgEarth/TaskService>
+#include <osgEarth/ThreadingUtils>
 #include <osgDB/FileNameUtils>
 
 #define LC "[CompositeTileSource] "
@@ -130,6 +132,49 @@ namespace
 
     // some helper types.    
     typedef std::vector<ImageInfo> ImageMixVector;   
+
+    // Fetches the image for one component layer.
+    struct FetchComponent
+    {
+        FetchComponent() : layer(0L), key(0L) { }
+
+        void execute()
+        {
+            if ( !progress.valid() || !progress->isCanceled() )
+            {
+                GeoImage geoImage = layer->createImage( *key, progress.get() );
+                if ( geoImage.valid() )
+                    image = geoImage.getImage();
+            }
+        }
+
+        ImageLayer*                          layer;
+        const TileKey*                       key;
+        osg::ref_ptr<ChildProgressCallback>  progress;
+        osg::ref_ptr<osg::Image>             image;
+    };
+
+    typedef ParallelTask<FetchComponent> FetchComponentTask;
+
+    Threading::Mutex s_compositeServiceMutex;
+    UID              s_compositeServiceUID = -1;
+
+    TaskService* getCompositeService()
+    {
+        Threading::ScopedMutexLock lock( s_compositeServiceMutex );
+        if ( s_compositeServiceUID < 0 )
+            s_compositeServiceUID = Registry::instance()->createUID();
+        return Registry::instance()->getTaskServiceManager()->getOrAdd( s_compositeServiceUID );
+    }
+
+    // True if the image hides everything beneath it in the composite.
+    bool isOpaque(const ImageInfo& info)
+    {
+        return
+            info.image.valid() &&
+            info.opacity >= 1.0f &&
+            !ImageUtils::hasTransparency( info.image.get() );
+    }
 }
 
 //-----------------------------------------------------------------------
@@ -147,36 +192,87 @@ osg::Image*
 CompositeTileSource::createImage(const TileKey&    key,
                                  ProgressCallback* progress )
 {    
-    ImageMixVector images;
-    images.reserve(_imageLayers.size());
+    ImageMixVector images( _imageLayers.size() );
+    for (unsigned i = 0; i < _imageLayers.size(); ++i)
+    {
+        ImageLayer* layer = _imageLayers[i].get();
+        images[i].dataInExtents = layer->mayHaveDataInExtent(key.getExtent()); //getTileSource()->hasDataInExtent( key.getExtent() );
+        images[i].opacity = layer->getOpacity();
+    }
+
+    // Try to get an image from each of the layers for the given key. Fetch from the
+    // top of the stack down, a batch at a time in parallel, and stop as soon as an
+    // opaque image covers the tile; nothing beneath it would show through.
+    TaskService* service = _imageLayers.size() > 1 && !TaskService::isPoolThread() ? getCompositeService() : 0L;
+    unsigned batchSize = service ? (unsigned)service->getNumThreads() + 1u : 1u;
+
+    unsigned first = 0u; // lowest layer that is visible in the output
+    int next = (int)_imageLayers.size() - 1;
 
-    // Try to get an image from each of the layers for the given key.
-    for (ImageLayerVector::const_iterator itr = _imageLayers.begin(); itr != _imageLayers.end(); ++itr)
+    while (next >= (int)first)
     {
-        ImageLayer* layer = itr->get();
-        ImageInfo imageInfo;
-        imageInfo.dataInExtents = layer->mayHaveDataInExtent(key.getExtent()); //getTileSource()->hasDataInExtent( key.getExtent() );
-        imageInfo.opacity = layer->getOpacity();
+        std::vector< osg::ref_ptr<FetchComponentTask> > tasks;
+        std::vector<unsigned> indices;
+        for (; next >= 0 && tasks.size() < batchSize; --next)
+        {
+            if (!images[next].dataInExtents)
+                continue;
+
+            FetchComponentTask* task = new FetchComponentTask();
+            task->layer = _imageLayers[next].get();
+            task->key = &key;
+            if (progress)
+                task->progress = new ChildProgressCallback(progress);
+            tasks.push_back(task);
+            indices.push_back(next);
+        }
 
-        if (imageInfo.dataInExtents)
+        if (tasks.size() > 1u)
         {
-            GeoImage image = layer->createImage(key, progress);
-            if (image.valid())
+            // run the first one here while the service runs the rest:
+            Threading::MultiEvent done( tasks.size()-1 );
+            for (unsigned i = 1; i < tasks.size(); ++i)
             {
-                imageInfo.image = image.getImage();
+                tasks[i]->_mev = &done;
+                service->add( tasks[i].get() );
             }
+            tasks[0]->execute();
+            done.wait();
+        }
+        else if (tasks.size() == 1u)
+        {
+            tasks[0]->execute();
+        }
 
-            // If the progress got cancelled or it needs a retry then return NULL to prevent this tile from being built and cached with incomplete or partial data.
-            if (progress && (progress->isCanceled() || progress->needsRetry()))
+        for (unsigned i = 0; i < tasks.size(); ++i)
+        {
+            if (tasks[i]->progress.valid())
+                tasks[i]->progress->merge();
+        }
+
+        // If the progress got cancelled or it needs a retry then return NULL to prevent this tile from being built and cached with incomplete or partial data.
+        if (progress && (progress->isCanceled() || progress->needsRetry()))
+        {
+            OE_DEBUG << LC << " createImage was cancelled or needs retry for " << key.str() << std::endl;
+            return 0L;
+        }
+
+        // tasks are in top-down order, so the first opaque one is the highest.
+        for (unsigned i = 0; i < tasks.size(); ++i)
+        {
+            ImageInfo& info = images[indices[i]];
+            info.image = tasks[i]->image.get();
+            if (isOpaque(info) && indices[i] > first)
             {
-                OE_DEBUG << LC << " createImage was cancelled or needs retry for " << key.str() << std::endl;
-                return 0L;
+                first = indices[i];
+                break;
             }
         }
-
-        images.push_back(imageInfo);
     }
 
+    // drop the layers hidden beneath an opaque one.
+    images.erase(images.begin(), images.begin() + first);
+
     // Determine the output texture size to use based on the image that were creatd.
     unsigned numValidImages = 0;
     osg::Vec2s textureSize;
@@ -199,7 +295,7 @@ CompositeTileSource::createImage(const TileKey&    key,
         for (unsigned int i = 0; i < images.size(); i++)
         {
             ImageInfo& info = images[i];
-            ImageLayer* layer = _imageLayers[i].get();
+            ImageLayer* layer = _imageLayers[first + i].get();
             if (!info.image.valid() && info.dataInExtents)
             {                      
                 TileKey parentKey = key.createParentKey();
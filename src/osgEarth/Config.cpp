@@ -29,15 +29,68 @@
 #include <sstream>
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
 
 using namespace osgEarth;
 
 #define LC "[Config] "
 
+// minimum number of children before an object gets a lookup index
+#define MIN_CHILDREN_TO_INDEX 16
+
+namespace
+{
+    struct LessKey
+    {
+        bool operator()(const Config* lhs, const Config* rhs) const {
+            return lhs->key() < rhs->key();
+        }
+        bool operator()(const Config* lhs, const std::string& rhs) const {
+            return lhs->key() < rhs;
+        }
+    };
+}
+
 Config::~Config()
 {
 }
 
+Config&
+Config::operator = ( const Config& rhs )
+{
+    if ( this != &rhs )
+    {
+        _key          = rhs._key;
+        _defaultValue = rhs._defaultValue;
+        _children     = rhs._children;
+        _referrer     = rhs._referrer;
+        _isLocation   = rhs._isLocation;
+        _externalRef  = rhs._externalRef;
+        _refMap       = rhs._refMap;
+
+        // the index points into the children list, so never copy it.
+        _index.clear();
+        if ( !rhs._index.empty() )
+            buildIndex();
+    }
+    return *this;
+}
+
+void
+Config::buildIndex()
+{
+    _index.clear();
+    if ( _children.size() >= MIN_CHILDREN_TO_INDEX )
+    {
+        _index.reserve( _children.size() );
+        for( ConfigSet::const_iterator i = _children.begin(); i != _children.end(); ++i )
+            _index.push_back( &(*i) );
+
+        // stable, so the first match in the index is the first in document order
+        std::stable_sort( _index.begin(), _index.end(), LessKey() );
+    }
+}
+
 void
 Config::setReferrer( const std::string& referrer )
 {
@@ -75,20 +128,42 @@ Config::setReferrer( const std::string& referrer )
 bool
 Config::fromXML( std::istream& in )
 {
-    osg::ref_ptr<XmlDocument> xml = XmlDocument::load( in );
-    if ( xml.valid() )
-        *this = xml->getConfig();
-    return xml.valid();
+    return XmlDocument::loadConfig( in, URIContext(), *this );
+}
+
+bool
+Config::fromXML( std::istream& in, const std::string& referrer )
+{
+    return XmlDocument::loadConfig( in, URIContext(referrer), *this );
+}
+
+const ConfigSet
+Config::children( const std::string& key ) const
+{
+    ConfigSet r;
+    if ( !_index.empty() )
+    {
+        std::vector<const Config*>::const_iterator i = std::lower_bound( _index.begin(), _index.end(), key, LessKey() );
+        for( ; i != _index.end() && (*i)->key() == key; ++i )
+            r.push_back( *(*i) );
+    }
+    else
+    {
+        for(ConfigSet::const_iterator i = _children.begin(); i != _children.end(); i++ ) {
+            if ( i->key() == key )
+                r.push_back( *i );
+        }
+    }
+    return r;
 }
 
 #if 1
 const Config&
 Config::child( const std::string& childName ) const
 {
-    for( ConfigSet::const_iterator i = _children.begin(); i != _children.end(); i++ ) {
-        if ( i->key() == childName )
-            return *i;
-    }
+    const Config* c = child_ptr( childName );
+    if ( c )
+        return *c;
     static Config s_emptyConf;
     return s_emptyConf;
     //Config emptyConf;
@@ -112,6 +187,12 @@ Config::child( const std::string& childName ) const
 const Config*
 Config::child_ptr( const std::string& childName ) const
 {
+    if ( !_index.empty() )
+    {
+        std::vector<const Config*>::const_iterator i = std::lower_bound( _index.begin(), _index.end(), childName, LessKey() );
+        return i != _index.end() && (*i)->key() == childName ? *i : 0L;
+    }
+
     for( ConfigSet::const_iterator i = _children.begin(); i != _children.end(); i++ ) {
         if ( i->key() == childName )
             return &(*i);
@@ -122,6 +203,9 @@ Config::child_ptr( const std::string& childName ) const
 Config*
 Config::mutable_child( const std::string& childName )
 {
+    // caller may change the child's key
+    _index.clear();
+
     for( ConfigSet::iterator i = _children.begin(); i != _children.end(); i++ ) {
         if ( i->key() == childName )
             return &(*i);
@@ -148,9 +232,9 @@ Config::find( const std::string& key, bool checkMe ) const
     if ( checkMe && key == this->key() )
         return this;
 
-    for( ConfigSet::const_iterator c = _children.begin(); c != _children.end(); ++c )
-        if ( key == c->key() )
-            return &(*c);
+    const Config* r = child_ptr( key );
+    if ( r )
+        return r;
 
     for( ConfigSet::const_iterator c = _children.begin(); c != _children.end(); ++c )
     {
@@ -167,6 +251,9 @@ Config::find( const std::string& key, bool checkMe )
     if ( checkMe && key == this->key() )
         return this;
 
+    // caller may change the result's key
+    _index.clear();
+
     for( ConfigSet::iterator c = _children.begin(); c != _children.end(); ++c )
         if ( key == c->key() )
             return &(*c);
@@ -0,0 +1,288 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/DataExtentIndex>
+#include <osgEarth/Profile>
+#include <osgEarth/TileKey>
+#include <algorithm>
+#include <cmath>
+
+using namespace osgEarth;
+
+namespace
+{
+    // Largest number of tiles in the finest coverage bitmap
+    const unsigned MAX_BITMAP_TILES = 1u << 20;
+
+    // Finest LOD held in the coverage bitmap
+    const unsigned MAX_BITMAP_LOD = 8u;
+
+    // Boxes of the valid extents as seen from "srs", with the index of the
+    // source extent. Geographic boxes are repeated one turn to either side
+    // so a query need not worry about the antimeridian.
+    void collectBoxes(const DataExtentList&            extents,
+                      const SpatialReference*          srs,
+                      std::vector<PackedRTree::Box>&   out_boxes,
+                      std::vector<unsigned>&           out_indices)
+    {
+        bool geographic = srs->isGeographic();
+
+        for (unsigned i = 0; i < extents.size(); ++i)
+        {
+            const GeoExtent& extent = extents[i];
+            if (!extent.isValid())
+                continue;
+
+            GeoExtent local = srs->isHorizEquivalentTo(extent.getSRS()) ?
+                extent : extent.transform(srs);
+            if (!local.isValid())
+                continue;
+
+            PackedRTree::Box box(local.xMin(), local.yMin(), local.xMax(), local.yMax());
+            out_boxes.push_back(box);
+            out_indices.push_back(i);
+
+            if (geographic)
+            {
+                for (int turn = -1; turn <= 1; turn += 2)
+                {
+                    PackedRTree::Box shifted(box);
+                    shifted._xmin += 360.0 * turn;
+                    shifted._xmax += 360.0 * turn;
+                    out_boxes.push_back(shifted);
+                    out_indices.push_back(i);
+                }
+            }
+        }
+    }
+
+    // Tile column or row containing "v", clamped to [0, count)
+    unsigned tileIndex(double v, double size, unsigned count)
+    {
+        double t = floor(v / size);
+        return t <= 0.0 ? 0u : t >= (double)count ? count - 1u : (unsigned)t;
+    }
+
+    // Sets bits [first, last] in a row of words
+    void setBits(unsigned* row, unsigned first, unsigned last)
+    {
+        unsigned w0 = first >> 5, w1 = last >> 5;
+        unsigned m0 = ~0u << (first & 31u);
+        unsigned m1 = ~0u >> (31u - (last & 31u));
+
+        if (w0 == w1)
+        {
+            row[w0] |= m0 & m1;
+        }
+        else
+        {
+            row[w0] |= m0;
+            for (unsigned w = w0 + 1; w < w1; ++w)
+                row[w] = ~0u;
+            row[w1] |= m1;
+        }
+    }
+}
+
+DataExtentIndex::DataExtentIndex(const DataExtentList& extents, const Profile* profile) :
+_extents(extents),
+_profile(profile)
+{
+    if (_profile.valid())
+    {
+        buildLevels();
+    }
+}
+
+const DataExtentIndex::Tree*
+DataExtentIndex::getTree(const SpatialReference* srs) const
+{
+    const std::string& key = srs->getHorizInitString();
+    {
+        Threading::ScopedReadLock shared(_treesMutex);
+        TreeMap::const_iterator i = _trees.find(key);
+        if (i != _trees.end())
+            return i->second.get();
+    }
+
+    Threading::ScopedWriteLock exclusive(_treesMutex);
+
+    // double-check, another thread may have built it
+    osg::ref_ptr<Tree>& tree = _trees[key];
+    if (!tree.valid())
+    {
+        tree = new Tree();
+        tree->_srs = srs;
+        buildTree(tree.get());
+    }
+    return tree.get();
+}
+
+void
+DataExtentIndex::buildTree(Tree* tree) const
+{
+    std::vector<PackedRTree::Box> boxes;
+    std::vector<unsigned> indices;
+    collectBoxes(_extents, tree->_srs.get(), boxes, indices);
+
+    for (unsigned i = 0; i < boxes.size(); ++i)
+    {
+        tree->_tree.insert(boxes[i], indices[i]);
+    }
+    tree->_tree.build();
+}
+
+void
+DataExtentIndex::buildLevels()
+{
+    // pick the finest LOD whose bitmap stays reasonably small:
+    unsigned finest = 0u;
+    for (unsigned lod = 0u; lod <= MAX_BITMAP_LOD; ++lod)
+    {
+        unsigned tx, ty;
+        _profile->getNumTiles(lod, tx, ty);
+        if ((double)tx * (double)ty > (double)MAX_BITMAP_TILES)
+        {
+            if (lod == 0u)
+                return;
+            break;
+        }
+        finest = lod;
+    }
+
+    _levels.resize(finest + 1u);
+    for (unsigned lod = 0u; lod <= finest; ++lod)
+    {
+        Level& level = _levels[lod];
+        _profile->getNumTiles(lod, level._tilesWide, level._tilesHigh);
+        level._stride = (level._tilesWide + 31u) >> 5;
+        level._bits.assign(level._stride * level._tilesHigh, 0u);
+    }
+
+    // mark the tiles each extent touches at the finest level:
+    std::vector<PackedRTree::Box> boxes;
+    std::vector<unsigned> indices;
+    collectBoxes(_extents, _profile->getSRS(), boxes, indices);
+
+    const GeoExtent& pe = _profile->getExtent();
+    Level& fine = _levels[finest];
+    double tw, th;
+    _profile->getTileDimensions(finest, tw, th);
+
+    for (unsigned i = 0; i < boxes.size(); ++i)
+    {
+        const PackedRTree::Box& b = boxes[i];
+        if (b._xmax < pe.xMin() || b._xmin > pe.xMax() ||
+            b._ymax < pe.yMin() || b._ymin > pe.yMax())
+        {
+            continue;
+        }
+
+        unsigned c0 = tileIndex(b._xmin - pe.xMin(), tw, fine._tilesWide);
+        unsigned c1 = tileIndex(b._xmax - pe.xMin(), tw, fine._tilesWide);
+        unsigned r0 = tileIndex(pe.yMax() - b._ymax, th, fine._tilesHigh);
+        unsigned r1 = tileIndex(pe.yMax() - b._ymin, th, fine._tilesHigh);
+
+        for (unsigned r = r0; r <= r1; ++r)
+        {
+            setBits(&fine._bits[r * fine._stride], c0, c1);
+        }
+    }
+
+    // each coarser level is the OR of its four children:
+    for (unsigned lod = finest; lod > 0u; --lod)
+    {
+        const Level& child = _levels[lod];
+        Level& parent = _levels[lod - 1u];
+
+        for (unsigned y = 0; y < child._tilesHigh; ++y)
+        {
+            const unsigned* row = &child._bits[y * child._stride];
+            unsigned* prow = &parent._bits[(y >> 1) * parent._stride];
+
+            for (unsigned x = 0; x < child._tilesWide; ++x)
+            {
+                if ((row[x >> 5] >> (x & 31u)) & 1u)
+                {
+                    unsigned px = x >> 1;
+                    prow[px >> 5] |= 1u << (px & 31u);
+                }
+            }
+        }
+    }
+}
+
+unsigned
+DataExtentIndex::getCandidates(const GeoExtent& extent, std::vector<unsigned>& out_indices) const
+{
+    if (!extent.isValid() || _extents.empty())
+        return 0u;
+
+    // Non-contiguous SRS's are compared in geographic space by
+    // GeoExtent::intersects; don't try to second-guess that.
+    if (!extent.getSRS()->isContiguous())
+    {
+        for (unsigned i = 0; i < _extents.size(); ++i)
+            out_indices.push_back(i);
+        return _extents.size();
+    }
+
+    const Tree* tree = getTree(extent.getSRS());
+
+    std::vector<unsigned> hits;
+    tree->_tree.query(
+        PackedRTree::Box(extent.xMin(), extent.yMin(), extent.xMax(), extent.yMax()),
+        hits);
+
+    std::sort(hits.begin(), hits.end());
+    hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+
+    out_indices.insert(out_indices.end(), hits.begin(), hits.end());
+    return hits.size();
+}
+
+bool
+DataExtentIndex::mayIntersect(const TileKey& key) const
+{
+    if (_levels.empty() || !key.valid())
+        return true;
+
+    if (!key.getProfile()->isHorizEquivalentTo(_profile.get()))
+        return true;
+
+    // keys finer than the bitmap use their ancestor at the finest level:
+    unsigned lod = key.getLOD();
+    unsigned x = key.getTileX();
+    unsigned y = key.getTileY();
+    unsigned finest = _levels.size() - 1u;
+    if (lod > finest)
+    {
+        x >>= (lod - finest);
+        y >>= (lod - finest);
+        lod = finest;
+    }
+
+    const Level& level = _levels[lod];
+    if (x >= level._tilesWide || y >= level._tilesHigh)
+        return true;
+
+    return ((level._bits[y * level._stride + (x >> 5)] >> (x & 31u)) & 1u) != 0u;
+}
@@ -25,6 +25,8 @@
 #include <osgEarth/ImageUtils>
 #include <osg/Version>
 #include <iterator>
+#include <iomanip>
+#include <sstream>
 
 using namespace osgEarth;
 using namespace OpenThreads;
@@ -155,13 +157,92 @@ namespace
         
         return true;
     }    
+
+    // cache key combines the key with the full signature (incl vdatum)
+    std::string getHeightFieldCacheKey(const TileKey& key)
+    {
+        return Stringify() << key.str() << "_" << key.getProfile()->getFullSignature();
+    }
+
+    // cache record holding the tile summary for a heightfield
+    std::string getSummaryCacheKey(const std::string& heightFieldCacheKey)
+    {
+        return heightFieldCacheKey + "_summary";
+    }
+}
+
+//------------------------------------------------------------------------
+
+ElevationTileSummary::ElevationTileSummary(const osg::HeightField* hf) :
+_minHeight(FLT_MAX),
+_maxHeight(-FLT_MAX),
+_hasNoData(false)
+{
+    if (hf)
+    {
+        const osg::HeightField::HeightList& heights = hf->getHeightList();
+        for (unsigned i = 0; i < heights.size(); ++i)
+        {
+            float h = heights[i];
+            if (h == NO_DATA_VALUE)
+            {
+                _hasNoData = true;
+            }
+            else
+            {
+                _minHeight = osg::minimum(_minHeight, h);
+                _maxHeight = osg::maximum(_maxHeight, h);
+            }
+        }
+    }
+}
+
+void
+ElevationTileSummary::expandBy(const ElevationTileSummary& rhs)
+{
+    _minHeight = osg::minimum(_minHeight, rhs._minHeight);
+    _maxHeight = osg::maximum(_maxHeight, rhs._maxHeight);
+    _hasNoData = _hasNoData || rhs._hasNoData;
+}
+
+std::string
+ElevationTileSummary::toString() const
+{
+    if (!hasHeights())
+        return _hasNoData ? "nodata" : "";
+
+    return Stringify() << std::setprecision(9)
+        << _minHeight << " " << _maxHeight << " " << (_hasNoData ? 1 : 0);
+}
+
+bool
+ElevationTileSummary::fromString(const std::string& str)
+{
+    if (str == "nodata")
+    {
+        *this = ElevationTileSummary();
+        _hasNoData = true;
+        return true;
+    }
+
+    std::istringstream in(str);
+    float minHeight, maxHeight;
+    int hasNoData;
+    if (!(in >> minHeight >> maxHeight >> hasNoData) || minHeight > maxHeight)
+        return false;
+
+    _minHeight = minHeight;
+    _maxHeight = maxHeight;
+    _hasNoData = hasNoData != 0;
+    return true;
 }
 
 //------------------------------------------------------------------------
 
 ElevationLayer::ElevationLayer() :
 TerrainLayer(&_optionsConcrete),
-_options(&_optionsConcrete)
+_options(&_optionsConcrete),
+_summaries(true, 16384u)
 {
     init();
 }
@@ -169,7 +250,8 @@ _options(&_optionsConcrete)
 ElevationLayer::ElevationLayer(const ElevationLayerOptions& options) :
 TerrainLayer(&_optionsConcrete),
 _options(&_optionsConcrete),
-_optionsConcrete(options)
+_optionsConcrete(options),
+_summaries(true, 16384u)
 {
     init();
 }
@@ -177,7 +259,8 @@ _optionsConcrete(options)
 ElevationLayer::ElevationLayer(const std::string& name, const TileSourceOptions& driverOptions) :
 TerrainLayer(&_optionsConcrete),
 _options(&_optionsConcrete),
-_optionsConcrete(name, driverOptions)
+_optionsConcrete(name, driverOptions),
+_summaries(true, 16384u)
 {
     init();
 }
@@ -185,14 +268,16 @@ _optionsConcrete(name, driverOptions)
 ElevationLayer::ElevationLayer(const ElevationLayerOptions& options, TileSource* tileSource) :
 TerrainLayer(&_optionsConcrete, tileSource),
 _options(&_optionsConcrete),
-_optionsConcrete(options)
+_optionsConcrete(options),
+_summaries(true, 16384u)
 {
     init();
 }
 
 ElevationLayer::ElevationLayer(ElevationLayerOptions* optionsPtr) :
 TerrainLayer(optionsPtr? optionsPtr : &_optionsConcrete),
-_options(optionsPtr? optionsPtr : &_optionsConcrete)
+_options(optionsPtr? optionsPtr : &_optionsConcrete),
+_summaries(true, 16384u)
 {
     //init(); // will be called by subclass.
 }
@@ -213,6 +298,56 @@ ElevationLayer::isOffset() const
     return options().offset().get();
 }
 
+bool
+ElevationLayer::getTileSummary(const TileKey& key, ElevationTileSummary& out_summary)
+{
+    std::string cacheKey = getHeightFieldCacheKey(key);
+
+    LRUCache<std::string, ElevationTileSummary>::Record rec;
+    if (_summaries.get(cacheKey, rec))
+    {
+        out_summary = rec.value();
+        return true;
+    }
+
+    // fall back on the record written next to the cached heightfield
+    const CachePolicy& policy = getCacheSettings()->cachePolicy().get();
+    CacheBin* cacheBin = getCacheBin(key.getProfile());
+    if (cacheBin && policy.isCacheReadable())
+    {
+        ReadResult r = cacheBin->readString(getSummaryCacheKey(cacheKey), 0L);
+        if (r.succeeded() && !policy.isExpired(r.lastModifiedTime()))
+        {
+            ElevationTileSummary summary;
+            if (summary.fromString(r.getString()))
+            {
+                _summaries.insert(cacheKey, summary);
+                out_summary = summary;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool
+ElevationLayer::getOrCreateTileSummary(const TileKey& key, ElevationTileSummary& out_summary, ProgressCallback* progress)
+{
+    if (getTileSummary(key, out_summary))
+        return true;
+
+    GeoHeightField geoHF = createHeightField(key, progress);
+    if (!geoHF.valid())
+        return false;
+
+    // createHeightField records the summary, but it may already be evicted
+    if (!getTileSummary(key, out_summary))
+        out_summary = ElevationTileSummary(geoHF.getHeightField());
+
+    return true;
+}
+
 TileSource::HeightFieldOperation*
 ElevationLayer::getOrCreatePreCacheOp()
 {
@@ -268,7 +403,14 @@ ElevationLayer::createHeightFieldFromTileSource(const TileKey&    key,
         }
 
         // Make it from the source:
+        osg::Timer_t start = osg::Timer::instance()->tick();
         result = source->createHeightField( key, getOrCreatePreCacheOp(), progress );
+        getCounters()->recordDecode(osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick()));
+
+        if (result.valid())
+        {
+            getCounters()->recordBytesDecoded(result->getNumColumns() * result->getNumRows() * sizeof(float));
+        }
    
         // If the result is good, we how have a heightfield but it's vertical values
         // are still relative to the tile source's vertical datum. Convert them.
@@ -431,6 +573,8 @@ ElevationLayer::createHeightField(const TileKey&    key,
         return GeoHeightField::INVALID;
     }
 
+    LayerCounters::ScopedFetch fetch( getCounters() );
+
     GeoHeightField result;
     osg::ref_ptr<osg::HeightField> hf;
     osg::ref_ptr<NormalMap> normalMap;
@@ -439,7 +583,7 @@ ElevationLayer::createHeightField(const TileKey&    key,
     bool fromMemCache = false;
 
     // cache key combines the key with the full signature (incl vdatum)
-    std::string cacheKey = Stringify() << key.str() << "_" << key.getProfile()->getFullSignature();
+    std::string cacheKey = getHeightFieldCacheKey(key);
     const CachePolicy& policy = getCacheSettings()->cachePolicy().get();
 
     if ( _memCache.valid() )
@@ -453,6 +597,7 @@ ElevationLayer::createHeightField(const TileKey&    key,
                 key.getExtent());
 
             fromMemCache = true;
+            getCounters()->recordCacheHit();
         }
     }
 
@@ -502,11 +647,17 @@ ElevationLayer::createHeightField(const TileKey&    key,
                     {
                         hf = cachedHF;
                         fromCache = true;
+                        getCounters()->recordCacheHit();
                     }
                 }
             }
         }
 
+        if ( !hf.valid() && (_memCache.valid() || (cacheBin && policy.isCacheReadable())) )
+        {
+            getCounters()->recordCacheMiss();
+        }
+
         // if we're cache-only, but didn't get data from the cache, fail silently.
         if ( !hf.valid() && policy.isCacheOnly() )
         {
@@ -544,13 +695,16 @@ ElevationLayer::createHeightField(const TileKey&    key,
                 hf = 0L; // to fall back on cached data if possible.
             }
 
-            // cache if necessary
+            // cache if necessary, along with the tile's summary record
             if ( hf            && 
                  cacheBin      && 
                  !fromCache    &&
                  policy.isCacheWriteable() )
             {
                 cacheBin->write(cacheKey, hf, 0L);
+
+                osg::ref_ptr<StringObject> summary = new StringObject(ElevationTileSummary(hf.get()).toString());
+                cacheBin->write(getSummaryCacheKey(cacheKey), summary.get(), 0L);
             }
 
             // We have an expired heightfield from the cache and no new data from the TileSource.  So just return the cached data.
@@ -579,6 +733,9 @@ ElevationLayer::createHeightField(const TileKey&    key,
         if ( hf.valid() )
         {
             result = GeoHeightField( hf.get(), normalMap.get(), key.getExtent() );
+
+            // remember the height range before any NO_DATA post-processing
+            _summaries.insert(cacheKey, ElevationTileSummary(hf.get()));
         }
     }
 
@@ -637,6 +794,57 @@ osg::MixinVector< osg::ref_ptr<ElevationLayer> >( rhs )
     //nop
 }
 
+bool
+ElevationLayerVector::getTileSummary(const TileKey&        key,
+                                     ElevationTileSummary& out_summary) const
+{
+    ElevationTileSummary absolute, offsets;
+    offsets._minHeight = offsets._maxHeight = 0.0f;
+    bool haveAbsolute = false;
+
+    for (const_iterator i = begin(); i != end(); ++i)
+    {
+        ElevationLayer* layer = i->get();
+        if (!layer->getEnabled() || !layer->getVisible() || !layer->isKeyInLegalRange(key))
+            continue;
+
+        // same choice of key as populateHeightFieldAndNormalMap; fallback
+        // data is interpolated from the best key, so its range holds
+        TileKey bestKey = layer->getBestAvailableTileKey(key);
+        if (!bestKey.valid())
+            continue;
+
+        ElevationTileSummary summary;
+        if (!layer->getTileSummary(bestKey, summary))
+            return false;
+
+        if (layer->isOffset())
+        {
+            if (summary.hasHeights())
+            {
+                offsets._minHeight += osg::minimum(summary._minHeight, 0.0f);
+                offsets._maxHeight += osg::maximum(summary._maxHeight, 0.0f);
+            }
+        }
+        else
+        {
+            absolute.expandBy(summary);
+            haveAbsolute = true;
+        }
+    }
+
+    if (!haveAbsolute)
+        return false;
+
+    out_summary = absolute;
+    if (out_summary.hasHeights())
+    {
+        out_summary._minHeight += offsets._minHeight;
+        out_summary._maxHeight += offsets._maxHeight;
+    }
+    return true;
+}
+
 
 
 namespace
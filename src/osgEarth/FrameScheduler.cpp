@@ -0,0 +1,278 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/FrameScheduler>
+#include <osgEarth/Notify>
+#include <osg/Timer>
+#include <algorithm>
+
+using namespace osgEarth;
+
+#define LC "[FrameScheduler] "
+
+namespace osgEarth
+{
+    struct FrameSchedulerThread : public OpenThreads::Thread
+    {
+        FrameSchedulerThread(FrameScheduler* owner) : _owner(owner) { }
+        void run() { _owner->work(); }
+        FrameScheduler* _owner;
+    };
+}
+
+namespace
+{
+    struct HigherPriority
+    {
+        bool operator()(const osg::ref_ptr<FrameScheduler::Job>& lhs, const osg::ref_ptr<FrameScheduler::Job>& rhs) const {
+            return lhs->getPriority() > rhs->getPriority();
+        }
+    };
+}
+
+//........................................................................
+
+FrameScheduler::Job::Job() :
+_state    ( IDLE ),
+_priority ( 0.0f ),
+_lastFrame( 0u )
+{
+    _progress = new ProgressCallback();
+}
+
+//........................................................................
+
+FrameScheduler::FrameScheduler(unsigned numThreads, const std::string& name) :
+_graceFrames( 2u ),
+_mergeBudget( 0u ),
+_shutdown   ( false )
+{
+    numThreads = std::max(numThreads, 1u);
+    for(unsigned i=0; i<numThreads; ++i)
+    {
+        FrameSchedulerThread* thread = new FrameSchedulerThread(this);
+        _threads.push_back( thread );
+        thread->start();
+    }
+
+    OE_INFO << LC << (name.empty() ? "" : name + ": ") << "Started " << numThreads << " threads\n";
+}
+
+FrameScheduler::~FrameScheduler()
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        _shutdown = true;
+
+        // tell running jobs to wrap up
+        for(Jobs::iterator i = _running.begin(); i != _running.end(); ++i)
+            (*i)->_progress->cancel();
+
+        _workAvailable.broadcast();
+    }
+
+    for(std::vector<OpenThreads::Thread*>::iterator t = _threads.begin(); t != _threads.end(); ++t)
+    {
+        (*t)->join();
+        delete *t;
+    }
+}
+
+void
+FrameScheduler::request(Job* job, float priority, unsigned frame)
+{
+    if ( !job )
+        return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+
+    job->_priority  = priority;
+    job->_lastFrame = frame;
+
+    if ( job->_state == Job::IDLE )
+    {
+        job->_state = Job::QUEUED;
+        job->_progress->reset();
+        _queue.push_back( job );
+        _stats._queued = _queue.size();
+        _workAvailable.signal();
+    }
+}
+
+void
+FrameScheduler::work()
+{
+    while( true )
+    {
+        osg::ref_ptr<Job> job;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+
+            while( !_shutdown && _queue.empty() )
+                _workAvailable.wait( &_mutex );
+
+            if ( _shutdown )
+                return;
+
+            // priorities change every frame, so pick the best one now.
+            Jobs::iterator best = std::min_element( _queue.begin(), _queue.end(), HigherPriority() );
+            job = best->get();
+            *best = _queue.back();
+            _queue.pop_back();
+
+            job->_state = Job::RUNNING;
+            _running.push_back( job.get() );
+            _stats._queued  = _queue.size();
+            _stats._running = _running.size();
+        }
+
+        if ( !job->_progress->isCanceled() )
+        {
+            job->run( job->_progress.get() );
+        }
+
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            _running.erase( std::find(_running.begin(), _running.end(), job) );
+            job->_state = Job::DONE;
+            _done.push_back( job.get() );
+            _stats._running = _running.size();
+            _stats._done    = _done.size();
+        }
+    }
+}
+
+void
+FrameScheduler::update(unsigned frame)
+{
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    Jobs canceled;
+    Jobs ready;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+
+        // drop queued jobs nobody has asked for lately; they never touch I/O.
+        for(unsigned i=0; i<_queue.size(); )
+        {
+            Job* job = _queue[i].get();
+            if ( frame - job->_lastFrame > _graceFrames )
+            {
+                job->_state = Job::IDLE;
+                canceled.push_back( job );
+                _queue[i] = _queue.back();
+                _queue.pop_back();
+                _stats._canceledQueued++;
+            }
+            else ++i;
+        }
+
+        // ask stale running jobs to stop early.
+        for(Jobs::iterator i = _running.begin(); i != _running.end(); ++i)
+        {
+            if ( frame - (*i)->_lastFrame > _graceFrames )
+                (*i)->_progress->cancel();
+        }
+
+        ready.swap( _done );
+        _stats._queued = _queue.size();
+    }
+
+    for(Jobs::iterator i = canceled.begin(); i != canceled.end(); ++i)
+        (*i)->onCanceled();
+
+    // merge the most important results first, as long as the budget allows.
+    std::sort( ready.begin(), ready.end(), HigherPriority() );
+
+    Jobs::iterator i;
+    unsigned merged = 0u, discarded = 0u;
+    for(i = ready.begin(); i != ready.end(); ++i)
+    {
+        if ( _mergeBudget > 0u && i != ready.begin() &&
+             osg::Timer::instance()->delta_u(start, osg::Timer::instance()->tick()) >= (double)_mergeBudget )
+        {
+            break;
+        }
+
+        Job* job = i->get();
+        bool wasCanceled = job->_progress->isCanceled();
+        {
+            // idle again before the callbacks, so they may re-request the job.
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            job->_state = Job::IDLE;
+        }
+
+        if ( wasCanceled )
+        {
+            job->onCanceled();
+            ++discarded;
+        }
+        else
+        {
+            job->merge();
+            ++merged;
+        }
+    }
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+
+        // whatever did not fit in the budget waits for the next frame.
+        _done.insert( _done.end(), i, ready.end() );
+
+        _stats._done = _done.size();
+        _stats._merged += merged;
+        _stats._canceledRunning += discarded;
+        _stats._lastMergeTime = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    }
+}
+
+void
+FrameScheduler::cancelAll()
+{
+    Jobs canceled;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+
+        for(Jobs::iterator i = _queue.begin(); i != _queue.end(); ++i)
+            (*i)->_state = Job::IDLE;
+        _stats._canceledQueued += _queue.size();
+        canceled.swap( _queue );
+
+        // running and finished jobs get discarded at the next update.
+        for(Jobs::iterator i = _running.begin(); i != _running.end(); ++i)
+            (*i)->_progress->cancel();
+        for(Jobs::iterator i = _done.begin(); i != _done.end(); ++i)
+            (*i)->_progress->cancel();
+
+        _stats._queued = 0u;
+    }
+
+    for(Jobs::iterator i = canceled.begin(); i != canceled.end(); ++i)
+        (*i)->onCanceled();
+}
+
+FrameScheduler::Stats
+FrameScheduler::getStats() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+    return _stats;
+}
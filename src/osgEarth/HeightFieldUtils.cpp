@@ -688,18 +688,181 @@ HeightFieldUtils::createClusterCullingCallback(const osg::HeightField*    grid,
 }
 
 
+namespace
+{
+    // Computes the normal and curvature of samples [1..count] of a row from
+    // the rows to the south and north of it, and encodes them into count
+    // RGBA8 pixels the same way NormalMap::set does. The clamped curvature
+    // also goes to "curv" for the stats. No NO_DATA or edge handling and no
+    // branches, so the compiler can vectorize the loop.
+    // (east-west) ^ (north-south) reduces to (-2dy(E-W), -2dx(N-S), 4dxdy).
+    void normalRow(const float* south, const float* center, const float* north,
+                   int count, float dx, float dy,
+                   GLubyte* out, float* curv)
+    {
+        const float ax = -2.0f*dy;
+        const float ay = -2.0f*dx;
+        const float az = 4.0f*dx*dy;
+        const float az2 = az*az;
+        const float kx = -100.0f/(dx*dx);
+        const float ky = -100.0f/(dy*dy);
+
+        for(int i=0; i<count; ++i)
+        {
+            float w = center[i];
+            float c = center[i+1];
+            float e = center[i+2];
+            float s = south[i+1];
+            float n = north[i+1];
+
+            float x = ax*(e-w);
+            float y = ay*(n-s);
+            float invLen = 1.0f/sqrtf(x*x + y*y + az2);
+
+            // differences first, so large heights don't swamp the curvature
+            float k = kx*((w-c)+(e-c)) + ky*((s-c)+(n-c));
+            k = std::max(-1.0f, std::min(1.0f, k));
+            curv[i] = k;
+
+            out[4*i+0] = (GLubyte)(0.5f*(x*invLen+1.0f)*255.0f);
+            out[4*i+1] = (GLubyte)(0.5f*(y*invLen+1.0f)*255.0f);
+            out[4*i+2] = (GLubyte)(0.5f*(az*invLen+1.0f)*255.0f);
+            out[4*i+3] = (GLubyte)(0.5f*(k+1.0f)*255.0f);
+        }
+    }
+
+    void addCurvature(NormalMapStats* stats, const float* curv, int count)
+    {
+        if (stats)
+        {
+            for(int i=0; i<count; ++i)
+            {
+                stats->_minCurvature = osg::minimum(stats->_minCurvature, curv[i]);
+                stats->_maxCurvature = osg::maximum(stats->_maxCurvature, curv[i]);
+            }
+        }
+    }
+
+    void addCurvature(NormalMapStats* stats, float curvature)
+    {
+        if (stats)
+        {
+            stats->_minCurvature = osg::minimum(stats->_minCurvature, curvature);
+            stats->_maxCurvature = osg::maximum(stats->_maxCurvature, curvature);
+        }
+    }
+
+    // True if the normal map can be written directly as RGBA8 rows.
+    bool isPackable(const NormalMap* normalMap)
+    {
+        return
+            normalMap->getPixelFormat() == GL_RGBA &&
+            normalMap->getDataType() == GL_UNSIGNED_BYTE;
+    }
+
+    // Generic per-sample normal for convertToNormalMap. Reads neighbors through
+    // the neighborhood so it handles tile edges and NO_DATA.
+    void neighborhoodSample(const HeightFieldNeighborhood& hood,
+                            const osg::HeightField* hf,
+                            int s, int t,
+                            double xres, double yres,
+                            double sIntervalMeters, double tIntervalMeters,
+                            NormalMap* normalMap,
+                            NormalMapStats* stats)
+    {
+        float centerHeight = hf->getHeight(s, t);
+
+        double nx = xres*(double)s;
+        double ny = yres*(double)t;
+
+        osg::Vec3f west ( -sIntervalMeters, 0, centerHeight );
+        osg::Vec3f east (  sIntervalMeters, 0, centerHeight );
+        osg::Vec3f south( 0, -tIntervalMeters, centerHeight );
+        osg::Vec3f north( 0,  tIntervalMeters, centerHeight );
+
+        if ( !HeightFieldUtils::getHeightAtNormalizedLocation(hood, nx-xres, ny, west.z()) )
+            west.x() = 0.0, 
+            west.z() = centerHeight;
+
+        if ( !HeightFieldUtils::getHeightAtNormalizedLocation(hood, nx+xres, ny, east.z()) )
+            east.x() = 0.0, 
+            east.z() = centerHeight;
+
+        if ( !HeightFieldUtils::getHeightAtNormalizedLocation(hood, nx, ny-yres, south.z()) )
+            south.y() = 0.0, 
+            south.z() = centerHeight;
+
+        if ( !HeightFieldUtils::getHeightAtNormalizedLocation(hood, nx, ny+yres, north.z()) )
+            north.y() = 0.0, 
+            north.z() = centerHeight;
+
+        // account for degenerate vectors
+        if (east.x() == 0.0 && west.x() == 0.0)
+            east.x() = sIntervalMeters;
+
+        if (north.y() == 0.0 && south.y() == 0.0)
+            north.y() = tIntervalMeters;
+
+        osg::Vec3f n = (east - west) ^ (north - south);
+        n.normalize();
+
+        // calculate and encode curvature (2nd derivative of elevation)
+        float D = (0.5*(west.z()+east.z()) - centerHeight) / (sIntervalMeters*sIntervalMeters);
+        float E = (0.5*(south.z()+north.z()) - centerHeight) / (tIntervalMeters*tIntervalMeters);
+        float curvature = osg::clampBetween(-2.0f*(D+E)*100.0f, -1.0f, 1.0f);
+
+        normalMap->set(s, t, n, curvature);
+        addCurvature(stats, &curvature, 1);
+    }
+
+    // Generic per-sample normal for createNormalMap; clamps at the image edges.
+    void imageSample(const ImageUtils::PixelReader& readElevation,
+                     int s, int t, int sMax, int tMax,
+                     double dx, double dy,
+                     NormalMap* normalMap,
+                     NormalMapStats* stats)
+    {
+        float h = readElevation(s, t).r();
+
+        osg::Vec3f west ( s > 0 ? -dx : 0, 0, h );
+        osg::Vec3f east ( s < sMax ?  dx : 0, 0, h );
+        osg::Vec3f south( 0, t > 0 ? -dy : 0, h );
+        osg::Vec3f north( 0, t < tMax ? dy : 0, h );
+
+        west.z() = readElevation(std::max(0, s - 1), t).r();
+        east.z() = readElevation(std::min(sMax, s + 1), t).r();
+        south.z() = readElevation(s, std::max(0, t - 1)).r();
+        north.z() = readElevation(s, std::min(tMax, t + 1)).r();
+
+        osg::Vec3f n = (east-west) ^ (north-south);
+        n.normalize();
+
+        // calculate and encode curvature (2nd derivative of elevation)
+        float D = (0.5*(west.z()+east.z()) - h) / (dx*dx);
+        float E = (0.5*(south.z()+north.z()) - h) / (dy*dy);
+        float curvature = osg::clampBetween(-2.0f*(D+E)*100.0f, -1.0f, 1.0f);
+
+        normalMap->set(s, t, n, curvature);
+        addCurvature(stats, &curvature, 1);
+    }
+}
+
 NormalMap*
 HeightFieldUtils::convertToNormalMap(const HeightFieldNeighborhood& hood,
-                                     const SpatialReference*        hoodSRS)
+                                     const SpatialReference*        hoodSRS,
+                                     NormalMapStats*                stats)
 {
     const osg::HeightField* hf = hood._center.get();
     if ( !hf )
         return 0L;
+
+    const int cols = (int)hf->getNumColumns();
+    const int rows = (int)hf->getNumRows();
     
-    NormalMap* normalMap = new NormalMap(hf->getNumColumns(), hf->getNumRows());
+    NormalMap* normalMap = new NormalMap(cols, rows);
 
-    double xcells = (double)(hf->getNumColumns()-1);
-    double ycells = (double)(hf->getNumRows()-1);
+    double xcells = (double)(cols-1);
+    double ycells = (double)(rows-1);
     double xres = 1.0/xcells;
     double yres = 1.0/ycells;
 
@@ -709,7 +872,41 @@ HeightFieldUtils::convertToNormalMap(const HeightFieldNeighborhood& hood,
         hoodSRS->isGeographic() ? hf->getYInterval() * mPerDegAtEquator :
         hf->getYInterval();
 
-    for(int t=0; t<(int)hf->getNumRows(); ++t)
+    // Scan for NO_DATA, collecting the height range on the way. Interior
+    // samples only read the center grid, so without NO_DATA they can skip
+    // the neighborhood lookups.
+    const osg::HeightField::HeightList& heights = hf->getHeightList();
+    unsigned noDataCount = 0u;
+    float minHeight = FLT_MAX, maxHeight = -FLT_MAX;
+    for(unsigned i=0; i<heights.size(); ++i)
+    {
+        float h = heights[i];
+        if (h == NO_DATA_VALUE)
+        {
+            ++noDataCount;
+        }
+        else
+        {
+            minHeight = osg::minimum(minHeight, h);
+            maxHeight = osg::maximum(maxHeight, h);
+        }
+    }
+
+    if (stats)
+    {
+        stats->_noDataCount += noDataCount;
+        stats->_minHeight = osg::minimum(stats->_minHeight, minHeight);
+        stats->_maxHeight = osg::maximum(stats->_maxHeight, maxHeight);
+    }
+
+    const bool fastPath =
+        noDataCount == 0u &&
+        cols >= 3 && rows >= 3 &&
+        isPackable(normalMap);
+
+    std::vector<float> curv(fastPath ? cols-2 : 0);
+
+    for(int t=0; t<rows; ++t)
     {
         // east-west interval in meters (changes for each row):
         double lat = hf->getOrigin().y() + hf->getYInterval()*(double)t;
@@ -717,57 +914,24 @@ HeightFieldUtils::convertToNormalMap(const HeightFieldNeighborhood& hood,
             hoodSRS->isGeographic() ? hf->getXInterval() * mPerDegAtEquator * cos(osg::DegreesToRadians(lat)) :
             hf->getXInterval();
 
-        for(int s=0; s<(int)hf->getNumColumns(); ++s)
+        if (fastPath && t > 0 && t < rows-1)
         {
-            float centerHeight = hf->getHeight(s, t);
-
-            double nx = xres*(double)s;
-            double ny = yres*(double)t;
+            neighborhoodSample(hood, hf, 0, t, xres, yres, sIntervalMeters, tIntervalMeters, normalMap, stats);
 
-            osg::Vec3f west ( -sIntervalMeters, 0, centerHeight );
-            osg::Vec3f east (  sIntervalMeters, 0, centerHeight );
-            osg::Vec3f south( 0, -tIntervalMeters, centerHeight );
-            osg::Vec3f north( 0,  tIntervalMeters, centerHeight );
+            const float* center = &heights[t*cols];
+            normalRow(center-cols, center, center+cols, cols-2,
+                      (float)sIntervalMeters, (float)tIntervalMeters,
+                      (GLubyte*)normalMap->data(1, t), &curv[0]);
+            addCurvature(stats, &curv[0], cols-2);
 
-            if ( !HeightFieldUtils::getHeightAtNormalizedLocation(hood, nx-xres, ny, west.z()) )
-                west.x() = 0.0, 
-                west.z() = centerHeight;
-
-            if ( !HeightFieldUtils::getHeightAtNormalizedLocation(hood, nx+xres, ny, east.z()) )
-                east.x() = 0.0, 
-                east.z() = centerHeight;
-
-            if ( !HeightFieldUtils::getHeightAtNormalizedLocation(hood, nx, ny-yres, south.z()) )
-                south.y() = 0.0, 
-                south.z() = centerHeight;
-
-            if ( !HeightFieldUtils::getHeightAtNormalizedLocation(hood, nx, ny+yres, north.z()) )
-                north.y() = 0.0, 
-                north.z() = centerHeight;
-
-            // account for degenerate vectors
-            if (east.x() == 0.0 && west.x() == 0.0)
-                east.x() = sIntervalMeters;
-
-            if (north.y() == 0.0 && south.y() == 0.0)
-                north.y() = tIntervalMeters;
-
-            osg::Vec3f n = (east - west) ^ (north - south);
-            n.normalize();
-
-            // calculate and encode curvature (2nd derivative of elevation)
-            //float L2inv = 1.0f/(sIntervalMeters*sIntervalMeters);
-            float D = (0.5*(west.z()+east.z()) - centerHeight) / (sIntervalMeters*sIntervalMeters); //* L2inv;
-            float E = (0.5*(south.z()+north.z()) - centerHeight) / (tIntervalMeters*tIntervalMeters); //* L2inv;
-            float curvature = osg::clampBetween(-2.0f*(D+E)*100.0f, -1.0f, 1.0f);
-
-            //// encode for RGBA [0..1]
-            //osg::Vec4f enc( n.x(), n.y(), n.z(), curvature );
-            //enc = (enc + osg::Vec4f(1.0,1.0,1.0,1.0))*0.5;
-
-            //write(enc, s, t);
-
-            normalMap->set(s, t, n, curvature);
+            neighborhoodSample(hood, hf, cols-1, t, xres, yres, sIntervalMeters, tIntervalMeters, normalMap, stats);
+        }
+        else
+        {
+            for(int s=0; s<cols; ++s)
+            {
+                neighborhoodSample(hood, hf, s, t, xres, yres, sIntervalMeters, tIntervalMeters, normalMap, stats);
+            }
         }
     }
 
@@ -778,19 +942,14 @@ HeightFieldUtils::convertToNormalMap(const HeightFieldNeighborhood& hood,
 void
 HeightFieldUtils::createNormalMap(const osg::Image* elevation,
                                   NormalMap* normalMap,
-                                  const GeoExtent& extent)
+                                  const GeoExtent& extent,
+                                  NormalMapStats* stats)
 {   
     ImageUtils::PixelReader readElevation(elevation);
-    //ImageUtils::PixelWriter writeNormal(normalMap);
 
     int sMax = (int)elevation->s()-1;
     int tMax = (int)elevation->t()-1;
     
-    double xcells = (double)(sMax);
-    double ycells = (double)(tMax);
-    double xres = 1.0/xcells;
-    double yres = 1.0/ycells;
-    
     // north-south interval in meters:
     double xInterval = extent.width() / (double)(sMax);
     double yInterval = extent.height() / (double)(tMax);
@@ -799,39 +958,57 @@ HeightFieldUtils::createNormalMap(const osg::Image* elevation,
     double mPerDegAtEquator = (srs->getEllipsoid()->getRadiusEquator() * 2.0 * osg::PI) / 360.0;
     double dy = srs->isGeographic() ? yInterval * mPerDegAtEquator : yInterval;
 
+    // Single-channel float elevation can be read a row at a time.
+    const bool fastPath =
+        elevation->getDataType() == GL_FLOAT &&
+        (elevation->getPixelFormat() == GL_LUMINANCE || elevation->getPixelFormat() == GL_RED) &&
+        sMax >= 2 && tMax >= 2 &&
+        normalMap->s() == elevation->s() && normalMap->t() == elevation->t() &&
+        isPackable(normalMap);
+
+    std::vector<float> curv(fastPath ? sMax-1 : 0);
+
     for (int t = 0; t<(int)elevation->t(); ++t)
     {
         double lat = extent.yMin() + yInterval*(double)t;
         double dx = srs->isGeographic() ? xInterval * mPerDegAtEquator * cos(osg::DegreesToRadians(lat)) : xInterval;
 
-        for(int s=0; s<(int)elevation->s(); ++s)
+        if (stats)
         {
-            float h = readElevation(s, t).r();
-
-            osg::Vec3f west ( s > 0 ? -dx : 0, 0, h );
-            osg::Vec3f east ( s < sMax ?  dx : 0, 0, h );
-            osg::Vec3f south( 0, t > 0 ? -dy : 0, h );
-            osg::Vec3f north( 0, t < tMax ? dy : 0, h );
-
-            west.z() = readElevation(std::max(0, s - 1), t).r();
-            east.z() = readElevation(std::min(sMax, s + 1), t).r();
-            south.z() = readElevation(s, std::max(0, t - 1)).r();
-            north.z() = readElevation(s, std::min(tMax, t + 1)).r();
-
-            osg::Vec3f n = (east-west) ^ (north-south);
-            n.normalize();
+            for(int s=0; s<(int)elevation->s(); ++s)
+            {
+                float h = readElevation(s, t).r();
+                if (h == NO_DATA_VALUE)
+                {
+                    stats->_noDataCount++;
+                }
+                else
+                {
+                    stats->_minHeight = osg::minimum(stats->_minHeight, h);
+                    stats->_maxHeight = osg::maximum(stats->_maxHeight, h);
+                }
+            }
+        }
 
-            // calculate and encode curvature (2nd derivative of elevation)
-            float D = (0.5*(west.z()+east.z()) - h) / (dx*dx);
-            float E = (0.5*(south.z()+north.z()) - h) / (dy*dy);
-            float curvature = osg::clampBetween(-2.0f*(D+E)*100.0f, -1.0f, 1.0f);
+        if (fastPath && t > 0 && t < tMax)
+        {
+            imageSample(readElevation, 0, t, sMax, tMax, dx, dy, normalMap, stats);
 
-            // encode for RGBA [0..1]
-            //osg::Vec4f NC( n.x(), n.y(), n.z(), curvature );
-            //NC = (NC + osg::Vec4f(1.0,1.0,1.0,1.0))*0.5;
+            normalRow((const float*)elevation->data(0, t-1),
+                      (const float*)elevation->data(0, t),
+                      (const float*)elevation->data(0, t+1),
+                      sMax-1, (float)dx, (float)dy,
+                      (GLubyte*)normalMap->data(1, t), &curv[0]);
+            addCurvature(stats, &curv[0], sMax-1);
 
-            normalMap->set(s, t, n, curvature);
-            //writeNormal(NC, s, t);
+            imageSample(readElevation, sMax, t, sMax, tMax, dx, dy, normalMap, stats);
+        }
+        else
+        {
+            for(int s=0; s<(int)elevation->s(); ++s)
+            {
+                imageSample(readElevation, s, t, sMax, tMax, dx, dy, normalMap, stats);
+            }
         }
     }
 }
@@ -29,6 +29,7 @@
 #include <osgEarth/Registry>
 #include <osgEarth/Capabilities>
 #include <osgEarth/Metrics>
+#include <osgEarth/TaskService>
 #include <osg/Version>
 #include <osgDB/WriteFile>
 #include <memory.h>
@@ -84,6 +85,7 @@ ImageLayerOptions::setDefaults()
     _minRange.init( 0.0 );
     _maxRange.init( FLT_MAX );
     _featherPixels.init( false );
+    _mosaicCacheSize.init( 16u );
     _minFilter.init( osg::Texture::LINEAR_MIPMAP_LINEAR );
     _magFilter.init( osg::Texture::LINEAR );
     _texcomp.init( osg::Texture::USE_IMAGE_DATA_FORMAT ); // none
@@ -107,6 +109,7 @@ ImageLayerOptions::fromConfig(const Config& conf)
     conf.getIfSet( "shared",         _shared );
     conf.getIfSet( "coverage",       _coverage );
     conf.getIfSet( "feather_pixels", _featherPixels);
+    conf.getIfSet( "mosaic_cache_size", _mosaicCacheSize);
 
     if ( conf.hasValue( "transparent_color" ) )
         _transparentColor = stringToColor( conf.value( "transparent_color" ), osg::Vec4ub(0,0,0,0));
@@ -152,6 +155,7 @@ ImageLayerOptions::getConfig() const
     conf.set( "shared",         _shared );
     conf.set( "coverage",       _coverage );
     conf.set( "feather_pixels", _featherPixels );
+    conf.set( "mosaic_cache_size", _mosaicCacheSize );
 
     if (_transparentColor.isSet())
         conf.set("transparent_color", colorToString( _transparentColor.value()));
@@ -297,7 +301,8 @@ ImageLayerTileProcessor::process( osg::ref_ptr<osg::Image>& image ) const
 
 ImageLayer::ImageLayer() :
 TerrainLayer(&_optionsConcrete),
-_options(&_optionsConcrete)
+_options(&_optionsConcrete),
+_mosaicCache(true)
 {
     init();
 }
@@ -305,7 +310,8 @@ _options(&_optionsConcrete)
 ImageLayer::ImageLayer(const ImageLayerOptions& options) :
 TerrainLayer(&_optionsConcrete),
 _options(&_optionsConcrete),
-_optionsConcrete(options)
+_optionsConcrete(options),
+_mosaicCache(true)
 {
     init();
 }
@@ -313,7 +319,8 @@ _optionsConcrete(options)
 ImageLayer::ImageLayer(const std::string& name, const TileSourceOptions& tileSourceOptions) :
 TerrainLayer(&_optionsConcrete),
 _options(&_optionsConcrete),
-_optionsConcrete(name, tileSourceOptions)
+_optionsConcrete(name, tileSourceOptions),
+_mosaicCache(true)
 {
     init();
 }
@@ -321,14 +328,16 @@ _optionsConcrete(name, tileSourceOptions)
 ImageLayer::ImageLayer(const ImageLayerOptions& options, TileSource* tileSource) :
 TerrainLayer(&_optionsConcrete, tileSource),
 _options(&_optionsConcrete),
-_optionsConcrete(options)
+_optionsConcrete(options),
+_mosaicCache(true)
 {
     init();
 }
 
 ImageLayer::ImageLayer(ImageLayerOptions* optionsPtr) :
 TerrainLayer(optionsPtr? optionsPtr : &_optionsConcrete),
-_options(optionsPtr? optionsPtr : &_optionsConcrete)
+_options(optionsPtr? optionsPtr : &_optionsConcrete),
+_mosaicCache(true)
 {
     //init(); // will be called by subclass.
 }
@@ -366,6 +375,9 @@ ImageLayer::init()
 
     // image layers render as a terrain texture.
     setRenderType(RENDERTYPE_TILE);
+
+    if (options().mosaicCacheSize().get() > 0u)
+        _mosaicCache.setMaxSize(options().mosaicCacheSize().get());
 }
 
 void
@@ -485,6 +497,8 @@ ImageLayer::createImage(const TileKey&    key,
         return GeoImage::INVALID;
     }
 
+    LayerCounters::ScopedFetch fetch( getCounters() );
+
     return createImageInKeyProfile( key, progress );
 }
 
@@ -599,7 +613,10 @@ ImageLayer::createImageInKeyProfile(const TileKey&    key,
         CacheBin* bin = _memCache->getOrCreateDefaultBin();
         ReadResult result = bin->readObject(cacheKey, 0L);
         if ( result.succeeded() )
+        {
+            getCounters()->recordCacheHit();
             return GeoImage(static_cast<osg::Image*>(result.releaseObject()), key.getExtent());
+        }
     }
 
     // locate the cache bin for the target profile for this layer:
@@ -644,6 +661,7 @@ ImageLayer::createImageInKeyProfile(const TileKey&    key,
             if (!expired)
             {
                 OE_DEBUG << "Got cached image for " << key.str() << std::endl;                
+                getCounters()->recordCacheHit();
                 return GeoImage( cachedImage.get(), key.getExtent() );                        
             }
             else
@@ -652,6 +670,11 @@ ImageLayer::createImageInKeyProfile(const TileKey&    key,
             }
         }
     }
+
+    if ( _memCache.valid() || (cacheBin && policy.isCacheReadable()) )
+    {
+        getCounters()->recordCacheMiss();
+    }
     
     // The data was not in the cache. If we are cache-only, fail sliently
     if ( policy.isCacheOnly() )
@@ -761,7 +784,14 @@ ImageLayer::createImageFromTileSource(const TileKey&    key,
     //}
 
     // create an image from the tile source.
+    osg::Timer_t start = osg::Timer::instance()->tick();
     osg::ref_ptr<osg::Image> result = source->createImage( key, op.get(), progress );   
+    getCounters()->recordDecode(osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick()));
+
+    if (result.valid())
+    {
+        getCounters()->recordBytesDecoded(result->getTotalSizeInBytesIncludingMipmaps());
+    }
 
     // Process images with full alpha to properly support MP blending.    
     if (result.valid() && 
@@ -786,6 +816,66 @@ ImageLayer::createImageFromTileSource(const TileKey&    key,
 }
 
 
+namespace
+{
+    // Make sure all images in a color mosaic are based on "RGBA - unsigned byte" pixels.
+    // This is not the smarter choice (in some case RGB would be sufficient) but
+    // it ensure consistency between all images / layers.
+    //
+    // The main drawback is probably the CPU memory foot-print which would be reduced by allocating RGB instead of RGBA images.
+    // On GPU side, this should not change anything because of data alignements : often RGB and RGBA textures have the same memory footprint
+    //
+    void normalizeMosaicImage(GeoImage& image)
+    {
+        ImageUtils::fixInternalFormat(image.getImage());
+
+        if (   (image.getImage()->getDataType() != GL_UNSIGNED_BYTE)
+            || (image.getImage()->getPixelFormat() != GL_RGBA) )
+        {
+            osg::ref_ptr<osg::Image> convertedImg = ImageUtils::convertToRGBA8(image.getImage());
+            if (convertedImg.valid())
+            {
+                image = GeoImage(convertedImg, image.getExtent());
+            }
+        }
+    }
+
+    // Fetches one source tile of a mosaic.
+    struct FetchMosaicTile
+    {
+        FetchMosaicTile() : layer(0L) { }
+
+        void execute()
+        {
+            if ( progress.valid() && progress->isCanceled() )
+                return;
+
+            result = layer->createImageImplementation( key, progress.get() );
+
+            if ( result.valid() && !layer->isCoverage() )
+                normalizeMosaicImage( result );
+        }
+
+        ImageLayer*                          layer;
+        TileKey                              key;
+        osg::ref_ptr<ChildProgressCallback>  progress;
+        GeoImage                             result;
+    };
+
+    typedef ParallelTask<FetchMosaicTile> FetchMosaicTileTask;
+
+    Threading::Mutex s_mosaicServiceMutex;
+    UID              s_mosaicServiceUID = -1;
+
+    TaskService* getMosaicService()
+    {
+        Threading::ScopedMutexLock lock( s_mosaicServiceMutex );
+        if ( s_mosaicServiceUID < 0 )
+            s_mosaicServiceUID = Registry::instance()->createUID();
+        return Registry::instance()->getTaskServiceManager()->getOrAdd( s_mosaicServiceUID );
+    }
+}
+
 GeoImage
 ImageLayer::assembleImage(const TileKey& key, ProgressCallback* progress)
 {
@@ -823,49 +913,74 @@ ImageLayer::assembleImage(const TileKey& key, ProgressCallback* progress)
         // keep track of failed tiles.
         std::vector<TileKey> failedKeys;
 
+        // Neighboring tiles overlap the same source tiles, so check the recently
+        // used ones first. The rest we fetch in parallel.
+        bool useCache = options().mosaicCacheSize().get() > 0u && !isDynamic();
+        std::vector< osg::ref_ptr<FetchMosaicTileTask> > tasks;
+
         for( std::vector<TileKey>::iterator k = intersectingKeys.begin(); k != intersectingKeys.end(); ++k )
         {
-            GeoImage image = createImageImplementation( *k, progress );
+            LRUCache<TileKey, GeoImage>::Record rec;
+            if ( useCache && _mosaicCache.get(*k, rec) )
+            {
+                mosaic.getImages().push_back( TileImage(rec.value().getImage(), *k) );
+            }
+            else
+            {
+                FetchMosaicTileTask* task = new FetchMosaicTileTask();
+                task->layer = this;
+                task->key = *k;
+                if ( progress )
+                    task->progress = new ChildProgressCallback(progress);
+                tasks.push_back( task );
+            }
+        }
 
-            if ( image.valid() )
+        if ( tasks.size() > 1u && !TaskService::isPoolThread() )
+        {
+            // run the first one here while the service runs the rest:
+            TaskService* service = getMosaicService();
+            Threading::MultiEvent done( tasks.size()-1 );
+            for(unsigned i = 1; i < tasks.size(); ++i)
             {
-                if ( !isCoverage() )
-                {
-                    ImageUtils::fixInternalFormat(image.getImage());
-
-                    // Make sure all images in mosaic are based on "RGBA - unsigned byte" pixels.
-                    // This is not the smarter choice (in some case RGB would be sufficient) but
-                    // it ensure consistency between all images / layers.
-                    //
-                    // The main drawback is probably the CPU memory foot-print which would be reduced by allocating RGB instead of RGBA images.
-                    // On GPU side, this should not change anything because of data alignements : often RGB and RGBA textures have the same memory footprint
-                    //
-                    if (   (image.getImage()->getDataType() != GL_UNSIGNED_BYTE)
-                        || (image.getImage()->getPixelFormat() != GL_RGBA) )
-                    {
-                        osg::ref_ptr<osg::Image> convertedImg = ImageUtils::convertToRGBA8(image.getImage());
-                        if (convertedImg.valid())
-                        {
-                            image = GeoImage(convertedImg, image.getExtent());
-                        }
-                    }
-                }
+                tasks[i]->_mev = &done;
+                service->add( tasks[i].get() );
+            }
+            tasks[0]->execute();
+            done.wait();
+        }
+        else
+        {
+            for(unsigned i = 0; i < tasks.size(); ++i)
+                tasks[i]->execute();
+        }
 
-                mosaic.getImages().push_back( TileImage(image.getImage(), *k) );
+        for(unsigned i = 0; i < tasks.size(); ++i)
+        {
+            FetchMosaicTile& fetch = *tasks[i].get();
+
+            if ( fetch.progress.valid() )
+                fetch.progress->merge();
+
+            if ( fetch.result.valid() )
+            {
+                if ( useCache )
+                    _mosaicCache.insert( fetch.key, fetch.result );
+
+                mosaic.getImages().push_back( TileImage(fetch.result.getImage(), fetch.key) );
             }
             else
             {
                 // the tile source did not return a tile, so make a note of it.
-                failedKeys.push_back( *k );
-
-                if (progress && (progress->isCanceled() || progress->needsRetry()))
-                {
-                    retry = true;
-                    break;
-                }
+                failedKeys.push_back( fetch.key );
             }
         }
 
+        if (!failedKeys.empty() && progress && (progress->isCanceled() || progress->needsRetry()))
+        {
+            retry = true;
+        }
+
         if ( mosaic.getImages().empty() || retry )
         {
             // if we didn't get any data, fail.
@@ -891,16 +1006,7 @@ ImageLayer::assembleImage(const TileKey& key, ProgressCallback* progress)
 
                     if ( !isCoverage() )
                     {
-                        ImageUtils::fixInternalFormat(image.getImage());
-                        if (   (image.getImage()->getDataType() != GL_UNSIGNED_BYTE)
-                            || (image.getImage()->getPixelFormat() != GL_RGBA) )
-                        {
-                            osg::ref_ptr<osg::Image> convertedImg = ImageUtils::convertToRGBA8(image.getImage());
-                            if (convertedImg.valid())
-                            {
-                                image = GeoImage(convertedImg, image.getExtent());
-                            }
-                        }
+                        normalizeMosaicImage(image);
 
                         cropped = image.crop( k->getExtent(), false, image.getImage()->s(), image.getImage()->t() );
                     }
@@ -23,6 +23,7 @@
 #include <osg/Notify>
 #include <osg/Timer>
 #include <osg/io_utils>
+#include <memory.h>
 
 #define LC "[ImageMosaic] "
 
@@ -118,10 +119,38 @@ ImageMosaic::createImage()
     //Initialize the image to be completely white!
     //memset(image->data(), 0xFF, image->getImageSizeInBytes());
 
-    ImageUtils::PixelWriter write(image.get());
-    for (unsigned t = 0; t < pixelsHigh; ++t)
-        for (unsigned s = 0; s < pixelsWide; ++s)
-            write(osg::Vec4(1,1,1,0), s, t);
+    // Only needed when some of the tiles are missing; the rest get overwritten.
+    unsigned numTiles = 0u;
+    for (TileImageList::iterator i = _images.begin(); i != _images.end(); ++i)
+        if (i->_image.valid())
+            ++numTiles;
+
+    if (numTiles < tilesWide * tilesHigh)
+    {
+        ImageUtils::PixelWriter write(image.get());
+        unsigned pixelBytes = image->getPixelSizeInBits() / 8u;
+
+        if (pixelBytes > 0u && image->getPixelSizeInBits() % 8u == 0u)
+        {
+            // write one pixel, then replicate it across the first row and
+            // that row down the rest of the image.
+            for (unsigned r = 0; r < tileDepth; ++r)
+            {
+                write(osg::Vec4(1,1,1,0), 0, 0, r);
+                unsigned char* row0 = image->data(0, 0, r);
+                for (unsigned s = 1; s < pixelsWide; ++s)
+                    memcpy(row0 + s*pixelBytes, row0, pixelBytes);
+                for (unsigned t = 1; t < pixelsHigh; ++t)
+                    memcpy(image->data(0, t, r), row0, pixelsWide*pixelBytes);
+            }
+        }
+        else
+        {
+            for (unsigned t = 0; t < pixelsHigh; ++t)
+                for (unsigned s = 0; s < pixelsWide; ++s)
+                    write(osg::Vec4(1,1,1,0), s, t);
+        }
+    }
 
     //Composite the incoming images into the master image
     for (TileImageList::iterator i = _images.begin(); i != _images.end(); ++i)
@@ -713,6 +713,29 @@ namespace
             return true;
         }
     };
+
+    bool isRGBA8(const osg::Image* image)
+    {
+        return
+            image->getPixelFormat() == GL_RGBA &&
+            image->getDataType() == GL_UNSIGNED_BYTE;
+    }
+
+    // Same blend as MixImage, on 8-bit RGBA rows in fixed point. The loop has
+    // no branches or calls so the compiler can vectorize it. Results can differ
+    // from the float path by one step, since this rounds where the writer truncates.
+    void mixRowRGBA8(unsigned char* dest, const unsigned char* src, unsigned width, unsigned a256)
+    {
+        for (unsigned i = 0; i < width; ++i, dest += 4, src += 4)
+        {
+            unsigned sa = (a256 * src[3] + 128u) >> 8;
+            unsigned da = 255u - sa;
+            dest[0] = (unsigned char)((dest[0]*da + src[0]*sa + 127u) / 255u);
+            dest[1] = (unsigned char)((dest[1]*da + src[1]*sa + 127u) / 255u);
+            dest[2] = (unsigned char)((dest[2]*da + src[2]*sa + 127u) / 255u);
+            dest[3] = (unsigned char)(sa > dest[3] ? sa : dest[3]);
+        }
+    }
 }
 
 bool
@@ -724,6 +747,16 @@ ImageUtils::mix(osg::Image* dest, const osg::Image* src, float a)
     {
         return false;
     }
+
+    // fast path for the common case of two 8-bit RGBA tiles:
+    if (isRGBA8(src) && isRGBA8(dest))
+    {
+        unsigned a256 = (unsigned)(osg::clampBetween( a, 0.0f, 1.0f ) * 256.0f + 0.5f);
+        for (int r = 0; r < dest->r(); ++r)
+            for (int t = 0; t < dest->t(); ++t)
+                mixRowRGBA8( dest->data(0, t, r), src->data(0, t, r), dest->s(), a256 );
+        return true;
+    }
     
     PixelVisitor<MixImage> mixer;
     mixer._a = osg::clampBetween( a, 0.0f, 1.0f );
@@ -1299,6 +1332,27 @@ ImageUtils::hasTransparency(const osg::Image* image, float threshold)
     if ( !image || !hasAlphaChannel(image) || !PixelReader::supports(image) )
         return false;
 
+    // fast path for 8-bit RGBA: scan the alpha bytes directly.
+    if ( isRGBA8(image) )
+    {
+        // smallest alpha byte that is not below the threshold:
+        unsigned cutoff = 0u;
+        while ( cutoff < 256u && (float)cutoff/255.0f < threshold )
+            ++cutoff;
+
+        for( int r=0; r<image->r(); ++r)
+        {
+            for( int t=0; t<image->t(); ++t )
+            {
+                const unsigned char* alpha = image->data(0, t, r) + 3;
+                for( int s=0; s<image->s(); ++s, alpha += 4 )
+                    if ( *alpha < cutoff )
+                        return true;
+            }
+        }
+        return false;
+    }
+
     PixelReader read(image);
     for( int r=0; r<image->r(); ++r)
         for( int t=0; t<image->t(); ++t )
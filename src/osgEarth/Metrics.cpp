@@ -17,10 +17,14 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include <osgEarth/Metrics>
+#include <osgEarth/TraceMetrics>
 #include <osgEarth/ThreadingUtils>
 #include <osgEarth/Memory>
 #include <osgViewer/Viewer>
+#include <osgDB/FileNameUtils>
 #include <cstdarg>
+#include <map>
+#include <vector>
 
 using namespace osgEarth;
 
@@ -31,6 +35,11 @@ namespace
     static osg::ref_ptr< MetricsBackend > s_metrics_backend;
     static bool s_metrics_debug = false;
 
+    // interned event names; index 0 is unused
+    static Threading::ReadWriteMutex       s_eventNamesMutex;
+    static std::vector<std::string>        s_eventNames(1);
+    static std::map<std::string, unsigned> s_eventIDs;
+
     class MetricsStartup
     {
     public:
@@ -39,7 +48,12 @@ namespace
             const char* metricsFile = ::getenv("OSGEARTH_METRICS_FILE");
             if (metricsFile)
             {
-                Metrics::setMetricsBackend(new ChromeMetricsBackend(std::string(metricsFile)));
+                // The binary trace format is much cheaper to record; convert it
+                // with osgearth_trace afterwards.
+                if (osgDB::getLowerCaseFileExtension(metricsFile) == "oetrace")
+                    Metrics::setMetricsBackend(new TraceMetricsBackend(std::string(metricsFile)));
+                else
+                    Metrics::setMetricsBackend(new ChromeMetricsBackend(std::string(metricsFile)));
             }
             const char* metricsVerbose = ::getenv("OSGEARTH_METRICS_DEBUG");
             if (metricsVerbose)
@@ -170,6 +184,60 @@ void Metrics::counter(const std::string& graph,const std::string& name0, double
     }
 }
 
+unsigned Metrics::intern(const char* name)
+{
+    std::string key(name ? name : "");
+    {
+        Threading::ScopedReadLock shared(s_eventNamesMutex);
+        std::map<std::string, unsigned>::const_iterator i = s_eventIDs.find(key);
+        if (i != s_eventIDs.end())
+            return i->second;
+    }
+
+    Threading::ScopedWriteLock exclusive(s_eventNamesMutex);
+    unsigned& id = s_eventIDs[key];
+    if (id == 0u)
+    {
+        id = s_eventNames.size();
+        s_eventNames.push_back(key);
+    }
+    return id;
+}
+
+std::string Metrics::getEventName(unsigned id)
+{
+    Threading::ScopedReadLock shared(s_eventNamesMutex);
+    return id < s_eventNames.size() ? s_eventNames[id] : std::string();
+}
+
+unsigned Metrics::getNumEventNames()
+{
+    Threading::ScopedReadLock shared(s_eventNamesMutex);
+    return s_eventNames.size() - 1u;
+}
+
+void Metrics::beginEvent(unsigned id)
+{
+    if (s_metrics_backend.valid())
+    {
+        if (s_metrics_debug)
+            OE_INFO << LC << "begin: " << getEventName(id) << std::endl;
+
+        s_metrics_backend->beginEvent(id);
+    }
+}
+
+void Metrics::endEvent(unsigned id)
+{
+    if (s_metrics_backend.valid())
+    {
+        s_metrics_backend->endEvent(id);
+
+        if (s_metrics_debug)
+            OE_INFO << LC << "end: " << getEventName(id) << std::endl;
+    }
+}
+
 MetricsBackend* Metrics::getMetricsBackend()
 {
     return s_metrics_backend.get();
@@ -310,6 +378,16 @@ int Metrics::run(osgViewer::Viewer& viewer)
 
 
 
+void MetricsBackend::beginEvent(unsigned id)
+{
+    begin(Metrics::getEventName(id));
+}
+
+void MetricsBackend::endEvent(unsigned id)
+{
+    end(Metrics::getEventName(id));
+}
+
 ChromeMetricsBackend::ChromeMetricsBackend(const std::string& filename):
 _firstEvent(true)
 {
@@ -495,3 +573,21 @@ ScopedMetric::~ScopedMetric()
     Metrics::end(_name);
 }
 
+ScopedMetricEvent::ScopedMetricEvent(unsigned& id, const char* name) :
+_id(0u)
+{
+    if (s_metrics_backend.valid())
+    {
+        // benign race: every thread interns the same name to the same ID
+        if (id == 0u)
+            id = Metrics::intern(name);
+        _id = id;
+        Metrics::beginEvent(_id);
+    }
+}
+
+ScopedMetricEvent::~ScopedMetricEvent()
+{
+    if (_id != 0u)
+        Metrics::endEvent(_id);
+}
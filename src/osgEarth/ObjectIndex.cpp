@@ -88,7 +88,14 @@ ObjectIndex::loadShaders(VirtualProgram* vp) const
 void
 ObjectIndex::setObjectIDAtrribLocation(int value)
 {
-    if ( _index.size() == 0 )
+    bool empty = true;
+    for (unsigned i = 0; i < NUM_SHARDS && empty; ++i)
+    {
+        Threading::ScopedMutexLock lock( _shards[i]._mutex );
+        empty = _shards[i]._ranges.empty();
+    }
+
+    if ( empty )
     {
         _attribLocation = value;
     } 
@@ -101,49 +108,114 @@ ObjectIndex::setObjectIDAtrribLocation(int value)
 ObjectID
 ObjectIndex::insert(osg::Referenced* object)
 {
-    Threading::ScopedMutexLock excl( _mutex );
-    return insertImpl( object );
+    return insert( object, 1u );
 }
 
 ObjectID
-ObjectIndex::insertImpl(osg::Referenced* object)
+ObjectIndex::insert(osg::Referenced* object, unsigned count)
 {
-    // internal: assume mutex is locked
-    ObjectID id = ++_idGen;
-    _index[id] = object;
-    OE_DEBUG << LC << "Insert " << id << "; size = " << _index.size() << "\n";
-    return id;
+    if ( count == 0u )
+        return OSGEARTH_OBJECTID_EMPTY;
+
+    ObjectID first;
+    {
+        Threading::ScopedMutexLock lock( _idGenMutex );
+        first = _idGen + 1;
+        _idGen += count;
+    }
+
+    // record the block, one range per span it touches.
+    for (ObjectID id = first; count > 0u; )
+    {
+        unsigned n = std::min( count, (unsigned)(SHARD_SPAN - (id % SHARD_SPAN)) );
+
+        Shard& shard = getShard( id );
+        Threading::ScopedMutexLock lock( shard._mutex );
+        Range& range = shard._ranges[id];
+        range._count = n;
+        range._live = n;
+        range._object = object;
+
+        id += n;
+        count -= n;
+    }
+
+    OE_DEBUG << LC << "Insert " << first << "\n";
+    return first;
 }
 
-osg::Referenced*
+osg::ref_ptr<osg::Referenced>
 ObjectIndex::getImpl(ObjectID id) const
 {
-    // assume the mutex is locked
-    IndexMap::const_iterator i = _index.find(id);
-    return i != _index.end() ? i->second.get() : 0L;
+    const Shard& shard = getShard( id );
+    Threading::ScopedMutexLock lock( shard._mutex );
+
+    // the last range starting at or before the ID
+    RangeMap::const_iterator i = shard._ranges.upper_bound( id );
+    if ( i == shard._ranges.begin() )
+        return 0L;
+    --i;
+
+    const Range& range = i->second;
+    unsigned offset = id - i->first;
+    if ( offset >= range._count || (!range._removed.empty() && range._removed[offset]) )
+        return 0L;
+
+    return range._object.get();
 }
 
 void
 ObjectIndex::remove(ObjectID id)
 {
-    Threading::ScopedMutexLock excl(_mutex);
     removeImpl(id);
 }
 
 void
 ObjectIndex::removeImpl(ObjectID id)
 {
-    // internal - assume mutex is locked
-    _index.erase( id );
-    OE_DEBUG << "Remove " << id << "; size = " << _index.size() << "\n";
+    Shard& shard = getShard( id );
+    Threading::ScopedMutexLock lock( shard._mutex );
 
+    RangeMap::iterator i = shard._ranges.upper_bound( id );
+    if ( i == shard._ranges.begin() )
+        return;
+    --i;
+
+    Range& range = i->second;
+    unsigned offset = id - i->first;
+    if ( offset >= range._count )
+        return;
+
+    // removing an ID twice is a no-op, so it can't release IDs still in use.
+    if ( range._count > 1u )
+    {
+        if ( range._removed.empty() )
+            range._removed.resize( range._count, false );
+        if ( range._removed[offset] )
+            return;
+        range._removed[offset] = true;
+    }
+
+    if ( --range._live == 0u )
+    {
+        shard._ranges.erase( i );
+    }
+    OE_DEBUG << LC << "Remove " << id << "\n";
+}
+
+void
+ObjectIndex::removeRange(ObjectID first, unsigned count)
+{
+    for (ObjectID id = first; id < first + count; ++id)
+    {
+        removeImpl( id );
+    }
 }
 
 ObjectID
 ObjectIndex::tagDrawable(osg::Drawable* drawable, osg::Referenced* object)
 {
-    Threading::ScopedMutexLock lock(_mutex);
-    ObjectID oid = insertImpl(object);
+    ObjectID oid = insert(object);
     tagDrawable(drawable, oid);
     return oid;
 }
@@ -200,8 +272,7 @@ namespace
 ObjectID
 ObjectIndex::tagAllDrawables(osg::Node* node, osg::Referenced* object)
 {
-    Threading::ScopedMutexLock lock(_mutex);
-    ObjectID oid = insertImpl(object);
+    ObjectID oid = insert(object);
     tagAllDrawables(node, oid);
     return oid;
 }
@@ -219,8 +290,7 @@ ObjectIndex::tagAllDrawables(osg::Node* node, ObjectID id) const
 ObjectID
 ObjectIndex::tagNode(osg::Node* node, osg::Referenced* object)
 {
-    Threading::ScopedMutexLock lock(_mutex);
-    ObjectID oid = insertImpl(object);
+    ObjectID oid = insert(object);
     tagNode(node, oid);
     return oid;
 }
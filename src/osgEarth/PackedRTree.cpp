@@ -0,0 +1,262 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/PackedRTree>
+#include <algorithm>
+
+using namespace osgEarth;
+
+namespace
+{
+    // Position of (x, y) along a Hilbert curve through a 65536 x 65536 grid.
+    // (Branch-free formulation after "Fast Hilbert curve generation" by
+    // rawrunprotected.)
+    unsigned hilbert(unsigned x, unsigned y)
+    {
+        unsigned a = x ^ y;
+        unsigned b = 0xFFFF ^ a;
+        unsigned c = 0xFFFF ^ (x | y);
+        unsigned d = x & (y ^ 0xFFFF);
+
+        unsigned A = a | (b >> 1);
+        unsigned B = (a >> 1) ^ a;
+        unsigned C = ((c >> 1) ^ (b & (d >> 1))) ^ c;
+        unsigned D = ((a & (c >> 1)) ^ (d >> 1)) ^ d;
+
+        a = A; b = B; c = C; d = D;
+        A = ((a & (a >> 2)) ^ (b & (b >> 2)));
+        B = ((a & (b >> 2)) ^ (b & ((a ^ b) >> 2)));
+        C ^= ((a & (c >> 2)) ^ (b & (d >> 2)));
+        D ^= ((b & (c >> 2)) ^ ((a ^ b) & (d >> 2)));
+
+        a = A; b = B; c = C; d = D;
+        A = ((a & (a >> 4)) ^ (b & (b >> 4)));
+        B = ((a & (b >> 4)) ^ (b & ((a ^ b) >> 4)));
+        C ^= ((a & (c >> 4)) ^ (b & (d >> 4)));
+        D ^= ((b & (c >> 4)) ^ ((a ^ b) & (d >> 4)));
+
+        a = A; b = B; c = C; d = D;
+        C ^= ((a & (c >> 8)) ^ (b & (d >> 8)));
+        D ^= ((b & (c >> 8)) ^ ((a ^ b) & (d >> 8)));
+
+        a = C ^ (C >> 1);
+        b = D ^ (D >> 1);
+
+        unsigned i0 = x ^ y;
+        unsigned i1 = b | (0xFFFF ^ (i0 | a));
+
+        i0 = (i0 | (i0 << 8)) & 0x00FF00FF;
+        i0 = (i0 | (i0 << 4)) & 0x0F0F0F0F;
+        i0 = (i0 | (i0 << 2)) & 0x33333333;
+        i0 = (i0 | (i0 << 1)) & 0x55555555;
+
+        i1 = (i1 | (i1 << 8)) & 0x00FF00FF;
+        i1 = (i1 | (i1 << 4)) & 0x0F0F0F0F;
+        i1 = (i1 | (i1 << 2)) & 0x33333333;
+        i1 = (i1 | (i1 << 1)) & 0x55555555;
+
+        return (i1 << 1) | i0;
+    }
+
+    // maps a coordinate into [0..65535] across the given range
+    unsigned quantize(double v, double vmin, double range)
+    {
+        if (range <= 0.0)
+            return 0u;
+        double t = (v - vmin) / range;
+        return t <= 0.0 ? 0u : t >= 1.0 ? 0xFFFFu : (unsigned)(t * 65535.0);
+    }
+}
+
+void
+PackedRTree::Box::expandBy(const Box& rhs)
+{
+    _xmin = std::min(_xmin, rhs._xmin);
+    _ymin = std::min(_ymin, rhs._ymin);
+    _xmax = std::max(_xmax, rhs._xmax);
+    _ymax = std::max(_ymax, rhs._ymax);
+}
+
+PackedRTree::PackedRTree(unsigned nodeSize) :
+_nodeSize(std::max(nodeSize, 2u)),
+_numItems(0u),
+_built(false)
+{
+    //nop
+}
+
+void
+PackedRTree::insert(const Box& box, unsigned id)
+{
+    if (_built)
+    {
+        // drop the node levels; the items stay in Hilbert order
+        _boxes.resize(_numItems);
+        _indices.resize(_numItems);
+        _levelEnds.clear();
+        _built = false;
+    }
+
+    if (_numItems == 0u)
+        _bounds = box;
+    else
+        _bounds.expandBy(box);
+
+    _boxes.push_back(box);
+    _indices.push_back(id);
+    ++_numItems;
+}
+
+void
+PackedRTree::clear()
+{
+    _boxes.clear();
+    _indices.clear();
+    _levelEnds.clear();
+    _numItems = 0u;
+    _built = false;
+}
+
+void
+PackedRTree::build()
+{
+    if (_built)
+        return;
+
+    _levelEnds.clear();
+
+    if (_numItems > 0u)
+    {
+        // sort the items along a Hilbert curve through their centers:
+        double width  = _bounds._xmax - _bounds._xmin;
+        double height = _bounds._ymax - _bounds._ymin;
+
+        std::vector< std::pair<unsigned, unsigned> > order(_numItems);
+        for (unsigned i = 0; i < _numItems; ++i)
+        {
+            const Box& b = _boxes[i];
+            order[i].first = hilbert(
+                quantize(0.5*(b._xmin + b._xmax), _bounds._xmin, width),
+                quantize(0.5*(b._ymin + b._ymax), _bounds._ymin, height));
+            order[i].second = i;
+        }
+        std::sort(order.begin(), order.end());
+
+        std::vector<Box> boxes(_numItems);
+        std::vector<unsigned> indices(_numItems);
+        for (unsigned i = 0; i < _numItems; ++i)
+        {
+            boxes[i] = _boxes[order[i].second];
+            indices[i] = _indices[order[i].second];
+        }
+        _boxes.swap(boxes);
+        _indices.swap(indices);
+
+        // pack each level into full nodes until one node remains:
+        unsigned start = 0u;
+        unsigned end = _numItems;
+        _levelEnds.push_back(end);
+
+        while (end - start > 1u)
+        {
+            for (unsigned i = start; i < end; i += _nodeSize)
+            {
+                unsigned last = std::min(i + _nodeSize, end);
+                Box node = _boxes[i];
+                for (unsigned j = i + 1; j < last; ++j)
+                    node.expandBy(_boxes[j]);
+                _boxes.push_back(node);
+                _indices.push_back(i);
+            }
+            start = end;
+            end = _boxes.size();
+            _levelEnds.push_back(end);
+        }
+    }
+
+    _built = true;
+}
+
+unsigned
+PackedRTree::query(const Box& box, std::vector<unsigned>& out_ids) const
+{
+    unsigned count = 0u;
+
+    if (_numItems == 0u)
+        return count;
+
+    // not built yet? fall back on testing every item.
+    if (!_built)
+    {
+        for (unsigned i = 0; i < _numItems; ++i)
+        {
+            if (_boxes[i].intersects(box))
+            {
+                out_ids.push_back(_indices[i]);
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    unsigned root = _boxes.size() - 1u;
+    if (!_boxes[root].intersects(box))
+        return count;
+
+    if (_levelEnds.size() == 1u)
+    {
+        out_ids.push_back(_indices[root]);
+        return 1u;
+    }
+
+    // stack of (node offset, level) pairs
+    std::vector< std::pair<unsigned, unsigned> > stack;
+    stack.reserve(64);
+    stack.push_back(std::make_pair(root, (unsigned)_levelEnds.size() - 1u));
+
+    while (!stack.empty())
+    {
+        unsigned node  = stack.back().first;
+        unsigned level = stack.back().second;
+        stack.pop_back();
+
+        unsigned first = _indices[node];
+        unsigned last  = std::min(first + _nodeSize, _levelEnds[level - 1u]);
+
+        for (unsigned c = first; c < last; ++c)
+        {
+            if (!_boxes[c].intersects(box))
+                continue;
+
+            if (level == 1u)
+            {
+                out_ids.push_back(_indices[c]);
+                ++count;
+            }
+            else
+            {
+                stack.push_back(std::make_pair(c, level - 1u));
+            }
+        }
+    }
+
+    return count;
+}
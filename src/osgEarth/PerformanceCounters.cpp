@@ -0,0 +1,410 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/PerformanceCounters>
+#include <osgEarth/JsonUtils>
+#include <osgEarth/Notify>
+#include <osgDB/FileNameUtils>
+#include <osgDB/fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace osgEarth;
+
+#define LC "[PerformanceCounters] "
+
+namespace
+{
+    // Upper bounds of the latency buckets, in milliseconds. The last
+    // bucket catches everything slower.
+    const double s_latencyBounds[LayerCounters::NUM_LATENCY_BUCKETS-1] = {
+        1.0, 2.0, 5.0, 10.0, 25.0, 50.0, 100.0, 250.0, 500.0, 1000.0, 2500.0, 5000.0, 10000.0 };
+
+    // Escapes a Prometheus label value.
+    std::string escapeLabel(const std::string& value)
+    {
+        std::string out;
+        out.reserve(value.size());
+        for(std::string::const_iterator c = value.begin(); c != value.end(); ++c)
+        {
+            if      (*c == '\\') out += "\\\\";
+            else if (*c == '"')  out += "\\\"";
+            else if (*c == '\n') out += "\\n";
+            else                 out += *c;
+        }
+        return out;
+    }
+
+    std::string labels(const LayerCounters* c)
+    {
+        return "kind=\"" + escapeLabel(c->getKind()) + "\",name=\"" + escapeLabel(c->getName()) + "\"";
+    }
+
+    // Writes a one-sample-per-source metric family.
+    template<typename FUNC>
+    void writeFamily(std::ostream& out,
+                     const std::vector< osg::ref_ptr<LayerCounters> >& counters,
+                     const std::vector<LayerCounters::Stats>& stats,
+                     const char* metric, const char* type, const char* help,
+                     FUNC value)
+    {
+        out << "# HELP " << metric << " " << help << "\n";
+        out << "# TYPE " << metric << " " << type << "\n";
+        for(unsigned i=0; i<counters.size(); ++i)
+        {
+            out << metric << "{" << labels(counters[i].get()) << "} " << value(stats[i]) << "\n";
+        }
+    }
+
+    struct Fetches       { double operator()(const LayerCounters::Stats& s) const { return s._fetches; } };
+    struct MaxFetchTime  { double operator()(const LayerCounters::Stats& s) const { return s._maxFetchTime; } };
+    struct CacheHits     { double operator()(const LayerCounters::Stats& s) const { return s._cacheHits; } };
+    struct CacheMisses   { double operator()(const LayerCounters::Stats& s) const { return s._cacheMisses; } };
+    struct BytesRead     { double operator()(const LayerCounters::Stats& s) const { return s._bytesRead; } };
+    struct BytesDecoded  { double operator()(const LayerCounters::Stats& s) const { return s._bytesDecoded; } };
+    struct Decodes       { double operator()(const LayerCounters::Stats& s) const { return s._decodes; } };
+    struct DecodeTime    { double operator()(const LayerCounters::Stats& s) const { return s._decodeTime; } };
+    struct QueueDepth    { double operator()(const LayerCounters::Stats& s) const { return s._queueDepth; } };
+    struct MaxQueueDepth { double operator()(const LayerCounters::Stats& s) const { return s._maxQueueDepth; } };
+}
+
+//........................................................................
+
+double
+LayerCounters::getLatencyBucketBound(unsigned bucket)
+{
+    return bucket < NUM_LATENCY_BUCKETS-1 ? s_latencyBounds[bucket] : -1.0;
+}
+
+LayerCounters::Stats::Stats() :
+_fetches      ( 0u ),
+_fetchTime    ( 0.0 ),
+_maxFetchTime ( 0.0 ),
+_cacheHits    ( 0u ),
+_cacheMisses  ( 0u ),
+_bytesRead    ( 0.0 ),
+_bytesDecoded ( 0.0 ),
+_decodes      ( 0u ),
+_decodeTime   ( 0.0 ),
+_queueDepth   ( 0u ),
+_maxQueueDepth( 0u )
+{
+    for(unsigned i=0; i<NUM_LATENCY_BUCKETS; ++i)
+        _latency[i] = 0u;
+}
+
+LayerCounters::LayerCounters(const std::string& kind, const std::string& name) :
+_kind( kind ),
+_name( name )
+{
+    //nop
+}
+
+void
+LayerCounters::recordFetch(double milliseconds)
+{
+    unsigned bucket = 0u;
+    while(bucket < NUM_LATENCY_BUCKETS-1 && milliseconds > s_latencyBounds[bucket])
+        ++bucket;
+
+    Threading::ScopedMutexLock lock(_mutex);
+    _stats._fetches++;
+    _stats._fetchTime += milliseconds;
+    _stats._latency[bucket]++;
+    if (milliseconds > _stats._maxFetchTime)
+        _stats._maxFetchTime = milliseconds;
+}
+
+void
+LayerCounters::recordCacheHit()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _stats._cacheHits++;
+}
+
+void
+LayerCounters::recordCacheMiss()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _stats._cacheMisses++;
+}
+
+void
+LayerCounters::recordBytesRead(double bytes)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _stats._bytesRead += bytes;
+}
+
+void
+LayerCounters::recordBytesDecoded(double bytes)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _stats._bytesDecoded += bytes;
+}
+
+void
+LayerCounters::recordDecode(double milliseconds)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _stats._decodes++;
+    _stats._decodeTime += milliseconds;
+}
+
+void
+LayerCounters::beginRequest()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _stats._queueDepth++;
+    if (_stats._queueDepth > _stats._maxQueueDepth)
+        _stats._maxQueueDepth = _stats._queueDepth;
+}
+
+void
+LayerCounters::endRequest()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    if (_stats._queueDepth > 0u)
+        _stats._queueDepth--;
+}
+
+void
+LayerCounters::add(const std::string& counter, double value)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _stats._custom[counter] += value;
+}
+
+LayerCounters::Stats
+LayerCounters::getStats() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return _stats;
+}
+
+void
+LayerCounters::reset()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    unsigned queueDepth = _stats._queueDepth;
+    _stats = Stats();
+    _stats._queueDepth = queueDepth;
+    _stats._maxQueueDepth = queueDepth;
+}
+
+LayerCounters::ScopedFetch::ScopedFetch(LayerCounters* counters) :
+_counters( counters ),
+_start   ( 0 )
+{
+    if (_counters)
+    {
+        _counters->beginRequest();
+        _start = osg::Timer::instance()->tick();
+    }
+}
+
+LayerCounters::ScopedFetch::~ScopedFetch()
+{
+    if (_counters)
+    {
+        _counters->recordFetch(osg::Timer::instance()->delta_m(_start, osg::Timer::instance()->tick()));
+        _counters->endRequest();
+    }
+}
+
+//........................................................................
+
+PerformanceCounters::PerformanceCounters()
+{
+    //nop
+}
+
+LayerCounters*
+PerformanceCounters::getOrCreate(const std::string& kind, const std::string& name)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    osg::ref_ptr<LayerCounters>& counters = _counters[std::make_pair(kind, name)];
+    if (!counters.valid())
+        counters = new LayerCounters(kind, name);
+    return counters.get();
+}
+
+LayerCounters*
+PerformanceCounters::get(const std::string& kind, const std::string& name) const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    CountersMap::const_iterator i = _counters.find(std::make_pair(kind, name));
+    return i != _counters.end() ? i->second.get() : 0L;
+}
+
+void
+PerformanceCounters::getAll(std::vector< osg::ref_ptr<LayerCounters> >& output) const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    output.reserve(output.size() + _counters.size());
+    for(CountersMap::const_iterator i = _counters.begin(); i != _counters.end(); ++i)
+        output.push_back(i->second.get());
+}
+
+void
+PerformanceCounters::reset()
+{
+    std::vector< osg::ref_ptr<LayerCounters> > all;
+    getAll(all);
+    for(unsigned i=0; i<all.size(); ++i)
+        all[i]->reset();
+}
+
+std::string
+PerformanceCounters::toJSON(bool pretty) const
+{
+    std::vector< osg::ref_ptr<LayerCounters> > all;
+    getAll(all);
+
+    Json::Value root(Json::objectValue);
+    Json::Value& list = root["counters"];
+    list = Json::Value(Json::arrayValue);
+
+    for(unsigned i=0; i<all.size(); ++i)
+    {
+        LayerCounters::Stats s = all[i]->getStats();
+
+        Json::Value entry(Json::objectValue);
+        entry["kind"]              = all[i]->getKind();
+        entry["name"]              = all[i]->getName();
+        entry["fetches"]           = s._fetches;
+        entry["fetch_time_ms"]     = s._fetchTime;
+        entry["max_fetch_time_ms"] = s._maxFetchTime;
+
+        Json::Value latency(Json::arrayValue);
+        for(unsigned b=0; b<LayerCounters::NUM_LATENCY_BUCKETS; ++b)
+        {
+            Json::Value bucket(Json::objectValue);
+            double bound = LayerCounters::getLatencyBucketBound(b);
+            bucket["le"]    = bound >= 0.0 ? Json::Value(bound) : Json::Value("+Inf");
+            bucket["count"] = s._latency[b];
+            latency.append(bucket);
+        }
+        entry["latency_ms"]      = latency;
+        entry["cache_hits"]      = s._cacheHits;
+        entry["cache_misses"]    = s._cacheMisses;
+        entry["bytes_read"]      = s._bytesRead;
+        entry["bytes_decoded"]   = s._bytesDecoded;
+        entry["decodes"]         = s._decodes;
+        entry["decode_time_ms"]  = s._decodeTime;
+        entry["queue_depth"]     = s._queueDepth;
+        entry["max_queue_depth"] = s._maxQueueDepth;
+
+        if (!s._custom.empty())
+        {
+            Json::Value custom(Json::objectValue);
+            for(std::map<std::string, double>::const_iterator c = s._custom.begin(); c != s._custom.end(); ++c)
+                custom[c->first] = c->second;
+            entry["custom"] = custom;
+        }
+
+        list.append(entry);
+    }
+
+    if ( pretty )
+        return Json::StyledWriter().write( root );
+    else
+        return Json::FastWriter().write( root );
+}
+
+std::string
+PerformanceCounters::toPrometheus() const
+{
+    std::vector< osg::ref_ptr<LayerCounters> > all;
+    getAll(all);
+
+    std::vector<LayerCounters::Stats> stats(all.size());
+    for(unsigned i=0; i<all.size(); ++i)
+        stats[i] = all[i]->getStats();
+
+    std::ostringstream out;
+    out << std::setprecision(15);
+
+    // latency histogram; Prometheus buckets are cumulative.
+    out << "# HELP osgearth_fetch_latency_ms Time to complete a fetch, in milliseconds.\n";
+    out << "# TYPE osgearth_fetch_latency_ms histogram\n";
+    for(unsigned i=0; i<all.size(); ++i)
+    {
+        std::string l = labels(all[i].get());
+        unsigned cumulative = 0u;
+        for(unsigned b=0; b<LayerCounters::NUM_LATENCY_BUCKETS; ++b)
+        {
+            cumulative += stats[i]._latency[b];
+            double bound = LayerCounters::getLatencyBucketBound(b);
+            out << "osgearth_fetch_latency_ms_bucket{" << l << ",le=\"";
+            if (bound >= 0.0) out << bound; else out << "+Inf";
+            out << "\"} " << cumulative << "\n";
+        }
+        out << "osgearth_fetch_latency_ms_sum{" << l << "} " << stats[i]._fetchTime << "\n";
+        out << "osgearth_fetch_latency_ms_count{" << l << "} " << stats[i]._fetches << "\n";
+    }
+
+    writeFamily(out, all, stats, "osgearth_fetch_latency_ms_max",  "gauge",   "Slowest fetch, in milliseconds.",         MaxFetchTime());
+    writeFamily(out, all, stats, "osgearth_cache_hits_total",      "counter", "Reads served from a cache.",              CacheHits());
+    writeFamily(out, all, stats, "osgearth_cache_misses_total",    "counter", "Reads that went past the cache.",         CacheMisses());
+    writeFamily(out, all, stats, "osgearth_bytes_read_total",      "counter", "Bytes of data read.",                     BytesRead());
+    writeFamily(out, all, stats, "osgearth_bytes_decoded_total",   "counter", "Bytes of decoded, in-memory data.",       BytesDecoded());
+    writeFamily(out, all, stats, "osgearth_decodes_total",         "counter", "Decode operations.",                      Decodes());
+    writeFamily(out, all, stats, "osgearth_decode_time_ms_total",  "counter", "Time spent decoding, in milliseconds.",   DecodeTime());
+    writeFamily(out, all, stats, "osgearth_queue_depth",           "gauge",   "Requests in progress.",                   QueueDepth());
+    writeFamily(out, all, stats, "osgearth_queue_depth_max",       "gauge",   "Most requests in progress at once.",      MaxQueueDepth());
+
+    bool customHeader = false;
+    for(unsigned i=0; i<all.size(); ++i)
+    {
+        for(std::map<std::string, double>::const_iterator c = stats[i]._custom.begin(); c != stats[i]._custom.end(); ++c)
+        {
+            if (!customHeader)
+            {
+                out << "# HELP osgearth_custom_total Totals published by individual sources.\n";
+                out << "# TYPE osgearth_custom_total counter\n";
+                customHeader = true;
+            }
+            out << "osgearth_custom_total{" << labels(all[i].get())
+                << ",counter=\"" << escapeLabel(c->first) << "\"} " << c->second << "\n";
+        }
+    }
+
+    return out.str();
+}
+
+bool
+PerformanceCounters::write(const std::string& filename) const
+{
+    std::string ext = osgDB::getLowerCaseFileExtension(filename);
+    bool prometheus = (ext == "prom" || ext == "txt");
+
+    osgDB::ofstream out(filename.c_str());
+    if (!out.is_open())
+    {
+        OE_WARN << LC << "Failed to open " << filename << " for writing" << std::endl;
+        return false;
+    }
+
+    out << (prometheus ? toPrometheus() : toJSON(true));
+    out.close();
+    return !out.fail();
+}
@@ -92,3 +92,34 @@ ConsoleProgressCallback::reportProgress(double current, double total,
     }
     return false;
 }
+
+//------------------------------------------------------------------------
+
+ChildProgressCallback::ChildProgressCallback(ProgressCallback* parent) :
+_parent( parent )
+{
+    if ( _parent.valid() )
+        collectStats() = _parent->collectStats();
+}
+
+bool
+ChildProgressCallback::isCanceled()
+{
+    return _canceled || (_parent.valid() && _parent->isCanceled());
+}
+
+void
+ChildProgressCallback::merge()
+{
+    if ( !_parent.valid() )
+        return;
+
+    for(Stats::const_iterator i = _stats.begin(); i != _stats.end(); ++i)
+        _parent->stats()[i->first] += i->second;
+
+    if ( _needsRetry )
+        _parent->setNeedsRetry( true );
+
+    if ( _failed )
+        _parent->reportError( _message );
+}
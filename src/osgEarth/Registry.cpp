@@ -30,6 +30,7 @@
 #include <osgEarth/StringUtils>
 #include <osgEarth/TerrainEngineNode>
 #include <osgEarth/ObjectIndex>
+#include <osgEarth/PerformanceCounters>
 
 #include <osgEarth/Units>
 #include <osg/Notify>
@@ -109,6 +110,9 @@ _devicePixelRatio(1.0f)
     // Default object index for tracking scene object by UID.
     _objectIndex = new ObjectIndex();
 
+    // Default registry of per-layer performance counters.
+    _performanceCounters = new PerformanceCounters();
+
     // activate KMZ support
     osgDB::Registry::instance()->addArchiveExtension  ( "kmz" );
     //osgDB::Registry::instance()->addFileExtensionAlias( "kmz", "kml" );
@@ -621,6 +625,12 @@ Registry::getObjectIndex() const
     return _objectIndex.get();
 }
 
+PerformanceCounters*
+Registry::getPerformanceCounters() const
+{
+    return _performanceCounters.get();
+}
+
 void
 Registry::startActivity(const std::string& activity)
 {
@@ -112,6 +112,246 @@ namespace
             points[i].set( osg::RadiansToDegrees(lon), osg::RadiansToDegrees(lat), alt );
         }
     }
+
+    // Farthest from the central meridian (radians) that the transverse mercator
+    // kernels will go; the Krueger series loses accuracy well before the
+    // projection's singularity at 90 degrees, so OGR handles anything beyond.
+    const double MAX_TM_LAMBDA = osg::DegreesToRadians(70.0);
+
+    inline double atanh_(double z)
+    {
+        return 0.5 * log( (1.0+z)/(1.0-z) );
+    }
+
+    // Pulls the datum shift terms out of a PROJ4 string so that two SRS's on the
+    // same datum but with different shift parameters are never treated as equal.
+    std::string getDatumShift(const std::string& proj4)
+    {
+        std::string result;
+        const char* terms[] = { "+towgs84=", "+nadgrids=" };
+        for(unsigned t=0; t<2; ++t)
+        {
+            std::string::size_type start = proj4.find(terms[t]);
+            if ( start != std::string::npos )
+            {
+                std::string::size_type end = proj4.find(' ', start);
+                result += proj4.substr(start, end == std::string::npos ? std::string::npos : end-start);
+            }
+        }
+        return result;
+    }
+}
+
+//------------------------------------------------------------------------
+
+// The native kernels below cover the conversions that dominate osgEarth's
+// workloads (geographic <-> UTM/transverse mercator and polar stereographic).
+// Each one transforms a single point and returns false if the point is outside
+// the domain where the series is trustworthy, so the caller can fall back to OGR.
+//
+// Transverse Mercator uses the Krueger series to 4th order in n (Karney, 2011),
+// which is accurate to well under a millimeter within a UTM zone. Polar
+// stereographic follows Snyder, "Map Projections - A Working Manual" (1987).
+
+void
+SpatialReference::NativeProjection::init(void*                     handle,
+                                         const std::string&        proj,
+                                         bool                      geographic,
+                                         const osg::EllipsoidModel* em,
+                                         const std::string&        proj4)
+{
+    type = NONE;
+
+    // the native kernels assume degrees on the Greenwich meridian.
+    if ( !osg::equivalent(OSRGetAngularUnits(handle, 0L), osg::DegreesToRadians(1.0), 1e-12) ||
+         as<double>(getOGRAttrValue(handle, "PRIMEM", 1), 0.0) != 0.0 )
+    {
+        return;
+    }
+
+    datumShift = getDatumShift(proj4);
+
+    if ( geographic )
+    {
+        type = GEOGRAPHIC;
+        return;
+    }
+
+    double a = em->getRadiusEquator();
+    double f = (a - em->getRadiusPolar()) / a;
+    e = sqrt(f * (2.0 - f));
+
+    // conformal latitude -> geodetic latitude, as a series in n (TM) and e^2 (PS)
+    double n = f / (2.0 - f);
+    double n2 = n*n, n3 = n2*n, n4 = n3*n;
+    chi[0] = 2.0*n - 2.0*n2/3.0 - 2.0*n3 + 116.0*n4/45.0;
+    chi[1] = 7.0*n2/3.0 - 8.0*n3/5.0 - 227.0*n4/45.0;
+    chi[2] = 56.0*n3/15.0 - 136.0*n4/35.0;
+    chi[3] = 4279.0*n4/630.0;
+
+    int err;
+    double lat0 = OSRGetProjParm(handle, SRS_PP_LATITUDE_OF_ORIGIN, 0.0, &err);
+    lon0        = OSRGetProjParm(handle, SRS_PP_CENTRAL_MERIDIAN, 0.0, &err);
+    k0          = OSRGetProjParm(handle, SRS_PP_SCALE_FACTOR, 1.0, &err);
+    toMeters    = OSRGetLinearUnits(handle, 0L);
+    x0          = OSRGetProjParm(handle, SRS_PP_FALSE_EASTING, 0.0, &err) * toMeters;
+    y0          = OSRGetProjParm(handle, SRS_PP_FALSE_NORTHING, 0.0, &err) * toMeters;
+
+    if ( toMeters <= 0.0 )
+        return;
+
+    if ( proj == "transverse_mercator" )
+    {
+        scale = k0 * (a / (1.0 + n)) * (1.0 + n2/4.0 + n4/64.0);
+
+        alpha[0] = n/2.0 - 2.0*n2/3.0 + 5.0*n3/16.0 + 41.0*n4/180.0;
+        alpha[1] = 13.0*n2/48.0 - 3.0*n3/5.0 + 557.0*n4/1440.0;
+        alpha[2] = 61.0*n3/240.0 - 103.0*n4/140.0;
+        alpha[3] = 49561.0*n4/161280.0;
+
+        beta[0] = n/2.0 - 2.0*n2/3.0 + 37.0*n3/96.0 - n4/360.0;
+        beta[1] = n2/48.0 + n3/15.0 - 437.0*n4/1440.0;
+        beta[2] = 17.0*n3/480.0 - 37.0*n4/840.0;
+        beta[3] = 4397.0*n4/161280.0;
+
+        // xi of the latitude of origin on the central meridian:
+        double s = sin(osg::DegreesToRadians(lat0));
+        double xip = atan( sinh(atanh_(s) - e*atanh_(e*s)) );
+        xi0 = xip;
+        for(int j=0; j<4; ++j)
+            xi0 += alpha[j] * sin(2.0*(j+1)*xip);
+
+        type = TRANSVERSE_MERCATOR;
+    }
+
+    else if ( proj == "polar_stereographic" )
+    {
+        // latitude_of_origin holds the latitude of true scale.
+        south = lat0 < 0.0;
+        double phic = osg::DegreesToRadians(fabs(lat0));
+
+        if ( osg::equivalent(fabs(lat0), 90.0) )
+        {
+            scale = 2.0 * a * k0 / sqrt( pow(1.0+e, 1.0+e) * pow(1.0-e, 1.0-e) );
+        }
+        else
+        {
+            double es = e * sin(phic);
+            double mc = cos(phic) / sqrt(1.0 - es*es);
+            double tc = tan(osg::PI_4 - 0.5*phic) / pow((1.0-es)/(1.0+es), 0.5*e);
+            scale = a * mc * k0 / tc;
+        }
+
+        // Snyder eq. 3-5, the e^2 series for the conformal latitude:
+        double e2 = e*e, e4 = e2*e2, e6 = e4*e2, e8 = e6*e2;
+        conf[0] = e2/2.0 + 5.0*e4/24.0 + e6/12.0 + 13.0*e8/360.0;
+        conf[1] = 7.0*e4/48.0 + 29.0*e6/240.0 + 811.0*e8/11520.0;
+        conf[2] = 7.0*e6/120.0 + 81.0*e8/1120.0;
+        conf[3] = 4279.0*e8/161280.0;
+
+        type = POLAR_STEREOGRAPHIC;
+    }
+}
+
+bool
+SpatialReference::NativeProjection::forward(double& x, double& y) const
+{
+    if ( type == TRANSVERSE_MERCATOR )
+    {
+        double lam = osg::DegreesToRadians(x - lon0);
+        if ( lam >  osg::PI ) lam -= 2.0*osg::PI;
+        if ( lam < -osg::PI ) lam += 2.0*osg::PI;
+
+        // the series diverges toward 90 degrees from the central meridian
+        if ( fabs(lam) > MAX_TM_LAMBDA || fabs(y) > 90.0 )
+            return false;
+
+        double s = sin(osg::DegreesToRadians(y));
+        double t = sinh(atanh_(s) - e*atanh_(e*s));
+        double xip = atan2(t, cos(lam));
+        double etap = atanh_(sin(lam) / sqrt(1.0 + t*t));
+
+        double xi = xip, eta = etap;
+        for(int j=0; j<4; ++j)
+        {
+            double k = 2.0*(j+1);
+            xi  += alpha[j] * sin(k*xip) * cosh(k*etap);
+            eta += alpha[j] * cos(k*xip) * sinh(k*etap);
+        }
+
+        x = (x0 + scale*eta) / toMeters;
+        y = (y0 + scale*(xi - xi0)) / toMeters;
+    }
+
+    else if ( type == POLAR_STEREOGRAPHIC )
+    {
+        // the south aspect is the north aspect with the signs flipped.
+        double sign = south ? -1.0 : 1.0;
+        double lam = sign * osg::DegreesToRadians(x - lon0);
+        double phi = sign * osg::DegreesToRadians(y);
+
+        // only the hemisphere of the projection's own pole
+        if ( phi < 0.0 || phi > osg::PI_2 )
+            return false;
+
+        double es  = e * sin(phi);
+        double rho = scale * tan(osg::PI_4 - 0.5*phi) / pow((1.0-es)/(1.0+es), 0.5*e);
+
+        x = (x0 + sign * rho * sin(lam)) / toMeters;
+        y = (y0 - sign * rho * cos(lam)) / toMeters;
+    }
+
+    return osg::isNaN(x) == false && osg::isNaN(y) == false && fabs(x) < DBL_MAX && fabs(y) < DBL_MAX;
+}
+
+bool
+SpatialReference::NativeProjection::inverse(double& x, double& y) const
+{
+    if ( type == TRANSVERSE_MERCATOR )
+    {
+        double xi  = (y*toMeters - y0) / scale + xi0;
+        double eta = (x*toMeters - x0) / scale;
+
+        double xip = xi, etap = eta;
+        for(int j=0; j<4; ++j)
+        {
+            double k = 2.0*(j+1);
+            xip  -= beta[j] * sin(k*xi) * cosh(k*eta);
+            etap -= beta[j] * cos(k*xi) * sinh(k*eta);
+        }
+
+        double c = asin( sin(xip) / cosh(etap) );
+        double phi = c;
+        for(int j=0; j<4; ++j)
+            phi += chi[j] * sin(2.0*(j+1)*c);
+
+        double lam = atan2(sinh(etap), cos(xip));
+        if ( fabs(lam) > MAX_TM_LAMBDA )
+            return false;
+
+        x = lon0 + osg::RadiansToDegrees( lam );
+        y = osg::RadiansToDegrees( phi );
+    }
+
+    else if ( type == POLAR_STEREOGRAPHIC )
+    {
+        double sign = south ? -1.0 : 1.0;
+        double dx = sign * (x*toMeters - x0);
+        double dy = sign * (y*toMeters - y0);
+        double t  = sqrt(dx*dx + dy*dy) / scale;
+        double c  = osg::PI_2 - 2.0*atan(t);
+
+        // the forward projection never leaves the pole's own hemisphere
+        if ( c < 0.0 )
+            return false;
+
+        double phi = c + conf[0]*sin(2.0*c) + conf[1]*sin(4.0*c) + conf[2]*sin(6.0*c) + conf[3]*sin(8.0*c);
+
+        x = lon0 + sign * osg::RadiansToDegrees( atan2(dx, -dy) );
+        y = sign * osg::RadiansToDegrees( phi );
+    }
+
+    return osg::isNaN(x) == false && osg::isNaN(y) == false;
 }
 
 //------------------------------------------------------------------------
@@ -467,9 +707,9 @@ SpatialReference::~SpatialReference()
     {
         GDAL_SCOPED_LOCK;
 
-        for (TransformHandleCache::iterator itr = _transformHandleCache.begin(); itr != _transformHandleCache.end(); ++itr)
+        for (std::vector<void*>::iterator itr = _transformHandles.begin(); itr != _transformHandles.end(); ++itr)
         {
-            OCTDestroyCoordinateTransformation(itr->second);
+            OCTDestroyCoordinateTransformation(*itr);
         }
 
         if ( _owns_handle )
@@ -1168,27 +1408,46 @@ SpatialReference::transformXYPointArrays(double*  x,
                                          unsigned count,
                                          const SpatialReference* out_srs) const
 {  
-    // Transform the X and Y values inside an exclusive GDAL/OGR lock
-    GDAL_SCOPED_LOCK;
-
     //OE_INFO << LC << "Attempt transfrom from \n"
     //    << "    " << getHorizInitString() << "\n"
     //    << " -> " << out_srs->getHorizInitString() << std::endl;
 
-    void* xform_handle = NULL;
-    TransformHandleCache::const_iterator itr = _transformHandleCache.find(out_srs->getWKT());
-    if (itr != _transformHandleCache.end())
+    if ( canTransformNatively(out_srs) )
     {
-        //OE_DEBUG << LC << "using cached transform handle" << std::endl;
-        xform_handle = itr->second;
-    }
-    else
-    {
-        OE_DEBUG << LC << "allocating new OCT Transform" << std::endl;
-        xform_handle = OCTNewCoordinateTransformation( _handle, out_srs->_handle);
-        const_cast<SpatialReference*>(this)->_transformHandleCache[out_srs->getWKT()] = xform_handle;
+        // Closed-form kernels, point by point; a point outside a kernel's
+        // domain keeps its input value and goes to OGR below instead.
+        std::vector<unsigned> rejects;
+        for(unsigned i=0; i<count; ++i)
+        {
+            double px = x[i], py = y[i];
+            if ( _native.inverse(px, py) && out_srs->_native.forward(px, py) )
+            {
+                x[i] = px;
+                y[i] = py;
+            }
+            else
+            {
+                rejects.push_back( i );
+            }
+        }
+
+        if ( rejects.empty() )
+            return true;
+
+        void* xform_handle = getTransformHandle( out_srs );
+        if ( !xform_handle )
+            return false;
+
+        for(unsigned r=0; r<rejects.size(); ++r)
+        {
+            unsigned i = rejects[r];
+            if ( OCTTransform(xform_handle, 1, &x[i], &y[i], 0L) == 0 )
+                return false;
+        }
+        return true;
     }
 
+    void* xform_handle = getTransformHandle( out_srs );
     if ( !xform_handle )
     {
         OE_WARN << LC
@@ -1205,6 +1464,51 @@ SpatialReference::transformXYPointArrays(double*  x,
     return OCTTransform( xform_handle, count, x, y, 0L ) > 0;
 }
 
+void*
+SpatialReference::getTransformHandle(const SpatialReference* out_srs) const
+{
+    // This thread's OGR transform to the output SRS. Entries are keyed by the
+    // output's definition rather than the instance, so equivalent SRS objects
+    // share one handle per thread. Only this thread ever touches the entry,
+    // so no further locking is required.
+    TransformHandle& xform = _transformHandleCache.get()[out_srs->getKey().horizLower];
+
+    if ( !xform.resolved )
+    {
+        // OGR transformation objects are not thread-safe, so each thread
+        // gets its own; creating one requires the GDAL lock.
+        OE_DEBUG << LC << "allocating new OCT Transform" << std::endl;
+        GDAL_SCOPED_LOCK;
+        xform.handle = OCTNewCoordinateTransformation( _handle, out_srs->_handle);
+        if ( xform.handle )
+        {
+            Threading::ScopedMutexLock lock( _transformHandlesMutex );
+            _transformHandles.push_back( xform.handle );
+        }
+        xform.resolved = true;
+    }
+
+    return xform.handle;
+}
+
+bool
+SpatialReference::canTransformNatively(const SpatialReference* out_srs) const
+{
+    // Both ends need closed-form kernels, and they must share a datum; OGR
+    // handles anything that needs a datum shift.
+    return
+        _native.type          != NativeProjection::NONE &&
+        out_srs->_native.type != NativeProjection::NONE &&
+        _ellipsoidId          == out_srs->_ellipsoidId &&
+        _datum                == out_srs->_datum &&
+        _native.datumShift    == out_srs->_native.datumShift &&
+        !_is_ltp   && !out_srs->_is_ltp &&
+        !_is_cube  && !out_srs->_is_cube &&
+        !_is_ecef  && !out_srs->_is_ecef &&
+        !_is_plate_carre  && !out_srs->_is_plate_carre &&
+        !_is_user_defined && !out_srs->_is_user_defined;
+}
+
 
 bool
 SpatialReference::transformZ(std::vector<osg::Vec3d>& points,
@@ -1653,6 +1957,9 @@ SpatialReference::_init()
         _key.vertLower = toLower(_key.vert);
     }
 
+    // parameters for the transforms that can bypass OGR:
+    _native.init( _handle, proj, _is_geographic, _ellipsoid.get(), _proj4 );
+
     _initialized = true;
 }
 
@@ -306,6 +306,12 @@ TaskService::add( TaskRequest* request )
     _queue->add( request );
 }
 
+bool
+TaskService::isPoolThread()
+{
+    return dynamic_cast<TaskThread*>( OpenThreads::Thread::CurrentThread() ) != 0L;
+}
+
 void TaskService::waitforThreadsToComplete()
 {        
     for( TaskThreads::iterator i = _threads.begin(); i != _threads.end(); i++ )
@@ -34,6 +34,9 @@ using namespace OpenThreads;
 
 #define LC "[TerrainLayer] Layer \"" << getName() << "\" "
 
+// Below this many data extents, a linear scan beats the spatial index.
+#define MIN_EXTENTS_TO_INDEX 32u
+
 //------------------------------------------------------------------------
 
 TerrainLayerOptions::TerrainLayerOptions() :
@@ -245,7 +248,8 @@ TerrainLayer::TerrainLayer(TerrainLayerOptions* optionsPtr) :
 VisibleLayer(optionsPtr ? optionsPtr : &_optionsConcrete),
 _options(optionsPtr ? optionsPtr : &_optionsConcrete),
 _openCalled(false),
-_tileSourceExpected(true)
+_tileSourceExpected(true),
+_dataExtentIndexSource(0L)
 {
     //nop - init() called by subclass
 }
@@ -255,7 +259,8 @@ VisibleLayer(optionsPtr ? optionsPtr : &_optionsConcrete),
 _options(optionsPtr ? optionsPtr : &_optionsConcrete),
 _tileSource(tileSource),
 _openCalled(false),
-_tileSourceExpected(true)
+_tileSourceExpected(true),
+_dataExtentIndexSource(0L)
 {
     //nop - init() called by subclass
 }
@@ -433,6 +438,20 @@ TerrainLayer::getCacheSettings() const
     return _cacheSettings.get();
 }
 
+LayerCounters*
+TerrainLayer::getCounters() const
+{
+    if (!_counters.valid())
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        if (!_counters.valid())
+        {
+            _counters = Registry::performanceCounters()->getOrCreate(className(), getName());
+        }
+    }
+    return _counters.get();
+}
+
 void
 TerrainLayer::setOpacity(float value)
 {
@@ -1014,6 +1033,8 @@ TerrainLayer::dirtyDataExtents()
 {
     Threading::ScopedMutexLock lock(_mutex);
     _dataExtentsUnion = GeoExtent::INVALID;
+    _dataExtentIndex = 0L;
+    _dataExtentIndexSource = 0L;
 }
 
 const GeoExtent&
@@ -1039,6 +1060,27 @@ TerrainLayer::getDataExtentsUnion() const
     return _dataExtentsUnion;
 }
 
+osg::ref_ptr<const DataExtentIndex>
+TerrainLayer::getDataExtentIndex() const
+{
+    const DataExtentList& de = getDataExtents();
+    if (de.size() < MIN_EXTENTS_TO_INDEX)
+        return 0L;
+
+    Threading::ScopedMutexLock lock(_mutex);
+
+    // rebuild if the extents came from somewhere else since the last build
+    // (e.g., the tile source replaced the cache bin metadata)
+    if (!_dataExtentIndex.valid() ||
+        _dataExtentIndexSource != &de ||
+        _dataExtentIndex->size() != de.size())
+    {
+        _dataExtentIndex = new DataExtentIndex(de, getProfile());
+        _dataExtentIndexSource = &de;
+    }
+    return _dataExtentIndex;
+}
+
 const GeoExtent&
 TerrainLayer::getExtent() const
 {
@@ -1106,8 +1148,13 @@ TerrainLayer::getBestAvailableTileKey(const TileKey& key) const
         }
     }
 
+    // With many extents, only visit the ones that might intersect the key.
+    // Candidate indices refer to the index's own copy of the extents, which
+    // stays put even if the live list changes under us.
+    osg::ref_ptr<const DataExtentIndex> index = getDataExtentIndex();
+
     // Next check against the data extents.
-    const DataExtentList& de = getDataExtents();
+    const DataExtentList& de = index.valid() ? index->getDataExtents() : getDataExtents();
 
     // If we have mo data extents available, just return the MDL-limited input key.
     if (de.empty())
@@ -1121,12 +1168,25 @@ TerrainLayer::getBestAvailableTileKey(const TileKey& key) const
         return TileKey::INVALID;
     }
 
+    std::vector<unsigned> candidates;
+    if (index.valid())
+    {
+        if (!index->mayIntersect(key))
+        {
+            return TileKey::INVALID;
+        }
+        index->getCandidates(key.getExtent(), candidates);
+    }
+
     bool     intersects = false;
     unsigned highestLOD = 0;
+    unsigned count = index.valid() ? candidates.size() : de.size();
     
     // Check each data extent in turn:
-    for (DataExtentList::const_iterator itr = de.begin(); itr != de.end(); ++itr)
+    for (unsigned i = 0; i < count; ++i)
     {
+        const DataExtent* itr = index.valid() ? &de[candidates[i]] : &de[i];
+
         // check for 2D intersection:
         if (key.getExtent().intersects(*itr))
         {
@@ -48,7 +48,9 @@ _minNormalMapLOD( 0u ),
 _gpuTessellation( false ),
 _debug( false ),
 _binNumber( 0 ),
-_castShadows( false )
+_castShadows( false ),
+_parallelLayerFetch( true ),
+_maxFetchesPerSource( 2u )
 {
     fromConfig( _conf );
 }
@@ -81,6 +83,8 @@ TerrainOptions::getConfig() const
     conf.set( "min_expiry_time", _minExpiryTime);
     conf.set( "min_expiry_frames", _minExpiryFrames);
     conf.set( "cast_shadows", _castShadows);
+    conf.set( "parallel_layer_fetch", _parallelLayerFetch);
+    conf.set( "max_fetches_per_source", _maxFetchesPerSource);
 
     //Save the filter settings
 	conf.set("mag_filter","LINEAR",                _magFilter,osg::Texture::LINEAR);
@@ -124,6 +128,8 @@ TerrainOptions::fromConfig( const Config& conf )
     conf.getIfSet( "min_expiry_time", _minExpiryTime);
     conf.getIfSet( "min_expiry_frames", _minExpiryFrames);
     conf.getIfSet( "cast_shadows", _castShadows);
+    conf.getIfSet( "parallel_layer_fetch", _parallelLayerFetch);
+    conf.getIfSet( "max_fetches_per_source", _maxFetchesPerSource);
 
     //Load the filter settings
 	conf.getIfSet("mag_filter","LINEAR",                _magFilter,osg::Texture::LINEAR);
@@ -23,8 +23,11 @@
 #include <osgEarth/PatchLayer>
 #include <osgEarth/MapOptions>
 #include <osgEarth/MapFrame>
+#include <osgEarth/TaskService>
+#include <osgEarth/ThreadingUtils>
 
 #include <osg/Texture2D>
+#include <OpenThreads/Condition>
 
 #define LC "[TerrainTileModelFactory] "
 
@@ -32,6 +35,73 @@ using namespace osgEarth;
 
 //.........................................................................
 
+namespace
+{
+    // Limits the number of fetches in flight against any one tile source,
+    // across all the tiles being built at once.
+    Threading::Mutex       s_gateMutex;
+    OpenThreads::Condition s_gateCond;
+    std::map<const void*, unsigned> s_inFlight;
+
+    void acquireSource(const void* source, unsigned maxInFlight)
+    {
+        Threading::ScopedMutexLock lock( s_gateMutex );
+        while ( s_inFlight[source] >= maxInFlight )
+            s_gateCond.wait( &s_gateMutex );
+        ++s_inFlight[source];
+    }
+
+    void releaseSource(const void* source)
+    {
+        Threading::ScopedMutexLock lock( s_gateMutex );
+        std::map<const void*, unsigned>::iterator i = s_inFlight.find( source );
+        if ( i != s_inFlight.end() && --i->second == 0u )
+            s_inFlight.erase( i );
+        s_gateCond.broadcast();
+    }
+
+    // Creates the image for one layer of a tile.
+    struct FetchLayerImage
+    {
+        FetchLayerImage() : layer(0L), key(0L), source(0L), maxInFlight(1u) { }
+
+        void execute()
+        {
+            if ( progress.valid() && progress->isCanceled() )
+                return;
+
+            acquireSource( source, maxInFlight );
+
+            if ( !progress.valid() || !progress->isCanceled() )
+                result = layer->createImage( *key, progress.get() );
+
+            releaseSource( source );
+        }
+
+        ImageLayer*                           layer;
+        const TileKey*                        key;
+        const void*                           source;
+        unsigned                              maxInFlight;
+        osg::ref_ptr<ChildProgressCallback>   progress;
+        GeoImage                              result;
+    };
+
+    typedef ParallelTask<FetchLayerImage> FetchLayerImageTask;
+
+    Threading::Mutex s_fetchServiceMutex;
+    UID              s_fetchServiceUID = -1;
+
+    TaskService* getFetchService()
+    {
+        Threading::ScopedMutexLock lock( s_fetchServiceMutex );
+        if ( s_fetchServiceUID < 0 )
+            s_fetchServiceUID = Registry::instance()->createUID();
+        return Registry::instance()->getTaskServiceManager()->getOrAdd( s_fetchServiceUID );
+    }
+}
+
+//.........................................................................
+
 TerrainTileModelFactory::TerrainTileModelFactory(const TerrainOptions& options) :
 _options         ( options ),
 _heightFieldCache( true, 128 )
@@ -61,7 +131,7 @@ TerrainTileModelFactory::createTileModel(const MapFrame&                  frame,
 
     if ( requirements == 0L || requirements->elevationTexturesRequired() )
     {
-        unsigned border = requirements->elevationBorderRequired() ? 1u : 0u;
+        unsigned border = requirements && requirements->elevationBorderRequired() ? 1u : 0u;
 
         addElevation( model.get(), frame, key, filter, border, progress );
     }
@@ -87,14 +157,19 @@ TerrainTileModelFactory::addImageLayers(TerrainTileModel* model,
 {
     OE_START_TIMER(fetch_image_layers);
 
-    int order = 0;
-
     ImageLayerVector imageLayers;
     frame.getLayers(imageLayers);
 
+    // Layers that can have data for this tile, in map order. Layers that make
+    // their own textures are fetched here; the rest go through createImage,
+    // which is the part we can run in parallel.
+    std::vector<ImageLayer*> layers;
+    std::vector< osg::ref_ptr<FetchLayerImageTask> > tasks;
+    tasks.reserve(imageLayers.size());
+
     for(ImageLayerVector::const_iterator i = imageLayers.begin();
         i != imageLayers.end();
-        ++i, ++order )
+        ++i )
     {
         ImageLayer* layer = i->get();
 
@@ -104,29 +179,96 @@ TerrainTileModelFactory::addImageLayers(TerrainTileModel* model,
         if (!layer->getEnabled())
             continue;
 
-        osg::Texture* tex = 0L;
-        osg::Matrixf textureMatrix;
+        layers.push_back(layer);
 
-        if (layer->isKeyInLegalRange(key) && layer->mayHaveDataInExtent(key.getExtent()))
+        if (layer->isKeyInLegalRange(key) &&
+            layer->mayHaveDataInExtent(key.getExtent()) &&
+            !layer->createTextureSupported())
         {
-            if (layer->createTextureSupported())
+            FetchLayerImageTask* task = new FetchLayerImageTask();
+            task->layer = layer;
+            task->key = &key;
+            task->source = layer->getTileSource() ? (const void*)layer->getTileSource() : (const void*)layer;
+            task->maxInFlight = osg::maximum(_options.maxFetchesPerSource().get(), 1u);
+            if (progress)
+                task->progress = new ChildProgressCallback(progress);
+            tasks.push_back(task);
+        }
+        else
+        {
+            tasks.push_back(0L);
+        }
+    }
+
+    // Fetch the images. With more than one to get, hand all but the first to
+    // the task service and run the first one on this thread while we wait.
+    unsigned numFetches = 0u;
+    for (unsigned i = 0; i < tasks.size(); ++i)
+        if (tasks[i].valid())
+            ++numFetches;
+
+    if (numFetches > 1u && _options.parallelLayerFetch() == true)
+    {
+        TaskService* service = getFetchService();
+        Threading::MultiEvent done( numFetches-1 );
+        FetchLayerImageTask* local = 0L;
+
+        for (unsigned i = 0; i < tasks.size(); ++i)
+        {
+            if (!tasks[i].valid())
+                continue;
+
+            if (local == 0L)
             {
-                tex = layer->createTexture( key, progress, textureMatrix );
+                local = tasks[i].get();
             }
-
             else
             {
-                GeoImage geoImage = layer->createImage( key, progress );
-           
-                if ( geoImage.valid() )
-                {
-                    if ( layer->isCoverage() )
-                        tex = createCoverageTexture(geoImage.getImage(), layer);
-                    else
-                        tex = createImageTexture(geoImage.getImage(), layer);
-                }
+                tasks[i]->_mev = &done;
+                service->add(tasks[i].get());
+            }
+        }
+
+        local->execute();
+        done.wait();
+    }
+    else
+    {
+        for (unsigned i = 0; i < tasks.size(); ++i)
+            if (tasks[i].valid())
+                tasks[i]->execute();
+    }
+
+    // Build the textures and layer models back in map order.
+    for (unsigned i = 0; i < layers.size(); ++i)
+    {
+        ImageLayer* layer = layers[i];
+
+        osg::Texture* tex = 0L;
+        osg::Matrixf textureMatrix;
+
+        if (tasks[i].valid())
+        {
+            FetchLayerImage& fetch = *tasks[i].get();
+
+            if (fetch.progress.valid())
+                fetch.progress->merge();
+
+            if (fetch.result.valid())
+            {
+                if ( layer->isCoverage() )
+                    tex = createCoverageTexture(fetch.result.getImage(), layer);
+                else
+                    tex = createImageTexture(fetch.result.getImage(), layer);
             }
         }
+
+        else if (layer->isKeyInLegalRange(key) &&
+                 layer->mayHaveDataInExtent(key.getExtent()) &&
+                 layer->createTextureSupported())
+        {
+            tex = layer->createTexture( key, progress, textureMatrix );
+        }
         
         // if this is the first LOD, and the engine requires that the first LOD
         // be populated, make an empty texture if we didn't get one.
@@ -0,0 +1,119 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/TileMemoryBudget>
+#include <algorithm>
+
+using namespace osgEarth;
+
+TileMemoryBudget::TileMemoryBudget() :
+_maxBytes     ( 0u ),
+_residentBytes( 0u )
+{
+    //nop
+}
+
+void
+TileMemoryBudget::setMaxBytes(size_t value)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _maxBytes = value;
+}
+
+size_t
+TileMemoryBudget::getMaxBytes() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return _maxBytes;
+}
+
+void
+TileMemoryBudget::add(size_t bytes)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _residentBytes += bytes;
+}
+
+void
+TileMemoryBudget::remove(size_t bytes)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _residentBytes = bytes < _residentBytes ? _residentBytes - bytes : 0u;
+}
+
+void
+TileMemoryBudget::update(size_t oldBytes, size_t newBytes)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _residentBytes = oldBytes < _residentBytes ? _residentBytes - oldBytes : 0u;
+    _residentBytes += newBytes;
+}
+
+void
+TileMemoryBudget::clear()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _residentBytes = 0u;
+}
+
+size_t
+TileMemoryBudget::getResidentBytes() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return _residentBytes;
+}
+
+bool
+TileMemoryBudget::isOverBudget() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return _maxBytes > 0u && _residentBytes > _maxBytes;
+}
+
+unsigned
+TileMemoryBudget::selectEvictions(std::vector<Candidate>& candidates) const
+{
+    size_t maxBytes, residentBytes;
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        maxBytes = _maxBytes;
+        residentBytes = _residentBytes;
+    }
+
+    if (maxBytes == 0u || residentBytes <= maxBytes)
+    {
+        candidates.clear();
+        return 0u;
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+
+    // keep evicting until the estimate drops under budget.
+    unsigned count = 0u;
+    while (count < candidates.size() && residentBytes > maxBytes)
+    {
+        size_t bytes = candidates[count++]._bytes;
+        residentBytes = bytes < residentBytes ? residentBytes - bytes : 0u;
+    }
+
+    candidates.resize(count);
+    return count;
+}
@@ -0,0 +1,571 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/TraceMetrics>
+#include <osgEarth/Notify>
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+using namespace osgEarth;
+
+#define LC "[TraceMetrics] "
+
+// Binary layout (native byte order):
+//
+//   header:  "OETRACE1", double seconds per tick, Timer_t start tick
+//   blocks:  unsigned block type, then
+//     BLOCK_EVENTS: unsigned thread ID, unsigned count, count x Record
+//     BLOCK_NAMES:  unsigned first ID, unsigned count, count x (unsigned length, chars)
+//     BLOCK_ARGS:   unsigned first index, unsigned count, count x (unsigned length, chars)
+
+#if defined(_MSC_VER)
+#  define OE_THREAD_LOCAL __declspec(thread)
+#else
+#  define OE_THREAD_LOCAL __thread
+#endif
+
+namespace
+{
+    const char     TRACE_MAGIC[8] = { 'O', 'E', 'T', 'R', 'A', 'C', 'E', '1' };
+    const unsigned BLOCK_EVENTS   = 1u;
+    const unsigned BLOCK_NAMES    = 2u;
+    const unsigned BLOCK_ARGS     = 3u;
+    const unsigned MAX_PAYLOAD    = 0x00FFFFFFu;
+
+    // Each backend gets a new generation, so a thread can tell whether
+    // its cached buffer belongs to the backend it's recording into.
+    OpenThreads::Atomic s_generations;
+
+    struct ThreadSlot
+    {
+        unsigned _generation;
+        void*    _buffer;
+    };
+
+    OE_THREAD_LOCAL ThreadSlot s_threadSlot = { 0u, 0L };
+
+    template<typename T>
+    void writeValue(std::ostream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    bool readValue(std::istream& in, T& value)
+    {
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return in.good();
+    }
+
+    void writeStrings(std::ostream& out, unsigned type, unsigned first, const std::vector<std::string>& strings)
+    {
+        writeValue(out, type);
+        writeValue(out, first);
+        writeValue(out, (unsigned)strings.size());
+        for (unsigned i = 0; i < strings.size(); ++i)
+        {
+            writeValue(out, (unsigned)strings[i].size());
+            out.write(strings[i].data(), strings[i].size());
+        }
+    }
+
+    bool readStrings(std::istream& in, std::map<unsigned, std::string>& output)
+    {
+        unsigned first, count;
+        if (!readValue(in, first) || !readValue(in, count))
+            return false;
+
+        for (unsigned i = 0; i < count; ++i)
+        {
+            unsigned length;
+            if (!readValue(in, length))
+                return false;
+            std::string& s = output[first + i];
+            s.resize(length);
+            if (length > 0u)
+            {
+                in.read(&s[0], length);
+                if (!in.good())
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    std::string escape(const std::string& input)
+    {
+        std::string output;
+        output.reserve(input.size());
+        for (unsigned i = 0; i < input.size(); ++i)
+        {
+            char c = input[i];
+            if (c == '"' || c == '\\')
+                output.push_back('\\');
+            if (c == '\n')
+                output.append("\\n");
+            else
+                output.push_back(c);
+        }
+        return output;
+    }
+}
+
+namespace osgEarth
+{
+    struct TraceMetricsWriter : public OpenThreads::Thread
+    {
+        TraceMetricsWriter(TraceMetricsBackend* owner) : _owner(owner) { }
+        void run() { _owner->writerLoop(); }
+        TraceMetricsBackend* _owner;
+    };
+}
+
+// Single-producer (the owning thread), single-consumer (the writer) ring.
+struct TraceMetricsBackend::ThreadBuffer
+{
+    ThreadBuffer(unsigned capacity) :
+        _records(capacity),
+        _mask(capacity - 1u),
+        _threadId(Threading::getCurrentThreadId()) { }
+
+    std::vector<Record> _records;
+    unsigned            _mask;
+    unsigned            _threadId;
+    OpenThreads::Atomic _head;      // next slot to write; only the owner advances it
+    OpenThreads::Atomic _tail;      // next slot to drain; only the writer advances it
+    OpenThreads::Atomic _dropped;
+};
+
+//------------------------------------------------------------------------
+
+TraceMetricsBackend::TraceMetricsBackend(const std::string& filename, unsigned eventsPerThread) :
+_numArgs(0u),
+_namesWritten(0u),
+_writer(0L),
+_done(false)
+{
+    _generation = ++s_generations;
+
+    _capacity = 1u;
+    while (_capacity < eventsPerThread && _capacity < 0x40000000u)
+        _capacity <<= 1;
+
+    _file.open(filename.c_str(), std::ios::out | std::ios::binary);
+    if (!_file.is_open())
+    {
+        OE_WARN << LC << "Failed to open " << filename << std::endl;
+        return;
+    }
+
+    _file.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    writeValue(_file, osg::Timer::instance()->getSecondsPerTick());
+    writeValue(_file, osg::Timer::instance()->tick());
+
+    _writer = new TraceMetricsWriter(this);
+    _writer->start();
+}
+
+TraceMetricsBackend::~TraceMetricsBackend()
+{
+    _done = true;
+    if (_writer)
+    {
+        _writer->join();
+        delete _writer;
+    }
+
+    flush();
+
+    unsigned dropped = getNumDropped();
+    if (dropped > 0u)
+    {
+        OE_WARN << LC << "Dropped " << dropped << " events; consider larger buffers" << std::endl;
+    }
+
+    _file.close();
+
+    for (unsigned i = 0; i < _buffers.size(); ++i)
+        delete _buffers[i];
+}
+
+void
+TraceMetricsBackend::writerLoop()
+{
+    while (!_done)
+    {
+        OpenThreads::Thread::microSleep(10000);
+        flush();
+    }
+}
+
+TraceMetricsBackend::ThreadBuffer*
+TraceMetricsBackend::getBuffer()
+{
+    if (s_threadSlot._generation == _generation)
+        return static_cast<ThreadBuffer*>(s_threadSlot._buffer);
+
+    // first event on this thread:
+    ThreadBuffer* buffer = new ThreadBuffer(_capacity);
+    {
+        Threading::ScopedMutexLock lock(_buffersMutex);
+        _buffers.push_back(buffer);
+    }
+    s_threadSlot._generation = _generation;
+    s_threadSlot._buffer = buffer;
+    return buffer;
+}
+
+void
+TraceMetricsBackend::record(const Record* records, unsigned count)
+{
+    ThreadBuffer* buffer = getBuffer();
+
+    unsigned head = buffer->_head;
+    unsigned tail = buffer->_tail;
+    if (head - tail + count > _capacity)
+    {
+        for (unsigned i = 0; i < count; ++i)
+            ++buffer->_dropped;
+        return;
+    }
+
+    for (unsigned i = 0; i < count; ++i)
+        buffer->_records[(head + i) & buffer->_mask] = records[i];
+
+    // publish to the writer
+    buffer->_head.exchange(head + count);
+}
+
+unsigned
+TraceMetricsBackend::addArgs(const Config& args)
+{
+    std::stringstream buf;
+    bool first = true;
+    for (ConfigSet::const_iterator i = args.children().begin(); i != args.children().end(); ++i)
+    {
+        if (!first)
+            buf << ", ";
+        buf << "\"" << escape(i->key()) << "\": \"" << escape(i->value()) << "\"";
+        first = false;
+    }
+
+    Threading::ScopedMutexLock lock(_argsMutex);
+    _pendingArgs.push_back(buf.str());
+    return _numArgs++;
+}
+
+void
+TraceMetricsBackend::beginEvent(unsigned id)
+{
+    Record r;
+    r._ticks = osg::Timer::instance()->tick();
+    r._value = 0.0;
+    r._id = id;
+    r._arg = RECORD_BEGIN << 24;
+    record(&r, 1u);
+}
+
+void
+TraceMetricsBackend::endEvent(unsigned id)
+{
+    Record r;
+    r._ticks = osg::Timer::instance()->tick();
+    r._value = 0.0;
+    r._id = id;
+    r._arg = RECORD_END << 24;
+    record(&r, 1u);
+}
+
+void
+TraceMetricsBackend::begin(const std::string& name, const Config& args)
+{
+    unsigned id = Metrics::intern(name.c_str());
+    unsigned argsIndex = args.empty() ? MAX_PAYLOAD + 1u : addArgs(args);
+    if (argsIndex > MAX_PAYLOAD)
+    {
+        beginEvent(id);
+        return;
+    }
+
+    Record r[2];
+    r[0]._ticks = r[1]._ticks = osg::Timer::instance()->tick();
+    r[0]._value = r[1]._value = 0.0;
+    r[0]._id = r[1]._id = id;
+    r[0]._arg = (RECORD_ARGS << 24) | argsIndex;
+    r[1]._arg = RECORD_BEGIN << 24;
+    record(r, 2u);
+}
+
+void
+TraceMetricsBackend::end(const std::string& name, const Config& args)
+{
+    unsigned id = Metrics::intern(name.c_str());
+    unsigned argsIndex = args.empty() ? MAX_PAYLOAD + 1u : addArgs(args);
+    if (argsIndex > MAX_PAYLOAD)
+    {
+        endEvent(id);
+        return;
+    }
+
+    Record r[2];
+    r[0]._ticks = r[1]._ticks = osg::Timer::instance()->tick();
+    r[0]._value = r[1]._value = 0.0;
+    r[0]._id = r[1]._id = id;
+    r[0]._arg = (RECORD_ARGS << 24) | argsIndex;
+    r[1]._arg = RECORD_END << 24;
+    record(r, 2u);
+}
+
+void
+TraceMetricsBackend::counter(const std::string& graph,
+                             const std::string& name0, double value0,
+                             const std::string& name1, double value1,
+                             const std::string& name2, double value2)
+{
+    const std::string* names[3] = { &name0, &name1, &name2 };
+    double values[3] = { value0, value1, value2 };
+
+    osg::Timer_t now = osg::Timer::instance()->tick();
+    unsigned graphID = Metrics::intern(graph.c_str());
+
+    Record r[3];
+    unsigned count = 0u;
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        if (names[i]->empty())
+            continue;
+
+        unsigned nameID = Metrics::intern(names[i]->c_str());
+        if (nameID > MAX_PAYLOAD)
+            continue;
+
+        r[count]._ticks = now;
+        r[count]._value = values[i];
+        r[count]._id = graphID;
+        r[count]._arg = (RECORD_COUNTER << 24) | nameID;
+        ++count;
+    }
+
+    if (count > 0u)
+        record(r, count);
+}
+
+void
+TraceMetricsBackend::flush()
+{
+    Threading::ScopedMutexLock lock(_fileMutex);
+    if (!_file.is_open())
+        return;
+
+    std::vector<ThreadBuffer*> buffers;
+    {
+        Threading::ScopedMutexLock bufferLock(_buffersMutex);
+        buffers = _buffers;
+    }
+
+    for (unsigned b = 0; b < buffers.size(); ++b)
+    {
+        ThreadBuffer* buffer = buffers[b];
+        unsigned head = buffer->_head;
+        unsigned tail = buffer->_tail;
+        unsigned count = head - tail;
+        if (count == 0u)
+            continue;
+
+        writeValue(_file, BLOCK_EVENTS);
+        writeValue(_file, buffer->_threadId);
+        writeValue(_file, count);
+
+        // the ring may wrap around the end of the array:
+        unsigned first = tail & buffer->_mask;
+        unsigned span = std::min(count, _capacity - first);
+        _file.write(reinterpret_cast<const char*>(&buffer->_records[first]), span * sizeof(Record));
+        if (span < count)
+            _file.write(reinterpret_cast<const char*>(&buffer->_records[0]), (count - span) * sizeof(Record));
+
+        // release the slots to the owner
+        buffer->_tail.exchange(head);
+    }
+
+    // names and args used by the events above were registered before
+    // the events were recorded, so they are all available now.
+    writeTables();
+
+    _file.flush();
+}
+
+void
+TraceMetricsBackend::writeTables()
+{
+    unsigned numNames = Metrics::getNumEventNames();
+    if (numNames > _namesWritten)
+    {
+        std::vector<std::string> names;
+        for (unsigned id = _namesWritten + 1u; id <= numNames; ++id)
+            names.push_back(Metrics::getEventName(id));
+        writeStrings(_file, BLOCK_NAMES, _namesWritten + 1u, names);
+        _namesWritten = numNames;
+    }
+
+    std::vector<std::string> args;
+    unsigned firstArgs;
+    {
+        Threading::ScopedMutexLock lock(_argsMutex);
+        args.swap(_pendingArgs);
+        firstArgs = _numArgs - args.size();
+    }
+    if (!args.empty())
+    {
+        writeStrings(_file, BLOCK_ARGS, firstArgs, args);
+    }
+}
+
+unsigned
+TraceMetricsBackend::getNumDropped() const
+{
+    Threading::ScopedMutexLock lock(_buffersMutex);
+    unsigned total = 0u;
+    for (unsigned i = 0; i < _buffers.size(); ++i)
+        total += _buffers[i]->_dropped;
+    return total;
+}
+
+bool
+TraceMetricsBackend::convertToChrome(std::istream& in, std::ostream& out)
+{
+    char magic[sizeof(TRACE_MAGIC)];
+    in.read(magic, sizeof(magic));
+    if (!in.good() || !std::equal(magic, magic + sizeof(magic), TRACE_MAGIC))
+        return false;
+
+    double secondsPerTick;
+    osg::Timer_t start;
+    if (!readValue(in, secondsPerTick) || !readValue(in, start))
+        return false;
+
+    // Read everything first; the string tables follow the events that use them.
+    std::map<unsigned, std::string> names, args;
+    std::vector< std::pair<unsigned, std::vector<Record> > > blocks;
+
+    unsigned type;
+    while (readValue(in, type))
+    {
+        if (type == BLOCK_EVENTS)
+        {
+            unsigned threadId, count;
+            if (!readValue(in, threadId) || !readValue(in, count))
+                return false;
+            blocks.push_back(std::make_pair(threadId, std::vector<Record>(count)));
+            if (count > 0u)
+            {
+                in.read(reinterpret_cast<char*>(&blocks.back().second[0]), count * sizeof(Record));
+                if (!in.good())
+                    return false;
+            }
+        }
+        else if (type == BLOCK_NAMES)
+        {
+            if (!readStrings(in, names))
+                return false;
+        }
+        else if (type == BLOCK_ARGS)
+        {
+            if (!readStrings(in, args))
+                return false;
+        }
+        else
+        {
+            OE_WARN << LC << "Unknown block type " << type << std::endl;
+            return false;
+        }
+    }
+
+    double usPerTick = secondsPerTick * 1.0e6;
+    bool firstEvent = true;
+
+    out << "[";
+    for (unsigned b = 0; b < blocks.size(); ++b)
+    {
+        unsigned threadId = blocks[b].first;
+        const std::vector<Record>& records = blocks[b].second;
+        int pendingArgs = -1;
+
+        for (unsigned i = 0; i < records.size(); ++i)
+        {
+            const Record& r = records[i];
+            RecordType rt = r.getType();
+
+            if (rt == RECORD_ARGS)
+            {
+                pendingArgs = (int)r.getPayload();
+                continue;
+            }
+
+            if (rt != RECORD_BEGIN && rt != RECORD_END && rt != RECORD_COUNTER)
+                continue;
+
+            if (!firstEvent)
+                out << "," << std::endl;
+            firstEvent = false;
+
+            double ts = (double)(r._ticks - start) * usPerTick;
+
+            out << "{"
+                << "\"cat\": \"\","
+                << "\"pid\": 0,"
+                << "\"tid\": " << threadId << ","
+                << "\"ts\": " << std::setprecision(15) << ts << ","
+                << "\"ph\": \"" << (rt == RECORD_BEGIN ? "B" : rt == RECORD_END ? "E" : "C") << "\","
+                << "\"name\": \"" << escape(names[r._id]) << "\"";
+
+            if (rt == RECORD_COUNTER)
+            {
+                // one counter event covers consecutive values for the same graph and time
+                out << ", \"args\": {";
+                unsigned j = i;
+                for (; j < records.size() &&
+                       records[j].getType() == RECORD_COUNTER &&
+                       records[j]._id == r._id &&
+                       records[j]._ticks == r._ticks; ++j)
+                {
+                    if (j > i)
+                        out << ", ";
+                    out << "\"" << escape(names[records[j].getPayload()]) << "\": "
+                        << std::setprecision(9) << records[j]._value;
+                }
+                out << "}";
+                i = j - 1u;
+            }
+            else if (pendingArgs >= 0)
+            {
+                out << ", \"args\": {" << args[(unsigned)pendingArgs] << "}";
+            }
+            pendingArgs = -1;
+
+            out << "}";
+        }
+    }
+    out << "]" << std::endl;
+
+    return true;
+}
@@ -0,0 +1,110 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/TrajectoryPredictor>
+#include <algorithm>
+
+using namespace osgEarth;
+
+namespace
+{
+    struct SortByTime
+    {
+        bool operator()(const TrajectoryPredictor::Sample& lhs, double rhs) const {
+            return lhs._time < rhs;
+        }
+    };
+}
+
+TrajectoryPredictor::TrajectoryPredictor() :
+_history( 0.5 )
+{
+    //nop
+}
+
+void
+TrajectoryPredictor::addSample(double time, const osg::Vec3d& eye)
+{
+    // a repeated time (e.g. a second camera in the same frame) replaces the sample.
+    if ( !_samples.empty() && time <= _samples.back()._time )
+    {
+        _samples.back()._eye = eye;
+        return;
+    }
+
+    _samples.push_back( Sample(time, eye) );
+
+    // keep one sample older than the window so the velocity spans all of it.
+    while ( _samples.size() > 2u && _samples[1]._time <= time - _history )
+    {
+        _samples.pop_front();
+    }
+}
+
+double
+TrajectoryPredictor::getLatestTime() const
+{
+    return _samples.empty() ? 0.0 : _samples.back()._time;
+}
+
+bool
+TrajectoryPredictor::predict(double ahead, osg::Vec3d& out_eye) const
+{
+    if ( !_path.empty() )
+    {
+        out_eye = interpolate( _path, getLatestTime() + ahead );
+        return true;
+    }
+
+    if ( _samples.size() < 2u )
+        return false;
+
+    const Sample& first = _samples.front();
+    const Sample& last  = _samples.back();
+    double dt = last._time - first._time;
+    if ( dt <= 0.0 )
+        return false;
+
+    osg::Vec3d velocity = (last._eye - first._eye) / dt;
+    out_eye = last._eye + velocity * ahead;
+    return true;
+}
+
+osg::Vec3d
+TrajectoryPredictor::interpolate(const Path& path, double time)
+{
+    if ( path.empty() )
+        return osg::Vec3d();
+
+    if ( time <= path.front()._time )
+        return path.front()._eye;
+
+    if ( time >= path.back()._time )
+        return path.back()._eye;
+
+    // first sample at or after the time; the one before it brackets the time.
+    Path::const_iterator hi = std::lower_bound( path.begin(), path.end(), time, SortByTime() );
+    Path::const_iterator lo = hi - 1;
+
+    double span = hi->_time - lo->_time;
+    double t = span > 0.0 ? (time - lo->_time) / span : 1.0;
+    return lo->_eye + (hi->_eye - lo->_eye) * t;
+}
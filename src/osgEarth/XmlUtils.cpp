@@ -25,6 +25,9 @@
 #include <algorithm>
 #include <sstream>
 #include <iomanip>
+#include <cstring>
+#include <map>
+#include <vector>
 
 
 using namespace osgEarth;
@@ -533,3 +536,449 @@ XmlDocument::store( std::ostream& out ) const
 
     //out << doc;    
 }
+
+//------------------------------------------------------------------------
+
+namespace
+{
+    inline bool isXmlSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    void appendUTF8(unsigned code, std::string& out)
+    {
+        if ( code < 0x80 ) {
+            out += (char)code;
+        }
+        else if ( code < 0x800 ) {
+            out += (char)(0xC0 | (code >> 6));
+            out += (char)(0x80 | (code & 0x3F));
+        }
+        else if ( code < 0x10000 ) {
+            out += (char)(0xE0 | (code >> 12));
+            out += (char)(0x80 | ((code >> 6) & 0x3F));
+            out += (char)(0x80 | (code & 0x3F));
+        }
+        else {
+            out += (char)(0xF0 | (code >> 18));
+            out += (char)(0x80 | ((code >> 12) & 0x3F));
+            out += (char)(0x80 | ((code >> 6) & 0x3F));
+            out += (char)(0x80 | (code & 0x3F));
+        }
+    }
+
+    /**
+     * Single-pass XML parser that builds a Config tree directly, skipping
+     * the TinyXML DOM and the XmlElement tree. It reproduces what
+     * XmlDocument::load(...)->getConfig() would create: lower-cased tag and
+     * attribute names, attributes ahead of child elements, text condensed the
+     * way TinyXML does it, and xi:include elements expanded in place.
+     */
+    class ConfigXmlParser
+    {
+    public:
+        ConfigXmlParser(const std::string& xml, const std::string& referrer) :
+            _begin   ( xml.c_str() ),
+            _p       ( xml.c_str() ),
+            _end     ( xml.c_str() + xml.size() ),
+            _referrer( referrer ) { }
+
+        bool parse(Config& doc);
+
+        const std::string& error() const { return _error; }
+
+    private:
+        struct Open
+        {
+            Config*     _conf;
+            std::string _text;
+        };
+
+        const char*        _begin;
+        const char*        _p;
+        const char*        _end;
+        std::string        _referrer;
+        std::string        _error;
+        std::vector<Open>  _stack;
+
+        // tag and attribute names, interned as lower-case keys
+        typedef std::map<std::string, std::string> KeyTable;
+        KeyTable _keys;
+
+        const std::string& key(const std::string& name)
+        {
+            KeyTable::iterator i = _keys.find(name);
+            if ( i == _keys.end() )
+                i = _keys.insert( std::make_pair(name, osgEarth::toLower(name)) ).first;
+            return i->second;
+        }
+
+        bool startsWith(const char* token) const
+        {
+            unsigned len = ::strlen(token);
+            return (unsigned)(_end - _p) >= len && ::strncmp(_p, token, len) == 0;
+        }
+
+        const char* search(const char* token) const
+        {
+            unsigned len = ::strlen(token);
+            for( const char* p = _p; p + len <= _end; ++p )
+                if ( ::strncmp(p, token, len) == 0 )
+                    return p;
+            return 0L;
+        }
+
+        void skipSpace()
+        {
+            while( _p < _end && isXmlSpace(*_p) )
+                ++_p;
+        }
+
+        std::string readName()
+        {
+            const char* start = _p;
+            while( _p < _end && !isXmlSpace(*_p) && *_p != '/' && *_p != '>' && *_p != '=' )
+                ++_p;
+            return std::string(start, _p);
+        }
+
+        const char* decodeEntity(const char* p, const char* end, std::string& out) const
+        {
+            if ( p+2 < end && p[1] == '#' )
+            {
+                const char* q = p+2;
+                bool hex = (*q == 'x' || *q == 'X');
+                if ( hex ) ++q;
+                unsigned code = 0;
+                const char* digits = q;
+                for( ; q < end && *q != ';'; ++q )
+                {
+                    char c = *q;
+                    if ( c >= '0' && c <= '9' )              code = code * (hex ? 16 : 10) + (c - '0');
+                    else if ( hex && c >= 'a' && c <= 'f' )  code = code * 16 + (c - 'a' + 10);
+                    else if ( hex && c >= 'A' && c <= 'F' )  code = code * 16 + (c - 'A' + 10);
+                    else break;
+                }
+                if ( q < end && *q == ';' && q > digits )
+                {
+                    appendUTF8(code, out);
+                    return q+1;
+                }
+            }
+            else
+            {
+                static const struct { const char* str; unsigned len; char chr; } entities[] = {
+                    { "&amp;",  5, '&'  },
+                    { "&lt;",   4, '<'  },
+                    { "&gt;",   4, '>'  },
+                    { "&quot;", 6, '\"' },
+                    { "&apos;", 6, '\'' } };
+
+                for( unsigned i = 0; i < 5; ++i )
+                {
+                    if ( (unsigned)(end - p) >= entities[i].len && ::strncmp(p, entities[i].str, entities[i].len) == 0 )
+                    {
+                        out += entities[i].chr;
+                        return p + entities[i].len;
+                    }
+                }
+            }
+
+            // not an entity; keep the ampersand.
+            out += '&';
+            return p+1;
+        }
+
+        // Appends character data, collapsing each run of whitespace into a single
+        // space and dropping leading and trailing whitespace (as TinyXML does).
+        void appendText(const char* start, const char* end, std::string& out) const
+        {
+            bool whitespace = false;
+            bool any = false;
+            for( const char* p = start; p < end; )
+            {
+                if ( isXmlSpace(*p) )
+                {
+                    whitespace = true;
+                    ++p;
+                    continue;
+                }
+
+                if ( whitespace && any )
+                    out += ' ';
+                whitespace = false;
+                any = true;
+
+                if ( *p == '&' )
+                    p = decodeEntity(p, end, out);
+                else
+                    out += *p++;
+            }
+        }
+
+        bool fail(const std::string& msg)
+        {
+            unsigned row = 1;
+            for( const char* p = _begin; p < _p && p < _end; ++p )
+                if ( *p == '\n' ) ++row;
+            _error = Stringify() << msg << " (row " << row << ")";
+            return false;
+        }
+
+        bool readStartTag(Config& parent);
+        void closeElement();
+        void expandInclude(Config& conf);
+    };
+
+    bool
+    ConfigXmlParser::parse(Config& doc)
+    {
+        bool rootDone = false;
+
+        while( _p < _end && !rootDone )
+        {
+            if ( *_p != '<' )
+            {
+                const char* start = _p;
+                while( _p < _end && *_p != '<' )
+                    ++_p;
+                if ( !_stack.empty() )
+                    appendText( start, _p, _stack.back()._text );
+            }
+
+            else if ( startsWith("<!--") )
+            {
+                const char* e = search("-->");
+                if ( !e ) return fail("Unterminated comment");
+                _p = e + 3;
+            }
+
+            else if ( startsWith("<![CDATA[") )
+            {
+                _p += 9;
+                const char* e = search("]]>");
+                if ( !e ) return fail("Unterminated CDATA section");
+                if ( !_stack.empty() )
+                    _stack.back()._text.append( _p, e );
+                _p = e + 3;
+            }
+
+            else if ( startsWith("<?") )
+            {
+                const char* e = search("?>");
+                if ( !e ) return fail("Unterminated declaration");
+                _p = e + 2;
+            }
+
+            else if ( startsWith("<!") )
+            {
+                // DOCTYPE and friends, which may nest <...> blocks.
+                int depth = 0;
+                for( ++_p; _p < _end; ++_p )
+                {
+                    if ( *_p == '<' ) ++depth;
+                    else if ( *_p == '>' && depth-- == 0 ) break;
+                }
+                if ( _p >= _end ) return fail("Unterminated declaration");
+                ++_p;
+            }
+
+            else if ( startsWith("</") )
+            {
+                _p += 2;
+                std::string name = readName();
+                skipSpace();
+                if ( _p >= _end || *_p != '>' )
+                    return fail("Malformed end tag");
+                ++_p;
+
+                if ( _stack.empty() || key(name) != _stack.back()._conf->key() )
+                    return fail("Mismatched end tag </" + name + ">");
+
+                closeElement();
+                rootDone = _stack.empty();
+            }
+
+            else
+            {
+                Config& parent = _stack.empty() ? doc : *_stack.back()._conf;
+                if ( !readStartTag(parent) )
+                    return false;
+                rootDone = _stack.empty();
+            }
+        }
+
+        if ( !rootDone )
+            return fail( _stack.empty() ? "No root element" : "Unclosed element <" + _stack.back()._conf->key() + ">" );
+
+        return true;
+    }
+
+    bool
+    ConfigXmlParser::readStartTag(Config& parent)
+    {
+        ++_p;
+        std::string name = readName();
+        if ( name.empty() )
+            return fail("Malformed tag");
+
+        parent.children().push_back( Config(key(name)) );
+        Config& conf = parent.children().back();
+
+        // attributes, sorted by name like XmlAttributes
+        std::map<std::string, std::string> attrs;
+        bool selfClosing = false;
+        while( true )
+        {
+            skipSpace();
+            if ( _p >= _end )
+                return fail("Unterminated tag <" + name + ">");
+
+            if ( *_p == '>' )
+            {
+                ++_p;
+                break;
+            }
+            if ( *_p == '/' )
+            {
+                if ( _p+1 >= _end || _p[1] != '>' )
+                    return fail("Malformed tag <" + name + ">");
+                _p += 2;
+                selfClosing = true;
+                break;
+            }
+
+            std::string attrName = readName();
+            if ( attrName.empty() )
+                return fail("Malformed attribute in <" + name + ">");
+            skipSpace();
+            if ( _p >= _end || *_p != '=' )
+                return fail("Missing value for attribute " + attrName);
+            ++_p;
+            skipSpace();
+
+            std::string value;
+            if ( _p < _end && (*_p == '"' || *_p == '\'') )
+            {
+                char quote = *_p++;
+                const char* start = _p;
+                while( _p < _end && *_p != quote )
+                    ++_p;
+                if ( _p >= _end )
+                    return fail("Unterminated value for attribute " + attrName);
+                for( const char* p = start; p < _p; )
+                {
+                    if ( *p == '&' ) p = decodeEntity(p, _p, value);
+                    else value += *p++;
+                }
+                ++_p;
+            }
+            else
+            {
+                // unquoted; tolerated the same way TinyXML does
+                while( _p < _end && !isXmlSpace(*_p) && *_p != '>' && *_p != '/' )
+                    value += *_p++;
+            }
+
+            attrs[key(attrName)] = value;
+        }
+
+        for( std::map<std::string, std::string>::const_iterator a = attrs.begin(); a != attrs.end(); ++a )
+            conf.children().push_back( Config(a->first, a->second) );
+
+        Open open;
+        open._conf = &conf;
+        _stack.push_back( open );
+
+        if ( selfClosing )
+            closeElement();
+
+        return true;
+    }
+
+    void
+    ConfigXmlParser::closeElement()
+    {
+        Open& top = _stack.back();
+        Config& conf = *top._conf;
+
+        conf.value() = trim( top._text );
+
+        if ( conf.key() == "xi:include" )
+            expandInclude( conf );
+        else
+            conf.buildIndex();
+
+        _stack.pop_back();
+    }
+
+    void
+    ConfigXmlParser::expandInclude(Config& conf)
+    {
+        std::string href = conf.child("href").value();
+        if ( href.empty() )
+        {
+            OE_WARN << "Missing href with xi:include" << std::endl;
+            conf = Config();
+            return;
+        }
+
+        URIContext uriContext( _referrer );
+        URI uri( href, uriContext );
+        std::string fullURI = uri.full();
+        OE_INFO << "Loading href from " << fullURI << std::endl;
+
+        Config included;
+        if ( XmlDocument::loadConfig(URI(fullURI), included) && !included.children().empty() )
+        {
+            Config result = included.children().front();
+            result.setExternalRef( href );
+            result.setReferrer( fullURI );
+            conf = result;
+        }
+        else
+        {
+            OE_WARN << "Failed to load xi:include from " << fullURI << std::endl;
+            conf = Config();
+        }
+    }
+
+    bool
+    parseConfig( const std::string& xml, const std::string& referrer, Config& output )
+    {
+        output = Config( "Document" );
+
+        ConfigXmlParser parser( xml, referrer );
+        if ( !parser.parse(output) )
+        {
+            OE_WARN << "Error in XML document: " << parser.error() << std::endl;
+            if ( !referrer.empty() )
+                OE_WARN << referrer << std::endl;
+            output = Config();
+            return false;
+        }
+
+        output.setReferrer( referrer );
+        return true;
+    }
+}
+
+bool
+XmlDocument::loadConfig( std::istream& in, const URIContext& uriContext, Config& output )
+{
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return parseConfig( buffer.str(), URI("", uriContext).full(), output );
+}
+
+bool
+XmlDocument::loadConfig( const URI& uri, Config& output, const osgDB::Options* dbOptions )
+{
+    ReadResult r = uri.readString( dbOptions );
+    if ( r.succeeded() )
+    {
+        return parseConfig( r.getString(), uri.full(), output );
+    }
+    return false;
+}
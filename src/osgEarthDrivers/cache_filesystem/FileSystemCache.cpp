@@ -152,6 +152,12 @@ namespace
             meta.fromJSON( bufStr );
         }
     }
+
+    double getFileSize( const std::string& fullPath )
+    {
+        struct stat buf;
+        return stat(fullPath.c_str(), &buf) == 0 ? (double)buf.st_size : 0.0;
+    }
 }
 
 
@@ -348,7 +354,10 @@ namespace
         std::string path = fileURI.full() + OSG_EXT;
 
         if ( !osgDB::fileExists(path) )
+        {
+            getCounters()->recordCacheMiss();
             return ReadResult( ReadResult::RESULT_NOT_FOUND );
+        }
 
         osgEarth::TimeStamp timeStamp = osgEarth::getLastModifiedTime(path);     
 
@@ -358,9 +367,17 @@ namespace
         {
             ScopedReadLock lock(_mutex);
 
+            osg::Timer_t start = osg::Timer::instance()->tick();
             r = _rw->readImage( path, dbo.get() );
+            getCounters()->recordDecode(osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick()));
             if ( !r.success() )
+            {
+                getCounters()->recordCacheMiss();
                 return ReadResult();
+            }
+
+            getCounters()->recordCacheHit();
+            getCounters()->recordBytesRead(getFileSize(path));
 
             // read metadata
             Config meta;
@@ -385,7 +402,10 @@ namespace
         std::string path = fileURI.full() + OSG_EXT;
 
         if ( !osgDB::fileExists(path) )
+        {
+            getCounters()->recordCacheMiss();
             return ReadResult( ReadResult::RESULT_NOT_FOUND );
+        }
 
         osgEarth::TimeStamp timeStamp = osgEarth::getLastModifiedTime(path);
 
@@ -395,9 +415,17 @@ namespace
         {
             ScopedReadLock lock(_mutex);
 
+            osg::Timer_t start = osg::Timer::instance()->tick();
             r = _rw->readObject( path, dbo.get() );
+            getCounters()->recordDecode(osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick()));
             if ( !r.success() )
+            {
+                getCounters()->recordCacheMiss();
                 return ReadResult();
+            }
+
+            getCounters()->recordCacheHit();
+            getCounters()->recordBytesRead(getFileSize(path));
 
             // read metadata
             Config meta;
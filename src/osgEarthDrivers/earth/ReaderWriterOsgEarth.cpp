@@ -228,12 +228,11 @@ class ReaderWriterEarth : public osgDB::ReaderWriter
             // from an "anonymous" stream here)
             URIContext uriContext( readOptions ); 
 
-            osg::ref_ptr<XmlDocument> doc = XmlDocument::load( in, uriContext );
-            if ( !doc.valid() )
+            // parse straight into a Config; no intermediate XML DOM
+            Config docConf;
+            if ( !XmlDocument::loadConfig( in, uriContext, docConf ) )
                 return ReadResult::ERROR_IN_READING_FILE;
 
-            Config docConf = doc->getConfig();
-
             // support both "map" and "earth" tag names at the top level
             Config conf;
             if ( docConf.hasChild( "map" ) )
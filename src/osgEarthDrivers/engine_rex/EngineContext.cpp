@@ -37,6 +37,7 @@ EngineContext::EngineContext(const Map*                     map,
                              GeometryPool*                  geometryPool,
                              Loader*                        loader,
                              Unloader*                      unloader,
+                             Prefetcher*                    prefetcher,
                              TileRasterizer*                tileRasterizer,
                              TileNodeRegistry*              liveTiles,
                              const RenderBindings&          renderBindings,
@@ -48,6 +49,7 @@ _terrainEngine ( terrainEngine ),
 _geometryPool  ( geometryPool ),
 _loader        ( loader ),
 _unloader      ( unloader ),
+_prefetcher    ( prefetcher ),
 _tileRasterizer( tileRasterizer ),
 _liveTiles     ( liveTiles ),
 _renderBindings( renderBindings ),
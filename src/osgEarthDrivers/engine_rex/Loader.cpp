@@ -42,6 +42,7 @@ Loader::Request::Request()
     _state = IDLE;
     _loadCount = 0;
     _priority = 0;
+    _screenSpaceError = 0.0f;
     _lastFrameSubmitted = 0;
     _lastTick = 0;
 }
@@ -480,6 +481,159 @@ PagerLoader::invokeAndRelease(UID requestUID)
 }
 
 
+//...............................................
+
+#undef  LC
+#define LC "[PooledLoader] "
+
+namespace
+{
+    // Cancels the rex request along with the scheduler job, so a load
+    // already in progress sees it through its own progress callback.
+    struct CancelRequest : public ProgressCallback
+    {
+        CancelRequest(Loader::Request* request) : _request(request) { }
+
+        void cancel()
+        {
+            ProgressCallback::cancel();
+            _request->setState( Loader::Request::IDLE );
+        }
+
+        Loader::Request* _request; // owned by the job
+    };
+}
+
+struct PooledLoader::Job : public FrameScheduler::Job
+{
+    Job(PooledLoader* loader, Loader::Request* request) :
+        _loader(loader), _request(request)
+    {
+        setProgressCallback( new CancelRequest(request) );
+    }
+
+    void run(ProgressCallback* progress)
+    {
+        if ( REPORT_ACTIVITY )
+            Registry::instance()->startActivity( _request->getName() );
+
+        _request->invoke();
+
+        // hold off new load() calls until the results merge.
+        if ( !progress->isCanceled() )
+            _request->setState( Request::MERGING );
+    }
+
+    void merge()
+    {
+        _request->apply( _loader->getFrameStamp() );
+        finish();
+    }
+
+    void onCanceled()
+    {
+        finish();
+    }
+
+    void finish()
+    {
+        _request->setState( Request::IDLE );
+        if ( REPORT_ACTIVITY )
+            Registry::instance()->endActivity( _request->getName() );
+        _loader->release( _request->getUID() );
+    }
+
+    PooledLoader*                 _loader;
+    osg::ref_ptr<Loader::Request> _request;
+};
+
+PooledLoader::PooledLoader(unsigned numThreads)
+{
+    _scheduler = new FrameScheduler( numThreads, "Rex loader" );
+    this->setNumChildrenRequiringUpdateTraversal( 1 );
+}
+
+void
+PooledLoader::setMergeBudget(unsigned microseconds)
+{
+    _scheduler->setMergeBudget( microseconds );
+    OE_INFO << LC << "Merge budget = " << microseconds << " us" << std::endl;
+}
+
+bool
+PooledLoader::load(Loader::Request* request, float priority, osg::NodeVisitor& nv)
+{
+    // check that the request is not already completed but unmerged:
+    if ( request && !request->isMerging() && !request->isFinished() )
+    {
+        unsigned fn = nv.getFrameStamp() ? nv.getFrameStamp()->getFrameNumber() : 0u;
+
+        // rank by screen-space error; prefetches (negative priority) go below everything else.
+        float score = request->_screenSpaceError;
+        if ( priority < 0.0f )
+            score = score/(1.0f + score) - 1.0f;
+
+        request->lock();
+        {
+            request->setState( Request::RUNNING );
+            request->_lastTick = osg::Timer::instance()->tick();
+            request->_priority = score;
+            request->setFrameNumber( fn );
+            request->_loadCount++;
+        }
+        request->unlock();
+
+        osg::ref_ptr<Job> job;
+        {
+            Threading::ScopedMutexLock lock( _jobsMutex );
+            osg::ref_ptr<Job>& entry = _jobs[request->getUID()];
+            if ( !entry.valid() )
+                entry = new Job( this, request );
+            job = entry.get();
+        }
+
+        _scheduler->request( job.get(), score, fn );
+        return true;
+    }
+    return false;
+}
+
+void
+PooledLoader::clear()
+{
+    _scheduler->cancelAll();
+}
+
+void
+PooledLoader::release(UID uid)
+{
+    Threading::ScopedMutexLock lock( _jobsMutex );
+    _jobs.erase( uid );
+}
+
+void
+PooledLoader::traverse(osg::NodeVisitor& nv)
+{
+    if ( nv.getVisitorType() == nv.UPDATE_VISITOR && nv.getFrameStamp() )
+    {
+        setFrameStamp( nv.getFrameStamp() );
+
+        // cancel what the cull no longer wants, and merge within the budget.
+        {
+            METRIC_SCOPED("loader.merge");
+            _scheduler->update( nv.getFrameStamp()->getFrameNumber() );
+        }
+
+        FrameScheduler::Stats stats = _scheduler->getStats();
+        Metrics::counter("RexStats",
+            "Loader queued", stats._queued,
+            "Loader running", stats._running,
+            "Loader canceled", stats._canceledQueued + stats._canceledRunning);
+    }
+
+    LoaderGroup::traverse( nv );
+}
+
 
 namespace osgEarth { namespace Drivers { namespace RexTerrainEngine
 {
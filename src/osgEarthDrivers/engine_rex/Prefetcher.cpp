@@ -0,0 +1,98 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Prefetcher"
+
+#include <osgEarth/Metrics>
+
+using namespace osgEarth::Drivers::RexTerrainEngine;
+using namespace osgEarth;
+
+#define LC "[Prefetcher] "
+
+// frames after which a camera that stopped culling is forgotten
+#define MAX_IDLE_FRAMES 120u
+
+Prefetcher::Prefetcher() :
+_lookAhead( 0.0 )
+{
+    //nop
+}
+
+void
+Prefetcher::setFlightPath(const TrajectoryPredictor::Path& path)
+{
+    Threading::ScopedMutexLock lock( _mutex );
+    _path = path;
+    for(Tracks::iterator i = _tracks.begin(); i != _tracks.end(); ++i)
+    {
+        i->second._predictor.setFlightPath( _path );
+    }
+}
+
+bool
+Prefetcher::update(const osg::Camera* camera, const osg::FrameStamp* stamp, const osg::Vec3d& eye, osg::Vec3d& out_eye)
+{
+    if ( !isEnabled() || !camera || !stamp )
+        return false;
+
+    Threading::ScopedMutexLock lock( _mutex );
+
+    unsigned frame = stamp->getFrameNumber();
+
+    Tracks::iterator t = _tracks.find( camera );
+    if ( t == _tracks.end() )
+    {
+        // forget cameras that have not been seen for a while
+        for(Tracks::iterator i = _tracks.begin(); i != _tracks.end(); )
+        {
+            if ( frame - i->second._lastFrame > MAX_IDLE_FRAMES )
+                _tracks.erase( i++ );
+            else
+                ++i;
+        }
+
+        t = _tracks.insert( std::make_pair(camera, Track()) ).first;
+        t->second._predictor.setFlightPath( _path );
+    }
+
+    Track& track = t->second;
+    track._lastFrame = frame;
+    track._predictor.addSample( stamp->getReferenceTime(), eye );
+
+    return track._predictor.predict( _lookAhead, out_eye );
+}
+
+float
+Prefetcher::getHitRate() const
+{
+    unsigned hits = _hits;
+    unsigned demanded = hits + (unsigned)_late;
+    return demanded > 0u ? (float)hits / (float)demanded : 0.0f;
+}
+
+void
+Prefetcher::report() const
+{
+    Metrics::counter("RexStats",
+        "Prefetch requests", (unsigned)_requests,
+        "Prefetch hit %", 100.0f * getHitRate());
+}
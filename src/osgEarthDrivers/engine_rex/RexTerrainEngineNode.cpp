@@ -153,6 +153,9 @@ _stateUpdateRequired  ( false )
     // unique ID for this engine:
     _uid = Registry::instance()->createUID();
 
+    // predicts camera motion for tile prefetching (disabled until setMap)
+    _prefetcher = new Prefetcher();
+
     // always require elevation.
     _requireElevationTextures = true;
 
@@ -263,25 +266,40 @@ RexTerrainEngineNode::setMap(const Map* map, const TerrainOptions& options)
     this->addChild( _geometryPool.get() );
 
     // Make a tile loader
-    PagerLoader* loader = new PagerLoader( this );
-    loader->setNumLODs(_terrainOptions.maxLOD().getOrUse(DEFAULT_MAX_LOD));
-    loader->setMergesPerFrame( _terrainOptions.mergesPerFrame().get() );
-    for (std::vector<RexTerrainEngineOptions::LODOptions>::const_iterator i = _terrainOptions.lods().begin(); i != _terrainOptions.lods().end(); ++i) {
-        if (i->_lod.isSet()) {
-            loader->setLODPriorityScale(i->_lod.get(), i->_priorityScale.getOrUse(1.0f));
-            loader->setLODPriorityOffset(i->_lod.get(), i->_priorityOffset.getOrUse(0.0f));
+    if ( _terrainOptions.loaderThreads().get() > 0u )
+    {
+        PooledLoader* loader = new PooledLoader( _terrainOptions.loaderThreads().get() );
+        loader->setMergeBudget( _terrainOptions.mergeBudget().get() );
+        _loader = loader;
+    }
+    else
+    {
+        PagerLoader* loader = new PagerLoader( this );
+        loader->setNumLODs(_terrainOptions.maxLOD().getOrUse(DEFAULT_MAX_LOD));
+        loader->setMergesPerFrame( _terrainOptions.mergesPerFrame().get() );
+        for (std::vector<RexTerrainEngineOptions::LODOptions>::const_iterator i = _terrainOptions.lods().begin(); i != _terrainOptions.lods().end(); ++i) {
+            if (i->_lod.isSet()) {
+                loader->setLODPriorityScale(i->_lod.get(), i->_priorityScale.getOrUse(1.0f));
+                loader->setLODPriorityOffset(i->_lod.get(), i->_priorityOffset.getOrUse(0.0f));
+            }
         }
+        _loader = loader;
     }
 
-    _loader = loader;
     this->addChild( _loader.get() );
 
     // Make a tile unloader
     _unloader = new UnloaderGroup( _liveTiles.get() );
     _unloader->setThreshold( _terrainOptions.expirationThreshold().get() );
+    // the option is in MB; clamp where size_t cannot hold the byte count.
+    double maxBytes = (double)_terrainOptions.memoryBudget().get() * 1048576.0;
+    _unloader->setMaxBytes( maxBytes < (double)(~(size_t)0) ? (size_t)maxBytes : ~(size_t)0 );
     _unloader->setReleaser(_releaser.get());
     this->addChild( _unloader.get() );
 
+    // Load tiles ahead of the camera's motion
+    _prefetcher->setLookAhead( _terrainOptions.prefetchTime().get() );
+
     // Tile rasterizer in case we need one
     _rasterizer = new TileRasterizer();
     this->addChild( _rasterizer );
@@ -314,6 +332,7 @@ RexTerrainEngineNode::setMap(const Map* map, const TerrainOptions& options)
         _geometryPool.get(),
         _loader.get(),
         _unloader.get(),
+        _prefetcher.get(),
         _rasterizer,
         _liveTiles.get(),
         _renderBindings,
@@ -537,6 +556,12 @@ RexTerrainEngineNode::traverse(osg::NodeVisitor& nv)
             _terrain->accept(visitor);
             _renderModelUpdateRequired = false;
         }
+
+        if ( _prefetcher->isEnabled() )
+        {
+            _prefetcher->report();
+        }
+
         TerrainEngineNode::traverse( nv );
     }
     
@@ -560,6 +585,16 @@ RexTerrainEngineNode::traverse(osg::NodeVisitor& nv)
         // Prepare the culler with the set of renderable layers:
         culler.setup(_mapFrame, _cachedLayerExtents, this->getEngineContext()->getRenderBindings());
 
+        // Predict where this camera is headed so tiles can load ahead of it.
+        // Inherited-viewpoint cameras follow another camera and don't count.
+        if ( _prefetcher->isEnabled() &&
+             cv->getCurrentCamera()->getReferenceFrame() != osg::Camera::ABSOLUTE_RF_INHERIT_VIEWPOINT )
+        {
+            osg::Vec3d eye;
+            culler._prefetch = _prefetcher->update(cv->getCurrentCamera(), nv.getFrameStamp(), culler.getViewPointLocal(), eye);
+            culler._prefetchEye = eye;
+        }
+
         // Assemble the terrain drawables:
         _terrain->accept(culler);
 
@@ -678,6 +713,12 @@ RexTerrainEngineNode::traverse(osg::NodeVisitor& nv)
     }
 }
 
+void
+RexTerrainEngineNode::setPrefetchPath(const TrajectoryPredictor::Path& path)
+{
+    _prefetcher->setFlightPath( path );
+}
+
 unsigned int
 RexTerrainEngineNode::computeSampleSize(unsigned int levelOfDetail)
 {    
@@ -71,6 +71,7 @@ _minExpiryTime( 0.0 ),
 _minExpiryFrames( 0 ),
 _lastTraversalTime(0.0),
 _lastTraversalFrame(0.0),
+_lastTraversalRange(0.0f),
 _count(0),
 _stitchNormalMap(false),
 _empty(false)               // an "empty" node exists but has no geometry or children.
@@ -338,18 +339,23 @@ TileNode::shouldSubDivide(TerrainCuller* culler, const SelectionInfo& selectionI
     }
     else
     {
-        float range = (float)selectionInfo.visParameters(currLOD+1)._visibilityRange2;
-        if (currLOD < selectionInfo.numLods() && currLOD != selectionInfo.numLods()-1)
-        {
-            return _surface->anyChildBoxIntersectsSphere(
-                culler->getViewPointLocal(), 
-                range,
-                culler->getLODScale());
-        }
+        return childrenInRange(selectionInfo, culler->getViewPointLocal(), culler->getLODScale());
     }                 
     return false;
 }
 
+bool
+TileNode::childrenInRange(const SelectionInfo& selectionInfo, const osg::Vec3& viewPoint, float lodScale) const
+{
+    unsigned currLOD = _key.getLOD();
+    if (currLOD < selectionInfo.numLods() && currLOD != selectionInfo.numLods()-1)
+    {
+        float range = (float)selectionInfo.visParameters(currLOD+1)._visibilityRange2;
+        return _surface->anyChildBoxIntersectsSphere(viewPoint, range, lodScale);
+    }
+    return false;
+}
+
 bool
 TileNode::cull_stealth(TerrainCuller* culler)
 {
@@ -387,6 +393,15 @@ TileNode::cull(TerrainCuller* culler)
         return false;
     }
     
+    // If this tile was prefetched, record whether its data arrived before the view needed it.
+    if ( _prefetched.exchange(0u) != 0u && context->getPrefetcher() )
+    {
+        if ( _dirty )
+            context->getPrefetcher()->late();
+        else
+            context->getPrefetcher()->hit();
+    }
+
     // determine whether we can and should subdivide to a higher resolution:
     bool childrenInRange = shouldSubDivide(culler, context->getSelectionInfo());
 
@@ -476,9 +491,70 @@ TileNode::cull(TerrainCuller* culler)
         load( culler );
     }
 
+    // The view doesn't need the children yet, but the predicted view might.
+    if ( !childrenInRange && culler->_prefetch && canLoadData && !_dirty )
+    {
+        prefetchSubTiles( culler );
+    }
+
     return true;
 }
 
+void
+TileNode::prefetchSubTiles(TerrainCuller* culler)
+{
+    EngineContext* context = culler->getEngineContext();
+
+    // Pixel-size selection depends on the whole camera, not just a viewpoint.
+    if ( *context->getOptions().rangeMode() == osg::LOD::PIXEL_SIZE_ON_SCREEN )
+        return;
+
+    if ( !childrenInRange(context->getSelectionInfo(), culler->_prefetchEye, culler->getLODScale()) )
+        return;
+
+    if ( !_childrenReady )
+    {
+        _mutex.lock();
+
+        if ( !_childrenReady )
+        {
+            createChildren( context );
+            _childrenReady = true;
+        }
+
+        _mutex.unlock();
+
+        // new subtiles cannot load until the next frame (same as cull).
+        return;
+    }
+
+    for(int i=0; i<4; ++i)
+    {
+        getSubTile(i)->prefetch( culler );
+    }
+}
+
+void
+TileNode::prefetch(TerrainCuller* culler)
+{
+    // keep the tile from going dormant while the prediction still wants it.
+    _lastTraversalFrame.exchange( culler->getFrameStamp()->getFrameNumber() );
+    _lastTraversalTime = culler->getFrameStamp()->getReferenceTime();
+
+    if ( _dirty )
+    {
+        if ( _prefetched.exchange(1u) == 0u && _context->getPrefetcher() )
+        {
+            _context->getPrefetcher()->requested();
+        }
+        load( culler, true );
+    }
+    else
+    {
+        prefetchSubTiles( culler );
+    }
+}
+
 bool
 TileNode::accept_cull(TerrainCuller* culler)
 {
@@ -489,6 +565,7 @@ TileNode::accept_cull(TerrainCuller* culler)
         // update the timestamp so this tile doesn't become dormant.
         _lastTraversalFrame.exchange( culler->getFrameStamp()->getFrameNumber() );
         _lastTraversalTime = culler->getFrameStamp()->getReferenceTime();
+        _lastTraversalRange = culler->getDistanceToViewPoint(getBound().center(), true);
 
         if ( !culler->isCulled(*this) )
         {
@@ -708,6 +785,24 @@ TileNode::merge(const TerrainTileModel* model, const RenderBindings& bindings)
         OE_DEBUG << LC << "notify (merge) key " << getKey().str() << std::endl;
         _context->getEngine()->getTerrain()->notifyTileAdded(getKey(), this);
     }
+
+    // new data changes the tile's memory footprint.
+    _context->liveTiles()->updateResidentBytes(this);
+}
+
+unsigned
+TileNode::getResidentBytes() const
+{
+    unsigned bytes = _renderModel.getResidentBytes();
+
+    // CPU copy of the mesh, used for intersections
+    if (_surface.valid() && _surface->getDrawable())
+    {
+        int size = _surface->getDrawable()->_tileSize;
+        bytes += size*size*sizeof(osg::Vec3f) + (size-1)*(size-1)*6*sizeof(GLuint);
+    }
+
+    return bytes;
 }
 
 void TileNode::loadChildren()
@@ -866,7 +961,7 @@ TileNode::refreshInheritedData(TileNode* parent, const RenderBindings& bindings)
 }
 
 void
-TileNode::load(TerrainCuller* culler)
+TileNode::load(TerrainCuller* culler, bool prefetch)
 {    
     const SelectionInfo& si = _context->getSelectionInfo();
     int lod     = getKey().getLOD();
@@ -886,9 +981,16 @@ TileNode::load(TerrainCuller* culler)
     // (because of the biggest range), and second by distance.
     float priority = lodPriority + distPriority;
 
+    // prefetches go behind everything the current view is waiting on.
+    if ( prefetch )
+        priority -= (float)(numLods+1);
+
     // normalize the composite priority to [0..1].
     //priority /= (float)(numLods+1); // GW: moved this to the PagerLoader.
 
+    // Loaders that rank by screen-space error use the tile's projected size.
+    _loadRequest->_screenSpaceError = culler->clampedPixelSize(getBound());
+
     // Submit to the loader.
     _context->getLoader()->load( _loadRequest.get(), priority, *culler );
 }
@@ -100,8 +100,16 @@ TileNodeRegistry::setDirty(const GeoExtent& extent,
 void
 TileNodeRegistry::addSafely(TileNode* tile)
 {
+    TileNodeMap::Entry* existing = _tiles.entry( tile->getKey() );
+    if ( existing )
+        _budget.remove( existing->bytes );
+
     _tiles.insert( tile->getKey(), tile );
     //_tiles[ tile->getTileKey() ] = tile;
+
+    TileNodeMap::Entry* entry = _tiles.entry( tile->getKey() );
+    entry->bytes = tile->getResidentBytes();
+    _budget.add( entry->bytes );
     if ( _revisioningEnabled )
         tile->setMapRevision( _maprev );
     
@@ -137,17 +145,21 @@ TileNodeRegistry::addSafely(TileNode* tile)
 void
 TileNodeRegistry::removeSafely(const TileKey& key)
 {
-    TileNode* tile = _tiles.find(key);
-    if (tile)
+    TileNodeMap::Entry* entry = _tiles.entry(key);
+    if (entry)
     {
+        TileNode* tile = entry->tile.get();
+
         // remove neighbor listeners:
         stopListeningFor(key.createNeighborKey(1, 0), tile);
         stopListeningFor(key.createNeighborKey(0, 1), tile);
 
+        _budget.remove( entry->bytes );
+
         // remove the tile.
         _tiles.erase( key );
 
-        Metrics::counter("RexStats", "Tiles", _tiles.size());
+        Metrics::counter("RexStats", "Tiles", _tiles.size(), "Resident MB", (double)_budget.getResidentBytes()/1048576.0);
     }
 
     //for(TileKeyOneToMany::iterator i = _notifiers.begin(); i != _notifiers.end(); )
@@ -161,6 +173,25 @@ TileNodeRegistry::removeSafely(const TileKey& key)
     //}
 }
 
+void
+TileNodeRegistry::updateResidentBytes( TileNode* tile )
+{
+    if ( tile )
+    {
+        unsigned bytes = tile->getResidentBytes();
+
+        Threading::ScopedWriteLock exclusive( _tilesMutex );
+        TileNodeMap::Entry* entry = _tiles.entry( tile->getKey() );
+        if ( entry && entry->tile.get() == tile )
+        {
+            _budget.update( entry->bytes, bytes );
+            entry->bytes = bytes;
+
+            Metrics::counter("RexStats", "Resident MB", (double)_budget.getResidentBytes()/1048576.0);
+        }
+    }
+}
+
 void
 TileNodeRegistry::add( TileNode* tile )
 {
@@ -334,8 +365,9 @@ TileNodeRegistry::releaseAll(ResourceReleaser* releaser)
 
         _tiles.clear();
         _notifiers.clear();
+        _budget.clear();
 
-        Metrics::counter("RexStats", "Tiles", _tiles.size());
+        Metrics::counter("RexStats", "Tiles", _tiles.size(), "Resident MB", 0.0);
     }
 
     releaser->push(objects);
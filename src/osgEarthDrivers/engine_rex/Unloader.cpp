@@ -21,6 +21,7 @@
 #include "TileNodeRegistry"
 
 #include <osgEarth/Metrics>
+#include <algorithm>
 
 using namespace osgEarth::Drivers::RexTerrainEngine;
 
@@ -59,6 +60,41 @@ namespace
             traverse(node);
         }
     };
+
+    // collects every tile whose subtiles are all dormant.
+    struct CollectCandidates : public TileNodeRegistry::ConstOperation
+    {
+        std::vector<TileMemoryBudget::Candidate>& _candidates;
+        const osg::FrameStamp*                    _stamp;
+
+        CollectCandidates(std::vector<TileMemoryBudget::Candidate>& candidates, const osg::FrameStamp* stamp)
+            : _candidates(candidates), _stamp(stamp) { }
+
+        void operator()(const TileNodeRegistry::TileNodeMap& tiles) const
+        {
+            for (TileNodeRegistry::TileNodeMap::const_iterator i = tiles.begin(); i != tiles.end(); ++i)
+            {
+                const TileNode* tile = i->second.tile.get();
+                if (tile->areSubTilesDormant(_stamp))
+                {
+                    // the subtiles' own bytes; their descendants go too, so
+                    // this underestimates what the eviction frees.
+                    TileMemoryBudget::Candidate c;
+                    c._key = i->first;
+                    for (unsigned k = 0; k < 4; ++k)
+                    {
+                        const TileNode* subtile = tile->getSubTile(k);
+                        c._lastFrame = std::max(c._lastFrame, subtile->getLastTraversalFrame());
+                        c._range = std::max(c._range, subtile->getLastTraversalRange());
+                        const TileNodeRegistry::TileNodeMap::Entry* entry = tiles.entry(subtile->getKey());
+                        if (entry)
+                            c._bytes += entry->bytes;
+                    }
+                    _candidates.push_back(c);
+                }
+            }
+        }
+    };
 }
 
 //........................................................................
@@ -74,6 +110,12 @@ _threshold( INT_MAX )
     this->setNumChildrenRequiringUpdateTraversal( 1u );
 }
 
+void
+UnloaderGroup::setMaxBytes(size_t value)
+{
+    _tiles->getMemoryBudget().setMaxBytes( value );
+}
+
 void
 UnloaderGroup::unloadChildren(const std::vector<TileKey>& keys)
 {
@@ -102,17 +144,7 @@ UnloaderGroup::traverse(osg::NodeVisitor& nv)
                     // re-check for dormancy in case something has changed
                     if ( parentNode->areSubTilesDormant(nv.getFrameStamp()) )
                     {
-                        // find and move all tiles to be unloaded to the dead pile.
-                        ExpirationCollector collector( _tiles );
-                        for(unsigned i=0; i<parentNode->getNumChildren(); ++i)
-                            parentNode->getSubTile(i)->accept( collector );
-                        unloaded += collector._count;
-
-                        // submit all collected nodes for GL resource release:
-                        if (!collector._nodes.empty() && _releaser.valid())
-                            _releaser->push(collector._nodes);
-
-                        parentNode->removeSubTiles();
+                        unloaded += unloadSubTiles( parentNode.get() );
                     }
                     else notDormant++;
                 }
@@ -122,7 +154,60 @@ UnloaderGroup::traverse(osg::NodeVisitor& nv)
             OE_DEBUG << LC << "Total=" << _parentKeys.size() << "; threshold=" << _threshold << "; unloaded=" << unloaded << "; notDormant=" << notDormant << "; notFound=" << notFound << "\n";
             _parentKeys.clear();
         }
+
+        if ( _tiles->getMemoryBudget().isOverBudget() )
+        {
+            unloadToBudget( nv.getFrameStamp() );
+        }
     }
     osg::Group::traverse( nv );
 }
 
+unsigned
+UnloaderGroup::unloadSubTiles(TileNode* parentNode)
+{
+    // find and move all tiles to be unloaded to the dead pile.
+    ExpirationCollector collector( _tiles );
+    for(unsigned i=0; i<parentNode->getNumChildren(); ++i)
+        parentNode->getSubTile(i)->accept( collector );
+
+    // submit all collected nodes for GL resource release:
+    if (!collector._nodes.empty() && _releaser.valid())
+        _releaser->push(collector._nodes);
+
+    parentNode->removeSubTiles();
+    return collector._count;
+}
+
+void
+UnloaderGroup::unloadToBudget(const osg::FrameStamp* stamp)
+{
+    ScopedMetric m("Unloader budget");
+
+    const TileMemoryBudget& budget = _tiles->getMemoryBudget();
+
+    std::vector<TileMemoryBudget::Candidate> candidates;
+    _tiles->run( CollectCandidates(candidates, stamp) );
+    budget.selectEvictions( candidates );
+
+    size_t before = budget.getResidentBytes();
+    unsigned unloaded = 0;
+    for(std::vector<TileMemoryBudget::Candidate>::const_iterator c = candidates.begin(); c != candidates.end(); ++c)
+    {
+        if ( !budget.isOverBudget() )
+            break;
+
+        // the tile may have gone with an ancestor already.
+        osg::ref_ptr<TileNode> parentNode;
+        if ( _tiles->get(c->_key, parentNode) && parentNode->areSubTilesDormant(stamp) )
+        {
+            unloaded += unloadSubTiles( parentNode.get() );
+        }
+    }
+
+    Metrics::counter("RexStats", "Budget unloads", unloaded);
+
+    OE_DEBUG << LC << "Budget=" << budget.getMaxBytes() << "; before=" << before << "; after=" << budget.getResidentBytes()
+        << "; candidates=" << candidates.size() << "; unloaded=" << unloaded << "\n";
+}
+
@@ -69,12 +69,13 @@ namespace
 }
 
 
-FeatureCursorOGR::FeatureCursorOGR(OGRDataSourceH              dsHandle,
-                                   OGRLayerH                   layerHandle,
-                                   const FeatureSource*        source,
-                                   const FeatureProfile*       profile,
-                                   const Symbology::Query&     query,
-                                   const FeatureFilterList&    filters) :
+FeatureCursorOGR::FeatureCursorOGR(OGRDataSourceH                dsHandle,
+                                   OGRLayerH                     layerHandle,
+                                   const FeatureSource*          source,
+                                   const FeatureProfile*         profile,
+                                   const Symbology::Query&       query,
+                                   const FeatureFilterList&      filters,
+                                   const std::vector<FeatureID>* fids) :
 _source           ( source ),
 _dsHandle         ( dsHandle ),
 _layerHandle      ( layerHandle ),
@@ -85,8 +86,23 @@ _chunkSize        ( 500 ),
 _nextHandleToQueue( 0L ),
 _resultSetEndReached(false),
 _profile          ( profile ),
-_filters          ( filters )
+_filters          ( filters ),
+_readById         ( fids != 0L ),
+_nextFid          ( 0u )
 {
+    if ( _readById )
+    {
+        // the features are already known; read them straight from the layer.
+        _fids = *fids;
+        _resultSetHandle = _layerHandle;
+
+        if ( _query.tileKey().isSet() && !_query.bounds().isSet() && profile )
+        {
+            GeoExtent localEx = _query.tileKey()->getExtent().transform( profile->getSRS() );
+            _query.bounds() = localEx.bounds();
+        }
+    }
+    else
     {
         OGR_SCOPED_LOCK;
 
@@ -238,7 +254,7 @@ FeatureCursorOGR::readChunk()
         FeatureList filterList;
         while( filterList.size() < _chunkSize && !_resultSetEndReached )
         {
-            OGRFeatureH handle = OGR_L_GetNextFeature( _resultSetHandle );
+            OGRFeatureH handle = readNext();
             if ( handle )
             {
                 osg::ref_ptr<Feature> feature = OgrUtils::createFeature( handle, _profile.get() );
@@ -290,3 +306,18 @@ FeatureCursorOGR::readChunk()
     }
 }
 
+// next feature of the result set or the ID list; call with the OGR lock held.
+OGRFeatureH
+FeatureCursorOGR::readNext()
+{
+    if ( !_readById )
+        return OGR_L_GetNextFeature( _resultSetHandle );
+
+    while ( _nextFid < _fids.size() )
+    {
+        OGRFeatureH handle = OGR_L_GetFeature( _resultSetHandle, _fids[_nextFid++] );
+        if ( handle )
+            return handle;
+    }
+    return 0L;
+}
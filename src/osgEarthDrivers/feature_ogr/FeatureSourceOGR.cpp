@@ -21,6 +21,7 @@
 #include <osgEarth/FileUtils>
 #include <osgEarth/StringUtils>
 #include <osgEarthFeatures/FeatureSource>
+#include <osgEarthFeatures/FeatureBoundsIndex>
 #include <osgEarthFeatures/Filter>
 #include <osgEarthFeatures/BufferFilter>
 #include <osgEarthFeatures/ScaleFilter>
@@ -29,6 +30,7 @@
 #include "FeatureCursorOGR"
 #include <osgEarthFeatures/OgrUtils>
 #include <osg/Notify>
+#include <osg/Timer>
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <list>
@@ -251,6 +253,12 @@ public:
                 }
             }
 
+            // or index the feature bounds ourselves, if requested.
+            if ( _options.boundsIndex() == true && !_writable )
+            {
+                initBoundsIndex();
+            }
+
 
             //Get the feature count
             _featureCount = OGR_L_GetFeatureCount( _layerHandle, 1 );
@@ -327,6 +335,31 @@ public:
         }
         else
         {
+            // If the bounds index can answer the query, read just the features it
+            // finds. Every OGR call holds the global lock, so the cursor can share
+            // our layer handle instead of opening the source again.
+            if ( _boundsIndex.valid() &&
+                 !query.expression().isSet() &&
+                 !query.orderby().isSet() &&
+                 (query.bounds().isSet() || query.tileKey().isSet()) )
+            {
+                Bounds bounds = query.bounds().isSet() ?
+                    query.bounds().get() :
+                    query.tileKey()->getExtent().transform( getFeatureProfile()->getSRS() ).bounds();
+
+                std::vector<FeatureID> fids;
+                _boundsIndex->query( bounds, fids );
+
+                return new FeatureCursorOGR(
+                    0L,
+                    _layerHandle,
+                    this,
+                    getFeatureProfile(),
+                    query,
+                    getFilters(),
+                    &fids );
+            }
+
             OGRDataSourceH dsHandle = 0L;
             OGRLayerH layerHandle = 0L;
 
@@ -375,6 +408,7 @@ public:
             if (OGR_L_DeleteFeature( _layerHandle, fid ) == OGRERR_NONE)
             {
                 _needsSync = true;
+                dirty();
                 return true;
             }            
         }
@@ -525,6 +559,67 @@ protected:
         }
     }
 
+    // Reads the bounds index saved next to the source file, or builds
+    // and saves it. Call with the OGR lock held.
+    void initBoundsIndex()
+    {
+        if ( !osgDB::fileExists(_source) )
+        {
+            OE_WARN << LC << "bounds_index needs a local file; ignoring it for " << getName() << std::endl;
+            return;
+        }
+
+        if ( !OGR_L_TestCapability(_layerHandle, OLCRandomRead) )
+        {
+            OE_WARN << LC << "OGR driver cannot read features by ID; ignoring bounds_index for " << getName() << std::endl;
+            return;
+        }
+
+        std::string filename = _source;
+        if ( _options.layer().isSet() )
+            filename += "." + _options.layer().get();
+        filename += ".oeidx";
+
+        TimeStamp modified = getLastModifiedTime(_source);
+
+        _boundsIndex = FeatureBoundsIndex::read(filename, modified);
+        if ( _boundsIndex.valid() )
+        {
+            OE_INFO << LC << "Read bounds index for " << _boundsIndex->size() << " features from " << filename << std::endl;
+            return;
+        }
+
+        osg::Timer_t t0 = osg::Timer::instance()->tick();
+
+        _boundsIndex = new FeatureBoundsIndex();
+
+        OGR_L_ResetReading( _layerHandle );
+        OGRFeatureH handle;
+        while ( (handle = OGR_L_GetNextFeature(_layerHandle)) != 0L )
+        {
+            // features without geometry never match a spatial query.
+            OGRGeometryH geom = OGR_F_GetGeometryRef( handle );
+            if ( geom )
+            {
+                OGREnvelope env;
+                OGR_G_GetEnvelope( geom, &env );
+                _boundsIndex->insert( (FeatureID)OGR_F_GetFID(handle), Bounds(env.MinX, env.MinY, env.MaxX, env.MaxY) );
+            }
+            OGR_F_Destroy( handle );
+        }
+        OGR_L_ResetReading( _layerHandle );
+
+        _boundsIndex->build();
+
+        OE_INFO << LC << "Indexed bounds of " << _boundsIndex->size() << " features in "
+            << osg::Timer::instance()->delta_s(t0, osg::Timer::instance()->tick()) << "s" << std::endl;
+
+        if ( !_boundsIndex->write(filename, modified) )
+        {
+            OE_INFO << LC << "Cannot save bounds index to " << filename << "; it will be rebuilt next time" << std::endl;
+        }
+    }
+
 
 
 
@@ -535,6 +630,7 @@ private:
     OGRLayerH _layerHandle;
     OGRSFDriverH _ogrDriverHandle;
     osg::ref_ptr<Symbology::Geometry> _geometry; // explicit geometry.
+    osg::ref_ptr<FeatureBoundsIndex> _boundsIndex;
     const OGRFeatureOptions _options;
     int _featureCount;
     bool _needsSync;
@@ -175,6 +175,12 @@ public:
         return false;
     }
 
+    // features come from an image layer in the query's map.
+    virtual bool dependsOnMap() const
+    {
+        return true;
+    }
+
     virtual const FeatureSchema& getSchema() const
     {
         //TODO:  Populate the schema from the DescribeFeatureType call
@@ -25,6 +25,7 @@
 #include <osgEarth/Registry>
 #include <osgEarth/ImageUtils>
 #include <osgEarthFeatures/FeatureSource>
+#include <osgEarthFeatures/BoundaryIndex>
 #include <osgEarthSymbology/Geometry>
 
 #define LC "[Intersect FeatureFilter] "
@@ -63,37 +64,18 @@ public: // FeatureFilter
         return Status::OK();
     }
 
-    /**
-     * Gets all the features that intersect the extent
-     */
-    void getFeatures(const GeoExtent& extent, FeatureList& features)
-    {
-        GeoExtent localExtent = extent.transform( _featureSource->getFeatureProfile()->getSRS() );
-        Query query;
-        query.bounds() = localExtent.bounds();
-        if (localExtent.intersects( _featureSource->getFeatureProfile()->getExtent()))
-        {
-            osg::ref_ptr< FeatureCursor > cursor = _featureSource->createFeatureCursor( query );
-            if (cursor)
-            {
-                cursor->fill( features );
-            }
-        }     
-    }
-
     FilterContext push(FeatureList& input, FilterContext& context)
     {
         if (_featureSource.valid())
         {
-            // Get any features that intersect this query.
-            FeatureList boundaries;
-            getFeatures(context.extent().get(), boundaries );
-            
-            
+            // Boundaries near this extent, in the features' SRS.
+            osg::ref_ptr<BoundaryIndex> boundaries = BoundaryIndex::getOrCreate(
+                context.getSession(), _featureSource.get(), context.profile()->getSRS(), context.extent().get() );
+
             // The list of output features
             FeatureList output;
 
-            if (boundaries.empty())
+            if (!boundaries.valid() || boundaries->size() == 0)
             {
                 // No intersecting features.  If contains is false, then just the output to the input.
                 if (contains() == false)
@@ -103,11 +85,7 @@ public: // FeatureFilter
             }
             else
             {
-                // Transform the boundaries into the coordinate system of the features
-                for (FeatureList::iterator itr = boundaries.begin(); itr != boundaries.end(); ++itr)
-                {
-                    itr->get()->transform( context.profile()->getSRS() );
-                }
+                const GeoExtent& sourceExtent = _featureSource->getFeatureProfile()->getExtent();
 
                 for(FeatureList::const_iterator f = input.begin(); f != input.end(); ++f)
                 {
@@ -116,43 +94,14 @@ public: // FeatureFilter
                     {
                         osg::Vec2d c = feature->getGeometry()->getBounds().center2d();
 
-                        if ( contains() == true )
-                        {
-                            // coarsest:
-                            if (_featureSource->getFeatureProfile()->getExtent().contains(GeoPoint(feature->getSRS(), c.x(), c.y())))
-                            {
-                                for (FeatureList::iterator itr = boundaries.begin(); itr != boundaries.end(); ++itr)
-                                {
-                                    Ring* ring = dynamic_cast< Ring*>(itr->get()->getGeometry());
-                                    if (ring && ring->contains2D(c.x(), c.y()))
-                                    {
-                                        output.push_back( feature );
-                                    }
-                                }                        
-                            }
-                        }
+                        // coarsest, then the indexed boundaries:
+                        bool contained =
+                            sourceExtent.contains(GeoPoint(feature->getSRS(), c.x(), c.y())) &&
+                            boundaries->findContaining(c.x(), c.y()) != 0L;
 
-                        else
-                        {    
-                            bool contained = false;
-
-                            // coarsest:
-                            if (_featureSource->getFeatureProfile()->getExtent().contains(GeoPoint(feature->getSRS(), c.x(), c.y())))
-                            {
-                                for (FeatureList::iterator itr = boundaries.begin(); itr != boundaries.end(); ++itr)
-                                {
-                                    Ring* ring = dynamic_cast< Ring*>(itr->get()->getGeometry());
-                                    if (ring && ring->contains2D(c.x(), c.y()))
-                                    {                             
-                                        contained = true;
-                                        break;
-                                    }
-                                }
-                            }
-                            if ( !contained )
-                            {
-                                output.push_back( feature );
-                            }
+                        if ( contained == contains() )
+                        {
+                            output.push_back( feature );
                         }
                     }
                 }
@@ -25,6 +25,7 @@
 #include <osgEarth/Registry>
 #include <osgEarth/ImageUtils>
 #include <osgEarthFeatures/FeatureSource>
+#include <osgEarthFeatures/BoundaryIndex>
 #include <osgEarthSymbology/Geometry>
 
 #define LC "[Intersect FeatureFilter] "
@@ -63,39 +64,17 @@ public: // FeatureFilter
         return Status::OK();
     }
 
-    /**
-     * Gets all the features that intersect the extent
-     */
-    void getFeatures(const GeoExtent& extent, FeatureList& features)
-    {
-        GeoExtent localExtent = extent.transform( _featureSource->getFeatureProfile()->getSRS() );
-        Query query;
-        query.bounds() = localExtent.bounds();
-        if (localExtent.intersects( _featureSource->getFeatureProfile()->getExtent()))
-        {
-            osg::ref_ptr< FeatureCursor > cursor = _featureSource->createFeatureCursor( query );
-            if (cursor)
-            {
-                cursor->fill( features );
-            }
-        }     
-    }
-
     FilterContext push(FeatureList& input, FilterContext& context)
     {
         if (_featureSource.valid())
         {
-            // Get any features that intersect this query.
-            FeatureList boundaries;
-            getFeatures(context.extent().get(), boundaries );
+            // Boundaries near this extent, in the features' SRS.
+            osg::ref_ptr<BoundaryIndex> boundaries = BoundaryIndex::getOrCreate(
+                context.getSession(), _featureSource.get(), context.profile()->getSRS(), context.extent().get() );
 
-            if (!boundaries.empty())
+            if (boundaries.valid() && boundaries->size() > 0)
             {
-                // Transform the boundaries into the coordinate system of the features
-                for (FeatureList::iterator itr = boundaries.begin(); itr != boundaries.end(); ++itr)
-                {
-                    itr->get()->transform( context.profile()->getSRS() );
-                }
+                const GeoExtent& sourceExtent = _featureSource->getFeatureProfile()->getExtent();
 
                 for(FeatureList::const_iterator f = input.begin(); f != input.end(); ++f)
                 {
@@ -103,24 +82,20 @@ public: // FeatureFilter
                     if ( feature && feature->getGeometry() )
                     {
                         osg::Vec2d c = feature->getGeometry()->getBounds().center2d();
-                       
-                        if (_featureSource->getFeatureProfile()->getExtent().contains(GeoPoint(feature->getSRS(), c.x(), c.y())))
+
+                        if (sourceExtent.contains(GeoPoint(feature->getSRS(), c.x(), c.y())))
                         {
-                            for (FeatureList::iterator itr = boundaries.begin(); itr != boundaries.end(); ++itr)
+                            const Feature* boundary = boundaries->findIntersecting( feature->getGeometry() );
+                            if ( boundary )
                             {
-                                //if (ring && ring->contains2D(c.x(), c.y()))
-                                if (itr->get()->getGeometry()->intersects( feature->getGeometry() ) )
+                                // Copy the attributes in the boundary to the feature
+                                for (AttributeTable::const_iterator attrItr = boundary->getAttrs().begin();
+                                     attrItr != boundary->getAttrs().end();
+                                     attrItr++)
                                 {
-                                    // Copy the attributes in the boundary to the feature
-                                    for (AttributeTable::const_iterator attrItr = itr->get()->getAttrs().begin();
-                                         attrItr != itr->get()->getAttrs().end();
-                                         attrItr++)
-                                    {
-                                        feature->set( attrItr->first, attrItr->second );
-                                    }
-                                    break;
+                                    feature->set( attrItr->first, attrItr->second );
                                 }
-                            }                        
+                            }
                         }
                     }
                 }
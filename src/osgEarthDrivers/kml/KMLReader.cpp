@@ -19,6 +19,7 @@
 #include "KMLReader"
 #include "KML_Root"
 #include "KML_Geometry"
+#include "KMLStreamReader"
 #include <osgEarth/Registry>
 #include <osgEarth/Capabilities>
 #include <osgEarth/XmlUtils>
@@ -47,6 +48,11 @@ KMLReader::read( std::istream& in, const osgDB::Options* dbOptions )
     // pull the URI context out of the DB options:
     URIContext context(dbOptions);
 
+    if ( _options && _options->streaming() == true )
+    {
+        return readStreaming( in, dbOptions );
+    }
+
 	// Load the XML
     osg::Timer_t start = osg::Timer::instance()->tick();
 	std::stringstream buffer;
@@ -141,3 +147,54 @@ KMLReader::read( xml_document<>& doc, const osgDB::Options* dbOptions )
 
     return root;
 }
+
+osg::Node*
+KMLReader::readStreaming( std::istream& in, const osgDB::Options* dbOptions )
+{
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    osg::Group* root = new osg::Group();
+    root->ref();
+
+    URIContext context(dbOptions);
+    root->setName( context.referrer() );
+
+    KMLContext cx;
+    cx._mapNode   = _mapNode;
+    cx._sheet     = new StyleSheet();
+    cx._options   = _options;
+    cx._srs       = _mapNode->getMapSRS()->getGeographicSRS();
+    cx._referrer  = context.referrer();
+    cx._groupStack.push( root );
+
+    // clone the dbOptions, and install a resource cache if there isn't one already:
+    URIResultCache defaultUriCache;
+    if ( !URIResultCache::from(dbOptions) )
+    {
+        osgDB::Options* newOptions = Registry::instance()->cloneOrCreateOptions();
+        defaultUriCache.apply( newOptions );
+        cx._dbOptions = newOptions;
+    }
+    else
+    {
+        cx._dbOptions = dbOptions;
+    }
+
+    unsigned numFeatures = 0u, peakBuffer = 0u;
+    {
+        KMLStreamReader reader( cx );
+        reader.read( in );
+        numFeatures = reader.getNumFeatures();
+        peakBuffer  = reader.getPeakBufferSize();
+    }
+
+    osg::Timer_t end = osg::Timer::instance()->tick();
+    OE_INFO << LC << "Streamed " << numFeatures << " features in "
+        << osg::Timer::instance()->delta_s(start, end) << " s; peak buffer = "
+        << (peakBuffer/1024) << " KB" << std::endl;
+
+    // Make sure the KML gets rendered after the terrain.
+    root->getOrCreateStateSet()->setRenderBinDetails(2, "RenderBin");
+
+    return root;
+}
@@ -0,0 +1,588 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+ * Copyright 2016 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "KMLStreamReader"
+#include "KML_Document"
+#include "KML_Folder"
+#include "KML_PhotoOverlay"
+#include "KML_ScreenOverlay"
+#include "KML_GroundOverlay"
+#include "KML_NetworkLink"
+#include "KML_NetworkLinkControl"
+#include "KML_Placemark"
+#include "KML_Style"
+#include "KML_StyleMap"
+#include <osgEarth/StringUtils>
+#include <OpenThreads/Thread>
+#include <cctype>
+
+using namespace osgEarth_kml;
+using namespace osgEarth;
+
+#undef LC
+#define LC "[KMLStreamReader] "
+
+// size of each read from the input stream
+#define CHUNK_SIZE 65536
+
+namespace
+{
+    // Whether the element name is a KML feature that we build as a unit.
+    bool isLeafFeature( const std::string& name )
+    {
+        return
+            name == "placemark"     ||
+            name == "groundoverlay" ||
+            name == "screenoverlay" ||
+            name == "photooverlay"  ||
+            name == "networklink";
+    }
+
+    // Finds the end of the token starting at "pos". Returns false if
+    // the buffer does not yet hold the complete token.
+    bool findTokenEnd( const std::string& buf, std::string::size_type pos, bool eof, std::string::size_type& end )
+    {
+        if ( buf[pos] != '<' )
+        {
+            end = buf.find( '<', pos );
+            if ( end == std::string::npos )
+            {
+                if ( !eof ) return false;
+                end = buf.size();
+            }
+            return true;
+        }
+
+        // need enough characters to tell markup types apart
+        if ( !eof && buf.size() - pos < 9 )
+            return false;
+
+        std::string::size_type e;
+        if ( buf.compare(pos, 4, "<!--") == 0 )
+        {
+            e = buf.find( "-->", pos+4 );
+            if ( e == std::string::npos ) return false;
+            end = e + 3;
+        }
+        else if ( buf.compare(pos, 9, "<![CDATA[") == 0 )
+        {
+            e = buf.find( "]]>", pos+9 );
+            if ( e == std::string::npos ) return false;
+            end = e + 3;
+        }
+        else if ( buf.compare(pos, 2, "<?") == 0 )
+        {
+            e = buf.find( "?>", pos+2 );
+            if ( e == std::string::npos ) return false;
+            end = e + 2;
+        }
+        else
+        {
+            // regular tag; skip over quoted attribute values.
+            char quote = 0;
+            for( e = pos+1; e < buf.size(); ++e )
+            {
+                char c = buf[e];
+                if ( quote )
+                {
+                    if ( c == quote ) quote = 0;
+                }
+                else if ( c == '"' || c == '\'' )
+                {
+                    quote = c;
+                }
+                else if ( c == '>' )
+                {
+                    break;
+                }
+            }
+            if ( e >= buf.size() ) return false;
+            end = e + 1;
+        }
+        return true;
+    }
+
+    // Extracts the element name from a start or end tag.
+    std::string getTagName( const char* token, unsigned len )
+    {
+        unsigned i = token[1] == '/' ? 2 : 1;
+        unsigned start = i;
+        while( i < len && !::isspace(token[i]) && token[i] != '/' && token[i] != '>' )
+            ++i;
+        return std::string( token+start, i-start );
+    }
+}
+
+//........................................................................
+
+/**
+ * A set of features sharing a parent group, built as a unit.
+ * Batches that carry no fragments just attach their output
+ * (e.g. a container group) to the parent in document order.
+ */
+struct KMLStreamReader::Batch : public TaskRequest
+{
+    std::vector<std::string>  _fragments;
+    osg::ref_ptr<osg::Group>  _parent;
+    osg::ref_ptr<osg::Group>  _output;
+    KMLContext                _cx;
+    Threading::Event          _done;
+
+    Batch( osg::Group* parent ) :
+        _parent( parent ),
+        _output( new osg::Group() )
+    {
+        //nop
+    }
+
+    void setContext( const KMLContext& cx )
+    {
+        _cx = cx;
+
+        // each batch gets a private style sheet since inline styles
+        // get written to it during the build. It is filled in when the
+        // batch is dispatched (see copyStyles).
+        _cx._sheet = new StyleSheet();
+
+        _cx._groupStack = std::stack<osg::ref_ptr<osg::Group> >();
+        _cx._groupStack.push( _output.get() );
+    }
+
+    // Takes a copy of the shared styles, including any read while
+    // this batch was filling. Call just before building.
+    void copyStyles( const StyleSheet* sheet )
+    {
+        _cx._sheet->styles() = sheet->styles();
+    }
+
+    void operator()( ProgressCallback* progress )
+    {
+        build();
+        _done.set();
+    }
+
+    void build()
+    {
+        for( unsigned i = 0; i < _fragments.size(); ++i )
+        {
+            std::string& xml = _fragments[i];
+            try
+            {
+                xml_document<> doc;
+                doc.parse<0>( &xml[0] );
+                xml_node<>* node = &doc;
+
+                // same three passes the DOM reader makes, one feature at a time.
+                for_features( scan,  node, _cx );
+                for_features( scan2, node, _cx );
+                for_features( build, node, _cx );
+            }
+            catch( rapidxml::parse_error& e )
+            {
+                OE_WARN << LC << "Skipping malformed feature: " << e.what() << std::endl;
+            }
+
+            // release the text as soon as we're done with it
+            std::string().swap( xml );
+        }
+    }
+};
+
+//........................................................................
+
+KMLStreamReader::KMLStreamReader( KMLContext& cx ) :
+_cx            ( cx ),
+_captureType   ( CAPTURE_NONE ),
+_captureDepth  ( 0u ),
+_numFeatures   ( 0u ),
+_peakBufferSize( 0u )
+{
+    _root = _cx._groupStack.top().get();
+
+    _batchSize  = osg::maximum( 1u, _cx._options->streamingBatchSize().get() );
+    _maxPending = osg::maximum( 1u, _cx._options->streamingMaxPendingBatches().get() );
+
+    unsigned numThreads = _cx._options->streamingNumThreads().get();
+    if ( numThreads == 0u )
+        numThreads = (unsigned)OpenThreads::GetNumberOfProcessors();
+
+    // Placemarks write to the shared icon/label group when one is set,
+    // so in that case build everything on the calling thread.
+    if ( _cx._options->iconAndLabelGroup().valid() )
+        numThreads = 0u;
+
+    if ( numThreads > 0u )
+    {
+        _service = new TaskService( "KMLStreamReader", numThreads );
+    }
+}
+
+KMLStreamReader::~KMLStreamReader()
+{
+    // never leave batches in the task queue
+    drain( true );
+}
+
+bool
+KMLStreamReader::read( std::istream& in )
+{
+    std::vector<char> chunk( CHUNK_SIZE );
+    std::string buf;
+    std::string::size_type pos = 0;
+    bool eof = false;
+
+    while( true )
+    {
+        std::string::size_type end;
+        if ( pos < buf.size() && findTokenEnd(buf, pos, eof, end) )
+        {
+            handleToken( buf.data() + pos, (unsigned)(end - pos) );
+            pos = end;
+            continue;
+        }
+
+        if ( eof )
+            break;
+
+        // discard consumed data and read the next chunk.
+        buf.erase( 0, pos );
+        pos = 0;
+
+        in.read( &chunk[0], chunk.size() );
+        std::streamsize num = in.gcount();
+        if ( num > 0 )
+            buf.append( &chunk[0], (std::string::size_type)num );
+        else
+            eof = true;
+
+        _peakBufferSize = osg::maximum( _peakBufferSize, (unsigned)(buf.capacity() + _capture.capacity()) );
+    }
+
+    // close any elements left open by a truncated stream.
+    bool complete = _frames.empty() && _captureType == CAPTURE_NONE;
+    if ( _captureType == CAPTURE_HEADER && !_frames.empty() )
+        _frames.back()._header.append( _capture );
+    _captureType = CAPTURE_NONE;
+    while( !_frames.empty() )
+        endElement();
+
+    dispatch();
+    drain( true );
+
+    if ( !complete )
+    {
+        OE_WARN << LC << "KML stream ended unexpectedly" << std::endl;
+    }
+
+    return complete;
+}
+
+void
+KMLStreamReader::handleToken( const char* token, unsigned len )
+{
+    // character data
+    if ( token[0] != '<' )
+    {
+        if ( _captureType != CAPTURE_NONE )
+            _capture.append( token, len );
+        return;
+    }
+
+    if ( len > 1 && (token[1] == '?' || token[1] == '!') )
+    {
+        // CDATA is content, but comments and declarations are not.
+        if ( _captureType != CAPTURE_NONE && len > 2 && token[2] == '[' )
+            _capture.append( token, len );
+        return;
+    }
+
+    bool endTag = len > 1 && token[1] == '/';
+    bool selfClosing = !endTag && len > 2 && token[len-2] == '/';
+
+    if ( _captureType != CAPTURE_NONE )
+    {
+        _capture.append( token, len );
+        if ( endTag )
+        {
+            if ( --_captureDepth == 0 )
+                endCapture();
+        }
+        else if ( !selfClosing )
+        {
+            ++_captureDepth;
+        }
+    }
+    else if ( endTag )
+    {
+        endElement();
+    }
+    else
+    {
+        startElement( toLower(getTagName(token, len)), token, len, selfClosing );
+    }
+}
+
+void
+KMLStreamReader::startElement( const std::string& name, const char* tag, unsigned len, bool selfClosing )
+{
+    if ( name == "document" || name == "folder" )
+    {
+        if ( !_frames.empty() )
+            openContainer( _frames.back() );
+
+        Frame frame;
+        frame._container = true;
+        frame._name = getTagName( tag, len );
+        frame._startTag.assign( tag, len );
+        if ( selfClosing )
+        {
+            frame._startTag.erase( frame._startTag.size()-2, 1 );
+        }
+        _frames.push_back( frame );
+
+        if ( selfClosing )
+            endElement();
+    }
+
+    else if ( isLeafFeature(name) )
+    {
+        if ( !_frames.empty() )
+            openContainer( _frames.back() );
+        beginCapture( CAPTURE_FEATURE, tag, len, selfClosing );
+    }
+
+    else if ( name == "style" || name == "stylemap" )
+    {
+        beginCapture( CAPTURE_STYLE, tag, len, selfClosing );
+    }
+
+    else if ( name == "networklinkcontrol" )
+    {
+        beginCapture( CAPTURE_CONTROL, tag, len, selfClosing );
+    }
+
+    else if ( _frames.empty() )
+    {
+        // the root element (normally <kml>).
+        _frames.push_back( Frame() );
+        if ( selfClosing )
+            endElement();
+    }
+
+    else if ( _frames.back()._container && !_frames.back()._group.valid() )
+    {
+        // name, visibility, etc. for a container we haven't built yet.
+        beginCapture( CAPTURE_HEADER, tag, len, selfClosing );
+    }
+
+    else
+    {
+        beginCapture( CAPTURE_DISCARD, tag, len, selfClosing );
+    }
+}
+
+void
+KMLStreamReader::endElement()
+{
+    if ( _frames.empty() )
+        return;
+
+    if ( _frames.back()._container )
+    {
+        openContainer( _frames.back() );
+
+        // the pending batch belongs to this container; send it off.
+        dispatch();
+    }
+
+    _frames.pop_back();
+}
+
+void
+KMLStreamReader::beginCapture( CaptureType type, const char* tag, unsigned len, bool selfClosing )
+{
+    _captureType = type;
+    _captureDepth = 1u;
+    _capture.assign( tag, len );
+
+    if ( selfClosing )
+    {
+        _captureDepth = 0u;
+        endCapture();
+    }
+}
+
+void
+KMLStreamReader::endCapture()
+{
+    CaptureType type = _captureType;
+    _captureType = CAPTURE_NONE;
+
+    if ( type == CAPTURE_FEATURE )
+    {
+        addFeature( _capture );
+    }
+
+    else if ( type == CAPTURE_HEADER )
+    {
+        _frames.back()._header.append( _capture );
+    }
+
+    else if ( type == CAPTURE_STYLE || type == CAPTURE_CONTROL )
+    {
+        try
+        {
+            xml_document<> doc;
+            doc.parse<0>( &_capture[0] );
+            xml_node<>* node = &doc;
+
+            // styles go straight into the shared sheet; each batch copies
+            // the sheet when it is dispatched, so features captured before
+            // a style but dispatched after it still see it.
+            for_many( Style,              scan,  node, _cx );
+            for_many( StyleMap,           scan,  node, _cx );
+            for_many( Style,              scan2, node, _cx );
+            for_many( StyleMap,           scan2, node, _cx );
+            for_many( NetworkLinkControl, scan,  node, _cx );
+            for_many( NetworkLinkControl, scan2, node, _cx );
+        }
+        catch( rapidxml::parse_error& e )
+        {
+            OE_WARN << LC << "Skipping malformed style: " << e.what() << std::endl;
+        }
+    }
+
+    _capture.clear();
+}
+
+void
+KMLStreamReader::openContainer( Frame& frame )
+{
+    if ( !frame._container || frame._group.valid() )
+        return;
+
+    // parent group, before we create our own:
+    osg::Group* parent = currentGroup();
+
+    frame._group = new osg::Group();
+
+    std::string xml = frame._startTag + frame._header + "</" + frame._name + ">";
+    std::string().swap( frame._header );
+
+    try
+    {
+        xml_document<> doc;
+        doc.parse<0>( &xml[0] );
+        xml_node<>* node = doc.first_node();
+        if ( node )
+        {
+            KML_Folder container;
+            container.KML_Container::build( node, _cx, frame._group.get() );
+        }
+    }
+    catch( rapidxml::parse_error& e )
+    {
+        OE_WARN << LC << "Malformed header in " << frame._name << ": " << e.what() << std::endl;
+    }
+
+    // Features that came before this container may still be building;
+    // attach the group through the queue so the document order holds.
+    dispatch();
+    osg::ref_ptr<Batch> attach = new Batch( parent );
+    attach->_output->addChild( frame._group.get() );
+    attach->_done.set();
+    _pending.push_back( attach.get() );
+}
+
+osg::Group*
+KMLStreamReader::currentGroup() const
+{
+    for( std::vector<Frame>::const_reverse_iterator i = _frames.rbegin(); i != _frames.rend(); ++i )
+    {
+        if ( i->_group.valid() )
+            return i->_group.get();
+    }
+    return _root.get();
+}
+
+void
+KMLStreamReader::addFeature( std::string& fragment )
+{
+    osg::Group* parent = currentGroup();
+
+    if ( _batch.valid() && _batch->_parent.get() != parent )
+        dispatch();
+
+    if ( !_batch.valid() )
+    {
+        _batch = new Batch( parent );
+        _batch->setContext( _cx );
+    }
+
+    _batch->_fragments.push_back( std::string() );
+    _batch->_fragments.back().swap( fragment );
+    ++_numFeatures;
+
+    if ( _batch->_fragments.size() >= _batchSize )
+        dispatch();
+}
+
+void
+KMLStreamReader::dispatch()
+{
+    if ( _batch.valid() && !_batch->_fragments.empty() )
+    {
+        _batch->copyStyles( _cx._sheet.get() );
+
+        if ( _service.valid() )
+        {
+            _service->add( _batch.get() );
+        }
+        else
+        {
+            _batch->build();
+            _batch->_done.set();
+        }
+        _pending.push_back( _batch.get() );
+    }
+    _batch = 0L;
+
+    drain( false );
+}
+
+void
+KMLStreamReader::drain( bool all )
+{
+    // Merge finished batches into the scene graph in order. Block on the
+    // oldest batch when there are too many in memory (or when flushing).
+    while( !_pending.empty() )
+    {
+        Batch* batch = _pending.front().get();
+
+        bool mustWait = all || _pending.size() > _maxPending;
+        if ( !mustWait && !batch->_done.isSet() )
+            break;
+
+        batch->_done.wait();
+
+        for( unsigned i = 0; i < batch->_output->getNumChildren(); ++i )
+            batch->_parent->addChild( batch->_output->getChild(i) );
+
+        _pending.pop_front();
+    }
+}
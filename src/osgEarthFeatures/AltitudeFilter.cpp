@@ -18,7 +18,14 @@
  */
 #include <osgEarthFeatures/AltitudeFilter>
 #include <osgEarth/ElevationQuery>
+#include <osgEarth/ElevationPool>
 #include <osgEarth/GeoData>
+#include <osgEarth/MapFrame>
+#include <osgEarth/Metrics>
+#include <osgEarth/ModelLayer>
+#include <osgEarth/Registry>
+#include <osgEarth/TaskService>
+#include <algorithm>
 
 #define LC "[AltitudeFilter] "
 
@@ -28,6 +35,131 @@ using namespace osgEarth::Symbology;
 
 //---------------------------------------------------------------------------
 
+namespace
+{
+    // Samples a run of points that share elevation tiles, with its own
+    // envelope (envelopes are not thread-safe).
+    struct SampleElevations
+    {
+        SampleElevations() : points(0L), order(0L), begin(0u), end(0u), output(0L) { }
+
+        void execute()
+        {
+            for (unsigned i = begin; i < end; ++i)
+            {
+                unsigned k = (*order)[i];
+                (*output)[k] = envelope->getElevation((*points)[k].x(), (*points)[k].y());
+            }
+        }
+
+        osg::ref_ptr<ElevationEnvelope> envelope;
+        const std::vector<osg::Vec3d>*  points;
+        const std::vector<unsigned>*    order;
+        unsigned                        begin, end;
+        std::vector<float>*             output;
+    };
+
+    typedef ParallelTask<SampleElevations> SampleElevationsTask;
+
+    // orders point indices by the elevation tile that contains them
+    struct TileOrder
+    {
+        TileOrder(const std::vector<TileKey>& keys) : _keys(keys) { }
+        bool operator()(unsigned a, unsigned b) const { return _keys[a] < _keys[b]; }
+        const std::vector<TileKey>& _keys;
+    };
+
+    // below this many points, threading costs more than it saves
+    const unsigned MIN_POINTS_PER_TASK = 512u;
+
+    Threading::Mutex s_clampServiceMutex;
+    UID              s_clampServiceUID = -1;
+
+    TaskService* getClampService()
+    {
+        Threading::ScopedMutexLock lock( s_clampServiceMutex );
+        if ( s_clampServiceUID < 0 )
+            s_clampServiceUID = Registry::instance()->createUID();
+        return Registry::instance()->getTaskServiceManager()->getOrAdd( s_clampServiceUID );
+    }
+
+    /**
+     * Samples the elevation under every point in one batch. Points are grouped
+     * by the map tile that contains them so that each tile is resolved once,
+     * and the groups are sampled in parallel. Failed samples are NO_DATA_VALUE.
+     */
+    void getElevations(const std::vector<osg::Vec3d>& input,
+                       const SpatialReference*        inputSRS,
+                       MapFrame&                      mapf,
+                       unsigned                       lod,
+                       std::vector<float>&            output)
+    {
+        output.assign( input.size(), NO_DATA_VALUE );
+        ElevationPool* pool = mapf.getElevationPool();
+        if ( input.empty() || !pool )
+            return;
+
+        // move everything into the map's SRS once, up front.
+        const Profile* profile = mapf.getProfile();
+        std::vector<osg::Vec3d> points( input );
+        if ( !inputSRS->transform(points, profile->getSRS()) )
+        {
+            OE_WARN << LC << "Failed to transform points to the map SRS" << std::endl;
+            return;
+        }
+
+        std::vector<TileKey> keys( points.size() );
+        std::vector<unsigned> order( points.size() );
+        for (unsigned i = 0; i < points.size(); ++i)
+        {
+            keys[i] = profile->createTileKey( points[i].x(), points[i].y(), lod );
+            order[i] = i;
+        }
+        std::sort( order.begin(), order.end(), TileOrder(keys) );
+
+        // split the ordered points into runs, breaking only between tiles.
+        TaskService* service = points.size() >= 2u*MIN_POINTS_PER_TASK ? getClampService() : 0L;
+        unsigned numTasks = service ? (unsigned)service->getNumThreads() * 4u : 1u;
+        unsigned runSize = std::max( MIN_POINTS_PER_TASK, (unsigned)(points.size() / numTasks) + 1u );
+
+        std::vector< osg::ref_ptr<SampleElevationsTask> > tasks;
+        for (unsigned begin = 0; begin < order.size(); )
+        {
+            unsigned end = std::min( begin + runSize, (unsigned)order.size() );
+            while ( end < order.size() && keys[order[end]] == keys[order[end-1]] )
+                ++end;
+
+            SampleElevationsTask* task = new SampleElevationsTask();
+            task->envelope = pool->createEnvelope( profile->getSRS(), lod );
+            task->points = &points;
+            task->order = &order;
+            task->begin = begin;
+            task->end = end;
+            task->output = &output;
+            tasks.push_back( task );
+
+            begin = end;
+        }
+
+        if ( tasks.size() == 1u )
+        {
+            tasks.front()->execute();
+        }
+        else
+        {
+            Threading::MultiEvent done( tasks.size() );
+            for (unsigned i = 0; i < tasks.size(); ++i)
+            {
+                tasks[i]->_mev = &done;
+                service->add( tasks[i].get() );
+            }
+            done.wait();
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+
 AltitudeFilter::AltitudeFilter() :
 _maxRes ( 0.0f )
 {
@@ -145,6 +277,8 @@ AltitudeFilter::pushAndDontClamp( FeatureList& features, FilterContext& cx )
 void
 AltitudeFilter::pushAndClamp( FeatureList& features, FilterContext& cx )
 {
+    METRIC_SCOPED_EX("AltitudeFilter::pushAndClamp", 1, "features", toString(features.size()).c_str());
+
     OE_START_TIMER(pushAndClamp);
     unsigned total = 0;
 
@@ -156,9 +290,6 @@ AltitudeFilter::pushAndClamp( FeatureList& features, FilterContext& cx )
     const SpatialReference* mapSRS = mapf.getProfile()->getSRS();
     osg::ref_ptr<const SpatialReference> featureSRS = cx.profile()->getSRS();
 
-    // establish an elevation query interface based on the features' SRS.
-    ElevationQuery eq( mapf );
-
     NumericExpression scaleExpr;
     if ( _altitude->verticalScale().isSet() )
         scaleExpr = *_altitude->verticalScale();
@@ -180,41 +311,115 @@ AltitudeFilter::pushAndClamp( FeatureList& features, FilterContext& cx )
     bool vertEquiv =
         featureSRS->isVertEquivalentTo( mapSRS );
 
-    for( FeatureList::iterator i = features.begin(); i != features.end(); ++i )
+    osg::ref_ptr<const SpatialReference> featureSRSwithMapVertDatum = !vertEquiv ?
+        SpatialReference::create(featureSRS->getHorizInitString(), mapSRS->getVertInitString()) : 0L;
+
+    // First pass: evaluate the per-feature expressions and collect every point
+    // we need an elevation for (each vertex, or each feature's centroid).
+    std::vector<double> scales( features.size(), 1.0 );
+    std::vector<double> offsets( features.size(), 0.0 );
+    std::vector<osg::Vec3d> queryPoints;
     {
-        Feature* feature = i->get();
+        METRIC_SCOPED("AltitudeFilter::collect");
+
+        unsigned f = 0;
+        for( FeatureList::iterator i = features.begin(); i != features.end(); ++i, ++f )
+        {
+            Feature* feature = i->get();
         
-        // run a symbol script if present.
-        if ( _altitude.valid() && _altitude->script().isSet() )
+            // run a symbol script if present.
+            if ( _altitude.valid() && _altitude->script().isSet() )
+            {
+                StringExpression temp( _altitude->script().get() );
+                feature->eval( temp, &cx );
+            }
+
+            if ( _altitude.valid() && _altitude->verticalScale().isSet() )
+                scales[f] = feature->eval( scaleExpr, &cx );
+
+            if ( _altitude.valid() && _altitude->verticalOffset().isSet() )
+                offsets[f] = feature->eval( offsetExpr, &cx );
+
+            // Clamping to the centroid uses the whole feature, so that multipolygons
+            // are clamped as one and not per polygon.
+            if ( !perVertex )
+            {
+                osgEarth::Bounds bounds = feature->getGeometry()->getBounds();
+                const osg::Vec2d& center = bounds.center2d();
+                queryPoints.push_back( osg::Vec3d(center.x(), center.y(), 0.0) );
+            }
+            else
+            {
+                GeometryIterator gi( feature->getGeometry() );
+                while( gi.hasMore() )
+                {
+                    Geometry* geom = gi.next();
+                    queryPoints.insert( queryPoints.end(), geom->begin(), geom->end() );
+                }
+            }
+        }
+    }
+
+    // Second pass: sample the terrain under all of those points at once.
+    std::vector<float> elevations;
+    bool hasElevation = !mapf.elevationLayers().empty();
+    {
+        METRIC_SCOPED_EX("AltitudeFilter::sample", 1, "points", toString(queryPoints.size()).c_str());
+
+        // Terrain patches are model layers, which only the ElevationQuery knows
+        // how to intersect; use it in that (rare) case.
+        ModelLayerVector modelLayers;
+        mapf.getLayers( modelLayers );
+        bool hasPatches = false;
+        for( ModelLayerVector::const_iterator i = modelLayers.begin(); i != modelLayers.end() && !hasPatches; ++i )
+            hasPatches = i->get()->isTerrainPatch();
+
+        if ( hasPatches )
         {
-            StringExpression temp( _altitude->script().get() );
-            feature->eval( temp, &cx );
+            ElevationQuery eq( mapf );
+            elevations.reserve( queryPoints.size() );
+            for( unsigned i=0; i<queryPoints.size(); ++i )
+                elevations.push_back( eq.getElevation(GeoPoint(featureSRS.get(), queryPoints[i]), _maxRes) );
+        }
+        else if ( hasElevation )
+        {
+            // map the requested resolution to an LOD, as ElevationQuery does.
+            unsigned lod = 23u;
+            if ( _maxRes > 0.0 )
+            {
+                int level = mapf.getProfile()->getLevelOfDetailForHorizResolution( _maxRes, 257 );
+                if ( level > 0 )
+                    lod = level;
+            }
+            getElevations( queryPoints, featureSRS.get(), mapf, lod, elevations );
+        }
+        else
+        {
+            elevations.assign( queryPoints.size(), NO_DATA_VALUE );
         }
+    }
+
+    // Third pass: apply the elevations to the features.
+    METRIC_SCOPED("AltitudeFilter::apply");
+
+    unsigned f = 0;
+    unsigned q = 0;
+    for( FeatureList::iterator i = features.begin(); i != features.end(); ++i, ++f )
+    {
+        Feature* feature = i->get();
 
         double maxTerrainZ  = -DBL_MAX;
         double minTerrainZ  =  DBL_MAX;
         double minHAT       =  DBL_MAX;
         double maxHAT       = -DBL_MAX;
 
-        double scaleZ = 1.0;
-        if ( _altitude.valid() && _altitude->verticalScale().isSet() )
-            scaleZ = feature->eval( scaleExpr, &cx );
-
-        double offsetZ = 0.0;
-        if ( _altitude.valid() && _altitude->verticalOffset().isSet() )
-            offsetZ = feature->eval( offsetExpr, &cx );
-
-        osgEarth::Bounds bounds = feature->getGeometry()->getBounds();
-        const osg::Vec2d& center = bounds.center2d();
-        GeoPoint centroid(featureSRS, center.x(), center.y());
-        double   centroidElevation = 0.0;
+        double scaleZ = scales[f];
+        double offsetZ = offsets[f];
 
-        // If we aren't doing per vertex clamping go ahead and get the centroid.
-        // We do this now instead of within the geometry iterator to ensure that multipolygons
-        // are clamped to the whole multipolygon and not per polygon.
+        double centroidElevation = 0.0;
         if (!perVertex)
         {
-            centroidElevation = eq.getElevation( centroid, _maxRes );
+            centroidElevation = elevations[q++];
             // Check for NO_DATA_VALUE and use zero instead.
             if (centroidElevation == NO_DATA_VALUE)
             {
@@ -229,46 +434,51 @@ AltitudeFilter::pushAndClamp( FeatureList& features, FilterContext& cx )
 
             total += geom->size();
 
+            // this geometry's samples, for per-vertex clamping
+            const float* vertexElevations = perVertex && !elevations.empty() ? &elevations.front() + q : 0L;
+            if ( perVertex )
+                q += geom->size();
+
             // Absolute heights in Z. Only need to collect the HATs; the geometry
             // remains unchanged.
             if ( _altitude->clamping() == AltitudeSymbol::CLAMP_ABSOLUTE )
             {
                 if ( perVertex )
                 {
-                    std::vector<float> elevations;
-
-                    if ( eq.getElevations( geom->asVector(), featureSRS, elevations, _maxRes ) )
+                    for( unsigned i=0; i<geom->size(); ++i )
                     {
-                        for( unsigned i=0; i<geom->size(); ++i )
-                        {
-                            osg::Vec3d& p = (*geom)[i];
+                        osg::Vec3d& p = (*geom)[i];
 
-                            if (elevations[i] != NO_DATA_VALUE)
-                            {
-                                p.z() *= scaleZ;
-                                p.z() += offsetZ;
+                        // failed samples count as zero, as long as there is elevation data at all
+                        float elevation = vertexElevations[i];
+                        if ( elevation == NO_DATA_VALUE && hasElevation )
+                            elevation = 0.0f;
 
-                                double z = p.z();
+                        if (elevation != NO_DATA_VALUE)
+                        {
+                            p.z() *= scaleZ;
+                            p.z() += offsetZ;
 
-                                if ( !vertEquiv )
-                                {
-                                    osg::Vec3d tempgeo;
-                                    if ( !featureSRS->transform(p, mapSRS->getGeographicSRS(), tempgeo) )
-                                        z = tempgeo.z();
-                                }
+                            double z = p.z();
 
-                                double hat = z - elevations[i];
+                            if ( !vertEquiv )
+                            {
+                                osg::Vec3d tempgeo;
+                                if ( !featureSRS->transform(p, mapSRS->getGeographicSRS(), tempgeo) )
+                                    z = tempgeo.z();
+                            }
 
-                                if ( hat > maxHAT )
-                                    maxHAT = hat;
-                                if ( hat < minHAT )
-                                    minHAT = hat;
+                            double hat = z - elevation;
 
-                                if ( elevations[i] > maxTerrainZ )
-                                    maxTerrainZ = elevations[i];
-                                if ( elevations[i] < minTerrainZ )
-                                    minTerrainZ = elevations[i];
-                            }
+                            if ( hat > maxHAT )
+                                maxHAT = hat;
+                            if ( hat < minHAT )
+                                minHAT = hat;
+
+                            if ( elevation > maxTerrainZ )
+                                maxTerrainZ = elevation;
+                            if ( elevation < minTerrainZ )
+                                minTerrainZ = elevation;
                         }
                     }
                 }
@@ -307,45 +517,40 @@ AltitudeFilter::pushAndClamp( FeatureList& features, FilterContext& cx )
             // and record HATs along the way.
             else if ( _altitude->clamping() == AltitudeSymbol::CLAMP_RELATIVE_TO_TERRAIN )
             {
-                osg::ref_ptr<const SpatialReference> featureSRSwithMapVertDatum = !vertEquiv ?
-                    SpatialReference::create(featureSRS->getHorizInitString(), mapSRS->getVertInitString()) : 0L;
-
                 if ( perVertex )
                 {
-                    std::vector<float> elevations;
-                    elevations.reserve( geom->size() );
-                    
-                    if ( eq.getElevations( geom->asVector(), featureSRS, elevations, _maxRes ) )
+                    for( unsigned i=0; i<geom->size(); ++i )
                     {
-                        for( unsigned i=0; i<geom->size(); ++i )
+                        osg::Vec3d& p = (*geom)[i];
+
+                        float elevation = vertexElevations[i];
+                        if ( elevation == NO_DATA_VALUE && hasElevation )
+                            elevation = 0.0f;
+
+                        if (elevation != NO_DATA_VALUE)
                         {
-                            osg::Vec3d& p = (*geom)[i];
+                            p.z() *= scaleZ;
+                            p.z() += offsetZ;
+
+                            double hat = p.z();
+                            p.z() = elevation + p.z();
 
-                            if (elevations[i] != NO_DATA_VALUE)
+                            // if necessary, convert the Z value (which is now in the map's SRS) back to
+                            // the feature's SRS.
+                            if ( !vertEquiv )
                             {
-                                p.z() *= scaleZ;
-                                p.z() += offsetZ;
-
-                                double hat = p.z();
-                                p.z() = elevations[i] + p.z();
-
-                                // if necessary, convert the Z value (which is now in the map's SRS) back to
-                                // the feature's SRS.
-                                if ( !vertEquiv )
-                                {
-                                    featureSRSwithMapVertDatum->transform(p, featureSRS, p);
-                                }
-
-                                if ( hat > maxHAT )
-                                    maxHAT = hat;
-                                if ( hat < minHAT )
-                                    minHAT = hat;
-
-                                if ( elevations[i] > maxTerrainZ )
-                                    maxTerrainZ = elevations[i];
-                                if ( elevations[i] < minTerrainZ )
-                                    minTerrainZ = elevations[i];
+                                featureSRSwithMapVertDatum->transform(p, featureSRS, p);
                             }
+
+                            if ( hat > maxHAT )
+                                maxHAT = hat;
+                            if ( hat < minHAT )
+                                minHAT = hat;
+
+                            if ( elevation > maxTerrainZ )
+                                maxTerrainZ = elevation;
+                            if ( elevation < minTerrainZ )
+                                minTerrainZ = elevation;
                         }
                     }
                 }
@@ -385,16 +590,21 @@ AltitudeFilter::pushAndClamp( FeatureList& features, FilterContext& cx )
             {
                 if ( perVertex )
                 {
-                    eq.getElevations( geom->asVector(), featureSRS, true, _maxRes );
+                    for( unsigned i=0; i<geom->size(); ++i )
+                    {
+                        // failed samples leave the vertex alone, unless there
+                        // is no elevation data at all.
+                        osg::Vec3d& p = (*geom)[i];
+                        if ( vertexElevations[i] != NO_DATA_VALUE )
+                            p.z() = vertexElevations[i];
+                        else if ( !hasElevation )
+                            p.z() = 0.0;
+                    }
                     
                     // if necessary, transform the Z values (which are now in the map SRS) back
                     // into the feature's SRS.
                     if ( !vertEquiv )
                     {
-                        osg::ref_ptr<const SpatialReference> featureSRSwithMapVertDatum =
-                            SpatialReference::create(featureSRS->getHorizInitString(), mapSRS->getVertInitString());
-
-                        osg::Vec3d tempgeo;
                         for( unsigned i=0; i<geom->size(); ++i )
                         {
                             osg::Vec3d& p = (*geom)[i];
@@ -404,17 +614,13 @@ AltitudeFilter::pushAndClamp( FeatureList& features, FilterContext& cx )
                 }
                 else // per-centroid
                 {
-                    osg::ref_ptr<const SpatialReference> featureSRSWithMapVertDatum;
-                    if ( !vertEquiv )
-                        featureSRSWithMapVertDatum = SpatialReference::create(featureSRS->getHorizInitString(), mapSRS->getVertInitString());
-
                     for( unsigned i=0; i<geom->size(); ++i )
                     {
                         osg::Vec3d& p = (*geom)[i];
                         p.z() = centroidElevation;
                         if ( !vertEquiv )
                         {
-                            featureSRSWithMapVertDatum->transform(p, featureSRS, p);
+                            featureSRSwithMapVertDatum->transform(p, featureSRS, p);
                         }
                     }
                 }
@@ -0,0 +1,193 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+ * Copyright 2016 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarthFeatures/BoundaryIndex>
+#include <osgEarthFeatures/FeatureSource>
+#include <osgEarthFeatures/FeatureCursor>
+#include <osgEarthFeatures/Session>
+#include <osgEarth/StringUtils>
+#include <algorithm>
+
+#define LC "[BoundaryIndex] "
+
+using namespace osgEarth;
+using namespace osgEarth::Features;
+
+namespace
+{
+    // Sources up to this size are read once and shared by every tile;
+    // larger ones are read one tile extent at a time.
+    const unsigned MAX_FEATURES_TO_INDEX = 100000u;
+}
+
+//---------------------------------------------------------------------------
+
+BoundaryIndex::BoundaryIndex(const FeatureList& boundaries) :
+_revision(-1)
+{
+    for (FeatureList::const_iterator i = boundaries.begin(); i != boundaries.end(); ++i)
+    {
+        Feature* feature = i->get();
+        if (!feature || !feature->getGeometry())
+            continue;
+
+        osg::ref_ptr<PreparedGeometry> prepared = new PreparedGeometry(feature->getGeometry());
+        const Bounds& b = prepared->getBounds();
+        if (!b.isValid())
+            continue;
+
+        _tree.insert(PackedRTree::Box(b.xMin(), b.yMin(), b.xMax(), b.yMax()), _features.size());
+        _features.push_back(feature);
+        _prepared.push_back(prepared.get());
+    }
+
+    _tree.build();
+}
+
+unsigned
+BoundaryIndex::getMaxFeaturesToIndex()
+{
+    return MAX_FEATURES_TO_INDEX;
+}
+
+BoundaryIndex*
+BoundaryIndex::create(FeatureSource* source, const SpatialReference* srs, const GeoExtent& extent)
+{
+    FeatureList boundaries;
+
+    if (source)
+    {
+        Query query;
+        bool read = true;
+
+        if (extent.isValid() && source->getFeatureProfile())
+        {
+            const GeoExtent& sourceExtent = source->getFeatureProfile()->getExtent();
+            GeoExtent localExtent = extent.transform(sourceExtent.getSRS());
+            query.bounds() = localExtent.bounds();
+            read = localExtent.intersects(sourceExtent);
+        }
+
+        if (read)
+        {
+            osg::ref_ptr<FeatureCursor> cursor = source->createFeatureCursor(query);
+            if (cursor.valid())
+            {
+                cursor->fill(boundaries);
+            }
+        }
+    }
+
+    if (srs)
+    {
+        for (FeatureList::iterator i = boundaries.begin(); i != boundaries.end(); ++i)
+        {
+            i->get()->transform(srs);
+        }
+    }
+
+    OE_DEBUG << LC << "Indexed " << boundaries.size() << " boundaries" << std::endl;
+
+    return new BoundaryIndex(boundaries);
+}
+
+osg::ref_ptr<BoundaryIndex>
+BoundaryIndex::getOrCreate(Session* session, FeatureSource* source, const SpatialReference* srs, const GeoExtent& extent)
+{
+    if (!source || !srs)
+        return 0L;
+
+    // Too big (or too costly to count) to read in full; use just the boundaries near the extent.
+    int count = source->getFeatureCount();
+    if (extent.isValid() && (count < 0 || count > (int)MAX_FEATURES_TO_INDEX))
+    {
+        return create(source, srs, extent);
+    }
+
+    Revision revision;
+    source->sync(revision);
+
+    if (!session)
+    {
+        osg::ref_ptr<BoundaryIndex> index = create(source, srs);
+        index->_revision = revision;
+        return index;
+    }
+
+    std::string key = Stringify()
+        << "BoundaryIndex:" << (const void*)source << ":" << srs->getHorizInitString();
+
+    osg::ref_ptr<BoundaryIndex> index = session->getObject<BoundaryIndex>(key);
+    if (!index.valid() || index->_revision != (int)revision)
+    {
+        osg::ref_ptr<BoundaryIndex> fresh = create(source, srs);
+        fresh->_revision = revision;
+
+        // Replace a stale index; otherwise another thread may have
+        // beaten us to it, in which case use theirs.
+        index = session->putObject(key, fresh.get(), index.valid());
+    }
+
+    return index;
+}
+
+void
+BoundaryIndex::query(const Bounds& bounds, std::vector<unsigned>& out) const
+{
+    _tree.query(
+        PackedRTree::Box(bounds.xMin(), bounds.yMin(), bounds.xMax(), bounds.yMax()),
+        out);
+
+    // report matches in the original order
+    std::sort(out.begin(), out.end());
+}
+
+const Feature*
+BoundaryIndex::findContaining(double x, double y) const
+{
+    std::vector<unsigned> candidates;
+    query(Bounds(x, y, x, y), candidates);
+
+    for (unsigned i = 0; i < candidates.size(); ++i)
+    {
+        if (_prepared[candidates[i]]->contains2D(x, y))
+            return _features[candidates[i]].get();
+    }
+    return 0L;
+}
+
+const Feature*
+BoundaryIndex::findIntersecting(const Geometry* geometry) const
+{
+    if (!geometry)
+        return 0L;
+
+    Bounds bounds = geometry->getBounds();
+    if (!bounds.isValid())
+        return 0L;
+
+    std::vector<unsigned> candidates;
+    query(bounds, candidates);
+
+    for (unsigned i = 0; i < candidates.size(); ++i)
+    {
+        if (_prepared[candidates[i]]->intersects(geometry))
+            return _features[candidates[i]].get();
+    }
+    return 0L;
+}
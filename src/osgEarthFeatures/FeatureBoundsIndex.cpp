@@ -0,0 +1,154 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+ * Copyright 2016 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarthFeatures/FeatureBoundsIndex>
+#include <osgEarth/BinaryFile>
+#include <algorithm>
+#include <stdint.h>
+
+#define LC "[FeatureBoundsIndex] "
+
+using namespace osgEarth;
+using namespace osgEarth::Features;
+
+namespace
+{
+    // File layout; all values are big-endian.
+    //   header:  BinaryFile header, then feature count (u32) and source modification time (f64)
+    //   records: xmin, ymin, xmax, ymax (f64), then the feature ID as high and low words (u32)
+    const char     MAGIC[8]    = { 'O', 'E', 'F', 'I', 'D', 'X', '\0', '\0' };
+    const unsigned VERSION     = 1u;
+    const unsigned HEADER_SIZE = 24u;
+    const unsigned RECORD_SIZE = 40u;
+}
+
+//---------------------------------------------------------------------------
+
+FeatureBoundsIndex::FeatureBoundsIndex()
+{
+    //nop
+}
+
+void
+FeatureBoundsIndex::insert(FeatureID fid, const Bounds& bounds)
+{
+    _boxes.push_back(PackedRTree::Box(bounds.xMin(), bounds.yMin(), bounds.xMax(), bounds.yMax()));
+    _fids.push_back(fid);
+}
+
+void
+FeatureBoundsIndex::build()
+{
+    _tree.clear();
+    for (unsigned i = 0; i < _boxes.size(); ++i)
+    {
+        _tree.insert(_boxes[i], i);
+    }
+    _tree.build();
+}
+
+void
+FeatureBoundsIndex::query(const Bounds& bounds, std::vector<FeatureID>& out_fids) const
+{
+    std::vector<unsigned> hits;
+    _tree.query(PackedRTree::Box(bounds.xMin(), bounds.yMin(), bounds.xMax(), bounds.yMax()), hits);
+
+    unsigned start = out_fids.size();
+    out_fids.reserve(start + hits.size());
+    for (unsigned i = 0; i < hits.size(); ++i)
+    {
+        out_fids.push_back(_fids[hits[i]]);
+    }
+
+    // read in ID order; most sources store features that way.
+    std::sort(out_fids.begin() + start, out_fids.end());
+}
+
+bool
+FeatureBoundsIndex::write(const std::string& filename, TimeStamp sourceModified) const
+{
+    // assemble the whole file and write it at once.
+    std::vector<char> buf(HEADER_SIZE + RECORD_SIZE*_fids.size());
+    BinaryFile::putHeader(&buf[0], MAGIC, VERSION);
+    BinaryFile::putU32(&buf[12], _fids.size());
+    BinaryFile::putF64(&buf[16], (double)sourceModified);
+
+    char* record = &buf[HEADER_SIZE];
+    for (unsigned i = 0; i < _fids.size(); ++i, record += RECORD_SIZE)
+    {
+        const PackedRTree::Box& b = _boxes[i];
+        BinaryFile::putF64(record,      b._xmin);
+        BinaryFile::putF64(record + 8,  b._ymin);
+        BinaryFile::putF64(record + 16, b._xmax);
+        BinaryFile::putF64(record + 24, b._ymax);
+
+        uint64_t fid = (uint64_t)_fids[i];
+        BinaryFile::putU32(record + 32, (unsigned)(fid >> 32));
+        BinaryFile::putU32(record + 36, (unsigned)(fid & 0xffffffffu));
+    }
+
+    return BinaryFile::write(filename, buf);
+}
+
+FeatureBoundsIndex*
+FeatureBoundsIndex::read(const std::string& filename, TimeStamp sourceModified)
+{
+    std::vector<char> buf;
+    unsigned version;
+    if (!BinaryFile::read(filename, buf, HEADER_SIZE) ||
+        !BinaryFile::getHeader(buf, MAGIC, version))
+        return 0L;
+
+    unsigned count = BinaryFile::getU32(&buf[12]);
+
+    if (version != VERSION)
+    {
+        OE_INFO << LC << filename << " has unsupported version " << version << std::endl;
+        return 0L;
+    }
+
+    if ((TimeStamp)BinaryFile::getF64(&buf[16]) != sourceModified)
+    {
+        OE_INFO << LC << filename << " is out of date" << std::endl;
+        return 0L;
+    }
+
+    if ((double)HEADER_SIZE + (double)RECORD_SIZE*(double)count != (double)buf.size())
+    {
+        OE_WARN << LC << filename << " is truncated or corrupt" << std::endl;
+        return 0L;
+    }
+
+    osg::ref_ptr<FeatureBoundsIndex> index = new FeatureBoundsIndex();
+    index->_boxes.reserve(count);
+    index->_fids.reserve(count);
+
+    const char* record = &buf[HEADER_SIZE];
+    for (unsigned i = 0; i < count; ++i, record += RECORD_SIZE)
+    {
+        index->_boxes.push_back(PackedRTree::Box(
+            BinaryFile::getF64(record),      BinaryFile::getF64(record + 8),
+            BinaryFile::getF64(record + 16), BinaryFile::getF64(record + 24)));
+
+        uint64_t fid = ((uint64_t)BinaryFile::getU32(record + 32) << 32) | (uint64_t)BinaryFile::getU32(record + 36);
+        index->_fids.push_back((FeatureID)fid);
+    }
+
+    index->build();
+    return index.release();
+}
@@ -0,0 +1,496 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+ * Copyright 2016 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarthFeatures/FeatureCache>
+#include <osgEarthFeatures/FeatureSource>
+#include <osgEarth/Metrics>
+#include <osgEarth/PerformanceCounters>
+#include <iomanip>
+#include <sstream>
+
+#define LC "[FeatureCache] "
+
+using namespace osgEarth;
+using namespace osgEarth::Features;
+
+namespace
+{
+    enum { VALUE_ABSENT = 0, VALUE_NULL = 1, VALUE_SET = 2 };
+
+    // Drops spare capacity and returns the memory the vector holds.
+    template<typename T>
+    unsigned compact(std::vector<T>& v)
+    {
+        std::vector<T>(v).swap(v);
+        return v.capacity() * sizeof(T);
+    }
+}
+
+//---------------------------------------------------------------------------
+
+/**
+ * A list of features stored column by column: one array per attribute,
+ * and the points of every geometry in one array with a table of parts.
+ */
+class FeatureCache::Block : public osg::Referenced
+{
+public:
+    /** Encodes a list of features, or returns NULL if they cannot be cached. */
+    static Block* encode(const FeatureList& features);
+
+    /** Appends new copies of the features to a list. */
+    void decode(FeatureList& out) const;
+
+    /** Memory held by the block */
+    unsigned getBytes() const { return _bytes; }
+
+private:
+    struct Column
+    {
+        std::string                _name;
+        AttributeType              _type;
+        std::vector<unsigned char> _state;    // per feature: VALUE_ABSENT, VALUE_NULL or VALUE_SET
+        std::vector<double>        _doubles;  // set values of a double column
+        std::vector<int>           _ints;     // set values of an int or bool column
+        std::vector<unsigned>      _ends;     // end of each set value of a string column in _chars
+        std::string                _chars;
+    };
+
+    osg::ref_ptr<const SpatialReference> _srs;
+    std::vector<FeatureID>               _fids;
+    std::vector<signed char>             _geoInterp;    // per feature; -1 if unset
+    std::vector<unsigned char>           _hasGeometry;  // per feature
+    std::vector<unsigned char>           _partType;     // geometry parts, depth first
+    std::vector<unsigned>                _partSize;     // points in each part
+    std::vector<unsigned>                _partChildren; // holes of a polygon, parts of a multi
+    std::vector<osg::Vec3d>              _points;
+    std::vector<Column>                  _columns;
+    unsigned                             _bytes;
+
+    Block() : _bytes(0u) { }
+
+    void encodeGeometry(const Geometry* geom);
+    Geometry* decodeGeometry(unsigned& part, unsigned& point, Vec3dVector& scratch) const;
+};
+
+FeatureCache::Block*
+FeatureCache::Block::encode(const FeatureList& features)
+{
+    osg::ref_ptr<Block> block = new Block();
+
+    unsigned count = features.size();
+    block->_fids.reserve(count);
+    block->_geoInterp.reserve(count);
+    block->_hasGeometry.reserve(count);
+
+    std::map< std::pair<std::string, int>, unsigned > columnIndex;
+
+    unsigned i = 0u;
+    for (FeatureList::const_iterator f = features.begin(); f != features.end(); ++f, ++i)
+    {
+        const Feature* feature = f->get();
+
+        // embedded styles don't fit the columns, and are rare enough not to bother.
+        if (feature->style().isSet())
+            return 0L;
+
+        if (i == 0u)
+            block->_srs = feature->getSRS();
+        else if (feature->getSRS() != block->_srs.get())
+            return 0L;
+
+        block->_fids.push_back(feature->getFID());
+        block->_geoInterp.push_back(feature->geoInterp().isSet() ? (signed char)feature->geoInterp().get() : -1);
+        block->_hasGeometry.push_back(feature->getGeometry() ? 1 : 0);
+        if (feature->getGeometry())
+            block->encodeGeometry(feature->getGeometry());
+
+        const AttributeTable& attrs = feature->getAttrs();
+        for (AttributeTable::const_iterator a = attrs.begin(); a != attrs.end(); ++a)
+        {
+            std::pair<std::string, int> columnKey(a->first, (int)a->second.first);
+            std::map< std::pair<std::string, int>, unsigned >::iterator c = columnIndex.find(columnKey);
+            if (c == columnIndex.end())
+            {
+                c = columnIndex.insert(std::make_pair(columnKey, (unsigned)block->_columns.size())).first;
+                block->_columns.push_back(Column());
+                block->_columns.back()._name = a->first;
+                block->_columns.back()._type = a->second.first;
+            }
+
+            Column& column = block->_columns[c->second];
+            column._state.resize(i + 1u, VALUE_ABSENT);
+
+            if (!a->second.second.set)
+            {
+                column._state[i] = VALUE_NULL;
+                continue;
+            }
+
+            column._state[i] = VALUE_SET;
+            switch (column._type)
+            {
+            case ATTRTYPE_STRING:
+                column._chars.append(a->second.second.stringValue);
+                column._ends.push_back(column._chars.size());
+                break;
+            case ATTRTYPE_DOUBLE:
+                column._doubles.push_back(a->second.second.doubleValue);
+                break;
+            case ATTRTYPE_INT:
+                column._ints.push_back(a->second.second.intValue);
+                break;
+            case ATTRTYPE_BOOL:
+                column._ints.push_back(a->second.second.boolValue ? 1 : 0);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    // size the arrays exactly and add up the memory:
+    unsigned bytes = sizeof(Block);
+    bytes += compact(block->_fids);
+    bytes += compact(block->_geoInterp);
+    bytes += compact(block->_hasGeometry);
+    bytes += compact(block->_partType);
+    bytes += compact(block->_partSize);
+    bytes += compact(block->_partChildren);
+    bytes += compact(block->_points);
+    for (unsigned c = 0; c < block->_columns.size(); ++c)
+    {
+        Column& column = block->_columns[c];
+        column._state.resize(count, VALUE_ABSENT);
+        bytes += sizeof(Column) + column._name.size() + column._chars.size();
+        bytes += compact(column._state);
+        bytes += compact(column._doubles);
+        bytes += compact(column._ints);
+        bytes += compact(column._ends);
+    }
+    block->_bytes = bytes;
+
+    return block.release();
+}
+
+void
+FeatureCache::Block::encodeGeometry(const Geometry* geom)
+{
+    unsigned children =
+        geom->getType() == Geometry::TYPE_POLYGON ? static_cast<const Polygon*>(geom)->getHoles().size() :
+        geom->getType() == Geometry::TYPE_MULTI   ? static_cast<const MultiGeometry*>(geom)->getComponents().size() :
+        0u;
+
+    _partType.push_back((unsigned char)geom->getType());
+    _partSize.push_back(geom->size());
+    _partChildren.push_back(children);
+    _points.insert(_points.end(), geom->begin(), geom->end());
+
+    if (geom->getType() == Geometry::TYPE_POLYGON)
+    {
+        const RingCollection& holes = static_cast<const Polygon*>(geom)->getHoles();
+        for (RingCollection::const_iterator h = holes.begin(); h != holes.end(); ++h)
+            encodeGeometry(h->get());
+    }
+    else if (geom->getType() == Geometry::TYPE_MULTI)
+    {
+        const GeometryCollection& parts = static_cast<const MultiGeometry*>(geom)->getComponents();
+        for (GeometryCollection::const_iterator p = parts.begin(); p != parts.end(); ++p)
+            encodeGeometry(p->get());
+    }
+}
+
+Geometry*
+FeatureCache::Block::decodeGeometry(unsigned& part, unsigned& point, Vec3dVector& scratch) const
+{
+    Geometry::Type type = (Geometry::Type)_partType[part];
+    unsigned size = _partSize[part];
+    unsigned children = _partChildren[part];
+    ++part;
+
+    scratch.assign(_points.begin() + point, _points.begin() + point + size);
+    point += size;
+
+    if (type == Geometry::TYPE_MULTI)
+    {
+        MultiGeometry* multi = new MultiGeometry();
+        for (unsigned c = 0; c < children; ++c)
+        {
+            Geometry* child = decodeGeometry(part, point, scratch);
+            if (child)
+                multi->add(child);
+        }
+        return multi;
+    }
+
+    Geometry* geom = Geometry::create(type, &scratch);
+
+    if (type == Geometry::TYPE_POLYGON)
+    {
+        Polygon* polygon = static_cast<Polygon*>(geom);
+        for (unsigned c = 0; c < children; ++c)
+        {
+            osg::ref_ptr<Geometry> hole = decodeGeometry(part, point, scratch);
+            if (hole.valid() && hole->getType() == Geometry::TYPE_RING)
+                polygon->getHoles().push_back(static_cast<Ring*>(hole.get()));
+        }
+    }
+
+    return geom;
+}
+
+void
+FeatureCache::Block::decode(FeatureList& out) const
+{
+    unsigned part = 0u, point = 0u;
+    Vec3dVector scratch;
+
+    // next value to read from each column:
+    std::vector<unsigned> next(_columns.size(), 0u);
+
+    for (unsigned i = 0; i < _fids.size(); ++i)
+    {
+        Geometry* geom = _hasGeometry[i] ? decodeGeometry(part, point, scratch) : 0L;
+
+        osg::ref_ptr<Feature> feature = new Feature(geom, _srs.get(), Style(), _fids[i]);
+        if (_geoInterp[i] >= 0)
+            feature->geoInterp() = (GeoInterpolation)_geoInterp[i];
+
+        for (unsigned c = 0; c < _columns.size(); ++c)
+        {
+            const Column& column = _columns[c];
+            if (column._state[i] == VALUE_ABSENT)
+                continue;
+
+            AttributeValue value;
+            value.first = column._type;
+            value.second.doubleValue = 0.0;
+            value.second.intValue = 0;
+            value.second.boolValue = false;
+            value.second.set = column._state[i] == VALUE_SET;
+
+            if (value.second.set)
+            {
+                unsigned k = next[c]++;
+                switch (column._type)
+                {
+                case ATTRTYPE_STRING:
+                    {
+                        unsigned begin = k > 0u ? column._ends[k-1] : 0u;
+                        value.second.stringValue.assign(column._chars, begin, column._ends[k] - begin);
+                    }
+                    break;
+                case ATTRTYPE_DOUBLE:
+                    value.second.doubleValue = column._doubles[k];
+                    break;
+                case ATTRTYPE_INT:
+                    value.second.intValue = column._ints[k];
+                    break;
+                case ATTRTYPE_BOOL:
+                    value.second.boolValue = column._ints[k] != 0;
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            feature->set(column._name, value);
+        }
+
+        out.push_back(feature.get());
+    }
+}
+
+//---------------------------------------------------------------------------
+
+FeatureCache::FeatureCache(unsigned maxBytes) :
+_maxBytes( maxBytes )
+{
+    //nop
+}
+
+FeatureCache::~FeatureCache()
+{
+    //nop
+}
+
+void
+FeatureCache::setMaxBytes(unsigned maxBytes)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _maxBytes = maxBytes;
+    trim();
+}
+
+FeatureCursor*
+FeatureCache::createFeatureCursor(FeatureSource* source, const Query& query)
+{
+    if (!source)
+        return 0L;
+
+    if (_maxBytes == 0u)
+        return source->createFeatureCursor(query);
+
+    // results drawn from the query's map can change with the map.
+    if (source->dependsOnMap())
+        return source->createFeatureCursor(query);
+
+    // sources that are always dirty can't be cached.
+    Revision revision;
+    source->sync(revision);
+    if (!source->inSyncWith(revision))
+        return source->createFeatureCursor(query);
+
+    std::stringstream buf;
+    buf << std::setprecision(17) << (const void*)source << ':' << (int)revision;
+    if (query.tileKey().isSet())
+        buf << ":k" << query.tileKey()->getProfile()->getHorizSignature() << '/' << query.tileKey()->str();
+    if (query.bounds().isSet())
+        buf << ":b" << query.bounds()->xMin() << ',' << query.bounds()->yMin() << ',' << query.bounds()->xMax() << ',' << query.bounds()->yMax();
+    if (query.limit().isSet())
+        buf << ":l" << query.limit().get();
+    if (query.expression().isSet())
+        buf << ":e" << query.expression().get();
+    if (query.orderby().isSet())
+        buf << ":o" << query.orderby().get();
+    std::string key = buf.str();
+
+    LayerCounters* counters = source->getCounters();
+
+    FeatureList features;
+    if (get(key, features))
+    {
+        if (counters)
+            counters->recordCacheHit();
+        return new FeatureListCursor(features);
+    }
+
+    if (counters)
+        counters->recordCacheMiss();
+
+    osg::ref_ptr<FeatureCursor> cursor = source->createFeatureCursor(query);
+    if (!cursor.valid())
+        return 0L;
+
+    cursor->fill(features);
+
+    osg::ref_ptr<Block> block = Block::encode(features);
+    if (block.valid())
+        put(key, block.get());
+
+    return new FeatureListCursor(features);
+}
+
+bool
+FeatureCache::get(const std::string& key, FeatureList& out)
+{
+    osg::ref_ptr<Block> block;
+    Stats stats;
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        EntryMap::iterator i = _entries.find(key);
+        if (i != _entries.end())
+        {
+            block = i->second._block.get();
+            _lru.splice(_lru.begin(), _lru, i->second._lru);
+            ++_stats._hits;
+        }
+        else
+        {
+            ++_stats._misses;
+        }
+        stats = _stats;
+    }
+
+    publish(stats);
+
+    if (!block.valid())
+        return false;
+
+    // blocks never change, so decode outside the lock.
+    block->decode(out);
+    return true;
+}
+
+void
+FeatureCache::put(const std::string& key, Block* block)
+{
+    unsigned bytes = block->getBytes() + key.size();
+
+    Threading::ScopedMutexLock lock(_mutex);
+
+    if (bytes > _maxBytes)
+        return;
+
+    // another thread may have read the same features meanwhile.
+    if (_entries.find(key) != _entries.end())
+        return;
+
+    _lru.push_front(key);
+    Entry& entry = _entries[key];
+    entry._block = block;
+    entry._lru = _lru.begin();
+
+    ++_stats._entries;
+    _stats._bytes += bytes;
+
+    trim();
+}
+
+void
+FeatureCache::trim()
+{
+    // call with the mutex held.
+    while (_stats._bytes > _maxBytes && !_lru.empty())
+    {
+        EntryMap::iterator i = _entries.find(_lru.back());
+        _stats._bytes -= i->second._block->getBytes() + i->first.size();
+        --_stats._entries;
+        _entries.erase(i);
+        _lru.pop_back();
+    }
+}
+
+void
+FeatureCache::clear()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _entries.clear();
+    _lru.clear();
+    _stats._entries = 0u;
+    _stats._bytes = 0u;
+}
+
+FeatureCache::Stats
+FeatureCache::getStats() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return _stats;
+}
+
+void
+FeatureCache::publish(const Stats& stats) const
+{
+    if (Metrics::enabled())
+    {
+        Metrics::counter("FeatureCache",
+            "Hit rate %", 100.0 * stats.getHitRate(),
+            "Entries", (double)stats._entries,
+            "MB", (double)stats._bytes/1048576.0);
+    }
+}
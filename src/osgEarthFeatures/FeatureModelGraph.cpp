@@ -18,6 +18,7 @@
  */
 
 #include <osgEarthFeatures/FeatureModelGraph>
+#include <osgEarthFeatures/FeatureCache>
 #include <osgEarthFeatures/CropFilter>
 #include <osgEarthFeatures/FeatureSourceIndexNode>
 #include <osgEarthFeatures/Session>
@@ -307,6 +308,12 @@ FeatureModelGraph::ctor()
         //_session->setResourceCache( new ResourceCache(_session->getDBOptions()) );
         _session->setResourceCache(new ResourceCache());
     }
+
+    // Cache feature query results in the session, so that tiles which overlap
+    // and style rebuilds can skip the feature source.
+    // The budget is held in 32 bits, so clamp it just under 4 GB.
+    unsigned cacheMB = std::min( _options.featureCacheSize().get(), 4095u );
+    _session->getFeatureCache()->setMaxBytes( cacheMB * 1048576u );
     
     // Calculate the usable extent (in both feature and map coordinates) and bounds.
     const Profile* mapProfile = _session->getMapInfo().getProfile();
@@ -489,6 +496,10 @@ void
 FeatureModelGraph::dirty()
 {
     _dirty = true;
+
+    // drop cached query results; the source may have changed in ways its
+    // revision does not show.
+    _session->getFeatureCache()->clear();
 }
 
 std::ostream& operator << (std::ostream& in, const osg::Vec3d& v) { in << v.x() << ", " << v.y() << ", " << v.z(); return in; }
@@ -1343,27 +1354,32 @@ FeatureModelGraph::queryAndSortIntoStyleGroups(const Query&            query,
     // get the extent of the full set of feature data:
     const GeoExtent& extent = featureProfile->getExtent();
     
-    // query the feature source:
-    osg::ref_ptr<FeatureCursor> cursor = _session->getFeatureSource()->createFeatureCursor( query );
-    if ( !cursor.valid() )
-        return;
-
     // establish the working bounds and a context:
     Bounds bounds = query.bounds().isSet() ? *query.bounds() : extent.bounds();
     FilterContext context( _session.get(), featureProfile, GeoExtent(featureProfile->getSRS(), bounds), index );
     StringExpression styleExprCopy( styleExpr );
 
-    // visit each feature and run the expression to sort it into a bin.
     std::map<std::string, FeatureList> styleBins;
-    while( cursor->hasMore() )
     {
-        osg::ref_ptr<Feature> feature = cursor->nextFeature();
-        if ( feature.valid() )
+        // time the query and the read, which is where the source does its work:
+        LayerCounters::ScopedFetch fetch( _session->getFeatureSource()->getCounters() );
+
+        // query the feature source:
+        osg::ref_ptr<FeatureCursor> cursor = _session->getFeatureCache()->createFeatureCursor( _session->getFeatureSource(), query );
+        if ( !cursor.valid() )
+            return;
+
+        // visit each feature and run the expression to sort it into a bin.
+        while( cursor->hasMore() )
         {
-            const std::string& styleString = feature->eval( styleExprCopy, &context );
-            if (!styleString.empty() && styleString != "null")
+            osg::ref_ptr<Feature> feature = cursor->nextFeature();
+            if ( feature.valid() )
             {
-                styleBins[styleString].push_back( feature.get() );
+                const std::string& styleString = feature->eval( styleExprCopy, &context );
+                if (!styleString.empty() && styleString != "null")
+                {
+                    styleBins[styleString].push_back( feature.get() );
+                }
             }
         }
     }
@@ -1487,21 +1503,29 @@ FeatureModelGraph::createStyleGroup(const Style&          style,
     const GeoExtent& extent = featureProfile->getExtent();
     
     // query the feature source:
-    osg::ref_ptr<FeatureCursor> cursor = _session->getFeatureSource()->createFeatureCursor( query );
+    FeatureList workingSet;
+    bool        gotFeatures = false;
+    {
+        LayerCounters::ScopedFetch fetch( _session->getFeatureSource()->getCounters() );
 
-    if ( cursor.valid() && cursor->hasMore() )
+        osg::ref_ptr<FeatureCursor> cursor = _session->getFeatureCache()->createFeatureCursor( _session->getFeatureSource(), query );
+        if ( cursor.valid() && cursor->hasMore() )
+        {
+            // start by culling our feature list to the working extent. By default, this is done by
+            // checking feature centroids. But the user can override this to crop feature geometry to
+            // the cell boundaries.
+            cursor->fill( workingSet );
+            gotFeatures = true;
+        }
+    }
+
+    if ( gotFeatures )
     {
         Bounds cellBounds =
             query.bounds().isSet() ? *query.bounds() : extent.bounds();
 
         FilterContext context( _session.get(), featureProfile, GeoExtent(featureProfile->getSRS(), cellBounds), index );
 
-        // start by culling our feature list to the working extent. By default, this is done by
-        // checking feature centroids. But the user can override this to crop feature geometry to
-        // the cell boundaries.
-        FeatureList workingSet;
-        cursor->fill( workingSet );
-
         styleGroup = createStyleGroup(style, workingSet, context, readOptions);
     }
 
@@ -42,7 +42,8 @@ _clusterCulling    ( true ),
 _backfaceCulling   ( true ),
 _alphaBlending     ( true ),
 _sessionWideResourceCache( true ),
-_nodeCaching(false)
+_nodeCaching(false),
+_featureCacheSize( 32u )
 {
     fromConfig(co.getConfig());
 }
@@ -65,6 +66,7 @@ FeatureModelOptions::fromConfig(const Config& conf)
     conf.getIfSet( "backface_culling", _backfaceCulling );
     conf.getIfSet( "alpha_blending",   _alphaBlending );
     conf.getIfSet( "node_caching",     _nodeCaching );
+    conf.getIfSet( "feature_cache_size", _featureCacheSize );
     
     conf.getIfSet( "session_wide_resource_cache", _sessionWideResourceCache );
 
@@ -96,6 +98,7 @@ FeatureModelOptions::getConfig() const
     conf.set( "backface_culling", _backfaceCulling );
     conf.set( "alpha_blending",   _alphaBlending );
     conf.set( "node_caching",     _nodeCaching );
+    conf.set( "feature_cache_size", _featureCacheSize );
     
     conf.set( "session_wide_resource_cache", _sessionWideResourceCache );
 
@@ -130,6 +133,7 @@ FeatureModelSourceOptions::fromConfig( const Config& conf )
     conf.getIfSet( "backface_culling", _backfaceCulling );
     conf.getIfSet( "alpha_blending",   _alphaBlending );
     conf.getIfSet( "node_caching",     _nodeCaching );
+    conf.getIfSet( "feature_cache_size", _featureCacheSize );
     
     conf.getIfSet( "session_wide_resource_cache", _sessionWideResourceCache );
 }
@@ -158,6 +162,7 @@ FeatureModelSourceOptions::getConfig() const
     conf.set( "backface_culling", _backfaceCulling );
     conf.set( "alpha_blending",   _alphaBlending );
     conf.set( "node_caching",     _nodeCaching );
+    conf.set( "feature_cache_size", _featureCacheSize );
     
     conf.set( "session_wide_resource_cache", _sessionWideResourceCache );
 
@@ -195,6 +195,25 @@ FeatureSource::applyFilters(FeatureList& features, const GeoExtent& extent) cons
     }
 }
 
+LayerCounters*
+FeatureSource::getCounters() const
+{
+    if ( !_counters.valid() )
+    {
+        Threading::ScopedMutexLock lock( _countersMutex );
+        if ( !_counters.valid() )
+        {
+            std::string name =
+                _options.name().isSet() ? _options.name().get() :
+                !getName().empty()      ? getName() :
+                _options.getDriver();
+
+            _counters = Registry::performanceCounters()->getOrCreate("FeatureSource", name);
+        }
+    }
+    return _counters.get();
+}
+
 //------------------------------------------------------------------------
 
 #undef  LC
@@ -187,7 +187,6 @@ namespace
     struct ReIndex : public osg::NodeVisitor
     {
         FeatureSourceIndexNode*        _indexNode;
-        FeatureSourceIndexNode::FIDMap _newFIDMap;
         std::map<ObjectID,ObjectID>&   _oldToNew;
 
         ReIndex(FeatureSourceIndexNode* indexNode, std::map<ObjectID,ObjectID>& oldToNew) :
@@ -199,16 +198,16 @@ namespace
 
         void apply(osg::Node& node)
         {
-            _indexNode->reIndexNode(&node, _oldToNew, _newFIDMap);
+            _indexNode->reIndexNode(&node, _oldToNew);
             traverse(node);
         }
 
         void apply(osg::Geode& geode)
         {
-            _indexNode->reIndexNode(&geode, _oldToNew, _newFIDMap);
+            _indexNode->reIndexNode(&geode, _oldToNew);
             for (unsigned i = 0; i < geode.getNumDrawables(); ++i)
             {
-                _indexNode->reIndexDrawable(geode.getDrawable(i), _oldToNew, _newFIDMap);
+                _indexNode->reIndexDrawable(geode.getDrawable(i), _oldToNew);
             }
             traverse(geode);
         }
@@ -233,24 +232,29 @@ FeatureSourceIndexNode::reIndex(std::map<ObjectID,ObjectID>& oidmappings)
 {
     ReIndex visitor(this, oidmappings);
     this->accept(visitor);
-    _fids = visitor._newFIDMap;
+
+    // with all the new ObjectIDs assigned, map our FIDs over in one pass.
+    FIDMap newFIDMap;
+    if ( _index.valid() )
+        _index->remap(oidmappings, _fids, newFIDMap);
+    _fids.swap( newFIDMap );
     //OE_INFO << LC << "Reindexed " << _fids.size() << " mappings\n";
 }
 
 void
-FeatureSourceIndexNode::reIndexDrawable(osg::Drawable* drawable, std::map<ObjectID,ObjectID>& oldNew, FIDMap& newFIDMap)
+FeatureSourceIndexNode::reIndexDrawable(osg::Drawable* drawable, std::map<ObjectID,ObjectID>& oldNew)
 {
     if ( !drawable || !_index.valid() ) return;
 
-    _index->update(drawable, oldNew, _fids, newFIDMap);
+    _index->update(drawable, oldNew);
 }
 
 void
-FeatureSourceIndexNode::reIndexNode(osg::Node* node, std::map<ObjectID,ObjectID>& oldNew, FIDMap& newFIDMap)
+FeatureSourceIndexNode::reIndexNode(osg::Node* node, std::map<ObjectID,ObjectID>& oldNew)
 {
     if (!node || !_index.valid()) return;
 
-    _index->update(node, oldNew, _fids, newFIDMap);
+    _index->update(node, oldNew);
 }
 
 FeatureSourceIndexNode* FeatureSourceIndexNode::get(osg::Node* graph)
@@ -346,12 +350,156 @@ namespace
 #undef  LC
 #define LC "[FeatureSourceIndex] "
 
+void
+ObjectIDTable::insert(ObjectID oid, FeatureID fid)
+{
+    // common case: the next ObjectID in the current run.
+    if ( !_runs.empty() && oid == _runs.back()._firstOID + (_fids.size() - _runs.back()._firstSlot) )
+    {
+        _fids.push_back( fid );
+        _live.push_back( true );
+        return;
+    }
+
+    int slot = findSlot( oid );
+    if ( slot >= 0 )
+    {
+        if ( !_live[slot] )
+        {
+            _live[slot] = true;
+            --_numDead;
+        }
+        _fids[slot] = fid;
+        return;
+    }
+
+    // find the first run that starts after this ObjectID
+    unsigned r = 0, hi = _runs.size();
+    while ( r < hi )
+    {
+        unsigned mid = (r + hi) / 2;
+        if ( _runs[mid]._firstOID > oid ) hi = mid; else r = mid + 1;
+    }
+
+    unsigned pos = r < _runs.size() ? _runs[r]._firstSlot : _fids.size();
+    _fids.insert( _fids.begin() + pos, fid );
+    _live.insert( _live.begin() + pos, true );
+    for (unsigned i = r; i < _runs.size(); ++i)
+        ++_runs[i]._firstSlot;
+
+    // extends the previous run, or starts a new one.
+    if ( r == 0 || _runs[r-1]._firstOID + (pos - _runs[r-1]._firstSlot) != oid )
+    {
+        Run run;
+        run._firstOID = oid;
+        run._firstSlot = pos;
+        _runs.insert( _runs.begin() + r, run );
+    }
+}
+
+bool
+ObjectIDTable::find(ObjectID oid, FeatureID& output) const
+{
+    int slot = findSlot( oid );
+    if ( slot < 0 || !_live[slot] )
+        return false;
+    output = _fids[slot];
+    return true;
+}
+
+void
+ObjectIDTable::erase(ObjectID oid)
+{
+    int slot = findSlot( oid );
+    if ( slot < 0 || !_live[slot] )
+        return;
+
+    _live[slot] = false;
+    ++_numDead;
+
+    if ( _numDead >= 1024u && _numDead*2u > _fids.size() )
+        compact();
+}
+
+void
+ObjectIDTable::getObjectIDs(std::vector<ObjectID>& output) const
+{
+    output.reserve( output.size() + size() );
+    for (unsigned r = 0; r < _runs.size(); ++r)
+    {
+        for (unsigned slot = _runs[r]._firstSlot; slot < runEnd(r); ++slot)
+        {
+            if ( _live[slot] )
+                output.push_back( _runs[r]._firstOID + (slot - _runs[r]._firstSlot) );
+        }
+    }
+}
+
+void
+ObjectIDTable::clear()
+{
+    _runs.clear();
+    _fids.clear();
+    _live.clear();
+    _numDead = 0u;
+}
+
+unsigned
+ObjectIDTable::runEnd(unsigned r) const
+{
+    return r+1 < _runs.size() ? _runs[r+1]._firstSlot : _fids.size();
+}
+
+int
+ObjectIDTable::findSlot(ObjectID oid) const
+{
+    // last run starting at or before the ObjectID
+    unsigned lo = 0, hi = _runs.size();
+    while ( lo < hi )
+    {
+        unsigned mid = (lo + hi) / 2;
+        if ( _runs[mid]._firstOID > oid ) hi = mid; else lo = mid + 1;
+    }
+    if ( lo == 0 )
+        return -1;
+
+    unsigned r = lo - 1;
+    unsigned slot = _runs[r]._firstSlot + (oid - _runs[r]._firstOID);
+    return slot < runEnd(r) ? (int)slot : -1;
+}
+
+void
+ObjectIDTable::compact()
+{
+    ObjectIDTable live;
+    live._fids.reserve( size() );
+    live._live.reserve( size() );
+
+    for (unsigned r = 0; r < _runs.size(); ++r)
+    {
+        for (unsigned slot = _runs[r]._firstSlot; slot < runEnd(r); ++slot)
+        {
+            if ( _live[slot] )
+                live.insert( _runs[r]._firstOID + (slot - _runs[r]._firstSlot), _fids[slot] );
+        }
+    }
+
+    _runs.swap( live._runs );
+    _fids.swap( live._fids );
+    _live.swap( live._live );
+    _numDead = 0u;
+}
+
+//-----------------------------------------------------------------------------
+
 FeatureSourceIndex::FeatureSourceIndex(FeatureSource* featureSource, 
                                        ObjectIndex*   index,
                                        const FeatureSourceIndexOptions& options) :
 _featureSource  ( featureSource ), 
 _masterIndex    ( index ),
-_options        ( options )
+_options        ( options ),
+_nextOID        ( OSGEARTH_OBJECTID_EMPTY ),
+_endOID         ( OSGEARTH_OBJECTID_EMPTY )
 {
     _embed = 
         _options.embedFeatures() == true ||
@@ -361,15 +509,45 @@ _options        ( options )
 
 FeatureSourceIndex::~FeatureSourceIndex()
 {
-    if ( _masterIndex.valid() && !_oids.empty() )
+    if ( _masterIndex.valid() )
     {
-        // remove all OIDs from the master index.
-        _masterIndex->remove( KeyIter<OIDMap>(_oids.begin()), KeyIter<OIDMap>(_oids.end()) );
+        // remove all OIDs, and the unassigned rest of the ID block, from the master index.
+        std::vector<ObjectID> oids;
+        _oids.getObjectIDs( oids );
+        _masterIndex->remove( oids.begin(), oids.end() );
+        _masterIndex->removeRange( _nextOID, _endOID - _nextOID );
     }
 
     _oids.clear();
     _fids.clear();
-    _embeddedFeatures.clear();
+}
+
+// Takes the next ObjectID from the reserved block, reserving a new block from
+// the master index when it runs out. Blocks keep this index's IDs contiguous
+// and spare the master index a call per feature. Call with the write lock held.
+ObjectID
+FeatureSourceIndex::allocateObjectID()
+{
+    if ( _nextOID == _endOID )
+    {
+        const unsigned blockSize = 256u;
+        _nextOID = _masterIndex->insert( this, blockSize );
+        _endOID = _nextOID + blockSize;
+    }
+    return _nextOID++;
+}
+
+// Records a newly tagged feature. Call with the write lock held.
+RefIDPair*
+FeatureSourceIndex::tag(FeatureID fid, ObjectID oid, Feature* feature)
+{
+    RefIDPair* p = new RefIDPair( fid, oid );
+    if ( _embed )
+        p->_feature = feature;
+
+    _fids[fid] = p;
+    _oids.insert( oid, fid );
+    return p;
 }
 
 RefIDPair*
@@ -377,32 +555,20 @@ FeatureSourceIndex::tagDrawable(osg::Drawable* drawable, Feature* feature)
 {
     if ( !feature ) return 0L;
 
-    Threading::ScopedMutexLock lock(_mutex);
+    Threading::ScopedWriteLock lock(_mutex);
     
-    RefIDPair* p = 0L;
     FeatureID fid = feature->getFID();
 
     FIDMap::const_iterator f = _fids.find( fid );
     if ( f != _fids.end() )
     {
-        ObjectID oid = f->second->_oid;
-        _masterIndex->tagDrawable( drawable, oid );
-        p = f->second.get();
-    }
-    else
-    {
-        ObjectID oid = _masterIndex->tagDrawable( drawable, this );
-        p = new RefIDPair( fid, oid );
-        _fids[fid] = p;
-        _oids[oid] = fid;
-    
-        if ( _embed )
-        {
-            _embeddedFeatures[fid] = feature;
-        }
+        _masterIndex->tagDrawable( drawable, f->second->_oid );
+        return f->second.get();
     }
 
-    return p;
+    ObjectID oid = allocateObjectID();
+    _masterIndex->tagDrawable( drawable, oid );
+    return tag( fid, oid, feature );
 }
 
 RefIDPair*
@@ -410,32 +576,20 @@ FeatureSourceIndex::tagAllDrawables(osg::Node* node, Feature* feature)
 {
     if ( !feature ) return 0L;
 
-    Threading::ScopedMutexLock lock(_mutex);
+    Threading::ScopedWriteLock lock(_mutex);
     
-    RefIDPair* p = 0L;
     FeatureID fid = feature->getFID();
 
     FIDMap::const_iterator f = _fids.find( fid );
     if ( f != _fids.end() )
     {
-        ObjectID oid = f->second->_oid;
-        _masterIndex->tagAllDrawables( node, oid );
-        p = f->second.get();
-    }
-    else
-    {
-        ObjectID oid = _masterIndex->tagAllDrawables( node, this );
-        p = new RefIDPair( fid, oid );
-        _fids[fid] = p;
-        _oids[oid] = fid;
-    
-        if ( _embed )
-        {
-            _embeddedFeatures[fid] = feature;
-        }
+        _masterIndex->tagAllDrawables( node, f->second->_oid );
+        return f->second.get();
     }
 
-    return p;
+    ObjectID oid = allocateObjectID();
+    _masterIndex->tagAllDrawables( node, oid );
+    return tag( fid, oid, feature );
 }
 
 RefIDPair*
@@ -443,33 +597,25 @@ FeatureSourceIndex::tagNode(osg::Node* node, Feature* feature)
 {
     if ( !feature ) return 0L;
 
-    Threading::ScopedMutexLock lock(_mutex);
+    Threading::ScopedWriteLock lock(_mutex);
     
     RefIDPair* p = 0L;
     FeatureID fid = feature->getFID();
-    ObjectID oid;
 
     FIDMap::const_iterator f = _fids.find( fid );
     if ( f != _fids.end() )
     {
-        oid = f->second->_oid;
-        _masterIndex->tagNode( node, oid );
+        _masterIndex->tagNode( node, f->second->_oid );
         p = f->second.get();
     }
     else
     {
-        oid = _masterIndex->tagNode( node, this );
-        p = new RefIDPair( fid, oid );
-        _fids[fid] = p;
-        _oids[oid] = fid;
-    
-        if ( _embed )
-        {
-            _embeddedFeatures[fid] = feature;
-        }
+        ObjectID oid = allocateObjectID();
+        _masterIndex->tagNode( node, oid );
+        p = tag( fid, oid, feature );
     }
 
-    OE_DEBUG << LC << "Tagging feature ID = " << fid << " => " << oid << " (" << feature->getString("name") << ")\n";
+    OE_DEBUG << LC << "Tagging feature ID = " << fid << " => " << p->_oid << " (" << feature->getString("name") << ")\n";
 
     return p;
 }
@@ -477,30 +623,31 @@ FeatureSourceIndex::tagNode(osg::Node* node, Feature* feature)
 Feature*
 FeatureSourceIndex::getFeature(ObjectID oid) const
 {
-    Feature* feature = 0L;
-    Threading::ScopedMutexLock lock(_mutex);
-    OIDMap::const_iterator i = _oids.find( oid );
-    if ( i != _oids.end() )
+    FeatureID fid;
     {
-        FeatureID fid = i->second;
+        Threading::ScopedReadLock lock(_mutex);
+        if ( !_oids.find(oid, fid) )
+            return 0L;
 
         if ( _embed )
         {
-            FeatureMap::const_iterator j = _embeddedFeatures.find( fid );
-            feature = j != _embeddedFeatures.end() ? j->second.get() : 0L;
-        }
-        else if ( _featureSource.valid() && _featureSource->supportsGetFeature() )
-        {
-            feature = _featureSource->getFeature( fid );
+            FIDMap::const_iterator i = _fids.find( fid );
+            return i != _fids.end() ? i->second->_feature.get() : 0L;
         }
     }
-    return feature;
+
+    // query the source outside the lock so pickers don't stall tagging.
+    if ( _featureSource.valid() && _featureSource->supportsGetFeature() )
+    {
+        return _featureSource->getFeature( fid );
+    }
+    return 0L;
 }
 
 ObjectID
 FeatureSourceIndex::getObjectID(FeatureID fid) const
 {
-    Threading::ScopedMutexLock lock(_mutex);
+    Threading::ScopedReadLock lock(_mutex);
     FIDMap::const_iterator i = _fids.find(fid);
     if ( i != _fids.end() )
         return i->second->_oid;
@@ -509,61 +656,41 @@ FeatureSourceIndex::getObjectID(FeatureID fid) const
 }
 
 // When Feature index data is deserialized, the old serialized ObjectIDs are 
-// no longer valid. This method will re-install the mappings in the master index
-// and write new local mappings with new ObjectIDs.
+// no longer valid. These methods re-install the mappings in the master index,
+// recording the new ObjectIDs in the old-to-new table.
 void
-FeatureSourceIndex::update(osg::Drawable* drawable, std::map<ObjectID,ObjectID>& oldToNew, const FIDMap& oldFIDMap, FIDMap& newFIDMap)
+FeatureSourceIndex::update(osg::Drawable* drawable, std::map<ObjectID,ObjectID>& oldToNew)
 {
-    unsigned count = 0;
-    if (_masterIndex->updateObjectIDs(drawable, oldToNew, this))
-    {
-        for (std::map<ObjectID, ObjectID>::const_iterator i = oldToNew.begin(); i != oldToNew.end(); ++i)
-        {
-            const ObjectID& oldoid = i->first;
-            const ObjectID& newoid = i->second;
+    _masterIndex->updateObjectIDs(drawable, oldToNew, this);
+}
 
-            for (FIDMap::const_iterator j = oldFIDMap.begin(); j != oldFIDMap.end(); ++j)
-            {
-                const RefIDPair* rip = j->second.get();
-                if (rip && rip->_oid == oldoid)
-                {
-                    RefIDPair* newrip = new RefIDPair(rip->_fid, newoid);
-                    _oids[newoid] = rip->_fid;
-                    _fids[rip->_fid] = newrip;
-                    newFIDMap[rip->_fid] = newrip;
-                    ++count;
-                }
-            }
-        }
-    }
+void
+FeatureSourceIndex::update(osg::Node* node, std::map<ObjectID,ObjectID>& oldToNew)
+{
+    _masterIndex->updateObjectID(node, oldToNew, this);
 }
 
-// When Feature index data is deserialized, the old serialized ObjectIDs are 
-// no longer valid. This method will re-install the mappings in the master index
-// and write new local mappings with new ObjectIDs.
+// Writes new local mappings for a node's FIDs once its graph has been
+// updated with new ObjectIDs.
 void
-FeatureSourceIndex::update(osg::Node* node, std::map<ObjectID,ObjectID>& oldToNew, const FIDMap& oldFIDMap, FIDMap& newFIDMap)
+FeatureSourceIndex::remap(const std::map<ObjectID,ObjectID>& oldToNew, const FIDMap& oldFIDMap, FIDMap& newFIDMap)
 {
-    unsigned count = 0;
-    if (_masterIndex->updateObjectID(node, oldToNew, this))
+    Threading::ScopedWriteLock lock(_mutex);
+
+    for (FIDMap::const_iterator j = oldFIDMap.begin(); j != oldFIDMap.end(); ++j)
     {
-        for (std::map<ObjectID, ObjectID>::const_iterator i = oldToNew.begin(); i != oldToNew.end(); ++i)
-        {
-            const ObjectID& oldoid = i->first;
-            const ObjectID& newoid = i->second;
+        const RefIDPair* rip = j->second.get();
+        if ( !rip )
+            continue;
 
-            for (FIDMap::const_iterator j = oldFIDMap.begin(); j != oldFIDMap.end(); ++j)
-            {
-                const RefIDPair* rip = j->second.get();
-                if (rip && rip->_oid == oldoid)
-                {
-                    RefIDPair* newrip = new RefIDPair(rip->_fid, newoid);
-                    _oids[newoid] = rip->_fid;
-                    _fids[rip->_fid] = newrip;
-                    newFIDMap[rip->_fid] = newrip;
-                    ++count;
-                }
-            }
+        std::map<ObjectID, ObjectID>::const_iterator i = oldToNew.find( rip->_oid );
+        if ( i != oldToNew.end() )
+        {
+            RefIDPair* newrip = new RefIDPair(rip->_fid, i->second);
+            newrip->_feature = rip->_feature.get();
+            _oids.insert( i->second, rip->_fid );
+            _fids[rip->_fid] = newrip;
+            newFIDMap[rip->_fid] = newrip;
         }
     }
 }
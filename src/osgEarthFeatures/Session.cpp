@@ -21,6 +21,7 @@
 #include <osgEarthFeatures/Script>
 #include <osgEarthFeatures/ScriptEngine>
 #include <osgEarthFeatures/FeatureSource>
+#include <osgEarthFeatures/FeatureCache>
 #include <osgEarthSymbology/ResourceCache>
 #include <osgEarth/FileUtils>
 #include <osgEarth/StringUtils>
@@ -57,6 +58,10 @@ _dbOptions     ( dbOptions )
     // tiles in a particular "layer" will tend to share state.
     _stateSetCache = new StateSetCache();
 
+    // Feature query cache; whoever compiles features under this session
+    // decides how much memory it may use.
+    _featureCache = new FeatureCache();
+
     _name = "Session (unnamed)";
 }
 
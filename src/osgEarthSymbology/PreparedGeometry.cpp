@@ -0,0 +1,159 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarthSymbology/PreparedGeometry>
+#include <osgEarthSymbology/GEOS>
+
+using namespace osgEarth;
+using namespace osgEarth::Symbology;
+
+#ifdef OSGEARTH_HAVE_GEOS
+#  include <geos/geom/Geometry.h>
+#  include <geos/geom/prep/PreparedGeometry.h>
+#  include <geos/geom/prep/PreparedGeometryFactory.h>
+using namespace geos;
+#endif
+
+#define LC "[PreparedGeometry] "
+
+// GEOS 3.8 changed PreparedGeometryFactory::prepare to return a unique_ptr.
+#ifdef OSGEARTH_HAVE_GEOS
+#  if GEOS_VERSION_MAJOR > 3 || (GEOS_VERSION_MAJOR == 3 && GEOS_VERSION_MINOR >= 8)
+#    define OE_GEOS_PREPARE_RETURNS_UNIQUE_PTR 1
+#  endif
+#endif
+
+struct PreparedGeometry::GEOSData
+{
+#ifdef OSGEARTH_HAVE_GEOS
+    GEOSData() : _geom(0L), _prepared(0L) { }
+    GEOSContext                         _context;
+    geom::Geometry*                     _geom;
+    const geom::prep::PreparedGeometry* _prepared;
+#endif
+};
+
+PreparedGeometry::PreparedGeometry(const Geometry* geometry) :
+_geometry(geometry),
+_ring(dynamic_cast<const Ring*>(geometry)),
+_geos(0L)
+{
+    if (geometry)
+    {
+        _bounds = geometry->getBounds();
+    }
+
+#ifdef OSGEARTH_HAVE_GEOS
+    if (geometry)
+    {
+        _geos = new GEOSData();
+        _geos->_geom = _geos->_context.importGeometry(geometry);
+        if (_geos->_geom)
+        {
+#ifdef OE_GEOS_PREPARE_RETURNS_UNIQUE_PTR
+            _geos->_prepared = geom::prep::PreparedGeometryFactory::prepare(_geos->_geom).release();
+#else
+            _geos->_prepared = geom::prep::PreparedGeometryFactory::prepare(_geos->_geom);
+#endif
+        }
+    }
+#endif
+}
+
+PreparedGeometry::~PreparedGeometry()
+{
+#ifdef OSGEARTH_HAVE_GEOS
+    if (_geos)
+    {
+        if (_geos->_prepared)
+        {
+#ifdef OE_GEOS_PREPARE_RETURNS_UNIQUE_PTR
+            delete _geos->_prepared;
+#else
+            geom::prep::PreparedGeometryFactory::destroy(_geos->_prepared);
+#endif
+        }
+        _geos->_context.disposeGeometry(_geos->_geom);
+    }
+#endif
+    delete _geos;
+}
+
+bool
+PreparedGeometry::intersects(const Geometry* other) const
+{
+    if (!other || !_bounds.isValid())
+        return false;
+
+    // quick reject on the bounds:
+    Bounds b = other->getBounds();
+    if (!b.isValid() ||
+        b.xMin() > _bounds.xMax() || b.xMax() < _bounds.xMin() ||
+        b.yMin() > _bounds.yMax() || b.yMax() < _bounds.yMin())
+    {
+        return false;
+    }
+
+#ifdef OSGEARTH_HAVE_GEOS
+
+    if (!_geos || !_geos->_prepared)
+        return false;
+
+    GEOSContext gc;
+    geom::Geometry* otherGeom = gc.importGeometry(other);
+    if (!otherGeom)
+        return false;
+
+    bool result;
+    {
+        // the prepared geometry builds its segment index lazily
+        Threading::ScopedMutexLock lock(_geosMutex);
+        result = _geos->_prepared->intersects(otherGeom);
+    }
+
+    gc.disposeGeometry(otherGeom);
+    return result;
+
+#else // OSGEARTH_HAVE_GEOS
+
+    static bool warned = false;
+    if (!warned)
+    {
+        OE_WARN << LC << "Intersects failed - GEOS not available" << std::endl;
+        warned = true;
+    }
+    return false;
+
+#endif // OSGEARTH_HAVE_GEOS
+}
+
+bool
+PreparedGeometry::contains2D(double x, double y) const
+{
+    if (!_ring ||
+        x < _bounds.xMin() || x > _bounds.xMax() ||
+        y < _bounds.yMin() || y > _bounds.yMax())
+    {
+        return false;
+    }
+
+    return _ring->contains2D(x, y);
+}
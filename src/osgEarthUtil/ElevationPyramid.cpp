@@ -0,0 +1,486 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarthUtil/ElevationPyramid>
+#include <osgEarth/ElevationPool>
+#include <osgEarth/Profile>
+#include <osgEarth/Metrics>
+#include <algorithm>
+#include <cfloat>
+
+#define LC "[ElevationPyramid] "
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // Largest grid we'll build, in samples per side
+    const unsigned MAX_SAMPLES = 2049u;
+
+    // Slack for slab and triangle tests so rays along cell edges don't slip through
+    const double EPSILON = 1e-9;
+
+    // Clips the parametric range [t0,t1] of a ray to the slab [lo,hi] along one axis.
+    bool clipSlab(double origin, double dir, double lo, double hi, double& t0, double& t1)
+    {
+        if (fabs(dir) < EPSILON)
+        {
+            return origin >= lo && origin <= hi;
+        }
+        double a = (lo - origin) / dir;
+        double b = (hi - origin) / dir;
+        if (a > b) std::swap(a, b);
+        t0 = std::max(t0, a - EPSILON);
+        t1 = std::min(t1, b + EPSILON);
+        return t0 <= t1;
+    }
+
+    // Moller-Trumbore ray/triangle test; double-sided.
+    bool intersectTriangle(const osg::Vec3d& orig, const osg::Vec3d& dir,
+                           const osg::Vec3d& v0, const osg::Vec3d& v1, const osg::Vec3d& v2,
+                           double& out_t)
+    {
+        osg::Vec3d e1 = v1 - v0;
+        osg::Vec3d e2 = v2 - v0;
+        osg::Vec3d p = dir ^ e2;
+        double det = e1 * p;
+        if (fabs(det) < 1e-12)
+            return false;
+
+        double invDet = 1.0 / det;
+        osg::Vec3d s = orig - v0;
+        double u = (s * p) * invDet;
+        if (u < -EPSILON || u > 1.0 + EPSILON)
+            return false;
+
+        osg::Vec3d q = s ^ e1;
+        double v = (dir * q) * invDet;
+        if (v < -EPSILON || u + v > 1.0 + EPSILON)
+            return false;
+
+        out_t = (e2 * q) * invDet;
+        return true;
+    }
+
+    struct Child
+    {
+        unsigned _col, _row;
+        double   _t0, _t1;
+        bool operator < (const Child& rhs) const { return _t0 < rhs._t0; }
+    };
+}
+
+ElevationPyramid::ElevationPyramid() :
+_radius ( 0.0 ),
+_spacing( 0.0 ),
+_origin ( 0.0 ),
+_size   ( 0u )
+{
+    //nop
+}
+
+bool
+ElevationPyramid::build(ElevationPool* pool, const GeoPoint& center, double radius, unsigned lod, double spacing)
+{
+    METRIC_SCOPED("ElevationPyramid::build");
+
+    clear();
+
+    if (!pool || !center.isValid() || radius <= 0.0)
+        return false;
+
+    osg::ref_ptr<ElevationEnvelope> envelope = pool->createEnvelope( center.getSRS(), lod );
+    if (!envelope.valid())
+        return false;
+
+    // Default spacing follows the resolution of the map's elevation tiles at this LOD.
+    if (spacing <= 0.0)
+    {
+        spacing = getTileSpacing( envelope->getProfile(), lod, pool->getTileSize(), center );
+        if (spacing <= 0.0)
+            return false;
+    }
+
+    unsigned size = std::min( 2u * (unsigned)ceil(radius / spacing) + 1u, MAX_SAMPLES );
+
+    // Sample the elevation data under every grid point.
+    std::vector<osg::Vec3d> points;
+    initGrid( center, radius, std::max(size, 2u), points );
+
+    envelope->getElevations( points, _elevations );
+    if (_elevations.size() != points.size())
+    {
+        clear();
+        return false;
+    }
+
+    buildLevels( points );
+    return true;
+}
+
+bool
+ElevationPyramid::build(const GeoPoint& center, double radius, unsigned numSamples, const std::vector<float>& elevations)
+{
+    clear();
+
+    if (!center.isValid() || radius <= 0.0 || numSamples < 2u || elevations.size() != numSamples*numSamples)
+        return false;
+
+    std::vector<osg::Vec3d> points;
+    initGrid( center, radius, numSamples, points );
+    _elevations = elevations;
+
+    buildLevels( points );
+    return true;
+}
+
+void
+ElevationPyramid::clear()
+{
+    _levels.clear();
+    _heights.clear();
+    _elevations.clear();
+}
+
+double
+ElevationPyramid::getTileSpacing(const Profile* profile, unsigned lod, unsigned tileSize, const GeoPoint& center)
+{
+    if (!profile)
+        return 0.0;
+
+    double width, height;
+    profile->getTileDimensions( lod, width, height );
+    double samples = (double)std::max(tileSize, 2u) - 1.0;
+
+    const SpatialReference* srs = profile->getSRS();
+    if (srs->isGeographic())
+    {
+        // Degrees to meters; a degree of longitude shrinks with latitude,
+        // so take the finer of the two directions.
+        GeoPoint c;
+        double lat = center.transform(srs, c) ? c.y() : 0.0;
+        double metersPerDegree = srs->getEllipsoid()->getRadiusEquator() * osg::PI / 180.0;
+        double x = (width / samples) * metersPerDegree * std::max( cos(osg::DegreesToRadians(lat)), 0.01 );
+        double y = (height / samples) * metersPerDegree;
+        return std::min(x, y);
+    }
+
+    return srs->getUnits().convertTo( Units::METERS, std::min(width, height) / samples );
+}
+
+void
+ElevationPyramid::initGrid(const GeoPoint& center, double radius, unsigned size, std::vector<osg::Vec3d>& points)
+{
+    const SpatialReference* srs = center.getSRS();
+
+    _center  = center;
+    _radius  = radius;
+    _size    = size;
+    _spacing = (2.0 * radius) / (double)(_size - 1u);
+    _origin  = -radius;
+
+    // Local tangent plane at the center, on the ellipsoid.
+    GeoPoint anchor(srs, center.x(), center.y(), 0.0, ALTMODE_ABSOLUTE);
+    anchor.createLocalToWorld( _local2world );
+    _world2local.invert( _local2world );
+
+    // Map location of every grid point.
+    points.clear();
+    points.reserve( _size * _size );
+    for (unsigned r = 0; r < _size; ++r)
+    {
+        for (unsigned c = 0; c < _size; ++c)
+        {
+            osg::Vec3d world = osg::Vec3d(_origin + c*_spacing, _origin + r*_spacing, 0.0) * _local2world;
+            GeoPoint p;
+            p.fromWorld( srs, world );
+            points.push_back( osg::Vec3d(p.x(), p.y(), 0.0) );
+        }
+    }
+}
+
+void
+ElevationPyramid::buildLevels(const std::vector<osg::Vec3d>& points)
+{
+    const SpatialReference* srs = _center.getSRS();
+
+    // Convert to heights above the tangent plane.
+    _heights.resize( points.size() );
+    for (unsigned i = 0; i < points.size(); ++i)
+    {
+        if (_elevations[i] == NO_DATA_VALUE)
+            _elevations[i] = 0.0f;
+
+        GeoPoint p(srs, points[i].x(), points[i].y(), _elevations[i], ALTMODE_ABSOLUTE);
+        osg::Vec3d world;
+        p.toWorld( world );
+        _heights[i] = (float)(world * _world2local).z();
+    }
+
+    // Level 0 holds the extrema of each grid cell's four corners.
+    Level base;
+    base._cols = _size - 1u;
+    base._rows = _size - 1u;
+    base._cells.resize( base._cols * base._rows );
+    for (unsigned r = 0; r < base._rows; ++r)
+    {
+        for (unsigned c = 0; c < base._cols; ++c)
+        {
+            float h00 = height(c, r), h10 = height(c+1, r), h01 = height(c, r+1), h11 = height(c+1, r+1);
+            MinMax& mm = base._cells[r*base._cols + c];
+            mm._min = std::min( std::min(h00, h10), std::min(h01, h11) );
+            mm._max = std::max( std::max(h00, h10), std::max(h01, h11) );
+        }
+    }
+    _levels.push_back( base );
+
+    // Each coarser level combines 2x2 blocks of the one below, up to a single root.
+    while (_levels.back()._cols > 1u || _levels.back()._rows > 1u)
+    {
+        const Level& fine = _levels.back();
+        Level coarse;
+        coarse._cols = (fine._cols + 1u) / 2u;
+        coarse._rows = (fine._rows + 1u) / 2u;
+        coarse._cells.resize( coarse._cols * coarse._rows );
+
+        for (unsigned r = 0; r < coarse._rows; ++r)
+        {
+            for (unsigned c = 0; c < coarse._cols; ++c)
+            {
+                MinMax mm;
+                mm._min = FLT_MAX, mm._max = -FLT_MAX;
+                for (unsigned dr = 0; dr < 2u; ++dr)
+                {
+                    for (unsigned dc = 0; dc < 2u; ++dc)
+                    {
+                        unsigned fc = 2u*c + dc, fr = 2u*r + dr;
+                        if (fc < fine._cols && fr < fine._rows)
+                        {
+                            const MinMax& f = fine.at(fc, fr);
+                            mm._min = std::min(mm._min, f._min);
+                            mm._max = std::max(mm._max, f._max);
+                        }
+                    }
+                }
+                coarse._cells[r*coarse._cols + c] = mm;
+            }
+        }
+        _levels.push_back( coarse );
+    }
+
+    OE_DEBUG << LC << "Built " << _size << "x" << _size << " grid, spacing " << _spacing
+        << "m, " << _levels.size() << " levels" << std::endl;
+}
+
+bool
+ElevationPyramid::getHeightRange(unsigned level, unsigned col, unsigned row, float& out_min, float& out_max) const
+{
+    if (level >= _levels.size() || col >= _levels[level]._cols || row >= _levels[level]._rows)
+        return false;
+
+    const MinMax& mm = _levels[level].at(col, row);
+    out_min = mm._min;
+    out_max = mm._max;
+    return true;
+}
+
+bool
+ElevationPyramid::intersect(const osg::Vec3d& startWorld, const osg::Vec3d& endWorld, double& out_ratio) const
+{
+    if (!valid())
+        return false;
+
+    return intersectLocal( startWorld * _world2local, endWorld * _world2local, out_ratio );
+}
+
+bool
+ElevationPyramid::intersect(const osg::Vec3d& startWorld, const osg::Vec3d& endWorld, osg::Vec3d& out_hitWorld) const
+{
+    double t;
+    if (!intersect(startWorld, endWorld, t))
+        return false;
+
+    out_hitWorld = startWorld + (endWorld - startWorld) * t;
+    return true;
+}
+
+unsigned
+ElevationPyramid::intersect(const osg::Vec3d& startWorld, const std::vector<osg::Vec3d>& endsWorld, std::vector<double>& out_ratios) const
+{
+    out_ratios.assign( endsWorld.size(), -1.0 );
+    if (!valid())
+        return 0u;
+
+    unsigned hits = 0u;
+    osg::Vec3d start = startWorld * _world2local;
+    for (unsigned i = 0; i < endsWorld.size(); ++i)
+    {
+        double t;
+        if (intersectLocal(start, endsWorld[i] * _world2local, t))
+        {
+            out_ratios[i] = t;
+            ++hits;
+        }
+    }
+    return hits;
+}
+
+bool
+ElevationPyramid::getElevation(const GeoPoint& point, double& out_elevation) const
+{
+    if (!valid())
+        return false;
+
+    GeoPoint p(point.getSRS(), point.x(), point.y(), 0.0, ALTMODE_ABSOLUTE);
+    osg::Vec3d world;
+    if (!p.toWorld(world))
+        return false;
+
+    osg::Vec3d local = world * _world2local;
+    double u = (local.x() - _origin) / _spacing;
+    double v = (local.y() - _origin) / _spacing;
+    if (u < 0.0 || v < 0.0 || u > (double)(_size-1u) || v > (double)(_size-1u))
+        return false;
+
+    unsigned c = std::min( (unsigned)u, _size-2u );
+    unsigned r = std::min( (unsigned)v, _size-2u );
+    double fu = u - (double)c, fv = v - (double)r;
+
+    double e00 = _elevations[r*_size + c],     e10 = _elevations[r*_size + c+1];
+    double e01 = _elevations[(r+1)*_size + c], e11 = _elevations[(r+1)*_size + c+1];
+
+    out_elevation =
+        e00 * (1.0-fu) * (1.0-fv) + e10 * fu * (1.0-fv) +
+        e01 * (1.0-fu) * fv       + e11 * fu * fv;
+
+    return true;
+}
+
+bool
+ElevationPyramid::intersectLocal(const osg::Vec3d& start, const osg::Vec3d& end, double& out_t) const
+{
+    osg::Vec3d dir = end - start;
+    double lo = _origin, hi = _origin + (double)(_size-1u) * _spacing;
+
+    // clip the segment to the grid's footprint
+    double t0 = 0.0, t1 = 1.0;
+    if (!clipSlab(start.x(), dir.x(), lo, hi, t0, t1) ||
+        !clipSlab(start.y(), dir.y(), lo, hi, t0, t1))
+    {
+        return false;
+    }
+
+    t0 = std::max(t0, 0.0);
+    t1 = std::min(t1, 1.0);
+    if (t0 > t1)
+        return false;
+
+    return intersectNode( _levels.size()-1u, 0u, 0u, start, dir, t0, t1, out_t );
+}
+
+bool
+ElevationPyramid::intersectNode(unsigned level, unsigned col, unsigned row,
+                                const osg::Vec3d& start, const osg::Vec3d& dir,
+                                double t0, double t1, double& out_t) const
+{
+    const MinMax& mm = _levels[level].at(col, row);
+    double z0 = start.z() + dir.z()*t0;
+    double z1 = start.z() + dir.z()*t1;
+
+    // The segment passes above everything in this block.
+    if (std::min(z0, z1) > mm._max)
+        return false;
+
+    // The segment is underground across the whole block.
+    if (std::max(z0, z1) < mm._min)
+    {
+        out_t = t0;
+        return true;
+    }
+
+    if (level == 0u)
+        return intersectCell(col, row, start, dir, t0, t1, out_t);
+
+    // Visit the children in the order the ray crosses them, so the first
+    // hit found is the nearest one.
+    const Level& fine = _levels[level-1u];
+    double childSize = (double)(1u << (level-1u)) * _spacing;
+    double hi = _origin + (double)(_size-1u) * _spacing;
+
+    Child children[4];
+    unsigned count = 0u;
+    for (unsigned dr = 0; dr < 2u; ++dr)
+    {
+        for (unsigned dc = 0; dc < 2u; ++dc)
+        {
+            Child child;
+            child._col = 2u*col + dc;
+            child._row = 2u*row + dr;
+            if (child._col >= fine._cols || child._row >= fine._rows)
+                continue;
+
+            double xmin = _origin + child._col * childSize, xmax = std::min(xmin + childSize, hi);
+            double ymin = _origin + child._row * childSize, ymax = std::min(ymin + childSize, hi);
+            child._t0 = t0, child._t1 = t1;
+            if (clipSlab(start.x(), dir.x(), xmin, xmax, child._t0, child._t1) &&
+                clipSlab(start.y(), dir.y(), ymin, ymax, child._t0, child._t1))
+            {
+                children[count++] = child;
+            }
+        }
+    }
+
+    std::sort(children, children + count);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (intersectNode(level-1u, children[i]._col, children[i]._row, start, dir, children[i]._t0, children[i]._t1, out_t))
+            return true;
+    }
+    return false;
+}
+
+bool
+ElevationPyramid::intersectCell(unsigned col, unsigned row,
+                                const osg::Vec3d& start, const osg::Vec3d& dir,
+                                double t0, double t1, double& out_t) const
+{
+    double x0 = _origin + col * _spacing, x1 = x0 + _spacing;
+    double y0 = _origin + row * _spacing, y1 = y0 + _spacing;
+
+    osg::Vec3d p00(x0, y0, height(col,   row  ));
+    osg::Vec3d p10(x1, y0, height(col+1, row  ));
+    osg::Vec3d p01(x0, y1, height(col,   row+1));
+    osg::Vec3d p11(x1, y1, height(col+1, row+1));
+
+    double best = DBL_MAX, t;
+    if (intersectTriangle(start, dir, p00, p10, p11, t) && t >= t0 - EPSILON && t <= t1 + EPSILON)
+        best = std::min(best, t);
+    if (intersectTriangle(start, dir, p00, p11, p01, t) && t >= t0 - EPSILON && t <= t1 + EPSILON)
+        best = std::min(best, t);
+
+    if (best == DBL_MAX)
+        return false;
+
+    out_t = osg::clampBetween(best, 0.0, 1.0);
+    return true;
+}
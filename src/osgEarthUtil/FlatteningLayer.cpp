@@ -22,6 +22,7 @@
 #include <osgEarth/Map>
 #include <osgEarth/Progress>
 #include <osgEarth/Utils>
+#include <osgEarth/TaskService>
 #include <osgEarthFeatures/FeatureCursor>
 #include <osgEarthFeatures/GeometryUtils>
 #include <osgEarthSymbology/Query>
@@ -197,8 +198,8 @@ namespace
     // The height of the area is found by sampling a point internal to the polygon.
     // bufferWidth = width of transition from flat area to natural terrain.
     bool integratePolygons(const TileKey& key, osg::HeightField* hf, const MultiGeometry* geom, const SpatialReference* geomSRS,
-                           WidthsList& widths, ElevationEnvelope* envelope, 
-                           bool fillAllPixels, ProgressCallback* progress)
+                           const WidthsList& widths, ElevationEnvelope* envelope, 
+                           bool fillAllPixels, unsigned colStart, unsigned colEnd)
     {
         bool wroteChanges = false;
 
@@ -211,7 +212,7 @@ namespace
 
         bool needsTransform = ex.getSRS() != geomSRS;
         
-        for (unsigned col = 0; col < hf->getNumColumns(); ++col)
+        for (unsigned col = colStart; col < colEnd; ++col)
         {
             Pex.x() = ex.xMin() + (double)col * col_interval;
 
@@ -237,7 +238,7 @@ namespace
                 for (unsigned int geomIndex = 0; geomIndex < geom->getNumComponents(); geomIndex++)
                 {
                     Geometry* component = geom->getComponents()[geomIndex];
-                    Widths width = widths[geomIndex];
+                    const Widths& width = widths[geomIndex];
                     ConstGeometryIterator giter(component, false);
                     while (giter.hasMore() && !done)
                     {
@@ -376,6 +377,115 @@ namespace
         return samples.size() > 0 ? (numer / (double)(samples.size())) : FLT_MAX;
     }
 
+    // A line segment along with the flattening radii of its feature.
+    struct IndexedSegment
+    {
+        osg::Vec3d A;
+        osg::Vec3d B;
+        double innerRadius;
+        double outerRadius;
+    };
+
+    /**
+     * Uniform grid over the buffered line segments of one tile. Each cell lists
+     * the segments whose buffered bounds overlap it, in their original order,
+     * so a heightfield sample only needs to visit the segments in its own cell
+     * instead of every segment of every feature. Visiting them in the original
+     * order keeps the results identical to an exhaustive search.
+     */
+    struct SegmentIndex
+    {
+        std::vector<IndexedSegment> segments;
+        std::vector< std::vector<unsigned> > cells;
+        double xmin, ymin, cellWidth, cellHeight;
+        unsigned cols, rows;
+
+        SegmentIndex() : xmin(0.0), ymin(0.0), cellWidth(1.0), cellHeight(1.0), cols(0u), rows(0u) { }
+
+        void build(const MultiGeometry* geom, const WidthsList& widths)
+        {
+            double xmax = -DBL_MAX, ymax = -DBL_MAX;
+            xmin = DBL_MAX, ymin = DBL_MAX;
+
+            for (unsigned int geomIndex = 0; geomIndex < geom->getNumComponents(); geomIndex++)
+            {
+                const Widths& w = widths[geomIndex];
+                double innerRadius = w.lineWidth * 0.5;
+                double outerRadius = innerRadius + w.bufferWidth;
+
+                ConstGeometryIterator giter(geom->getComponents()[geomIndex].get());
+                while (giter.hasMore())
+                {
+                    const Geometry* part = giter.next();
+                    for (int i = 0; i < (int)part->size()-1; ++i)
+                    {
+                        IndexedSegment seg;
+                        seg.A = (*part)[i];
+                        seg.B = (*part)[i+1];
+                        seg.innerRadius = innerRadius;
+                        seg.outerRadius = outerRadius;
+                        segments.push_back(seg);
+
+                        xmin = std::min(xmin, std::min(seg.A.x(), seg.B.x()) - outerRadius);
+                        ymin = std::min(ymin, std::min(seg.A.y(), seg.B.y()) - outerRadius);
+                        xmax = std::max(xmax, std::max(seg.A.x(), seg.B.x()) + outerRadius);
+                        ymax = std::max(ymax, std::max(seg.A.y(), seg.B.y()) + outerRadius);
+                    }
+                }
+            }
+
+            if (segments.empty())
+                return;
+
+            // Aim for about one segment per cell.
+            const unsigned maxDim = 512u;
+            double width = std::max(xmax - xmin, 1e-9);
+            double height = std::max(ymax - ymin, 1e-9);
+            double cellSize = sqrt(width * height / (double)segments.size());
+            cols = osg::clampBetween((unsigned)ceil(width / cellSize), 1u, maxDim);
+            rows = osg::clampBetween((unsigned)ceil(height / cellSize), 1u, maxDim);
+            cellWidth = width / (double)cols;
+            cellHeight = height / (double)rows;
+            cells.resize(cols * rows);
+
+            for (unsigned s = 0; s < segments.size(); ++s)
+            {
+                const IndexedSegment& seg = segments[s];
+                unsigned c0 = getCol(std::min(seg.A.x(), seg.B.x()) - seg.outerRadius);
+                unsigned c1 = getCol(std::max(seg.A.x(), seg.B.x()) + seg.outerRadius);
+                unsigned r0 = getRow(std::min(seg.A.y(), seg.B.y()) - seg.outerRadius);
+                unsigned r1 = getRow(std::max(seg.A.y(), seg.B.y()) + seg.outerRadius);
+                for (unsigned r = r0; r <= r1; ++r)
+                    for (unsigned c = c0; c <= c1; ++c)
+                        cells[r*cols + c].push_back(s);
+            }
+        }
+
+        // Segments that might be within their outer radius of (x, y); NULL if none.
+        const std::vector<unsigned>* getCandidates(double x, double y) const
+        {
+            if (cells.empty() ||
+                x < xmin || x > xmin + cellWidth*(double)cols ||
+                y < ymin || y > ymin + cellHeight*(double)rows)
+            {
+                return 0L;
+            }
+            return &cells[getRow(y)*cols + getCol(x)];
+        }
+
+        unsigned getCol(double x) const
+        {
+            double c = floor((x - xmin) / cellWidth);
+            return c <= 0.0 ? 0u : std::min((unsigned)c, cols-1u);
+        }
+
+        unsigned getRow(double y) const
+        {
+            double r = floor((y - ymin) / cellHeight);
+            return r <= 0.0 ? 0u : std::min((unsigned)r, rows-1u);
+        }
+    };
+
     /**
      * Create a heightfield that flattens the terrain around linear geometry.
      * lineWidth = width of completely flat area
@@ -391,9 +501,9 @@ namespace
      * source elevation into the heightfield as a starting point, and then sample that
      * modifiable heightfield as we go along.
      */
-    bool integrateLines(const TileKey& key, osg::HeightField* hf, const MultiGeometry* geom, const SpatialReference* geomSRS,
-                        WidthsList& widths, ElevationEnvelope* envelope,
-                        bool fillAllPixels, ProgressCallback* progress)
+    bool integrateLines(const TileKey& key, osg::HeightField* hf, const SegmentIndex& index, const SpatialReference* geomSRS,
+                        ElevationEnvelope* envelope,
+                        bool fillAllPixels, unsigned colStart, unsigned colEnd)
     {
         bool wroteChanges = false;
 
@@ -407,7 +517,7 @@ namespace
         bool needsTransform = ex.getSRS() != geomSRS;
         
         // Loop over the new heightfield.
-        for (unsigned col = 0; col < hf->getNumColumns(); ++col)
+        for (unsigned col = colStart; col < colEnd; ++col)
         {
             Pex.x() = ex.xMin() + (double)col * col_interval;
 
@@ -432,89 +542,83 @@ namespace
                 static const unsigned Maxsamples = 4;
                 Samples samples;
 
-                for (unsigned int geomIndex = 0; geomIndex < geom->getNumComponents(); geomIndex++)
+                // Search for line segments near P.
+                const std::vector<unsigned>* candidates = index.getCandidates(P.x(), P.y());
+                if (candidates)
                 {
-                    Widths w = widths[geomIndex];
-                    double innerRadius = w.lineWidth * 0.5;
-                    double outerRadius = innerRadius + w.bufferWidth;
-                    double outerRadius2 = outerRadius * outerRadius;
-
-                    Geometry* component = geom->getComponents()[geomIndex];
-                    // Search for line segments.
-                    ConstGeometryIterator giter(component);
-                    while (giter.hasMore())
+                    for (std::vector<unsigned>::const_iterator c = candidates->begin(); c != candidates->end(); ++c)
                     {
-                        const Geometry* part = giter.next();                        
+                        const IndexedSegment& seg = index.segments[*c];
+                        double innerRadius = seg.innerRadius;
+                        double outerRadius = seg.outerRadius;
+                        double outerRadius2 = outerRadius * outerRadius;
+
+                        // AB is a candidate line segment:
+                        const osg::Vec3d& A = seg.A;
+                        const osg::Vec3d& B = seg.B;
 
-                        for (int i = 0; i < part->size()-1; ++i)
+                        osg::Vec3d AB = B - A;    // current segment AB
+
+                        double t;                 // parameter [0..1] on segment AB
+                        double D2;                // shortest distance from point P to segment AB, squared
+                        double L2 = AB.length2(); // length (squared) of segment AB
+                        osg::Vec3d AP = P - A;    // vector from endpoint A to point P
+
+                        if (L2 == 0.0)
+                        {
+                            // trivial case: zero-length segment
+                            t = 0.0;
+                            D2 = AP.length2();
+                        }
+                        else
                         {
-                            // AB is a candidate line segment:
-                            const osg::Vec3d& A = (*part)[i];
-                            const osg::Vec3d& B = (*part)[i+1];
+                            // Calculate parameter "t" [0..1] which will yield the closest point on AB to P.
+                            // Clamping it means the closest point won't be beyond the endpoints of the segment.
+                            t = clamp((AP * AB)/L2, 0.0, 1.0);
 
-                            osg::Vec3d AB = B - A;    // current segment AB
+                            // project our point P onto segment AB:
+                            PROJ.set( A + AB*t );
 
-                            double t;                 // parameter [0..1] on segment AB
-                            double D2;                // shortest distance from point P to segment AB, squared
-                            double L2 = AB.length2(); // length (squared) of segment AB
-                            osg::Vec3d AP = P - A;    // vector from endpoint A to point P
+                            // measure the distance (squared) from P to the projected point on AB:
+                            D2 = (P - PROJ).length2();
+                        }
 
-                            if (L2 == 0.0)
+                        // If the distance from our point to the line segment falls within
+                        // the maximum flattening distance, store it.
+                        if (D2 <= outerRadius2)
+                        {
+                            // see if P is a new sample.
+                            Sample* b;
+                            if (samples.size() < Maxsamples)
                             {
-                                // trivial case: zero-length segment
-                                t = 0.0;
-                                D2 = AP.length2();
+                                // If we haven't collected the maximum number of samples yet,
+                                // just add this to the list:
+                                samples.push_back(Sample());
+                                b = &samples.back();
                             }
                             else
                             {
-                                // Calculate parameter "t" [0..1] which will yield the closest point on AB to P.
-                                // Clamping it means the closest point won't be beyond the endpoints of the segment.
-                                t = clamp((AP * AB)/L2, 0.0, 1.0);
+                                // If we are maxed out on samples, find the farthest one we have so far
+                                // and replace it if the new point is closer:
+                                unsigned max_i = 0;
+                                for (unsigned i=1; i<samples.size(); ++i)
+                                    if (samples[i].D2 > samples[max_i].D2)
+                                        max_i = i;
 
-                                // project our point P onto segment AB:
-                                PROJ.set( A + AB*t );
+                                b = &samples[max_i];
 
-                                // measure the distance (squared) from P to the projected point on AB:
-                                D2 = (P - PROJ).length2();
+                                if (b->D2 < D2)
+                                    b = 0L;
                             }
 
-                            // If the distance from our point to the line segment falls within
-                            // the maximum flattening distance, store it.
-                            if (D2 <= outerRadius2)
+                            if (b)
                             {
-                                // see if P is a new sample.
-                                Sample* b;
-                                if (samples.size() < Maxsamples)
-                                {
-                                    // If we haven't collected the maximum number of samples yet,
-                                    // just add this to the list:
-                                    samples.push_back(Sample());
-                                    b = &samples.back();
-                                }
-                                else
-                                {
-                                    // If we are maxed out on samples, find the farthest one we have so far
-                                    // and replace it if the new point is closer:
-                                    unsigned max_i = 0;
-                                    for (unsigned i=1; i<samples.size(); ++i)
-                                        if (samples[i].D2 > samples[max_i].D2)
-                                            max_i = i;
-
-                                    b = &samples[max_i];
-
-                                    if (b->D2 < D2)
-                                        b = 0L;
-                                }
-
-                                if (b)
-                                {
-                                    b->D2 = D2;
-                                    b->A = A;
-                                    b->B = B;
-                                    b->T = t;
-                                    b->innerRadius = innerRadius;
-                                    b->outerRadius = outerRadius;
-                                }
+                                b->D2 = D2;
+                                b->A = A;
+                                b->B = B;
+                                b->T = t;
+                                b->innerRadius = innerRadius;
+                                b->outerRadius = outerRadius;
                             }
                         }
                     }
@@ -606,14 +710,86 @@ namespace
     }
     
 
+    // Integrates one band of heightfield columns.
+    struct IntegrateColumns
+    {
+        IntegrateColumns() : hf(0L), geom(0L), index(0L), geomSRS(0L), widths(0L), fill(false), colStart(0u), colEnd(0u), wroteChanges(false) { }
+
+        void execute()
+        {
+            if (index)
+                wroteChanges = integrateLines(key, hf, *index, geomSRS, envelope.get(), fill, colStart, colEnd);
+            else
+                wroteChanges = integratePolygons(key, hf, geom, geomSRS, *widths, envelope.get(), fill, colStart, colEnd);
+        }
+
+        TileKey                          key;
+        osg::HeightField*                hf;
+        const MultiGeometry*             geom;
+        const SegmentIndex*              index;
+        const SpatialReference*          geomSRS;
+        const WidthsList*                widths;
+        osg::ref_ptr<ElevationEnvelope>  envelope;  // not thread-safe, so one per band
+        bool                             fill;
+        unsigned                         colStart, colEnd;
+        bool                             wroteChanges;
+    };
+
+    typedef ParallelTask<IntegrateColumns> IntegrateColumnsTask;
+
     bool integrate(const TileKey& key, osg::HeightField* hf, const MultiGeometry* geom, const SpatialReference* geomSRS,
-                   WidthsList& widths, ElevationEnvelope* envelope,
+                   WidthsList& widths, ElevationPool* pool, TaskService* service,
                    bool fillAllPixels, ProgressCallback* progress)
     {
+        // Lines are matched against a spatial index of their segments.
+        SegmentIndex index;
         if (geom->isLinear())
-            return integrateLines(key, hf, geom, geomSRS, widths, envelope, fillAllPixels, progress);
+            index.build(geom, widths);
+
+        // Split the columns into bands; more bands than threads evens out
+        // the load when the features are not uniformly distributed.
+        unsigned numCols = hf->getNumColumns();
+        if (numCols == 0u)
+            return false;
+
+        unsigned numBands = service ? std::min(numCols, 4u * (unsigned)service->getNumThreads()) : 1u;
+        unsigned bandSize = (numCols + numBands - 1u) / numBands;
+        numBands = (numCols + bandSize - 1u) / bandSize;
+
+        std::vector< osg::ref_ptr<IntegrateColumnsTask> > tasks;
+        Threading::MultiEvent done(numBands);
+
+        for (unsigned band = 0; band < numBands; ++band)
+        {
+            IntegrateColumnsTask* task = new IntegrateColumnsTask(&done);
+            task->key = key;
+            task->hf = hf;
+            task->geom = geom;
+            task->index = geom->isLinear() ? &index : 0L;
+            task->geomSRS = geomSRS;
+            task->widths = &widths;
+            task->envelope = pool->createEnvelope(geomSRS, key.getLOD());
+            task->fill = fillAllPixels;
+            task->colStart = band * bandSize;
+            task->colEnd = std::min(numCols, task->colStart + bandSize);
+            tasks.push_back(task);
+        }
+
+        if (numBands == 1u)
+        {
+            tasks.front()->execute();
+        }
         else
-            return integratePolygons(key, hf, geom, geomSRS, widths, envelope, fillAllPixels, progress);
+        {
+            for (unsigned i = 0; i < tasks.size(); ++i)
+                service->add(tasks[i].get());
+            done.wait();
+        }
+
+        bool wroteChanges = false;
+        for (unsigned i = 0; i < tasks.size(); ++i)
+            wroteChanges = wroteChanges || tasks[i]->wroteChanges;
+        return wroteChanges;
     }
 }
 
@@ -677,6 +853,11 @@ FlatteningLayer::open()
         setProfile( profile );
     }
 
+    // Threads that share the work of each heightfield.
+    unsigned numThreads = OpenThreads::GetNumberOfProcessors();
+    if (numThreads > 1u && !_service.valid())
+        _service = new TaskService("FlatteningLayer", numThreads);
+
     return ElevationLayer::open();
 }
 
@@ -974,11 +1155,9 @@ FlatteningLayer::createImplementation(const TileKey& key,
             hf->getFloatArray()->assign(hf->getNumColumns()*hf->getNumRows(), NO_DATA_VALUE);
         }
 
-        // Create an elevation query envelope at the LOD we are creating
-        osg::ref_ptr<ElevationEnvelope> envelope = _pool->createEnvelope(workingSRS, key.getLOD());
-
         bool fill = (options().fill() == true);     
         
-        integrate(key, hf, &geoms, workingSRS, widths, envelope, fill, progress);
+        // Elevation query envelopes are created per thread, at the LOD we are creating
+        integrate(key, hf, &geoms, workingSRS, widths, _pool.get(), _service.get(), fill, progress);
     }
 }
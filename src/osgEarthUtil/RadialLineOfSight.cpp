@@ -21,6 +21,7 @@
 */
 #include <osgEarthUtil/RadialLineOfSight>
 #include <osgEarth/TerrainEngineNode>
+#include <osgEarth/ElevationPool>
 #include <osgUtil/LineSegmentIntersector>
 #include <osgSim/LineOfSight>
 #include <osgUtil/IntersectionVisitor>
@@ -89,7 +90,9 @@ _outlineColor( 1.0f, 1.0f, 1.0f, 1.0f),
 _displayMode( LineOfSight::MODE_SPLIT ),
 //_altitudeMode( ALTMODE_ABSOLUTE ),
 _fill(false),
-_terrainOnly( false )
+_terrainOnly( false ),
+_useElevationData( false ),
+_elevationLOD( 14u )
 {
     //compute(getNode());
     _terrainChangedCallback = new RadialLineOfSightNodeTerrainChangedCallback( this );
@@ -118,6 +121,7 @@ RadialLineOfSightNode::setMapNode( MapNode* mapNode )
         }
 
         _mapNode = mapNode;
+        _pyramid = 0L;
 
         if ( _mapNode.valid() && _terrainChangedCallback.valid() )
         {
@@ -214,6 +218,151 @@ void RadialLineOfSightNode::setTerrainOnly( bool terrainOnly )
     }
 }
 
+bool
+RadialLineOfSightNode::getUseElevationData() const
+{
+    return _useElevationData;
+}
+
+void
+RadialLineOfSightNode::setUseElevationData( bool value )
+{
+    if (_useElevationData != value)
+    {
+        _useElevationData = value;
+        _pyramid = 0L;
+        compute(getNode());
+    }
+}
+
+unsigned
+RadialLineOfSightNode::getElevationLOD() const
+{
+    return _elevationLOD;
+}
+
+void
+RadialLineOfSightNode::setElevationLOD( unsigned lod )
+{
+    if (_elevationLOD != lod)
+    {
+        _elevationLOD = lod;
+        _pyramid = 0L;
+        compute(getNode());
+    }
+}
+
+ElevationPyramid*
+RadialLineOfSightNode::getElevationPyramid()
+{
+    if ( !_useElevationData || !getMapNode() )
+        return 0L;
+
+    // rebuild when the region or the map's elevation layers change
+    const Map* map = getMapNode()->getMap();
+    if ( !_pyramid.valid() ||
+         _pyramid->getCenter() != _center ||
+         _pyramid->getRadius() != _radius ||
+         _pyramidRevision != map->getDataModelRevision() )
+    {
+        _pyramid = new ElevationPyramid();
+        _pyramidRevision = map->getDataModelRevision();
+        if ( !_pyramid->build(map->getElevationPool(), _center, _radius, _elevationLOD) )
+        {
+            OE_WARN << "[RadialLineOfSightNode] Failed to sample elevation data" << std::endl;
+            _pyramid = 0L;
+        }
+    }
+    return _pyramid.get();
+}
+
+void
+RadialLineOfSightNode::computeSpokes(osg::Node* node, std::vector<osg::Vec3d>& ends, std::vector<osg::Vec3d>& hits, std::vector<bool>& clear)
+{
+    ElevationPyramid* pyramid = getElevationPyramid();
+
+    GeoPoint centerMap;
+    _center.transform( getMapNode()->getMapSRS(), centerMap );
+
+    if ( pyramid && centerMap.altitudeMode() == ALTMODE_RELATIVE )
+    {
+        // resolve the height from the same data we intersect against
+        double elevation = 0.0;
+        pyramid->getElevation( centerMap, elevation );
+        centerMap.z() += elevation;
+        centerMap.altitudeMode() = ALTMODE_ABSOLUTE;
+        centerMap.toWorld( _centerWorld );
+    }
+    else
+    {
+        centerMap.toWorld( _centerWorld, getMapNode()->getTerrain() );
+    }
+
+    bool isProjected = getMapNode()->getMapSRS()->isProjected();
+    osg::Vec3d up = isProjected ? osg::Vec3d(0,0,1) : osg::Vec3d(_centerWorld);
+    up.normalize();
+
+    //Get the "side" vector
+    osg::Vec3d side = isProjected ? osg::Vec3d(1,0,0) : up ^ osg::Vec3d(0,0,1);
+
+    //Get the number of spokes
+    double delta = osg::PI * 2.0 / (double)_numSpokes;
+
+    ends.resize( _numSpokes );
+    hits.assign( _numSpokes, osg::Vec3d() );
+    clear.assign( _numSpokes, true );
+
+    for (unsigned int i = 0; i < (unsigned int)_numSpokes; i++)
+    {
+        double angle = delta * (double)i;
+        osg::Quat quat(angle, up );
+        osg::Vec3d spoke = quat * (side * _radius);
+        ends[i] = _centerWorld + spoke;
+    }
+
+    if ( pyramid )
+    {
+        std::vector<double> ratios;
+        pyramid->intersect( _centerWorld, ends, ratios );
+        for (unsigned int i = 0; i < (unsigned int)_numSpokes; i++)
+        {
+            if ( ratios[i] >= 0.0 )
+            {
+                clear[i] = false;
+                hits[i] = _centerWorld + (ends[i] - _centerWorld) * ratios[i];
+            }
+        }
+        return;
+    }
+
+    osg::ref_ptr<osgUtil::IntersectorGroup> ivGroup = new osgUtil::IntersectorGroup();
+
+    for (unsigned int i = 0; i < (unsigned int)_numSpokes; i++)
+    {
+        osg::ref_ptr<osgUtil::LineSegmentIntersector> dplsi = new osgUtil::LineSegmentIntersector( _centerWorld, ends[i] );
+        ivGroup->addIntersector( dplsi.get() );
+    }
+
+    osgUtil::IntersectionVisitor iv;
+    iv.setIntersector( ivGroup.get() );
+
+    node->accept( iv );
+
+    for (unsigned int i = 0; i < (unsigned int)_numSpokes; i++)
+    {
+        osgUtil::LineSegmentIntersector* los = dynamic_cast<osgUtil::LineSegmentIntersector*>(ivGroup->getIntersectors()[i].get());
+        if ( !los )
+            continue;
+
+        osgUtil::LineSegmentIntersector::Intersections& intersections = los->getIntersections();
+        if ( !intersections.empty() )
+        {
+            clear[i] = false;
+            hits[i] = intersections.begin()->getWorldIntersectPoint();
+        }
+    }
+}
+
 osg::Node*
 RadialLineOfSightNode::getNode()
 {
@@ -226,6 +375,17 @@ void
 RadialLineOfSightNode::terrainChanged( const osgEarth::TileKey& tileKey, osg::Node* terrain )
 {
     OE_DEBUG << "RadialLineOfSightNode::terrainChanged" << std::endl;
+
+    // Results from elevation data don't depend on which tiles are loaded, but
+    // the terrain also reloads when elevation layers are added, removed or
+    // toggled; recompute then, against a fresh pyramid.
+    if ( _useElevationData && getMapNode() )
+    {
+        if ( _pyramid.valid() && _pyramidRevision == getMapNode()->getMap()->getDataModelRevision() )
+            return;
+        _pyramid = 0L;
+    }
+
     compute( getNode() );    
 }
 
@@ -248,19 +408,9 @@ RadialLineOfSightNode::compute_line(osg::Node* node)
     if ( !getMapNode() )
         return;
 
-    GeoPoint centerMap;
-    _center.transform( getMapNode()->getMapSRS(), centerMap );
-    centerMap.toWorld( _centerWorld, getMapNode()->getTerrain() );
-
-    bool isProjected = getMapNode()->getMapSRS()->isProjected();
-    osg::Vec3d up = isProjected ? osg::Vec3d(0,0,1) : osg::Vec3d(_centerWorld);
-    up.normalize();
-
-    //Get the "side" vector
-    osg::Vec3d side = isProjected ? osg::Vec3d(1,0,0) : up ^ osg::Vec3d(0,0,1);
-
-    //Get the number of spokes
-    double delta = osg::PI * 2.0 / (double)_numSpokes;
+    std::vector<osg::Vec3d> ends, hits;
+    std::vector<bool> clear;
+    computeSpokes( node, ends, hits, clear );
     
     osg::Geometry* geometry = new osg::Geometry;
     geometry->setUseVertexBufferObjects(true);
@@ -278,40 +428,13 @@ RadialLineOfSightNode::compute_line(osg::Node* node)
     osg::Vec3d previousEnd;
     osg::Vec3d firstEnd;
 
-    osg::ref_ptr<osgUtil::IntersectorGroup> ivGroup = new osgUtil::IntersectorGroup();
-
-    for (unsigned int i = 0; i < (unsigned int)_numSpokes; i++)
-    {
-        double angle = delta * (double)i;
-        osg::Quat quat(angle, up );
-        osg::Vec3d spoke = quat * (side * _radius);
-        osg::Vec3d end = _centerWorld + spoke;
-        osg::ref_ptr<osgUtil::LineSegmentIntersector> dplsi = new osgUtil::LineSegmentIntersector( _centerWorld, end );
-        ivGroup->addIntersector( dplsi.get() );
-    }
-
-    osgUtil::IntersectionVisitor iv;
-    iv.setIntersector( ivGroup.get() );
-
-    node->accept( iv );
-
     for (unsigned int i = 0; i < (unsigned int)_numSpokes; i++)
     {
-        osgUtil::LineSegmentIntersector* los = dynamic_cast<osgUtil::LineSegmentIntersector*>(ivGroup->getIntersectors()[i].get());
-        if ( !los )
-            continue;
-
-        osgUtil::LineSegmentIntersector::Intersections& hits = los->getIntersections();
+        osg::Vec3d start = _centerWorld;
+        osg::Vec3d end = ends[i];
 
-        osg::Vec3d start = los->getStart();
-        osg::Vec3d end = los->getEnd();
-
-        osg::Vec3d hit;
-        bool hasLOS = hits.empty();
-        if (!hasLOS)
-        {
-            hit = hits.begin()->getWorldIntersectPoint();
-        }
+        osg::Vec3d hit = hits[i];
+        bool hasLOS = clear[i];
 
         if (hasLOS)
         {
@@ -393,20 +516,9 @@ RadialLineOfSightNode::compute_fill(osg::Node* node)
     if ( !getMapNode() )
         return;
 
-    GeoPoint centerMap;
-    _center.transform( getMapNode()->getMapSRS(), centerMap );
-    centerMap.toWorld( _centerWorld, getMapNode()->getTerrain() );
-
-    bool isProjected = getMapNode()->getMapSRS()->isProjected();
-
-    osg::Vec3d up = isProjected ? osg::Vec3d(0,0,1) : osg::Vec3d(_centerWorld);
-    up.normalize();
-
-    //Get the "side" vector
-    osg::Vec3d side = isProjected ? osg::Vec3d(1,0,0) : up ^ osg::Vec3d(0,0,1);
-
-    //Get the number of spokes
-    double delta = osg::PI * 2.0 / (double)_numSpokes;
+    std::vector<osg::Vec3d> ends, hits;
+    std::vector<bool> clear;
+    computeSpokes( node, ends, hits, clear );
     
     osg::Geometry* geometry = new osg::Geometry;
     geometry->setUseVertexBufferObjects(true);
@@ -421,46 +533,20 @@ RadialLineOfSightNode::compute_fill(osg::Node* node)
     geometry->setColorArray( colors );
     geometry->setColorBinding(osg::Geometry::BIND_PER_VERTEX);
 
-    osg::ref_ptr<osgUtil::IntersectorGroup> ivGroup = new osgUtil::IntersectorGroup();
-
-    for (unsigned int i = 0; i < (unsigned int)_numSpokes; i++)
-    {
-        double angle = delta * (double)i;
-        osg::Quat quat(angle, up );
-        osg::Vec3d spoke = quat * (side * _radius);
-        osg::Vec3d end = _centerWorld + spoke;        
-        osg::ref_ptr<osgUtil::LineSegmentIntersector> dplsi = new osgUtil::LineSegmentIntersector( _centerWorld, end );
-        if (dplsi)
-            ivGroup->addIntersector( dplsi.get() );
-    }
-
-    osgUtil::IntersectionVisitor iv;
-    iv.setIntersector( ivGroup.get() );
-
-    node->accept( iv );
-
     for (unsigned int i = 0; i < (unsigned int)_numSpokes; i++)
     {
         //Get the current hit
-        osgUtil::LineSegmentIntersector* los = dynamic_cast<osgUtil::LineSegmentIntersector*>(ivGroup->getIntersectors()[i].get());
-        if ( !los )
-            continue;
-
-        osgUtil::LineSegmentIntersector::Intersections& hits = los->getIntersections();
-
-        osg::Vec3d currEnd = los->getEnd();
-        bool currHasLOS = hits.empty();
-        osg::Vec3d currHit = currHasLOS ? osg::Vec3d() : hits.begin()->getWorldIntersectPoint();
+        osg::Vec3d currEnd = ends[i];
+        bool currHasLOS = clear[i];
+        osg::Vec3d currHit = hits[i];
 
         //Get the next hit
         unsigned int nextIndex = i + 1;
         if (nextIndex == _numSpokes) nextIndex = 0;
-        osgUtil::LineSegmentIntersector* losNext = static_cast<osgUtil::LineSegmentIntersector*>(ivGroup->getIntersectors()[nextIndex].get());
-        osgUtil::LineSegmentIntersector::Intersections& hitsNext = losNext->getIntersections();
 
-        osg::Vec3d nextEnd = losNext->getEnd();
-        bool nextHasLOS = hitsNext.empty();
-        osg::Vec3d nextHit = nextHasLOS ? osg::Vec3d() : hitsNext.begin()->getWorldIntersectPoint();
+        osg::Vec3d nextEnd = ends[nextIndex];
+        bool nextHasLOS = clear[nextIndex];
+        osg::Vec3d nextHit = hits[nextIndex];
         
         if (currHasLOS && nextHasLOS)
         {
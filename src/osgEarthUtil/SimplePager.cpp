@@ -169,6 +169,24 @@ osg::BoundingSphere SimplePager::getBounds(const TileKey& key) const
     double xSample = extent.width() / (double)samples;
     double ySample = extent.height() / (double)samples;
 
+    // cover the terrain's height range when the elevation layers know it
+    double heights[2] = { 0.0, 0.0 };
+    ElevationTileSummary summary;
+    if (!_elevationLayers.empty() &&
+        _elevationLayers.getTileSummary(key, summary) &&
+        summary.hasHeights())
+    {
+        heights[0] = summary._minHeight;
+        heights[1] = summary._maxHeight;
+
+        // NO_DATA samples end up at sea level
+        if (summary._hasNoData)
+        {
+            heights[0] = osg::minimum(heights[0], 0.0);
+            heights[1] = osg::maximum(heights[1], 0.0);
+        }
+    }
+
     osg::BoundingSphere bs;
     for (int c = 0; c < samples+1; c++)
     {
@@ -176,13 +194,19 @@ osg::BoundingSphere SimplePager::getBounds(const TileKey& key) const
         for (int r = 0; r < samples+1; r++)
         {
             double y = extent.yMin() + (double)r * ySample;
-            osg::Vec3d world;
+            for (int h = 0; h < 2; h++)
+            {
+                osg::Vec3d world;
 
-            GeoPoint samplePoint(extent.getSRS(), x, y, 0, ALTMODE_ABSOLUTE);
+                GeoPoint samplePoint(extent.getSRS(), x, y, heights[h], ALTMODE_ABSOLUTE);
 
-            GeoPoint wgs84 = samplePoint.transform(osgEarth::SpatialReference::create("epsg:4326"));
-            wgs84.toWorld(world);
-            bs.expandBy(world);
+                GeoPoint wgs84 = samplePoint.transform(osgEarth::SpatialReference::create("epsg:4326"));
+                wgs84.toWorld(world);
+                bs.expandBy(world);
+
+                if (heights[1] == heights[0])
+                    break;
+            }
         }
     }
     return bs;
@@ -25,6 +25,11 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <osgEarth/FileUtils>
+#include <osgEarth/TaskService>
+#include <osgEarth/ThreadingUtils>
+#include <osg/Math>
+#include <algorithm>
+#include <vector>
 
 #define LC "[TFSPackager] "
 
@@ -211,6 +216,66 @@ public:
 
 
 /******************************************************************************************/
+
+/**
+ * Loads the features with the given IDs, crops them to the tile, and writes
+ * them out as a GeoJSON tile file.
+ */
+template<typename ITER>
+void writeFeatureTile(FeatureSource* source, const TileKey& key, ITER begin, ITER end,
+                      const std::string& dest, CropFilter::Method cropMethod, const SpatialReference* srs)
+{
+    //Actually load up the features
+    FeatureList features;
+    for (ITER i = begin; i != end; ++i)
+    {
+        Feature* f = source->getFeature( *i );
+
+        if (f)
+        {
+            //Reproject the feature to the dest SRS if it's not already
+            if (!f->getSRS()->isEquivalentTo( srs ) )
+            {
+                f->transform( srs );
+            }
+            features.push_back( f );
+        }
+        else
+        {
+            OE_NOTICE << "couldn't get feature " << *i << std::endl;
+        }
+    }
+
+    //Need to do the cropping again since these are brand new features coming from the feature source.
+    CropFilter cropFilter(cropMethod);
+    FilterContext context(0);
+    context.extent() = key.getExtent();
+    cropFilter.push( features, context );
+
+    std::string contents = Feature::featuresToGeoJSON( features );
+    std::stringstream buf;
+    int x =  key.getTileX();
+    unsigned int numRows, numCols;
+    key.getProfile()->getNumTiles(key.getLevelOfDetail(), numCols, numRows);
+    int y  = numRows - key.getTileY() - 1;
+
+    buf << dest << "/" << key.getLevelOfDetail() << "/" << x << "/" << y << ".json";
+    std::string filename = buf.str();
+    //OE_NOTICE << "Writing " << features.size() << " features to " << filename << std::endl;
+
+    if ( !osgDB::fileExists( osgDB::getFilePath(filename) ) )
+        osgEarth::makeDirectoryForFile( filename );
+
+
+    std::fstream output( filename.c_str(), std::ios_base::out );
+    if ( output.is_open() )
+    {
+        output << contents;
+        output.flush();
+        output.close();
+    }
+}
+
 class WriteFeaturesVisitor : public FeatureTileVisitor
 {
 public:
@@ -226,56 +291,8 @@ public:
       virtual void traverse( FeatureTile* tile)
       {
           if (tile->getFeatures().size() > 0)
-          {                 
-              //Actually load up the features
-              FeatureList features;
-              for (FeatureIDList::const_iterator i = tile->getFeatures().begin(); i != tile->getFeatures().end(); i++)
-              {
-                  Feature* f = _features->getFeature( *i );                  
-
-                  if (f)
-                  {
-                      //Reproject the feature to the dest SRS if it's not already
-                      if (!f->getSRS()->isEquivalentTo( _srs ) )
-                      {
-                          f->transform( _srs );
-                      }
-                      features.push_back( f );
-                  }
-                  else
-                  {
-                      OE_NOTICE << "couldn't get feature " << *i << std::endl;
-                  }
-              }
-
-              //Need to do the cropping again since these are brand new features coming from the feature source.
-              CropFilter cropFilter(_cropMethod);
-              FilterContext context(0);
-              context.extent() = tile->getExtent();
-              cropFilter.push( features, context );
-
-              std::string contents = Feature::featuresToGeoJSON( features );
-              std::stringstream buf;
-              int x =  tile->getKey().getTileX();
-              unsigned int numRows, numCols;
-              tile->getKey().getProfile()->getNumTiles(tile->getKey().getLevelOfDetail(), numCols, numRows);
-              int y  = numRows - tile->getKey().getTileY() - 1;
-
-              buf << _dest << "/" << tile->getKey().getLevelOfDetail() << "/" << x << "/" << y << ".json";
-              std::string filename = buf.str();
-              //OE_NOTICE << "Writing " << features.size() << " features to " << filename << std::endl;
-
-              if ( !osgDB::fileExists( osgDB::getFilePath(filename) ) )
-                  osgEarth::makeDirectoryForFile( filename );
-
-
-              std::fstream output( filename.c_str(), std::ios_base::out );
-              if ( output.is_open() )
-              {
-                  output << contents;
-                  output.flush();
-                  output.close();                
-              }            
+          {
+              writeFeatureTile( _features.get(), tile->getKey(), tile->getFeatures().begin(), tile->getFeatures().end(), _dest, _cropMethod, _srs.get() );
           }
           tile->traverse( this );        
       }
@@ -287,6 +304,226 @@ public:
 };
 
 
+/******************************************************************************************/
+
+namespace
+{
+    /**
+     * Where one feature goes in the bulk packager.
+     */
+    struct BulkEntry
+    {
+        unsigned long long _code;   // Morton code of the feature's tile at the max level
+        unsigned           _seq;    // position in the cursor, so the query's ordering is honored
+        unsigned           _level;  // deepest level at which a single tile holds the feature
+        unsigned           _x0, _y0, _x1, _y1; // tiles the feature covers at the max level
+        FeatureID          _fid;
+    };
+
+    struct LessMorton
+    {
+        bool operator()(const BulkEntry& lhs, const BulkEntry& rhs) const
+        {
+            return lhs._code < rhs._code || (lhs._code == rhs._code && lhs._seq < rhs._seq);
+        }
+    };
+
+    // Features that stay in a full tile instead of moving down to its children
+    struct StaysInTile
+    {
+        StaysInTile(unsigned maxSeq) : _maxSeq(maxSeq) { }
+        bool operator()(const BulkEntry& e) const { return e._seq <= _maxSeq; }
+        unsigned _maxSeq;
+    };
+
+    struct BulkTile
+    {
+        unsigned _level, _x, _y;
+        unsigned _begin, _end;      // range in the packaged feature ID list
+    };
+
+    unsigned long long interleave(unsigned x, unsigned y)
+    {
+        unsigned long long code = 0;
+        for (unsigned b = 0; b < 32; ++b)
+        {
+            code |= (unsigned long long)((x >> b) & 1u) << (2*b);
+            code |= (unsigned long long)((y >> b) & 1u) << (2*b + 1);
+        }
+        return code;
+    }
+
+    // Tile column and row (row 0 at the top) that contain a point at a level.
+    void getTileXY(const GeoExtent& extent, double x, double y, unsigned level, unsigned& tx, unsigned& ty)
+    {
+        double n = (double)(1u << level);
+        double fx = floor( (x - extent.xMin()) / extent.width() * n );
+        double fy = floor( (extent.yMax() - y) / extent.height() * n );
+        tx = (unsigned)osg::clampBetween( fx, 0.0, n - 1.0 );
+        ty = (unsigned)osg::clampBetween( fy, 0.0, n - 1.0 );
+    }
+
+    // Places an entry covering a range of tiles at the max level.
+    void placeBulkEntry(BulkEntry& e, unsigned x0, unsigned y0, unsigned x1, unsigned y1, unsigned maxLevel)
+    {
+        e._x0 = x0, e._y0 = y0, e._x1 = x1, e._y1 = y1;
+
+        // The deepest tile holding the whole range is the common prefix
+        // of its corners' Morton codes.
+        e._code = interleave( x0, y0 );
+        unsigned long long diff = e._code ^ interleave( x1, y1 );
+        e._level = maxLevel;
+        for (unsigned bit = 0; diff != 0; ++bit, diff >>= 1)
+        {
+            if (diff == 1)
+                e._level = maxLevel - (bit/2 + 1);
+        }
+    }
+
+    void partitionBulk(std::vector<BulkEntry>& entries, unsigned begin, unsigned end,
+                       unsigned level, unsigned x, unsigned y,
+                       unsigned firstLevel, unsigned maxLevel, unsigned maxFeatures,
+                       std::vector<FeatureID>& fids, std::vector<BulkTile>& tiles);
+
+    // Hands a Morton-sorted range of features to the children of a tile.
+    // Each child's features are contiguous in Morton order.
+    void partitionBulkChildren(std::vector<BulkEntry>& entries, unsigned begin, unsigned end,
+                               unsigned level, unsigned x, unsigned y,
+                               unsigned firstLevel, unsigned maxLevel, unsigned maxFeatures,
+                               std::vector<FeatureID>& fids, std::vector<BulkTile>& tiles)
+    {
+        unsigned shift = 2 * (maxLevel - level - 1);
+        for (unsigned i = begin; i < end; )
+        {
+            unsigned quadrant = (unsigned)(entries[i]._code >> shift) & 3u;
+            unsigned j = i + 1;
+            while (j < end && ((unsigned)(entries[j]._code >> shift) & 3u) == quadrant)
+                ++j;
+
+            partitionBulk( entries, i, j, level+1, 2*x + (quadrant & 1u), 2*y + (quadrant >> 1),
+                           firstLevel, maxLevel, maxFeatures, fids, tiles );
+            i = j;
+        }
+    }
+
+    /**
+     * Splits a Morton-sorted range of features into tiles the way the quadtree
+     * would: a tile keeps the first maxFeatures features (in query order) that
+     * fall inside it and passes the rest down to its children. A feature that
+     * crosses a child boundary is passed down to every child it touches, so
+     * only tiles at the max level can hold more than maxFeatures features.
+     */
+    void partitionBulk(std::vector<BulkEntry>& entries, unsigned begin, unsigned end,
+                       unsigned level, unsigned x, unsigned y,
+                       unsigned firstLevel, unsigned maxLevel, unsigned maxFeatures,
+                       std::vector<FeatureID>& fids, std::vector<BulkTile>& tiles)
+    {
+        if (begin == end)
+            return;
+
+        unsigned stayEnd = begin;
+        if (level >= firstLevel)
+        {
+            if (end - begin <= maxFeatures || level == maxLevel)
+            {
+                stayEnd = end;
+            }
+            else
+            {
+                std::vector<unsigned> seqs;
+                seqs.reserve(end - begin);
+                for (unsigned i = begin; i < end; ++i)
+                    seqs.push_back( entries[i]._seq );
+                std::nth_element( seqs.begin(), seqs.begin() + (maxFeatures-1), seqs.end() );
+                unsigned maxSeq = seqs[maxFeatures-1];
+
+                // stable, so the features moving down stay in Morton order
+                stayEnd = std::stable_partition(
+                    entries.begin() + begin, entries.begin() + end,
+                    StaysInTile(maxSeq) ) - entries.begin();
+            }
+        }
+
+        if (stayEnd > begin)
+        {
+            BulkTile tile;
+            tile._level = level, tile._x = x, tile._y = y;
+            tile._begin = (unsigned)fids.size();
+            for (unsigned i = begin; i < stayEnd; ++i)
+                fids.push_back( entries[i]._fid );
+            tile._end = (unsigned)fids.size();
+            tiles.push_back( tile );
+        }
+
+        unsigned numStraddling = 0;
+        for (unsigned i = stayEnd; i < end; ++i)
+        {
+            if (entries[i]._level <= level)
+                ++numStraddling;
+        }
+
+        if (numStraddling == 0)
+        {
+            partitionBulkChildren( entries, stayEnd, end, level, x, y,
+                                   firstLevel, maxLevel, maxFeatures, fids, tiles );
+            return;
+        }
+
+        // Crop the features that straddle the children into each child they
+        // touch, the way pass 1 does for features bigger than a first-level tile.
+        std::vector<BulkEntry> down;
+        down.reserve( end - stayEnd + 3*numStraddling );
+        unsigned shift = maxLevel - level - 1;
+        for (unsigned i = stayEnd; i < end; ++i)
+        {
+            const BulkEntry& e = entries[i];
+            if (e._level > level)
+            {
+                down.push_back( e );
+                continue;
+            }
+
+            for (unsigned q = 0; q < 4; ++q)
+            {
+                unsigned cx0 = (2*x + (q & 1u)) << shift, cx1 = cx0 + (1u << shift) - 1;
+                unsigned cy0 = (2*y + (q >> 1)) << shift, cy1 = cy0 + (1u << shift) - 1;
+                if (e._x0 <= cx1 && e._x1 >= cx0 && e._y0 <= cy1 && e._y1 >= cy0)
+                {
+                    BulkEntry child = e;
+                    placeBulkEntry( child,
+                        std::max(e._x0, cx0), std::max(e._y0, cy0),
+                        std::min(e._x1, cx1), std::min(e._y1, cy1), maxLevel );
+                    down.push_back( child );
+                }
+            }
+        }
+        std::sort( down.begin(), down.end(), LessMorton() );
+
+        partitionBulkChildren( down, 0, (unsigned)down.size(), level, x, y,
+                               firstLevel, maxLevel, maxFeatures, fids, tiles );
+    }
+
+    struct WriteTileTask : public TaskRequest
+    {
+        WriteTileTask(FeatureSource* source, const TileKey& key, const std::string& dest,
+                      CropFilter::Method method, const SpatialReference* srs, Threading::MultiEvent* done) :
+            _source(source), _key(key), _dest(dest), _method(method), _srs(srs), _done(done) { }
+
+        void operator()(ProgressCallback* progress)
+        {
+            writeFeatureTile( _source.get(), _key, _fids.begin(), _fids.end(), _dest, _method, _srs.get() );
+            _done->notify();
+        }
+
+        osg::ref_ptr<FeatureSource>           _source;
+        TileKey                               _key;
+        std::vector<FeatureID>                _fids;
+        std::string                           _dest;
+        CropFilter::Method                    _method;
+        osg::ref_ptr<const SpatialReference>  _srs;
+        Threading::MultiEvent*                _done;
+    };
+}
 
 /******************************************************************************************/
 
@@ -294,10 +531,150 @@ TFSPackager::TFSPackager():
 _firstLevel( 0 ),
     _maxLevel( 10 ),
     _maxFeatures( 300 ),
-    _method( CropFilter::METHOD_CENTROID )
+    _method( CropFilter::METHOD_CENTROID ),
+    _bulk( false ),
+    _numThreads( OpenThreads::GetNumberOfProcessors() )
 {
 }
 
+int
+TFSPackager::packageBulk( FeatureSource* features, const Profile* profile, const std::string& destination )
+{
+    const GeoExtent& rootExtent = profile->getExtent();
+
+    // Morton codes are 64 bits, so 31 levels at most.
+    unsigned maxLevel    = std::min( _maxLevel, 30u );
+    unsigned firstLevel  = std::min( _firstLevel, maxLevel );
+    unsigned maxFeatures = std::max( _maxFeatures, 1u );
+
+    // Pass 1: place every feature from its extent alone.
+    std::vector<BulkEntry> entries;
+    osg::ref_ptr< FeatureCursor > cursor = features->createFeatureCursor( _query );
+    unsigned seq = 0;
+    int added = 0;
+    int failed = 0;
+    int skipped = 0;
+
+    while (cursor.valid() && cursor->hasMore())
+    {
+        osg::ref_ptr< Feature > feature = cursor->nextFeature();
+
+        //Reproject the feature to the dest SRS if it's not already
+        if (!feature->getSRS()->isEquivalentTo( _srs ) )
+        {
+            feature->transform( _srs );
+        }
+
+        if (!feature->getGeometry() || !feature->getGeometry()->getBounds().valid() || !feature->getGeometry()->isValid())
+        {
+            OE_NOTICE << "Skipping feature " << feature->getFID() << " with null or invalid geometry" << std::endl;
+            skipped++;
+            continue;
+        }
+
+        Bounds bounds = feature->getGeometry()->getBounds();
+        BulkEntry entry;
+        entry._seq = seq++;
+        entry._fid = feature->getFID();
+
+        if (_method == CropFilter::METHOD_CENTROID)
+        {
+            osg::Vec3d centroid = bounds.center();
+            if (!rootExtent.contains( centroid.x(), centroid.y() ))
+            {
+                OE_NOTICE << "Failed to add feature " << feature->getFID() << std::endl;
+                failed++;
+                continue;
+            }
+            unsigned tx, ty;
+            getTileXY( rootExtent, centroid.x(), centroid.y(), maxLevel, tx, ty );
+            placeBulkEntry( entry, tx, ty, tx, ty, maxLevel );
+            entries.push_back( entry );
+        }
+        else
+        {
+            if (!GeoExtent(_srs.get(), bounds).intersects( rootExtent ))
+            {
+                OE_NOTICE << "Failed to add feature " << feature->getFID() << std::endl;
+                failed++;
+                continue;
+            }
+
+            unsigned tx0, ty0, tx1, ty1;
+            getTileXY( rootExtent, bounds.xMin(), bounds.yMax(), maxLevel, tx0, ty0 );
+            getTileXY( rootExtent, bounds.xMax(), bounds.yMin(), maxLevel, tx1, ty1 );
+
+            placeBulkEntry( entry, tx0, ty0, tx1, ty1, maxLevel );
+
+            if (entry._level >= firstLevel)
+            {
+                entries.push_back( entry );
+            }
+            else
+            {
+                // Too big for any single first-level tile, so crop it into each one it touches.
+                unsigned shift = maxLevel - firstLevel;
+                for (unsigned ty = (ty0 >> shift); ty <= (ty1 >> shift); ++ty)
+                {
+                    for (unsigned tx = (tx0 >> shift); tx <= (tx1 >> shift); ++tx)
+                    {
+                        BulkEntry cropped = entry;
+                        placeBulkEntry( cropped,
+                            std::max(tx0, tx << shift), std::max(ty0, ty << shift),
+                            std::min(tx1, ((tx+1) << shift) - 1), std::min(ty1, ((ty+1) << shift) - 1),
+                            maxLevel );
+                        entries.push_back( cropped );
+                    }
+                }
+            }
+        }
+        added++;
+    }
+    cursor = 0L;
+
+    OE_NOTICE << "Added=" << added << " Skipped=" << skipped << " Failed=" << failed << std::endl;
+
+    // Pass 2: sort and carve the features into tiles.
+    std::sort( entries.begin(), entries.end(), LessMorton() );
+
+    std::vector<BulkTile> tiles;
+    std::vector<FeatureID> fids;
+    fids.reserve( entries.size() );
+    partitionBulk( entries, 0, entries.size(), 0, 0, 0, firstLevel, maxLevel, maxFeatures, fids, tiles );
+    std::vector<BulkEntry>().swap( entries );
+
+    int highestLevel = 0;
+    for (unsigned i = 0; i < tiles.size(); ++i)
+        highestLevel = std::max( highestLevel, (int)tiles[i]._level );
+
+    OE_NOTICE << "Writing " << tiles.size() << " tiles on " << _numThreads << " threads" << std::endl;
+
+    // Pass 3: write the tiles in parallel. The queue is bounded so only a
+    // few tiles' worth of features are loaded at any time.
+    if (!tiles.empty())
+    {
+        unsigned numThreads = std::max( _numThreads, 1u );
+        Threading::MultiEvent done( tiles.size() );
+        osg::ref_ptr<TaskService> service = new TaskService( "TFSPackager", numThreads, 2*numThreads );
+
+        for (unsigned i = 0; i < tiles.size(); ++i)
+        {
+            const BulkTile& tile = tiles[i];
+            WriteTileTask* task = new WriteTileTask(
+                features, TileKey(tile._level, tile._x, tile._y, profile),
+                destination, _method, _srs.get(), &done );
+
+            task->_fids.assign( fids.begin() + tile._begin, fids.begin() + tile._end );
+
+            service->add( task );
+        }
+
+        done.wait();
+    }
+
+    return highestLevel;
+}
+
 void
     TFSPackager::package( FeatureSource* features, const std::string& destination, const std::string& layername, const std::string& description )
 {   
@@ -323,67 +700,75 @@ void
     osg::ref_ptr< const osgEarth::Profile > profile = osgEarth::Profile::create(extent.getSRS(), extent.xMin(), extent.yMin(), extent.xMax(), extent.yMax(), 1, 1);
 
 
-    TileKey rootKey = TileKey(0, 0, 0, profile );    
-
-
-    osg::ref_ptr< FeatureTile > root = new FeatureTile( rootKey );
-    //Loop through all the features and try to insert them into the quadtree
-    osg::ref_ptr< FeatureCursor > cursor = features->createFeatureCursor( _query );
-    int added = 0;
-    int failed = 0;
-    int skipped = 0;
     int highestLevel = 0;
 
-    while (cursor.valid() && cursor->hasMore())
-    {        
-        osg::ref_ptr< Feature > feature = cursor->nextFeature();
+    if (_bulk)
+    {
+        highestLevel = packageBulk( features, profile.get(), destination );
+    }
+    else
+    {
+        TileKey rootKey = TileKey(0, 0, 0, profile );    
 
-        //Reproject the feature to the dest SRS if it's not already
-        if (!feature->getSRS()->isEquivalentTo( _srs ) )
-        {
-            feature->transform( _srs );
-        }
 
-        if (feature->getGeometry() && feature->getGeometry()->getBounds().valid() && feature->getGeometry()->isValid())
-        {
+        osg::ref_ptr< FeatureTile > root = new FeatureTile( rootKey );
+        //Loop through all the features and try to insert them into the quadtree
+        osg::ref_ptr< FeatureCursor > cursor = features->createFeatureCursor( _query );
+        int added = 0;
+        int failed = 0;
+        int skipped = 0;
+
+        while (cursor.valid() && cursor->hasMore())
+        {        
+            osg::ref_ptr< Feature > feature = cursor->nextFeature();
 
-            AddFeatureVisitor v(feature.get(), _maxFeatures, _firstLevel, _maxLevel, _method);
-            root->accept( &v );
-            if (!v._added)
+            //Reproject the feature to the dest SRS if it's not already
+            if (!feature->getSRS()->isEquivalentTo( _srs ) )
             {
-                OE_NOTICE << "Failed to add feature " << feature->getFID() << std::endl;
-                failed++;
+                feature->transform( _srs );
             }
-            else
-            {                
-                if (highestLevel < v._levelAdded)
+
+            if (feature->getGeometry() && feature->getGeometry()->getBounds().valid() && feature->getGeometry()->isValid())
+            {
+
+                AddFeatureVisitor v(feature.get(), _maxFeatures, _firstLevel, _maxLevel, _method);
+                root->accept( &v );
+                if (!v._added)
                 {
-                    highestLevel = v._levelAdded;
+                    OE_NOTICE << "Failed to add feature " << feature->getFID() << std::endl;
+                    failed++;
                 }
-                added++;
-                OE_DEBUG << "Added " << added << std::endl;
-            }   
-        }
-        else
-        {
-            OE_NOTICE << "Skipping feature " << feature->getFID() << " with null or invalid geometry" << std::endl;
-            skipped++;
-        }
-    }   
-    OE_NOTICE << "Added=" << added << " Skipped=" << skipped << " Failed=" << failed << std::endl;
+                else
+                {                
+                    if (highestLevel < v._levelAdded)
+                    {
+                        highestLevel = v._levelAdded;
+                    }
+                    added++;
+                    OE_DEBUG << "Added " << added << std::endl;
+                }   
+            }
+            else
+            {
+                OE_NOTICE << "Skipping feature " << feature->getFID() << " with null or invalid geometry" << std::endl;
+                skipped++;
+            }
+        }   
+        OE_NOTICE << "Added=" << added << " Skipped=" << skipped << " Failed=" << failed << std::endl;
 
 #if 1
-    // Print the width of tiles at each level
-    for (int i = 0; i <= highestLevel; ++i)
-    {
-        TileKey tileKey(i, 0, 0, profile);
-        GeoExtent tileExtent = tileKey.getExtent();
-        OE_NOTICE << "Level " << i << " tile size: " << tileExtent.width() << std::endl;
-    }
+        // Print the width of tiles at each level
+        for (int i = 0; i <= highestLevel; ++i)
+        {
+            TileKey tileKey(i, 0, 0, profile);
+            GeoExtent tileExtent = tileKey.getExtent();
+            OE_NOTICE << "Level " << i << " tile size: " << tileExtent.width() << std::endl;
+        }
 #endif
 
-    WriteFeaturesVisitor write(features, destination, _method, _srs);
-    root->accept( &write );
+        WriteFeaturesVisitor write(features, destination, _method, _srs);
+        root->accept( &write );
+    }
 
     //Write out the meta doc
     TFSLayer layer;
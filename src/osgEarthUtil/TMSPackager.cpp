@@ -28,6 +28,13 @@
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
 #include <osgDB/WriteFile>
+#include <osgDB/Registry>
+#include <OpenThreads/Condition>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
 
 
 #define LC "[TMSPackager] "
@@ -35,6 +42,302 @@
 using namespace osgEarth::Util;
 using namespace osgEarth;
 
+/*****************************************************************************************************/
+
+namespace osgEarth { namespace Util
+{
+    /**
+     * Three-stage tile pipeline: tiles generated by the TileVisitor are
+     * handed to a pool of encode threads, and the encoded bytes go to a
+     * single writer thread. Both stages have bounded queues, so a fast
+     * generator blocks instead of piling up images in memory. Writers that
+     * cannot encode to a stream write their file from the encode thread.
+     */
+    class TMSPackager::Pipeline : public osg::Referenced
+    {
+    public:
+        struct Tile
+        {
+            TileKey                  _key;
+            osg::ref_ptr<osg::Image> _image;
+            std::string              _path;
+            std::string              _data;
+        };
+
+        Pipeline(TMSPackager* packager, unsigned numEncodeThreads, unsigned maxQueued) :
+            _tileSource( packager->getTileSource() ),
+            _options   ( packager->getOptions() ),
+            _pending   ( 0 ),
+            _written   ( 0 ),
+            _failed    ( 0 ),
+            _streamable( true )
+        {
+            _rw = osgDB::Registry::instance()->getReaderWriterForExtension( packager->getExtension() );
+            if ( !_rw.valid() && !_tileSource.valid() )
+            {
+                OE_WARN << LC << "No plugin found to write \"" << packager->getExtension() << "\" tiles" << std::endl;
+            }
+
+            if ( numEncodeThreads > 0 )
+            {
+                _encodeService = new TaskService( "TMSPackager encode", numEncodeThreads, maxQueued );
+                _writeService  = new TaskService( "TMSPackager write", 1, maxQueued );
+            }
+        }
+
+        /**
+         * Queues a generated tile; runs inline if there are no encode threads.
+         * Returns false if the tile ran inline and failed to encode or write.
+         */
+        bool push(const TileKey& key, osg::Image* image, const std::string& path)
+        {
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                ++_pending;
+            }
+
+            Tile tile;
+            tile._key   = key;
+            tile._image = image;
+            tile._path  = path;
+
+            if ( _encodeService.valid() )
+            {
+                _encodeService->add( new EncodeTask(this, tile) );
+                return true;
+            }
+
+            unsigned failed = getNumFailed();
+            encode( tile );
+            return getNumFailed() == failed;
+        }
+
+        /** Blocks until every queued tile has been written, and returns the number written. */
+        unsigned finish()
+        {
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                while( _pending > 0 )
+                    _done.wait( &_mutex );
+            }
+
+            _encodeService = 0L;
+            _writeService  = 0L;
+
+            if ( _failed > 0 )
+            {
+                OE_WARN << LC << _failed << " tiles failed to write" << std::endl;
+            }
+            return _written;
+        }
+
+        unsigned getNumFailed()
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            return _failed;
+        }
+
+        /** Keys of the tiles that failed to encode or write. */
+        const TileKeyList& getFailedKeys() const { return _failedKeys; }
+
+    private:
+        struct EncodeTask : public TaskRequest
+        {
+            EncodeTask(Pipeline* pipeline, const Tile& tile) : _pipeline(pipeline), _tile(tile) { }
+            void operator()(ProgressCallback* progress) { _pipeline->encode(_tile); }
+            osg::ref_ptr<Pipeline> _pipeline;
+            Tile                   _tile;
+        };
+
+        struct WriteTask : public TaskRequest
+        {
+            WriteTask(Pipeline* pipeline, const Tile& tile) : _pipeline(pipeline), _tile(tile) { }
+            void operator()(ProgressCallback* progress) { _pipeline->write(_tile); }
+            osg::ref_ptr<Pipeline> _pipeline;
+            Tile                   _tile;
+        };
+
+        void encode(Tile& tile)
+        {
+            // A TileSource does its own encoding when it stores the image.
+            if ( !_tileSource.valid() )
+            {
+                bool toFile = false;
+                if ( !encodeImage(tile, toFile) )
+                {
+                    finished( tile, false );
+                    return;
+                }
+
+                // The plugin can only write to a file, so encode and write here.
+                if ( toFile )
+                {
+                    makeFolder( tile._path );
+                    bool ok = osgDB::writeImageFile( *tile._image.get(), tile._path, _options.get() );
+                    if ( !ok )
+                    {
+                        OE_WARN << LC << "Failed to write " << tile._path << std::endl;
+                        ::remove( tile._path.c_str() );
+                    }
+                    finished( tile, ok );
+                    return;
+                }
+
+                tile._image = 0L;
+            }
+
+            if ( _writeService.valid() )
+                _writeService->add( new WriteTask(this, tile) );
+            else
+                write( tile );
+        }
+
+        bool encodeImage(Tile& tile, bool& toFile)
+        {
+            // Some writers (GDAL's, for one) only write to a named file.
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                if ( !_rw.valid() || !_streamable )
+                {
+                    toFile = true;
+                    return true;
+                }
+            }
+
+            const osg::Image* image = tile._image.get();
+
+            // Single-color tiles (ocean, nodata fill) are common and always encode
+            // to the same bytes, so encode each distinct one only once.
+            std::string colorKey;
+            if ( image->data() && ImageUtils::isSingleColorImage(image, 0.0f) )
+            {
+                colorKey = Stringify()
+                    << image->s() << "x" << image->t() << "x" << image->r()
+                    << ":" << image->getPixelFormat() << ":" << image->getDataType() << ":"
+                    << std::string( (const char*)image->data(), image->getPixelSizeInBits()/8 );
+
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                std::map<std::string, std::string>::const_iterator i = _singleColorTiles.find( colorKey );
+                if ( i != _singleColorTiles.end() )
+                {
+                    tile._data = i->second;
+                    return true;
+                }
+            }
+
+            std::stringstream buf;
+            osgDB::ReaderWriter::WriteResult wr = _rw->writeImage( *image, buf, _options.get() );
+            if ( wr.status() == osgDB::ReaderWriter::WriteResult::NOT_IMPLEMENTED ||
+                 wr.status() == osgDB::ReaderWriter::WriteResult::FILE_NOT_HANDLED )
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                _streamable = false;
+                toFile = true;
+                return true;
+            }
+            else if ( !wr.success() )
+            {
+                OE_WARN << LC << "Failed to encode tile " << tile._key.str() << ": " << wr.message() << std::endl;
+                return false;
+            }
+            tile._data = buf.str();
+
+            if ( !colorKey.empty() )
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                _singleColorTiles[colorKey] = tile._data;
+            }
+            return true;
+        }
+
+        void write(Tile& tile)
+        {
+            bool ok = false;
+
+            if ( _tileSource.valid() )
+            {
+                ok = _tileSource->storeImage( tile._key, tile._image.get(), 0L );
+                if ( !ok )
+                {
+                    OE_WARN << LC << "Failed to store tile " << tile._key.str() << std::endl;
+                }
+            }
+            else
+            {
+                makeFolder( tile._path );
+
+                {
+                    std::ofstream out( tile._path.c_str(), std::ios::out | std::ios::binary );
+                    if ( out.is_open() )
+                    {
+                        out.write( tile._data.c_str(), tile._data.size() );
+                        out.close();
+                        ok = !out.fail();
+                    }
+                }
+                if ( !ok )
+                {
+                    OE_WARN << LC << "Failed to write " << tile._path << std::endl;
+
+                    // don't leave a partial tile behind for a non-overwriting rerun to skip
+                    ::remove( tile._path.c_str() );
+                }
+            }
+
+            finished( tile, ok );
+        }
+
+        /** Creates the folder for a tile path, hitting the file system only once per folder. */
+        void makeFolder(const std::string& path)
+        {
+            std::string folder = osgDB::getFilePath( path );
+            bool create = false;
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                create = _folders.insert( folder ).second;
+            }
+            if ( create )
+            {
+                osgDB::makeDirectory( folder );
+            }
+        }
+
+        void finished(const Tile& tile, bool ok)
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            if ( ok )
+            {
+                ++_written;
+            }
+            else
+            {
+                ++_failed;
+                _failedKeys.push_back( tile._key );
+            }
+            --_pending;
+            _done.broadcast();
+        }
+
+        osg::ref_ptr<TileSource>              _tileSource;
+        osg::ref_ptr<osgDB::Options>          _options;
+        osg::ref_ptr<osgDB::ReaderWriter>     _rw;
+        osg::ref_ptr<TaskService>             _encodeService;
+        osg::ref_ptr<TaskService>             _writeService;
+
+        OpenThreads::Mutex                    _mutex;
+        OpenThreads::Condition                _done;
+        unsigned                              _pending;
+        unsigned                              _written;
+        unsigned                              _failed;
+        bool                                  _streamable;
+        TileKeyList                           _failedKeys;
+        std::set<std::string>                 _folders;
+        std::map<std::string, std::string>    _singleColorTiles;
+    };
+} }
+
+/*****************************************************************************************************/
+
 WriteTMSTileHandler::WriteTMSTileHandler(TerrainLayer* layer,  Map* map, TMSPackager* packager):
     _layer( layer ),
     _map(map),
@@ -114,18 +417,8 @@ bool WriteTMSTileHandler::handleTile(const TileKey& key, const TileVisitor& tv)
                 final = ImageUtils::convertToRGB8( final );
             }
 
-            // use the TileSource provided if set, else use writeImageFile
-            if (tileSource)
-            {
-                tileSource->storeImage(key, final.get(), 0L);
-                return true;
-            }
-            else
-            {
-                // attempt to create the output folder:
-                osgEarth::makeDirectoryForFile( path );
-                return osgDB::writeImageFile(*final, path, _packager->getOptions());
-            }
+            // hand off to the encode/write pipeline
+            return _packager->writeTile(key, final.get(), path);
         }
     }
     else if (elevationLayer )
@@ -137,18 +430,8 @@ bool WriteTMSTileHandler::handleTile(const TileKey& key, const TileVisitor& tv)
             ImageToHeightFieldConverter conv;
             osg::ref_ptr< osg::Image > image = conv.convert( hf.getHeightField(), _packager->getElevationPixelDepth() );
 
-            // use the TileSource provided if set, else use writeImageFile
-            if (tileSource)
-            {
-                tileSource->storeImage(key, image.get(), 0L);
-                return true;
-            }
-            else
-            {
-                // attempt to create the output folder:
-                osgEarth::makeDirectoryForFile( path );
-                return osgDB::writeImageFile(*image.get(), path, _packager->getOptions());
-            }
+            // hand off to the encode/write pipeline
+            return _packager->writeTile(key, image.get(), path);
         }
     }
 
@@ -240,8 +523,16 @@ _visitor(new TileVisitor()),
     _overwrite(false),
     _keepEmpties(false),
     _applyAlphaMask(false),
-    _tileSource(0L)
+    _tileSource(0L),
+    _numEncodeThreads(OpenThreads::GetNumberOfProcessors()),
+    _maxQueuedTiles(64),
+    _numTilesWritten(0)
+{
+}
+
+TMSPackager::~TMSPackager()
 {
+    //nop
 }
 
 const std::string& TMSPackager::getDestination() const
@@ -334,6 +625,50 @@ void TMSPackager::setApplyAlphaMask(bool applyAlphaMask)
     _applyAlphaMask = applyAlphaMask;
 }
 
+unsigned TMSPackager::getNumEncodeThreads() const
+{
+    return _numEncodeThreads;
+}
+
+void TMSPackager::setNumEncodeThreads(unsigned value)
+{
+    _numEncodeThreads = value;
+}
+
+unsigned TMSPackager::getMaxQueuedTiles() const
+{
+    return _maxQueuedTiles;
+}
+
+void TMSPackager::setMaxQueuedTiles(unsigned value)
+{
+    _maxQueuedTiles = std::max(value, 1u);
+}
+
+unsigned TMSPackager::getNumTilesWritten() const
+{
+    return _numTilesWritten;
+}
+
+unsigned TMSPackager::getNumTilesFailed() const
+{
+    return _failedTiles.size();
+}
+
+const TileKeyList& TMSPackager::getFailedTiles() const
+{
+    return _failedTiles;
+}
+
+bool TMSPackager::writeTile( const TileKey& key, osg::Image* image, const std::string& path )
+{
+    if (_pipeline.valid() && image)
+    {
+        return _pipeline->push(key, image, path);
+    }
+    return false;
+}
+
 TileVisitor* TMSPackager::getTileVisitor() const
 {
     return _visitor;
@@ -431,9 +766,16 @@ void TMSPackager::run( TerrainLayer* layer,  Map* map  )
     }
 
 
+    _pipeline = new Pipeline(this, _numEncodeThreads, _maxQueuedTiles);
+
     _handler = new WriteTMSTileHandler(layer, map, this);
     _visitor->setTileHandler( _handler );
     _visitor->run( map->getProfile() );
+
+    // wait for the encoders and the writer to drain
+    _numTilesWritten = _pipeline->finish();
+    _failedTiles = _pipeline->getFailedKeys();
+    _pipeline = 0L;
 }
 
 void TMSPackager::writeXML(TerrainLayer* layer, Map* map)
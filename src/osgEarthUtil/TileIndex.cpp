@@ -26,7 +26,10 @@
 #include <osgEarthDrivers/feature_ogr/OGRFeatureOptions>
 #include <ogr_api.h>
 #include <osgEarthFeatures/OgrUtils>
+#include <osgEarth/BinaryFile>
 #include <osgDB/FileUtils>
+#include <algorithm>
+#include <string.h>
 
 using namespace osgEarth;
 using namespace osgEarth::Util;
@@ -36,6 +39,20 @@ using namespace std;
 
 #define OGR_SCOPED_LOCK GDAL_SCOPED_LOCK
 
+#define LC "[TileIndex] "
+
+namespace
+{
+    // Compact index layout; all values are big-endian.
+    //   header:  BinaryFile header, then entry count and string table size (u32)
+    //   records: xmin, ymin, xmax, ymax, modified time (f64), then path offset and length (u32)
+    //   strings: the paths, back to back
+    const char     COMPACT_MAGIC[8] = { 'O', 'E', 'T', 'I', 'D', 'X', '\0', '\0' };
+    const unsigned COMPACT_VERSION  = 1u;
+    const unsigned HEADER_SIZE      = 20u;
+    const unsigned RECORD_SIZE      = 48u;
+}
+
 TileIndex::TileIndex()
 {
 }
@@ -53,6 +70,24 @@ TileIndex::load(const std::string& filename)
         return 0;
     }
 
+    if (isCompact( filename ))
+    {
+        osg::ref_ptr<TileIndex> index = new TileIndex();
+        if (!readCompact( filename, index->_entries ))
+        {
+            return 0L;
+        }
+
+        for (unsigned i = 0; i < index->_entries.size(); ++i)
+        {
+            const Entry& e = index->_entries[i];
+            index->_tree.insert( PackedRTree::Box(e._xmin, e._ymin, e._xmax, e._ymax), i );
+        }
+        index->_tree.build();
+        index->_filename = filename;
+        return index.release();
+    }
+
     //Load up an index file
     OGRFeatureOptions featureOpt;
     featureOpt.url() = filename;        
@@ -109,10 +144,128 @@ TileIndex::create( const std::string& filename, const osgEarth::SpatialReference
 }
 
 
+bool
+TileIndex::isCompact(const std::string& filename)
+{
+    return BinaryFile::hasMagic( filename, COMPACT_MAGIC );
+}
+
+bool
+TileIndex::writeCompact(const std::string& filename, const EntryVector& entries)
+{
+    unsigned stringsSize = 0u;
+    for (unsigned i = 0; i < entries.size(); ++i)
+        stringsSize += entries[i]._filename.size();
+
+    // assemble the whole file and write it at once.
+    std::vector<char> buf( HEADER_SIZE + RECORD_SIZE*entries.size() + stringsSize );
+    BinaryFile::putHeader( &buf[0], COMPACT_MAGIC, COMPACT_VERSION );
+    BinaryFile::putU32( &buf[12], entries.size() );
+    BinaryFile::putU32( &buf[16], stringsSize );
+
+    char* record = &buf[HEADER_SIZE];
+    unsigned stringsStart = HEADER_SIZE + RECORD_SIZE*entries.size();
+    unsigned offset = 0u;
+    for (unsigned i = 0; i < entries.size(); ++i, record += RECORD_SIZE)
+    {
+        const Entry& e = entries[i];
+        BinaryFile::putF64( record,      e._xmin );
+        BinaryFile::putF64( record + 8,  e._ymin );
+        BinaryFile::putF64( record + 16, e._xmax );
+        BinaryFile::putF64( record + 24, e._ymax );
+        BinaryFile::putF64( record + 32, (double)e._modified );
+        BinaryFile::putU32( record + 40, offset );
+        BinaryFile::putU32( record + 44, e._filename.size() );
+
+        if ( !e._filename.empty() )
+            memcpy( &buf[stringsStart + offset], e._filename.data(), e._filename.size() );
+        offset += e._filename.size();
+    }
+
+    if ( !BinaryFile::write( filename, buf ) )
+    {
+        OE_WARN << LC << "Failed to write " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool
+TileIndex::readCompact(const std::string& filename, EntryVector& out_entries)
+{
+    out_entries.clear();
+
+    // read the whole file in one go; the layout needs no parsing.
+    std::vector<char> buf;
+    unsigned version;
+    if ( !BinaryFile::read( filename, buf, HEADER_SIZE ) ||
+         !BinaryFile::getHeader( buf, COMPACT_MAGIC, version ) )
+        return false;
+
+    unsigned count       = BinaryFile::getU32( &buf[12] );
+    unsigned stringsSize = BinaryFile::getU32( &buf[16] );
+
+    if ( version != COMPACT_VERSION )
+    {
+        OE_WARN << LC << filename << " has unsupported version " << version << std::endl;
+        return false;
+    }
+
+    unsigned stringsStart = HEADER_SIZE + RECORD_SIZE*count;
+    if ( (double)stringsStart + (double)stringsSize != (double)buf.size() )
+    {
+        OE_WARN << LC << filename << " is truncated or corrupt" << std::endl;
+        return false;
+    }
+
+    out_entries.resize( count );
+    const char* record = &buf[HEADER_SIZE];
+    for (unsigned i = 0; i < count; ++i, record += RECORD_SIZE)
+    {
+        Entry& e = out_entries[i];
+        e._xmin     = BinaryFile::getF64( record );
+        e._ymin     = BinaryFile::getF64( record + 8 );
+        e._xmax     = BinaryFile::getF64( record + 16 );
+        e._ymax     = BinaryFile::getF64( record + 24 );
+        e._modified = (TimeStamp)BinaryFile::getF64( record + 32 );
+
+        unsigned offset = BinaryFile::getU32( record + 40 );
+        unsigned length = BinaryFile::getU32( record + 44 );
+        if ( (double)offset + (double)length > (double)stringsSize )
+        {
+            OE_WARN << LC << filename << " is corrupt" << std::endl;
+            out_entries.clear();
+            return false;
+        }
+        e._filename.assign( &buf[stringsStart + offset], length );
+    }
+
+    return true;
+}
+
 void
 TileIndex::getFiles(const osgEarth::GeoExtent& extent, std::vector< std::string >& files)
 {            
     files.clear();
+
+    if ( !_features.valid() )
+    {
+        // compact index; entries are in WGS84.
+        GeoExtent transformed = extent.transform( SpatialReference::get("wgs84") );
+        Bounds b = transformed.bounds();
+
+        std::vector<unsigned> ids;
+        _tree.query( PackedRTree::Box(b.xMin(), b.yMin(), b.xMax(), b.yMax()), ids );
+
+        // keep the order the files were indexed in, like the shapefile does.
+        std::sort( ids.begin(), ids.end() );
+        for (unsigned i = 0; i < ids.size(); ++i)
+        {
+            files.push_back( getFullPath(_filename, _entries[ids[i]]._filename) );
+        }
+        return;
+    }
+
     osgEarth::Symbology::Query query;    
 
     GeoExtent transformed = extent.transform( _features->getFeatureProfile()->getSRS() );
@@ -132,6 +285,12 @@ TileIndex::getFiles(const osgEarth::GeoExtent& extent, std::vector< std::string
 
 bool TileIndex::add( const std::string& filename, const GeoExtent& extent )
 {       
+    if ( !_features.valid() )
+    {
+        OE_WARN << LC << "Cannot add to a compact index" << std::endl;
+        return false;
+    }
+
     osg::ref_ptr< Polygon > polygon = new Polygon();
     polygon->push_back( osg::Vec3d(extent.bounds().xMin(), extent.bounds().yMin(), 0) );
     polygon->push_back( osg::Vec3d(extent.bounds().xMax(), extent.bounds().yMin(), 0) );
@@ -24,19 +24,162 @@
 #include <osgEarth/Registry>
 #include <osgEarth/FileUtils>
 #include <osgEarth/Progress>
-#include <osgEarth/ImageLayer>
-#include <osgEarthDrivers/gdal/GDALOptions>
+#include <osgEarth/TaskService>
+#include <osgEarth/ThreadingUtils>
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
+#include <OpenThreads/Thread>
+#include <gdal.h>
+#include <cpl_error.h>
+#include <cfloat>
+#include <map>
+#include <sstream>
+
+#define LC "[TileIndexBuilder] "
 
 using namespace osgDB;
 using namespace osgEarth;
 using namespace osgEarth::Util;
-using namespace osgEarth::Drivers;
 using namespace osgEarth::Features;
 using namespace std;
 
-TileIndexBuilder::TileIndexBuilder()
+namespace
+{
+    // Reads the extent of one raster from its header, in WGS84. GDAL is
+    // safe to use from several threads as long as each one has its own
+    // dataset handle, so this does not take the global GDAL lock.
+    bool scanFile(const std::string& filename, TileIndex::Entry& entry)
+    {
+        // skip files GDAL can't read without filling the console with errors
+        CPLPushErrorHandler( CPLQuietErrorHandler );
+        GDALDatasetH ds = GDALOpen( filename.c_str(), GA_ReadOnly );
+        CPLPopErrorHandler();
+
+        if ( !ds )
+            return false;
+
+        double gt[6];
+        bool ok = GDALGetGeoTransform( ds, gt ) == CE_None;
+        const char* proj = GDALGetProjectionRef( ds );
+        std::string wkt = proj ? proj : "";
+        double w = (double)GDALGetRasterXSize( ds );
+        double h = (double)GDALGetRasterYSize( ds );
+        GDALClose( ds );
+
+        if ( !ok || wkt.empty() )
+            return false;
+
+        // corners of the raster, which may be rotated:
+        double px[4] = { 0.0, w, 0.0, w };
+        double py[4] = { 0.0, 0.0, h, h };
+        double xmin = DBL_MAX, ymin = DBL_MAX, xmax = -DBL_MAX, ymax = -DBL_MAX;
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            double x = gt[0] + px[i]*gt[1] + py[i]*gt[2];
+            double y = gt[3] + px[i]*gt[4] + py[i]*gt[5];
+            xmin = osg::minimum(xmin, x); xmax = osg::maximum(xmax, x);
+            ymin = osg::minimum(ymin, y); ymax = osg::maximum(ymax, y);
+        }
+
+        osg::ref_ptr<SpatialReference> srs = SpatialReference::create( wkt );
+        if ( !srs.valid() )
+            return false;
+
+        GeoExtent extent = GeoExtent( srs.get(), xmin, ymin, xmax, ymax ).transform( SpatialReference::get("wgs84") );
+        if ( !extent.isValid() )
+            return false;
+
+        entry._xmin = extent.xMin();
+        entry._ymin = extent.yMin();
+        entry._xmax = extent.xMax();
+        entry._ymax = extent.yMax();
+        return true;
+    }
+
+    // Hands out runs of files to scan to the pool threads and the calling thread.
+    struct ScanQueue
+    {
+        ScanQueue() : next(0u), done(0u), canceled(false) { }
+
+        bool take(unsigned& begin, unsigned& end)
+        {
+            Threading::ScopedMutexLock lock( mutex );
+            if ( canceled || next >= indices->size() )
+                return false;
+            begin = next;
+            end = osg::minimum( next + RUN_SIZE, (unsigned)indices->size() );
+            next = end;
+            return true;
+        }
+
+        void finish(unsigned count)
+        {
+            Threading::ScopedMutexLock lock( mutex );
+            done += count;
+        }
+
+        unsigned getDone()
+        {
+            Threading::ScopedMutexLock lock( mutex );
+            return done;
+        }
+
+        void cancel()
+        {
+            Threading::ScopedMutexLock lock( mutex );
+            canceled = true;
+        }
+
+        static const unsigned RUN_SIZE = 16u;
+
+        const std::vector<std::string>* filenames;
+        const std::vector<unsigned>*    indices;
+        TileIndex::EntryVector*         entries;
+        std::vector<bool>*              ok;
+        Threading::Mutex                mutex;
+        unsigned                        next, done;
+        bool                            canceled;
+    };
+
+    // Scans runs of files until the queue is empty.
+    struct ScanFiles
+    {
+        ScanFiles() : queue(0L) { }
+
+        void execute()
+        {
+            unsigned begin, end;
+            while ( queue->take(begin, end) )
+            {
+                scanRun( begin, end );
+            }
+        }
+
+        void scanRun(unsigned begin, unsigned end)
+        {
+            for (unsigned i = begin; i < end; ++i)
+            {
+                unsigned k = (*queue->indices)[i];
+                bool ok = scanFile( (*queue->filenames)[k], (*queue->entries)[k] );
+
+                // vector<bool> packs bits, so writes need the lock.
+                Threading::ScopedMutexLock lock( queue->mutex );
+                (*queue->ok)[k] = ok;
+            }
+            queue->finish( end - begin );
+        }
+
+        ScanQueue* queue;
+    };
+
+    typedef ParallelTask<ScanFiles> ScanFilesTask;
+}
+
+TileIndexBuilder::TileIndexBuilder() :
+_numThreads( OpenThreads::GetNumberOfProcessors() ),
+_numScanned( 0u ),
+_numReused ( 0u ),
+_numSkipped( 0u )
 {
 }
 
@@ -47,68 +190,162 @@ void TileIndexBuilder::setProgressCallback( osgEarth::ProgressCallback* progress
 
 void TileIndexBuilder::build(const std::string& indexFilename, const osgEarth::SpatialReference* srs)
 {
+    // Make sure the registry is loaded since that is where the OGR/GDAL registration happens
+    osgEarth::Registry::instance();
+
     expandFilenames();
 
-    if (!srs)
+    _indexFilename = indexFilename;
+    std::string indexDir = getFilePath( _indexFilename );    
+
+    bool compact = !osgDB::equalCaseInsensitive( osgDB::getFileExtension(indexFilename), "shp" );
+
+    // When updating a compact index, remember what it already knows.
+    std::map<std::string, TileIndex::Entry> previous;
+    if ( compact && osgDB::fileExists(indexFilename) )
     {
-        srs = osgEarth::SpatialReference::create("wgs84");
+        TileIndex::EntryVector entries;
+        if ( TileIndex::readCompact(indexFilename, entries) )
+        {
+            for (unsigned i = 0; i < entries.size(); ++i)
+                previous[entries[i]._filename] = entries[i];
+        }
+        else
+        {
+            OE_WARN << LC << indexFilename << " is not a compact index; rebuilding it" << std::endl;
+        }
     }
 
-    osg::ref_ptr< osgEarth::Util::TileIndex > index = osgEarth::Util::TileIndex::create( indexFilename, srs );
-
-    _indexFilename = indexFilename;
-    std::string indexDir = getFilePath( _indexFilename );    
-    
     unsigned int total = _expandedFilenames.size();
 
-    for (unsigned int i = 0; i < _expandedFilenames.size(); i++)
+    TileIndex::EntryVector entries( total );
+    std::vector<bool> ok( total, false );
+    std::vector<unsigned> toScan;
+
+    _numReused = 0u;
+    for (unsigned int i = 0; i < total; i++)
     {   
         std::string filename = _expandedFilenames[ i ];        
 
-        GDALOptions opt;
-        opt.url() = filename;
-        
-        osg::ref_ptr< ImageLayer > layer = new ImageLayer( ImageLayerOptions("", opt) );        
+        // We want the filename as it is relative to the index file                
+        entries[i]._filename = getPathRelative( indexDir, filename );
+        entries[i]._modified = getLastModifiedTime( filename );
 
-        bool ok = false;
-                
-        if ( layer.valid() )        
-        {            
-            osg::ref_ptr< TileSource > source = layer->getTileSource();
-            if (source.valid())
+        std::map<std::string, TileIndex::Entry>::const_iterator p = previous.find( entries[i]._filename );
+        if ( p != previous.end() && p->second._modified == entries[i]._modified )
+        {
+            entries[i] = p->second;
+            ok[i] = true;
+            ++_numReused;
+        }
+        else
+        {
+            toScan.push_back( i );
+        }
+    }
+
+    scanFiles( toScan, entries, ok );
+
+    _numScanned = 0u;
+    for (unsigned i = 0; i < toScan.size(); ++i)
+        if ( ok[toScan[i]] )
+            ++_numScanned;
+    _numSkipped = total - _numScanned - _numReused;
+
+    if ( _progress.valid() && _progress->isCanceled() )
+        return;
+
+    if ( compact )
+    {
+        TileIndex::EntryVector indexed;
+        indexed.reserve( total - _numSkipped );
+        for (unsigned i = 0; i < total; ++i)
+            if ( ok[i] )
+                indexed.push_back( entries[i] );
+
+        TileIndex::writeCompact( indexFilename, indexed );
+    }
+    else
+    {
+        if (!srs)
+        {
+            srs = osgEarth::SpatialReference::create("wgs84");
+        }
+
+        osg::ref_ptr< osgEarth::Util::TileIndex > index = osgEarth::Util::TileIndex::create( indexFilename, srs );
+        if ( !index.valid() )
+            return;
+
+        const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+        for (unsigned i = 0; i < total; ++i)
+        {
+            if ( ok[i] )
             {
-                for (DataExtentList::iterator itr = source->getDataExtents().begin(); itr != source->getDataExtents().end(); ++itr)
-                {
-                    // We want the filename as it is relative to the index file                
-                    std::string relative = getPathRelative( indexDir, filename );                
-                    index->add( relative, *itr);    
-                    ok = true;
-                }                
+                const TileIndex::Entry& e = entries[i];
+                index->add( e._filename, GeoExtent(wgs84, e._xmin, e._ymin, e._xmax, e._ymax) );
             }
-        }        
+        }
+    }
+
+    OE_INFO << LC << "Indexed " << (_numScanned + _numReused) << " files (" << _numScanned << " read, "
+        << _numReused << " unchanged), skipped " << _numSkipped << std::endl;
+}
+
+void TileIndexBuilder::scanFiles(const std::vector<unsigned>& indices, TileIndex::EntryVector& entries, std::vector<bool>& ok)
+{
+    if ( indices.empty() )
+        return;
+
+    ScanQueue queue;
+    queue.filenames = &_expandedFilenames;
+    queue.indices = &indices;
+    queue.entries = &entries;
+    queue.ok = &ok;
+
+    // The pool threads drain the queue; this thread helps, and reports progress as it goes.
+    unsigned numTasks = osg::minimum( osg::maximum(_numThreads, 1u) - 1u, (unsigned)indices.size() / ScanQueue::RUN_SIZE );
+    osg::ref_ptr<TaskService> service = numTasks > 0u ? new TaskService( "TileIndexBuilder", numTasks ) : 0L;
+    Threading::MultiEvent done( numTasks );
+    std::vector< osg::ref_ptr<ScanFilesTask> > tasks;
 
-        if (_progress.valid())
+    for (unsigned i = 0; i < numTasks; ++i)
+    {
+        ScanFilesTask* task = new ScanFilesTask();
+        task->queue = &queue;
+        task->_mev = &done;
+        tasks.push_back( task );
+        service->add( task );
+    }
+
+    ScanFiles local;
+    local.queue = &queue;
+    unsigned begin, end;
+    while ( queue.take(begin, end) )
+    {
+        local.scanRun( begin, end );
+
+        if ( _progress.valid() )
         {
             std::stringstream buf;
-            if (ok)
-            {
-                buf << "Processed ";
-            }
-            else
+            buf << "Processed " << _expandedFilenames[indices[end-1]];
+            if ( _progress->reportProgress((double)queue.getDone(), (double)indices.size(), buf.str()) ||
+                 _progress->isCanceled() )
             {
-                buf << "Skipped ";
+                queue.cancel();
             }
-
-            buf << filename;
-            _progress->reportProgress( (double)i+1, (double)total, buf.str() );
         }
     }
 
-    osg::Timer_t end = osg::Timer::instance()->tick();    
+    if ( numTasks > 0u )
+    {
+        done.wait();
+    }
 }
 
 void TileIndexBuilder::expandFilenames()
 {
+    _expandedFilenames.clear();
+
     // Expand the filenames since they might contain directories    
     for (unsigned int i = 0; i < _filenames.size(); i++)
     {
@@ -128,4 +365,3 @@ void TileIndexBuilder::expandFilenames()
         }
     }
 }
-
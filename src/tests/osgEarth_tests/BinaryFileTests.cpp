@@ -0,0 +1,84 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/BinaryFile>
+#include <stdio.h>
+
+using namespace osgEarth;
+
+TEST_CASE( "BinaryFile encodes big-endian values" ) {
+
+    char buf[12];
+    BinaryFile::putU32(buf, 0x01020304u);
+    REQUIRE(buf[0] == 0x01);
+    REQUIRE(buf[3] == 0x04);
+    REQUIRE(BinaryFile::getU32(buf) == 0x01020304u);
+
+    BinaryFile::putF64(buf + 4, -1234.5678);
+    REQUIRE(BinaryFile::getF64(buf + 4) == -1234.5678);
+}
+
+TEST_CASE( "BinaryFile writes and reads whole files" ) {
+
+    const std::string filename = "osgEarth_tests_binaryfile.bin";
+    const char magic[8] = { 'O', 'E', 'T', 'E', 'S', 'T', '\0', '\0' };
+
+    std::vector<char> buf(BinaryFile::HEADER_SIZE + 4u);
+    BinaryFile::putHeader(&buf[0], magic, 3u);
+    BinaryFile::putU32(&buf[BinaryFile::HEADER_SIZE], 42u);
+    REQUIRE(BinaryFile::write(filename, buf));
+    REQUIRE(BinaryFile::hasMagic(filename, magic));
+
+    SECTION("contents read back unchanged") {
+        std::vector<char> read;
+        unsigned version = 0u;
+        REQUIRE(BinaryFile::read(filename, read));
+        REQUIRE(read == buf);
+        REQUIRE(BinaryFile::getHeader(read, magic, version));
+        REQUIRE(version == 3u);
+        REQUIRE(BinaryFile::getU32(&read[BinaryFile::HEADER_SIZE]) == 42u);
+    }
+
+    SECTION("other magic strings are rejected") {
+        const char other[8] = { 'O', 'E', 'O', 'T', 'H', 'E', 'R', '\0' };
+        std::vector<char> read;
+        unsigned version = 0u;
+        REQUIRE(BinaryFile::read(filename, read));
+        REQUIRE(BinaryFile::getHeader(read, other, version) == false);
+        REQUIRE(BinaryFile::hasMagic(filename, other) == false);
+    }
+
+    SECTION("files shorter than the minimum are rejected") {
+        std::vector<char> read;
+        REQUIRE(BinaryFile::read(filename, read, (unsigned)buf.size() + 1u) == false);
+        REQUIRE(read.empty());
+    }
+
+    SECTION("missing files are rejected") {
+        std::vector<char> read;
+        REQUIRE(BinaryFile::read("osgEarth_tests_no_such_file.bin", read) == false);
+    }
+
+    ::remove(filename.c_str());
+}
@@ -0,0 +1,109 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/catch.hpp>
+#include <osgEarth/Config>
+#include <osgEarth/XmlUtils>
+#include <sstream>
+
+using namespace osgEarth;
+
+namespace
+{
+    Config legacyParse(const std::string& xml)
+    {
+        std::stringstream in(xml);
+        osg::ref_ptr<XmlDocument> doc = XmlDocument::load(in);
+        return doc.valid() ? doc->getConfig() : Config();
+    }
+
+    Config fastParse(const std::string& xml)
+    {
+        std::stringstream in(xml);
+        Config conf;
+        XmlDocument::loadConfig(in, URIContext(), conf);
+        return conf;
+    }
+}
+
+TEST_CASE( "XmlDocument::loadConfig matches the XmlDocument DOM" ) {
+
+    std::string xml =
+        "<?xml version=\"1.0\"?>\n"
+        "<!DOCTYPE map>\n"
+        "<Map Name='test &amp; more' type=\"geocentric\">\n"
+        "  <!-- a comment -->\n"
+        "  <image name=\"one\" driver=gdal>\n"
+        "     <URL>  some   spaced\n   text  </URL>\n"
+        "     <profile>global-geodetic</profile>\n"
+        "  </image>\n"
+        "  <image name=\"two\"><url><![CDATA[a <raw>  value]]></url></image>\n"
+        "  <empty/>\n"
+        "  <entities>&lt;&#65;&#x42;&gt;</entities>\n"
+        "</Map>\n";
+
+    Config legacy = legacyParse(xml);
+    Config fast   = fastParse(xml);
+
+    REQUIRE( !fast.empty() );
+    REQUIRE( fast.key() == "Document" );
+    REQUIRE( fast.toJSON() == legacy.toJSON() );
+    REQUIRE( fast.child("map").value("name") == "test & more" );
+    REQUIRE( fast.child("map").child("image").value("url") == "some spaced text" );
+    REQUIRE( fast.child("map").value("entities") == "<AB>" );
+}
+
+TEST_CASE( "XmlDocument::loadConfig rejects malformed documents" ) {
+    Config conf;
+    std::stringstream in("<map><image></map>");
+    REQUIRE( XmlDocument::loadConfig(in, URIContext(), conf) == false );
+    REQUIRE( conf.empty() );
+}
+
+TEST_CASE( "Indexed Config lookups keep first-match semantics" ) {
+
+    std::stringstream xml;
+    xml << "<map>";
+    for (unsigned i = 0; i < 40; ++i)
+        xml << "<layer name=\"" << i << "\"/><other>" << i << "</other>";
+    xml << "<options>last</options></map>";
+
+    Config doc = fastParse(xml.str());
+    const Config& map = doc.child("map");
+
+    REQUIRE( map.hasChild("options") );
+    REQUIRE( map.value("options") == "last" );
+    REQUIRE( map.child("layer").value("name") == "0" );
+    REQUIRE( map.value("other") == "0" );
+    REQUIRE( map.children("layer").size() == 40 );
+    REQUIRE( map.children("layer").back().value("name") == "39" );
+    REQUIRE( !map.hasChild("missing") );
+
+    // copies carry the index and agree with the original
+    Config copy = map;
+    REQUIRE( copy.value("options") == "last" );
+
+    // modifying the children drops the index; lookups stay correct
+    copy.remove("options");
+    REQUIRE( !copy.hasChild("options") );
+    copy.add("options", "new");
+    REQUIRE( copy.value("options") == "new" );
+}
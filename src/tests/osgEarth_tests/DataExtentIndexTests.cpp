@@ -0,0 +1,173 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/DataExtentIndex>
+#include <osgEarth/PackedRTree>
+#include <osgEarth/Profile>
+#include <osgEarth/TileKey>
+#include <algorithm>
+
+using namespace osgEarth;
+
+namespace
+{
+    // deterministic numbers in [0..1)
+    struct Numbers
+    {
+        Numbers() : _state(12345u) { }
+        double next() { _state = _state * 1664525u + 1013904223u; return (double)(_state >> 8) / 16777216.0; }
+        unsigned _state;
+    };
+
+    DataExtentList makeExtents(const SpatialReference* srs, unsigned count)
+    {
+        Numbers n;
+        DataExtentList extents;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            double w = -180.0 + 360.0 * n.next();
+            double s = -90.0 + 170.0 * n.next();
+            double width = 0.1 + 10.0 * n.next();
+            double height = 0.1 + 10.0 * n.next();
+            extents.push_back(DataExtent(GeoExtent(srs, w, s, w + width, s + height), 0, 20));
+        }
+        return extents;
+    }
+
+    std::vector<unsigned> bruteForce(const DataExtentList& extents, const GeoExtent& query)
+    {
+        std::vector<unsigned> result;
+        for (unsigned i = 0; i < extents.size(); ++i)
+            if (query.intersects(extents[i]))
+                result.push_back(i);
+        return result;
+    }
+
+    // exact hits among the candidates
+    std::vector<unsigned> indexed(const DataExtentIndex& index, const GeoExtent& query)
+    {
+        std::vector<unsigned> candidates, result;
+        index.getCandidates(query, candidates);
+        for (unsigned i = 0; i < candidates.size(); ++i)
+            if (query.intersects(index.getDataExtents()[candidates[i]]))
+                result.push_back(candidates[i]);
+        return result;
+    }
+}
+
+TEST_CASE( "PackedRTree" ) {
+
+    SECTION("Finds every intersecting box") {
+        PackedRTree tree(4u);
+        for (unsigned i = 0; i < 100; ++i)
+        {
+            double x = (double)(i % 10), y = (double)(i / 10);
+            tree.insert(PackedRTree::Box(x, y, x + 0.5, y + 0.5), i);
+        }
+        tree.build();
+
+        std::vector<unsigned> ids;
+        REQUIRE(tree.query(PackedRTree::Box(2.25, 3.25, 4.25, 4.25), ids) == 6u);
+        std::sort(ids.begin(), ids.end());
+        REQUIRE(ids[0] == 32u);
+        REQUIRE(ids[5] == 44u);
+
+        ids.clear();
+        REQUIRE(tree.query(PackedRTree::Box(20.0, 20.0, 21.0, 21.0), ids) == 0u);
+    }
+
+    SECTION("Can be rebuilt after more inserts") {
+        PackedRTree tree;
+        tree.insert(PackedRTree::Box(0, 0, 1, 1), 7u);
+        tree.build();
+        tree.insert(PackedRTree::Box(5, 5, 6, 6), 8u);
+        tree.build();
+
+        std::vector<unsigned> ids;
+        REQUIRE(tree.query(PackedRTree::Box(5.5, 5.5, 5.5, 5.5), ids) == 1u);
+        REQUIRE(ids[0] == 8u);
+    }
+}
+
+TEST_CASE( "DataExtentIndex" ) {
+
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+    const SpatialReference* wgs84 = profile->getSRS();
+    DataExtentList extents = makeExtents(wgs84, 2000);
+    osg::ref_ptr<DataExtentIndex> index = new DataExtentIndex(extents, profile.get());
+
+    SECTION("Agrees with a linear scan") {
+        Numbers n;
+        for (unsigned q = 0; q < 200; ++q)
+        {
+            double w = -180.0 + 355.0 * n.next();
+            double s = -90.0 + 175.0 * n.next();
+            GeoExtent query(wgs84, w, s, w + 5.0 * n.next() + 0.01, s + 5.0 * n.next() + 0.01);
+            REQUIRE(indexed(*index, query) == bruteForce(extents, query));
+        }
+    }
+
+    SECTION("Handles extents that cross the antimeridian") {
+        DataExtentList wrapped;
+        wrapped.push_back(DataExtent(GeoExtent(wgs84, 175.0, 0.0, -175.0, 10.0)));
+        osg::ref_ptr<DataExtentIndex> wrappedIndex = new DataExtentIndex(wrapped, profile.get());
+
+        GeoExtent west(wgs84, -179.0, 1.0, -178.0, 2.0);
+        GeoExtent east(wgs84, 178.0, 1.0, 179.0, 2.0);
+        GeoExtent neither(wgs84, 0.0, 1.0, 1.0, 2.0);
+        REQUIRE(indexed(*wrappedIndex, west) == bruteForce(wrapped, west));
+        REQUIRE(indexed(*wrappedIndex, east) == bruteForce(wrapped, east));
+        REQUIRE(indexed(*wrappedIndex, neither).empty());
+        REQUIRE(bruteForce(wrapped, west).size() == 1u);
+    }
+
+    SECTION("Coverage bitmap never rejects a tile with data") {
+        for (unsigned lod = 0; lod <= 10; lod += 2)
+        {
+            unsigned tx, ty;
+            profile->getNumTiles(lod, tx, ty);
+            for (unsigned y = 0; y < ty; y += 1 + ty / 16)
+            {
+                for (unsigned x = 0; x < tx; x += 1 + tx / 16)
+                {
+                    TileKey key(lod, x, y, profile.get());
+                    if (!bruteForce(extents, key.getExtent()).empty())
+                    {
+                        REQUIRE(index->mayIntersect(key));
+                    }
+                }
+            }
+        }
+    }
+
+    SECTION("Coverage bitmap rejects empty tiles") {
+        DataExtentList one;
+        one.push_back(DataExtent(GeoExtent(wgs84, 10.0, 10.0, 11.0, 11.0)));
+        osg::ref_ptr<DataExtentIndex> oneIndex = new DataExtentIndex(one, profile.get());
+
+        REQUIRE(oneIndex->mayIntersect(TileKey(0, 1, 0, profile.get())));
+        REQUIRE_FALSE(oneIndex->mayIntersect(TileKey(0, 0, 0, profile.get())));
+        REQUIRE_FALSE(oneIndex->mayIntersect(TileKey(12, 0, 0, profile.get())));
+    }
+}
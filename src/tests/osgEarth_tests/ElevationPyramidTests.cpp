@@ -0,0 +1,149 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarthUtil/ElevationPyramid>
+#include <osgEarth/SpatialReference>
+#include <algorithm>
+#include <cfloat>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    const double RADIUS = 1000.0;
+    const unsigned SAMPLES = 65u;   // 31.25m spacing
+    const double METERS_PER_DEGREE = 6378137.0 * osg::PI / 180.0;
+
+    // Flat ground with a 100m north-south ridge from 250m to 375m east of the center.
+    std::vector<float> ridge()
+    {
+        std::vector<float> elevations(SAMPLES*SAMPLES, 0.0f);
+        for (unsigned r = 0; r < SAMPLES; ++r)
+            for (unsigned c = 40; c <= 44; ++c)
+                elevations[r*SAMPLES + c] = 100.0f;
+        return elevations;
+    }
+
+    // World position of a point east of the center (which is at 0,0) at an altitude.
+    osg::Vec3d east(const SpatialReference* srs, double meters, double altitude)
+    {
+        osg::Vec3d world;
+        GeoPoint(srs, meters / METERS_PER_DEGREE, 0.0, altitude, ALTMODE_ABSOLUTE).toWorld(world);
+        return world;
+    }
+}
+
+TEST_CASE( "ElevationPyramid" ) {
+
+    osg::ref_ptr<const SpatialReference> srs = SpatialReference::create("wgs84");
+    GeoPoint center(srs.get(), 0.0, 0.0, 0.0, ALTMODE_ABSOLUTE);
+
+    osg::ref_ptr<ElevationPyramid> pyramid = new ElevationPyramid();
+    REQUIRE(pyramid->build(center, RADIUS, SAMPLES, ridge()));
+    REQUIRE(pyramid->getNumSamples() == SAMPLES);
+    REQUIRE(pyramid->getSpacing() == Approx(31.25));
+    REQUIRE(pyramid->getNumLevels() == 7u);
+
+    SECTION("Rejects a grid of the wrong size") {
+        osg::ref_ptr<ElevationPyramid> bad = new ElevationPyramid();
+        REQUIRE_FALSE(bad->build(center, RADIUS, SAMPLES, std::vector<float>(10u, 0.0f)));
+        REQUIRE_FALSE(bad->valid());
+    }
+
+    SECTION("Each block holds the extrema of the blocks below it") {
+        for (unsigned level = 1u; level < pyramid->getNumLevels(); ++level)
+        {
+            float mn, mx;
+            for (unsigned r = 0u; pyramid->getHeightRange(level, 0u, r, mn, mx); ++r)
+            {
+                for (unsigned c = 0u; pyramid->getHeightRange(level, c, r, mn, mx); ++c)
+                {
+                    float childMin = FLT_MAX, childMax = -FLT_MAX, a, b;
+                    for (unsigned d = 0u; d < 4u; ++d)
+                    {
+                        if (pyramid->getHeightRange(level-1u, 2u*c + (d&1u), 2u*r + (d>>1), a, b))
+                        {
+                            childMin = std::min(childMin, a);
+                            childMax = std::max(childMax, b);
+                        }
+                    }
+                    REQUIRE(mn == childMin);
+                    REQUIRE(mx == childMax);
+                }
+            }
+        }
+
+        // the root sees the ridge; a cell on the flat ground doesn't
+        float mn, mx;
+        REQUIRE(pyramid->getHeightRange(pyramid->getNumLevels()-1u, 0u, 0u, mn, mx));
+        REQUIRE(mx == Approx(100.0).epsilon(0.01));
+        REQUIRE(mn == Approx(0.0).margin(0.5));
+        REQUIRE(pyramid->getHeightRange(0u, 0u, 0u, mn, mx));
+        REQUIRE(mx < 1.0f);
+        REQUIRE(pyramid->getHeightRange(0u, 40u, 10u, mn, mx));
+        REQUIRE(mx == Approx(100.0).epsilon(0.01));
+    }
+
+    SECTION("A ray below the ridge hits it") {
+        double ratio;
+        REQUIRE(pyramid->intersect(east(srs.get(), -900.0, 50.0), east(srs.get(), 900.0, 50.0), ratio));
+        REQUIRE(ratio == Approx((250.0 + 900.0) / 1800.0).margin(0.03));
+
+        osg::Vec3d hit;
+        REQUIRE(pyramid->intersect(east(srs.get(), -900.0, 50.0), east(srs.get(), 900.0, 50.0), hit));
+        GeoPoint hitPoint;
+        hitPoint.fromWorld(srs.get(), hit);
+        REQUIRE(hitPoint.x() * METERS_PER_DEGREE == Approx(250.0).margin(40.0));
+    }
+
+    SECTION("Rays above the ridge, or short of it, miss") {
+        double ratio;
+        REQUIRE_FALSE(pyramid->intersect(east(srs.get(), -900.0, 150.0), east(srs.get(), 900.0, 150.0), ratio));
+        REQUIRE_FALSE(pyramid->intersect(east(srs.get(), -900.0, 50.0), east(srs.get(), 200.0, 50.0), ratio));
+    }
+
+    SECTION("Batched rays") {
+        std::vector<osg::Vec3d> ends;
+        ends.push_back(east(srs.get(), 900.0, 50.0));
+        ends.push_back(east(srs.get(), 900.0, 150.0));
+        ends.push_back(east(srs.get(), -900.0, 50.0));
+
+        std::vector<double> ratios;
+        REQUIRE(pyramid->intersect(east(srs.get(), 0.0, 50.0), ends, ratios) == 1u);
+        REQUIRE(ratios.size() == 3u);
+        REQUIRE(ratios[0] == Approx(250.0 / 900.0).margin(0.05));
+        REQUIRE(ratios[1] == -1.0);
+        REQUIRE(ratios[2] == -1.0);
+    }
+
+    SECTION("Elevation lookups") {
+        double elevation;
+        REQUIRE(pyramid->getElevation(GeoPoint(srs.get(), 300.0 / METERS_PER_DEGREE, 0.0, 0.0, ALTMODE_ABSOLUTE), elevation));
+        REQUIRE(elevation == Approx(100.0));
+        REQUIRE(pyramid->getElevation(GeoPoint(srs.get(), -300.0 / METERS_PER_DEGREE, 0.0, 0.0, ALTMODE_ABSOLUTE), elevation));
+        REQUIRE(elevation == Approx(0.0).margin(0.001));
+        REQUIRE_FALSE(pyramid->getElevation(GeoPoint(srs.get(), 2000.0 / METERS_PER_DEGREE, 0.0, 0.0, ALTMODE_ABSOLUTE), elevation));
+    }
+}
@@ -0,0 +1,126 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/ElevationLayer>
+
+using namespace osgEarth;
+
+namespace
+{
+    // Elevation layer that builds a ramp in memory and counts how often it's asked to.
+    class RampLayer : public ElevationLayer
+    {
+    public:
+        RampLayer() : _creates(0)
+        {
+            setTileSourceExpected(false);
+            setProfile(Profile::create("global-geodetic"));
+        }
+
+        int _creates;
+
+    protected:
+        void createImplementation(const TileKey& key,
+                                  osg::ref_ptr<osg::HeightField>& out_hf,
+                                  osg::ref_ptr<NormalMap>& out_normalMap,
+                                  ProgressCallback* progress)
+        {
+            ++_creates;
+            out_hf = new osg::HeightField();
+            out_hf->allocate(17, 17);
+            for (unsigned t = 0; t < 17; ++t)
+                for (unsigned s = 0; s < 17; ++s)
+                    out_hf->setHeight(s, t, (float)(key.getLOD() * 100u + s + t));
+            if (key.getLOD() > 0)
+                out_hf->setHeight(3, 3, NO_DATA_VALUE);
+        }
+    };
+}
+
+TEST_CASE( "ElevationTileSummary" ) {
+
+    SECTION("Summarizes a heightfield") {
+        osg::ref_ptr<osg::HeightField> hf = new osg::HeightField();
+        hf->allocate(4, 4);
+        for (unsigned i = 0; i < 16; ++i)
+            hf->getHeightList()[i] = -10.0f + (float)i;
+        hf->setHeight(2, 2, NO_DATA_VALUE);
+
+        ElevationTileSummary summary(hf.get());
+        REQUIRE(summary.hasHeights());
+        REQUIRE(summary._minHeight == -10.0f);
+        REQUIRE(summary._maxHeight == 5.0f);
+        REQUIRE(summary._hasNoData == true);
+    }
+
+    SECTION("Round-trips through its cache record") {
+        ElevationTileSummary summary;
+        summary._minHeight = -412.25f;
+        summary._maxHeight = 8848.86f;
+        summary._hasNoData = true;
+
+        ElevationTileSummary copy;
+        REQUIRE(copy.fromString(summary.toString()));
+        REQUIRE(copy._minHeight == summary._minHeight);
+        REQUIRE(copy._maxHeight == summary._maxHeight);
+        REQUIRE(copy._hasNoData == true);
+
+        ElevationTileSummary empty;
+        empty._hasNoData = true;
+        REQUIRE(copy.fromString(empty.toString()));
+        REQUIRE(copy.hasHeights() == false);
+        REQUIRE(copy._hasNoData == true);
+
+        REQUIRE(copy.fromString("garbage") == false);
+    }
+
+    SECTION("Layers record summaries as they create heightfields") {
+        osg::ref_ptr<RampLayer> layer = new RampLayer();
+        REQUIRE(layer->open().isOK());
+
+        TileKey key(1, 0, 0, layer->getProfile());
+        ElevationTileSummary summary;
+        REQUIRE(layer->getTileSummary(key, summary) == false);
+
+        REQUIRE(layer->createHeightField(key).valid());
+        REQUIRE(layer->getTileSummary(key, summary));
+        REQUIRE(summary._minHeight == 100.0f);
+        REQUIRE(summary._maxHeight == 132.0f);
+        REQUIRE(summary._hasNoData == true);
+
+        // only builds the heightfield when it has to
+        TileKey other(1, 1, 0, layer->getProfile());
+        int creates = layer->_creates;
+        REQUIRE(layer->getOrCreateTileSummary(other, summary));
+        REQUIRE(layer->_creates == creates + 1);
+        REQUIRE(layer->getOrCreateTileSummary(other, summary));
+        REQUIRE(layer->_creates == creates + 1);
+
+        ElevationLayerVector layers;
+        layers.push_back(layer.get());
+        REQUIRE(layers.getTileSummary(key, summary));
+        REQUIRE(summary._maxHeight == 132.0f);
+        REQUIRE(layers.getTileSummary(TileKey(1, 0, 1, layer->getProfile()), summary) == false);
+    }
+}
@@ -0,0 +1,85 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarthFeatures/FeatureBoundsIndex>
+#include <stdio.h>
+
+using namespace osgEarth;
+using namespace osgEarth::Features;
+
+namespace
+{
+    // a grid of unit boxes, with IDs counting up row by row.
+    FeatureBoundsIndex* makeGrid(unsigned n)
+    {
+        FeatureBoundsIndex* index = new FeatureBoundsIndex();
+        for (unsigned y = 0; y < n; ++y)
+            for (unsigned x = 0; x < n; ++x)
+                index->insert(100 + y*n + x, Bounds(x, y, x + 0.5, y + 0.5));
+        index->build();
+        return index;
+    }
+}
+
+TEST_CASE( "FeatureBoundsIndex returns intersecting features in ID order" ) {
+
+    osg::ref_ptr<FeatureBoundsIndex> index = makeGrid(10);
+    REQUIRE(index->size() == 100);
+
+    std::vector<FeatureID> fids;
+    index->query(Bounds(2.25, 3.25, 3.25, 4.25), fids);
+    REQUIRE(fids.size() == 4);
+    REQUIRE(fids[0] == 132);
+    REQUIRE(fids[1] == 133);
+    REQUIRE(fids[2] == 142);
+    REQUIRE(fids[3] == 143);
+
+    fids.clear();
+    index->query(Bounds(20.0, 20.0, 30.0, 30.0), fids);
+    REQUIRE(fids.empty());
+}
+
+TEST_CASE( "FeatureBoundsIndex saves and reloads until the source changes" ) {
+
+    const std::string filename = "osgEarth_tests_bounds.oeidx";
+
+    osg::ref_ptr<FeatureBoundsIndex> index = makeGrid(4);
+    REQUIRE(index->write(filename, 12345));
+
+    osg::ref_ptr<FeatureBoundsIndex> loaded = FeatureBoundsIndex::read(filename, 12345);
+    REQUIRE(loaded.valid());
+    REQUIRE(loaded->size() == 16);
+
+    std::vector<FeatureID> fids;
+    loaded->query(Bounds(0.0, 0.0, 4.0, 4.0), fids);
+    REQUIRE(fids.size() == 16);
+    REQUIRE(fids.front() == 100);
+    REQUIRE(fids.back() == 115);
+
+    // a different modification time means the source changed:
+    osg::ref_ptr<FeatureBoundsIndex> stale = FeatureBoundsIndex::read(filename, 12346);
+    REQUIRE(!stale.valid());
+
+    ::remove(filename.c_str());
+}
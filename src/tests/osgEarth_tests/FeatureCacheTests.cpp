@@ -0,0 +1,205 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarthFeatures/FeatureCache>
+#include <osgEarthFeatures/FeatureListSource>
+#include <osgEarth/SpatialReference>
+
+using namespace osgEarth;
+using namespace osgEarth::Features;
+using namespace osgEarth::Symbology;
+
+namespace
+{
+    // counts the queries that reach the source.
+    class CountingSource : public FeatureListSource
+    {
+    public:
+        CountingSource() : _queries(0) { }
+        FeatureCursor* createFeatureCursor(const Query& query) {
+            ++_queries;
+            return FeatureListSource::createFeatureCursor(query);
+        }
+        int _queries;
+    };
+
+    // a source whose results come from the query's map.
+    class MapSource : public CountingSource
+    {
+    public:
+        bool dependsOnMap() const { return true; }
+    };
+
+    Feature* makePolygon(FeatureID fid)
+    {
+        Polygon* polygon = new Polygon();
+        polygon->push_back(osg::Vec3d(0, 0, 0));
+        polygon->push_back(osg::Vec3d(10, 0, 0));
+        polygon->push_back(osg::Vec3d(10, 10, 0));
+        polygon->push_back(osg::Vec3d(0, 10, 0));
+
+        Ring* hole = new Ring();
+        hole->push_back(osg::Vec3d(2, 2, 0));
+        hole->push_back(osg::Vec3d(4, 2, 0));
+        hole->push_back(osg::Vec3d(4, 4, 0));
+        polygon->getHoles().push_back(hole);
+
+        Feature* feature = new Feature(polygon, SpatialReference::get("wgs84"), Style(), fid);
+        feature->set("name", std::string("park"));
+        feature->set("area", 99.5);
+        feature->set("lanes", 3);
+        feature->set("open", true);
+        feature->setNull("owner", ATTRTYPE_STRING);
+        return feature;
+    }
+
+    Feature* makeMulti(FeatureID fid)
+    {
+        MultiGeometry* multi = new MultiGeometry();
+        LineString* a = new LineString();
+        a->push_back(osg::Vec3d(1, 1, 5));
+        a->push_back(osg::Vec3d(2, 2, 5));
+        multi->add(a);
+        PointSet* b = new PointSet();
+        b->push_back(osg::Vec3d(3, 3, 0));
+        multi->add(b);
+
+        Feature* feature = new Feature(multi, SpatialReference::get("wgs84"), Style(), fid);
+        feature->set("name", std::string("road"));
+        return feature;
+    }
+}
+
+TEST_CASE( "FeatureCache answers repeated queries from memory" ) {
+
+    osg::ref_ptr<CountingSource> source = new CountingSource();
+    source->getFeatures().push_back(makePolygon(7));
+    source->getFeatures().push_back(makeMulti(8));
+
+    osg::ref_ptr<FeatureCache> cache = new FeatureCache(1024*1024);
+
+    Query query;
+    query.bounds() = Bounds(0, 0, 10, 10);
+
+    FeatureList first, second;
+    osg::ref_ptr<FeatureCursor> cursor = cache->createFeatureCursor(source.get(), query);
+    REQUIRE(cursor.valid());
+    cursor->fill(first);
+
+    cursor = cache->createFeatureCursor(source.get(), query);
+    REQUIRE(cursor.valid());
+    cursor->fill(second);
+
+    REQUIRE(source->_queries == 1);
+    REQUIRE(cache->getStats()._hits == 1);
+    REQUIRE(cache->getStats()._misses == 1);
+    REQUIRE(cache->getStats()._entries == 1);
+
+    SECTION("cached features match the originals") {
+        REQUIRE(second.size() == 2);
+
+        Feature* polygon = second.front().get();
+        REQUIRE(polygon != first.front().get());
+        REQUIRE(polygon->getFID() == 7);
+        REQUIRE(polygon->getSRS() == SpatialReference::get("wgs84"));
+        REQUIRE(polygon->getString("name") == "park");
+        REQUIRE(polygon->getDouble("area") == 99.5);
+        REQUIRE(polygon->getInt("lanes") == 3);
+        REQUIRE(polygon->getBool("open") == true);
+        REQUIRE(polygon->hasAttr("owner"));
+        REQUIRE(!polygon->isSet("owner"));
+
+        REQUIRE(polygon->getGeometry()->getType() == Geometry::TYPE_POLYGON);
+        REQUIRE(polygon->getGeometry()->size() == 4);
+        const Polygon* p = static_cast<const Polygon*>(polygon->getGeometry());
+        REQUIRE(p->getHoles().size() == 1);
+        REQUIRE(p->getHoles().front()->size() == 3);
+        REQUIRE((*p->getHoles().front())[1] == osg::Vec3d(4, 2, 0));
+
+        Feature* multi = second.back().get();
+        REQUIRE(multi->getFID() == 8);
+        REQUIRE(multi->getGeometry()->getType() == Geometry::TYPE_MULTI);
+        const MultiGeometry* m = static_cast<const MultiGeometry*>(multi->getGeometry());
+        REQUIRE(m->getComponents().size() == 2);
+        REQUIRE(m->getComponents()[0]->getType() == Geometry::TYPE_LINESTRING);
+        REQUIRE((*m->getComponents()[0])[1] == osg::Vec3d(2, 2, 5));
+        REQUIRE(m->getComponents()[1]->getType() == Geometry::TYPE_POINTSET);
+    }
+
+    SECTION("a different query or a changed source goes back to the source") {
+        Query other;
+        other.bounds() = Bounds(0, 0, 5, 5);
+        cursor = cache->createFeatureCursor(source.get(), other);
+        REQUIRE(source->_queries == 2);
+
+        source->dirty();
+        cursor = cache->createFeatureCursor(source.get(), query);
+        REQUIRE(source->_queries == 3);
+    }
+}
+
+TEST_CASE( "FeatureCache never caches map-dependent sources" ) {
+
+    osg::ref_ptr<MapSource> source = new MapSource();
+    source->getFeatures().push_back(makePolygon(7));
+
+    osg::ref_ptr<FeatureCache> cache = new FeatureCache(1024*1024);
+
+    osg::ref_ptr<FeatureCursor> cursor = cache->createFeatureCursor(source.get(), Query());
+    REQUIRE(cursor.valid());
+    cursor = cache->createFeatureCursor(source.get(), Query());
+    REQUIRE(source->_queries == 2);
+    REQUIRE(cache->getStats()._entries == 0);
+}
+
+TEST_CASE( "FeatureCache stays within its memory budget" ) {
+
+    osg::ref_ptr<CountingSource> source = new CountingSource();
+    for (unsigned i = 0; i < 100; ++i)
+        source->getFeatures().push_back(makePolygon(i));
+
+    // room for one result but not two:
+    osg::ref_ptr<FeatureCache> probe = new FeatureCache(1024*1024);
+    osg::ref_ptr<FeatureCursor> cursor = probe->createFeatureCursor(source.get(), Query());
+    unsigned bytes = probe->getStats()._bytes;
+    REQUIRE(bytes > 0u);
+
+    osg::ref_ptr<FeatureCache> cache = new FeatureCache(bytes + bytes/2);
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        Query query;
+        query.limit() = (int)i;
+        cursor = cache->createFeatureCursor(source.get(), query);
+        REQUIRE(cache->getStats()._entries == 1);
+        REQUIRE(cache->getStats()._bytes <= bytes + bytes/2);
+    }
+
+    // disabled:
+    osg::ref_ptr<FeatureCache> off = new FeatureCache(0u);
+    int before = source->_queries;
+    cursor = off->createFeatureCursor(source.get(), Query());
+    cursor = off->createFeatureCursor(source.get(), Query());
+    REQUIRE(source->_queries == before + 2);
+    REQUIRE(off->getStats()._entries == 0);
+}
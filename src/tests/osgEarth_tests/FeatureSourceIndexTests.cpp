@@ -0,0 +1,93 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+#include <osgEarthFeatures/FeatureSourceIndexNode>
+
+using namespace osgEarth;
+using namespace osgEarth::Features;
+
+TEST_CASE( "ObjectIDTable maps ObjectIDs to FeatureIDs" ) {
+
+    ObjectIDTable table;
+
+    // two runs of consecutive ObjectIDs, as two tiles would produce
+    for (ObjectID oid = 100; oid < 200; ++oid)
+        table.insert(oid, oid * 10);
+    for (ObjectID oid = 500; oid < 550; ++oid)
+        table.insert(oid, oid * 10);
+
+    REQUIRE( table.size() == 150u );
+
+    FeatureID fid;
+    SECTION("Lookups") {
+        REQUIRE( table.find(100, fid) );
+        REQUIRE( fid == 1000 );
+        REQUIRE( table.find(549, fid) );
+        REQUIRE( fid == 5490 );
+        REQUIRE( !table.find(99, fid) );
+        REQUIRE( !table.find(200, fid) );
+        REQUIRE( !table.find(550, fid) );
+    }
+
+    SECTION("Out of order inserts") {
+        table.insert(300, 7);
+        table.insert(50, 8);
+        table.insert(200, 9);
+        REQUIRE( table.size() == 153u );
+        REQUIRE( table.find(300, fid) );
+        REQUIRE( fid == 7 );
+        REQUIRE( table.find(50, fid) );
+        REQUIRE( fid == 8 );
+        REQUIRE( table.find(200, fid) );
+        REQUIRE( fid == 9 );
+        REQUIRE( table.find(520, fid) );
+        REQUIRE( fid == 5200 );
+    }
+
+    SECTION("Erase and reinsert") {
+        table.erase(150);
+        REQUIRE( !table.find(150, fid) );
+        REQUIRE( table.size() == 149u );
+        table.insert(150, 42);
+        REQUIRE( table.find(150, fid) );
+        REQUIRE( fid == 42 );
+    }
+
+    SECTION("Compaction keeps live entries") {
+        for (ObjectID oid = 1000; oid < 5000; ++oid)
+            table.insert(oid, oid);
+        for (ObjectID oid = 1000; oid < 4000; ++oid)
+            table.erase(oid);
+
+        REQUIRE( table.size() == 1150u );
+        REQUIRE( !table.find(3999, fid) );
+        REQUIRE( table.find(4000, fid) );
+        REQUIRE( fid == 4000 );
+        REQUIRE( table.find(120, fid) );
+        REQUIRE( fid == 1200 );
+
+        std::vector<ObjectID> oids;
+        table.getObjectIDs(oids);
+        REQUIRE( oids.size() == 1150u );
+    }
+}
@@ -0,0 +1,79 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/ImageMosaic>
+#include <osgEarth/Registry>
+
+using namespace osgEarth;
+
+namespace
+{
+    osg::Image* makeTile(unsigned char r, unsigned char g, unsigned char b)
+    {
+        osg::Image* image = new osg::Image();
+        image->allocateImage(8, 8, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        for (unsigned t = 0; t < 8; ++t)
+        {
+            for (unsigned s = 0; s < 8; ++s)
+            {
+                unsigned char* p = image->data(s, t);
+                p[0] = r; p[1] = g; p[2] = b; p[3] = 255;
+            }
+        }
+        return image;
+    }
+}
+
+TEST_CASE( "ImageMosaic fills missing tiles with transparent white" ) {
+
+    const Profile* profile = Registry::instance()->getGlobalGeodeticProfile();
+
+    ImageMosaic mosaic;
+    mosaic.getImages().push_back(TileImage(makeTile(255, 0, 0), TileKey(1, 0, 0, profile)));
+    mosaic.getImages().push_back(TileImage(makeTile(0, 0, 255), TileKey(1, 1, 1, profile)));
+
+    osg::ref_ptr<osg::Image> image = mosaic.createImage();
+    REQUIRE(image.valid());
+    REQUIRE(image->s() == 16);
+    REQUIRE(image->t() == 16);
+
+    // image rows run bottom-up, tile rows top-down:
+    const unsigned char* red = image->data(3, 12);
+    REQUIRE(red[0] == 255);
+    REQUIRE(red[2] == 0);
+    REQUIRE(red[3] == 255);
+
+    const unsigned char* blue = image->data(12, 3);
+    REQUIRE(blue[0] == 0);
+    REQUIRE(blue[2] == 255);
+
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        const unsigned char* empty = i == 0 ? image->data(0, 0) : image->data(15, 15);
+        REQUIRE(empty[0] == 255);
+        REQUIRE(empty[1] == 255);
+        REQUIRE(empty[2] == 255);
+        REQUIRE(empty[3] == 0);
+    }
+}
@@ -0,0 +1,102 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/ImageUtils>
+#include <cstdlib>
+
+using namespace osgEarth;
+
+namespace
+{
+    osg::Image* makeRGBA8(unsigned size, unsigned char r, unsigned char g, unsigned char b, unsigned char a)
+    {
+        osg::Image* image = new osg::Image();
+        image->allocateImage(size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        for (unsigned t = 0; t < size; ++t)
+        {
+            for (unsigned s = 0; s < size; ++s)
+            {
+                unsigned char* p = image->data(s, t);
+                p[0] = r; p[1] = g; p[2] = b; p[3] = a;
+            }
+        }
+        return image;
+    }
+
+    bool near(unsigned char value, int expected)
+    {
+        return std::abs((int)value - expected) <= 1;
+    }
+}
+
+TEST_CASE( "ImageUtils::mix blends 8-bit RGBA images" ) {
+
+    osg::ref_ptr<osg::Image> dest = makeRGBA8(16, 255, 0, 0, 255);
+
+    SECTION("Opaque source at half opacity") {
+        osg::ref_ptr<osg::Image> src = makeRGBA8(16, 0, 0, 255, 255);
+        REQUIRE(ImageUtils::mix(dest.get(), src.get(), 0.5f));
+        const unsigned char* p = dest->data(7, 9);
+        REQUIRE(near(p[0], 128));
+        REQUIRE(p[1] == 0);
+        REQUIRE(near(p[2], 128));
+        REQUIRE(p[3] == 255);
+    }
+
+    SECTION("Transparent source leaves the destination alone") {
+        osg::ref_ptr<osg::Image> src = makeRGBA8(16, 0, 255, 0, 0);
+        REQUIRE(ImageUtils::mix(dest.get(), src.get(), 1.0f));
+        const unsigned char* p = dest->data(3, 3);
+        REQUIRE(p[0] == 255);
+        REQUIRE(p[1] == 0);
+        REQUIRE(p[3] == 255);
+    }
+
+    SECTION("Source alpha raises the destination alpha") {
+        osg::ref_ptr<osg::Image> clear = makeRGBA8(16, 0, 0, 0, 0);
+        osg::ref_ptr<osg::Image> src = makeRGBA8(16, 0, 255, 0, 102);
+        REQUIRE(ImageUtils::mix(clear.get(), src.get(), 1.0f));
+        const unsigned char* p = clear->data(0, 15);
+        REQUIRE(near(p[1], 102));
+        REQUIRE(p[3] == 102);
+    }
+
+    SECTION("Mismatched sizes are rejected") {
+        osg::ref_ptr<osg::Image> src = makeRGBA8(8, 0, 0, 255, 255);
+        REQUIRE(!ImageUtils::mix(dest.get(), src.get(), 1.0f));
+    }
+}
+
+TEST_CASE( "ImageUtils::hasTransparency finds translucent 8-bit RGBA pixels" ) {
+
+    osg::ref_ptr<osg::Image> image = makeRGBA8(32, 10, 20, 30, 255);
+    REQUIRE(!ImageUtils::hasTransparency(image.get()));
+
+    image->data(31, 31)[3] = 254;
+    REQUIRE(ImageUtils::hasTransparency(image.get()));
+    REQUIRE(!ImageUtils::hasTransparency(image.get(), 0.5f));
+
+    image->data(0, 0)[3] = 100;
+    REQUIRE(ImageUtils::hasTransparency(image.get(), 0.5f));
+}
@@ -0,0 +1,104 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarthDrivers/kml/KML>
+#include <osgEarthAnnotation/FeatureNode>
+#include <osgEarthSymbology/LineSymbol>
+#include <osg/NodeVisitor>
+#include <algorithm>
+#include <fstream>
+#include <stdio.h>
+
+using namespace osgEarth;
+using namespace osgEarth::Annotation;
+using namespace osgEarth::Drivers;
+using namespace osgEarth::Symbology;
+
+namespace
+{
+    // line widths of every feature node, in document order.
+    struct CollectWidths : public osg::NodeVisitor
+    {
+        std::vector<float> _widths;
+        CollectWidths() : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN) { }
+        void apply(osg::Node& node)
+        {
+            FeatureNode* featureNode = dynamic_cast<FeatureNode*>(&node);
+            if (featureNode)
+            {
+                const LineSymbol* line = featureNode->getStyle().get<LineSymbol>();
+                _widths.push_back(line && line->stroke()->width().isSet() ? line->stroke()->width().get() : 0.0f);
+            }
+            traverse(node);
+        }
+    };
+
+    std::vector<float> load(const std::string& path, MapNode* mapNode, bool streaming)
+    {
+        KMLOptions options;
+        options.declutter() = false;
+        options.streaming() = streaming;
+        options.streamingBatchSize() = 16u;
+        options.streamingNumThreads() = 2u;
+
+        osg::ref_ptr<osg::Node> node = KML::load(URI(path), mapNode, options);
+        CollectWidths collector;
+        if (node.valid())
+            node->accept(collector);
+        return collector._widths;
+    }
+}
+
+TEST_CASE( "Streaming KML sees styles read in the middle of a batch" ) {
+
+    const std::string path = "osgEarth_tests_kmlstream.kml";
+    {
+        // both placemarks fit in one batch; the second one's style
+        // arrives after the batch has started filling.
+        std::ofstream out(path.c_str());
+        out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            << "<kml xmlns=\"http://www.opengis.net/kml/2.2\"><Document>\n"
+            << "<Style id=\"early\"><LineStyle><width>2</width></LineStyle></Style>\n"
+            << "<Placemark><styleUrl>#early</styleUrl><LineString><coordinates>0,0,0 1,1,0</coordinates></LineString></Placemark>\n"
+            << "<Style id=\"late\"><LineStyle><width>5</width></LineStyle></Style>\n"
+            << "<Placemark><styleUrl>#late</styleUrl><LineString><coordinates>2,2,0 3,3,0</coordinates></LineString></Placemark>\n"
+            << "</Document></kml>\n";
+    }
+
+    osg::ref_ptr<MapNode> mapNode = new MapNode(new Map());
+
+    std::vector<float> dom = load(path, mapNode.get(), false);
+    std::vector<float> streamed = load(path, mapNode.get(), true);
+
+    REQUIRE(dom.size() == 2u);
+    REQUIRE(streamed.size() == 2u);
+
+    std::sort(dom.begin(), dom.end());
+    std::sort(streamed.begin(), streamed.end());
+    REQUIRE(streamed[0] == 2.0f);
+    REQUIRE(streamed[1] == 5.0f);
+    REQUIRE(streamed == dom);
+
+    ::remove(path.c_str());
+}
@@ -0,0 +1,132 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/HeightFieldUtils>
+#include <osgEarth/SpatialReference>
+#include <cstdlib>
+
+using namespace osgEarth;
+
+namespace
+{
+    osg::HeightField* makeTile(int size, double interval)
+    {
+        osg::HeightField* hf = new osg::HeightField();
+        hf->allocate(size, size);
+        hf->setOrigin(osg::Vec3(-10.0f, 40.0f, 0.0f));
+        hf->setXInterval(interval);
+        hf->setYInterval(interval);
+        for (int t = 0; t < size; ++t)
+            for (int s = 0; s < size; ++s)
+                hf->setHeight(s, t, 1000.0f + 400.0f*sin(s*0.11)*cos(t*0.07) + 3.0f*s);
+        return hf;
+    }
+
+    // The per-sample formula convertToNormalMap used before the row kernel,
+    // for an interior sample of a projected tile.
+    void referenceSample(const osg::HeightField* hf, int s, int t, osg::Vec3f& n, float& curvature)
+    {
+        double dx = hf->getXInterval(), dy = hf->getYInterval();
+        float h = hf->getHeight(s, t);
+        osg::Vec3f west (-dx, 0, hf->getHeight(s-1, t));
+        osg::Vec3f east ( dx, 0, hf->getHeight(s+1, t));
+        osg::Vec3f south(0, -dy, hf->getHeight(s, t-1));
+        osg::Vec3f north(0,  dy, hf->getHeight(s, t+1));
+        n = (east - west) ^ (north - south);
+        n.normalize();
+        float D = (0.5*(west.z() + east.z()) - h) / (dx*dx);
+        float E = (0.5*(south.z() + north.z()) - h) / (dy*dy);
+        curvature = osg::clampBetween(-2.0f*(D + E)*100.0f, -1.0f, 1.0f);
+    }
+}
+
+TEST_CASE( "HeightFieldUtils normal maps" ) {
+
+    const double tolerance = 2.0/255.0 * 2.0;
+
+    SECTION("Row kernel matches the per-sample formula") {
+        HeightFieldNeighborhood hood;
+        hood._center = makeTile(257, 30.0);
+        osg::ref_ptr<NormalMap> map = HeightFieldUtils::convertToNormalMap(hood, SpatialReference::get("spherical-mercator"));
+        REQUIRE(map.valid());
+
+        for (int t = 1; t < 256; t += 7) {
+            for (int s = 1; s < 256; s += 5) {
+                osg::Vec3f n;
+                float curvature;
+                referenceSample(hood._center.get(), s, t, n, curvature);
+                osg::Vec3 got = map->getNormal(s, t);
+                REQUIRE(got.x() == Approx(n.x()).margin(tolerance));
+                REQUIRE(got.y() == Approx(n.y()).margin(tolerance));
+                REQUIRE(got.z() == Approx(n.z()).margin(tolerance));
+                REQUIRE(map->getCurvature(s, t) == Approx(curvature).margin(tolerance));
+            }
+        }
+    }
+
+    SECTION("Tiles with NO_DATA agree with the fast path away from the hole") {
+        const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+
+        HeightFieldNeighborhood clean;
+        clean._center = makeTile(65, 0.001);
+        osg::ref_ptr<NormalMap> fast = HeightFieldUtils::convertToNormalMap(clean, wgs84);
+
+        HeightFieldNeighborhood holed;
+        holed._center = makeTile(65, 0.001);
+        holed._center->setHeight(0, 0, NO_DATA_VALUE);
+        NormalMapStats stats;
+        osg::ref_ptr<NormalMap> slow = HeightFieldUtils::convertToNormalMap(holed, wgs84, &stats);
+        REQUIRE(stats._noDataCount == 1u);
+
+        // the hole only touches edge samples, so every interior sample of
+        // the generic path should match the row kernel
+        for (int t = 1; t < 64; ++t) {
+            for (int s = 1; s < 64; ++s) {
+                const unsigned char* a = fast->data(s, t);
+                const unsigned char* b = slow->data(s, t);
+                for (int c = 0; c < 4; ++c)
+                    REQUIRE(std::abs((int)a[c] - (int)b[c]) <= 1);
+            }
+        }
+    }
+
+    SECTION("Stats are gathered in the same pass") {
+        HeightFieldNeighborhood hood;
+        hood._center = makeTile(33, 30.0);
+        hood._center->setHeight(5, 5, -250.0f);
+        hood._center->setHeight(20, 9, 9000.0f);
+
+        NormalMapStats stats;
+        osg::ref_ptr<NormalMap> map = HeightFieldUtils::convertToNormalMap(hood, SpatialReference::get("spherical-mercator"), &stats);
+        REQUIRE(stats._noDataCount == 0u);
+        REQUIRE(stats._minHeight == -250.0f);
+        REQUIRE(stats._maxHeight == 9000.0f);
+
+        // the pit and the peak saturate the curvature in both directions
+        REQUIRE(stats._minCurvature == -1.0f);
+        REQUIRE(stats._maxCurvature == 1.0f);
+        REQUIRE(map->getCurvature(5, 5) == Approx(-1.0f).margin(tolerance));
+        REQUIRE(map->getCurvature(20, 9) == Approx(1.0f).margin(tolerance));
+    }
+}
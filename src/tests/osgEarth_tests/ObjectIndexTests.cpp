@@ -0,0 +1,68 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/ObjectIndex>
+
+using namespace osgEarth;
+
+TEST_CASE( "ObjectIndex hands out blocks of IDs" ) {
+
+    osg::ref_ptr<ObjectIndex> index = new ObjectIndex();
+    osg::ref_ptr<osg::Referenced> object = new osg::Referenced();
+
+    ObjectID first = index->insert(object.get(), 4u);
+    REQUIRE(first != OSGEARTH_OBJECTID_EMPTY);
+    for (unsigned i = 0; i < 4u; ++i)
+        REQUIRE(index->get<osg::Referenced>(first + i).get() == object.get());
+
+    SECTION("Removed IDs are gone; the rest stay") {
+        index->remove(first + 1);
+        REQUIRE(index->get<osg::Referenced>(first + 1).valid() == false);
+        REQUIRE(index->get<osg::Referenced>(first).get() == object.get());
+        REQUIRE(index->get<osg::Referenced>(first + 2).get() == object.get());
+    }
+
+    SECTION("Removing an ID twice is a no-op") {
+        index->remove(first);
+        index->remove(first);
+        index->remove(first);
+        index->remove(first);
+
+        // the block still holds the three IDs that were never removed
+        REQUIRE(index->get<osg::Referenced>(first + 1).get() == object.get());
+        REQUIRE(index->get<osg::Referenced>(first + 3).get() == object.get());
+
+        index->removeRange(first + 1, 3u);
+        for (unsigned i = 0; i < 4u; ++i)
+            REQUIRE(index->get<osg::Referenced>(first + i).valid() == false);
+    }
+
+    SECTION("Single IDs") {
+        ObjectID id = index->insert(object.get());
+        index->remove(id);
+        index->remove(id);
+        REQUIRE(index->get<osg::Referenced>(id).valid() == false);
+        REQUIRE(index->get<osg::Referenced>(first).get() == object.get());
+    }
+}
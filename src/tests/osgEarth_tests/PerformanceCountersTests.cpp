@@ -0,0 +1,118 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/PerformanceCounters>
+#include <osgEarth/Registry>
+#include <osgEarth/ImageLayer>
+#include <osgEarth/JsonUtils>
+
+using namespace osgEarth;
+
+TEST_CASE( "PerformanceCounters" ) {
+
+    osg::ref_ptr<PerformanceCounters> registry = new PerformanceCounters();
+
+    SECTION("Shares counters by kind and name") {
+        LayerCounters* a = registry->getOrCreate("ImageLayer", "roads");
+        REQUIRE(registry->getOrCreate("ImageLayer", "roads") == a);
+        REQUIRE(registry->getOrCreate("ElevationLayer", "roads") != a);
+        REQUIRE(registry->get("ImageLayer", "rivers") == 0L);
+    }
+
+    SECTION("Buckets fetch latencies") {
+        LayerCounters* c = registry->getOrCreate("ImageLayer", "roads");
+        c->recordFetch(0.5);
+        c->recordFetch(1.0);
+        c->recordFetch(30.0);
+        c->recordFetch(60000.0);
+
+        LayerCounters::Stats s = c->getStats();
+        REQUIRE(s._fetches == 4u);
+        REQUIRE(s._latency[0] == 2u);
+        REQUIRE(s._latency[5] == 1u);
+        REQUIRE(s._latency[LayerCounters::NUM_LATENCY_BUCKETS-1] == 1u);
+        REQUIRE(s._maxFetchTime == 60000.0);
+        REQUIRE(LayerCounters::getLatencyBucketBound(5) == 50.0);
+        REQUIRE(LayerCounters::getLatencyBucketBound(LayerCounters::NUM_LATENCY_BUCKETS-1) < 0.0);
+    }
+
+    SECTION("Tracks queue depth") {
+        LayerCounters* c = registry->getOrCreate("FeatureSource", "parcels");
+        {
+            LayerCounters::ScopedFetch f1(c);
+            LayerCounters::ScopedFetch f2(c);
+            REQUIRE(c->getStats()._queueDepth == 2u);
+        }
+        LayerCounters::Stats s = c->getStats();
+        REQUIRE(s._queueDepth == 0u);
+        REQUIRE(s._maxQueueDepth == 2u);
+        REQUIRE(s._fetches == 2u);
+
+        c->reset();
+        REQUIRE(c->getStats()._fetches == 0u);
+        REQUIRE(c->getStats()._maxQueueDepth == 0u);
+    }
+
+    SECTION("Writes Prometheus text") {
+        LayerCounters* c = registry->getOrCreate("CacheBin", "say \"hi\"");
+        c->recordFetch(3.0);
+        c->recordCacheHit();
+        c->recordCacheMiss();
+        c->recordBytesRead(2048.0);
+        c->recordBytesDecoded(4096.0);
+        c->add("tiles", 7.0);
+
+        std::string text = registry->toPrometheus();
+        REQUIRE(text.find("# TYPE osgearth_fetch_latency_ms histogram") != std::string::npos);
+        REQUIRE(text.find("osgearth_fetch_latency_ms_bucket{kind=\"CacheBin\",name=\"say \\\"hi\\\"\",le=\"2\"} 0") != std::string::npos);
+        REQUIRE(text.find("osgearth_fetch_latency_ms_bucket{kind=\"CacheBin\",name=\"say \\\"hi\\\"\",le=\"5\"} 1") != std::string::npos);
+        REQUIRE(text.find("osgearth_fetch_latency_ms_bucket{kind=\"CacheBin\",name=\"say \\\"hi\\\"\",le=\"+Inf\"} 1") != std::string::npos);
+        REQUIRE(text.find("osgearth_cache_hits_total{kind=\"CacheBin\",name=\"say \\\"hi\\\"\"} 1") != std::string::npos);
+        REQUIRE(text.find("osgearth_bytes_read_total{kind=\"CacheBin\",name=\"say \\\"hi\\\"\"} 2048") != std::string::npos);
+        REQUIRE(text.find("osgearth_bytes_decoded_total{kind=\"CacheBin\",name=\"say \\\"hi\\\"\"} 4096") != std::string::npos);
+        REQUIRE(text.find("osgearth_custom_total{kind=\"CacheBin\",name=\"say \\\"hi\\\"\",counter=\"tiles\"} 7") != std::string::npos);
+    }
+
+    SECTION("Writes JSON") {
+        LayerCounters* c = registry->getOrCreate("ElevationLayer", "dem");
+        c->recordCacheMiss();
+
+        Json::Value root;
+        REQUIRE(Json::Reader().parse(registry->toJSON(), root));
+        const Json::Value& counters = root["counters"];
+        REQUIRE(counters.size() == 1u);
+        REQUIRE(counters[0u]["kind"].asString() == "ElevationLayer");
+        REQUIRE(counters[0u]["name"].asString() == "dem");
+        REQUIRE(counters[0u]["cache_misses"].asUInt() == 1u);
+        REQUIRE(counters[0u]["latency_ms"].size() == (unsigned)LayerCounters::NUM_LATENCY_BUCKETS);
+    }
+}
+
+TEST_CASE( "TerrainLayer counters are registered by class and name" ) {
+    osg::ref_ptr<ImageLayer> layer = new ImageLayer();
+    layer->setName("PerformanceCountersTests");
+    LayerCounters* c = layer->getCounters();
+    REQUIRE(c != 0L);
+    REQUIRE(c == Registry::performanceCounters()->get("ImageLayer", "PerformanceCountersTests"));
+}
@@ -23,6 +23,7 @@
 #include <osgEarth/catch.hpp>
 
 #include <osgEarth/SpatialReference>
+#include <cfloat>
 
 using namespace osgEarth;
 
@@ -90,3 +91,126 @@ TEST_CASE("Plate Carre SpatialReferences can be created") {
     REQUIRE(!plateCarre->isGeodetic());
     REQUIRE(plateCarre->isProjected());
 }
+
+namespace
+{
+    // Transforms points with the native kernels and again through OGR, by way of
+    // an equivalent SRS whose (null) datum shift keeps it off the native path.
+    void compareWithOGR(const std::string& nativeInit, const std::string& ogrInit,
+                        const std::vector<osg::Vec3d>& lonlat)
+    {
+        osg::ref_ptr<const SpatialReference> wgs84 = SpatialReference::create("wgs84");
+        osg::ref_ptr<const SpatialReference> native = SpatialReference::create(nativeInit);
+        osg::ref_ptr<const SpatialReference> ogr = SpatialReference::create(ogrInit);
+        REQUIRE(native.valid());
+        REQUIRE(ogr.valid());
+
+        std::vector<osg::Vec3d> a(lonlat), b(lonlat);
+        REQUIRE(wgs84->transform(a, native.get()));
+        REQUIRE(wgs84->transform(b, ogr.get()));
+
+        for(unsigned i=0; i<lonlat.size(); ++i)
+        {
+            REQUIRE(fabs(a[i].x() - b[i].x()) < 1e-3);
+            REQUIRE(fabs(a[i].y() - b[i].y()) < 1e-3);
+        }
+
+        REQUIRE(native->transform(a, wgs84.get()));
+        for(unsigned i=0; i<lonlat.size(); ++i)
+        {
+            REQUIRE(fabs(a[i].x() - lonlat[i].x()) < 1e-8);
+            REQUIRE(fabs(a[i].y() - lonlat[i].y()) < 1e-8);
+        }
+    }
+}
+
+TEST_CASE("Native UTM transforms match OGR") {
+    std::vector<osg::Vec3d> points;
+    points.push_back(osg::Vec3d(9.0, 0.0, 0.0));
+    points.push_back(osg::Vec3d(12.0, 48.0, 0.0));
+    points.push_back(osg::Vec3d(6.5, 33.0, 0.0));
+    points.push_back(osg::Vec3d(11.9, 70.0, 0.0));
+
+    compareWithOGR("epsg:32632", "+proj=utm +zone=32 +ellps=WGS84 +towgs84=0,0,0 +units=m +no_defs", points);
+
+    SECTION("UTM to UTM across zones") {
+        osg::ref_ptr<const SpatialReference> utm32 = SpatialReference::create("epsg:32632");
+        osg::ref_ptr<const SpatialReference> utm33 = SpatialReference::create("epsg:32633");
+        osg::Vec3d p32(500000.0, 5000000.0, 0.0), p33, back;
+        REQUIRE(utm32->transform(p32, utm33.get(), p33));
+        REQUIRE(utm33->transform(p33, utm32.get(), back));
+        REQUIRE(fabs(back.x() - p32.x()) < 1e-4);
+        REQUIRE(fabs(back.y() - p32.y()) < 1e-4);
+    }
+}
+
+TEST_CASE("Native polar stereographic transforms match OGR") {
+    std::vector<osg::Vec3d> points;
+    points.push_back(osg::Vec3d(0.0, -71.0, 0.0));
+    points.push_back(osg::Vec3d(45.0, -80.0, 0.0));
+    points.push_back(osg::Vec3d(-120.0, -60.0, 0.0));
+
+    compareWithOGR("epsg:3031", "+proj=stere +lat_0=-90 +lat_ts=-71 +lon_0=0 +k=1 +x_0=0 +y_0=0 +ellps=WGS84 +towgs84=0,0,0 +units=m +no_defs", points);
+}
+
+TEST_CASE("Points outside the native domain fall back to OGR") {
+    osg::ref_ptr<const SpatialReference> wgs84 = SpatialReference::create("wgs84");
+    osg::ref_ptr<const SpatialReference> utm = SpatialReference::create("epsg:32632");
+    osg::ref_ptr<const SpatialReference> utmOGR = SpatialReference::create("+proj=utm +zone=32 +ellps=WGS84 +towgs84=0,0,0 +units=m +no_defs");
+
+    SECTION("Far from the central meridian") {
+        // 75 degrees east of the zone's meridian, mixed with a point inside the zone
+        std::vector<osg::Vec3d> a, b;
+        a.push_back(osg::Vec3d(84.0, 10.0, 0.0));
+        a.push_back(osg::Vec3d(9.0, 45.0, 0.0));
+        b = a;
+        REQUIRE(wgs84->transform(a, utm.get()));
+        REQUIRE(wgs84->transform(b, utmOGR.get()));
+        for(unsigned i=0; i<a.size(); ++i)
+        {
+            REQUIRE(fabs(a[i].x() - b[i].x()) < 1e-3);
+            REQUIRE(fabs(a[i].y() - b[i].y()) < 1e-3);
+        }
+    }
+
+    SECTION("At the projection's singularity") {
+        // 90 degrees from the meridian on the equator; never reported as a finite success
+        osg::Vec3d out;
+        if (wgs84->transform(osg::Vec3d(99.0, 0.0, 0.0), utm.get(), out))
+        {
+            REQUIRE(!osg::isNaN(out.x()));
+            REQUIRE(fabs(out.x()) < DBL_MAX);
+        }
+    }
+
+    SECTION("Opposite hemisphere of a polar stereographic") {
+        osg::ref_ptr<const SpatialReference> ps = SpatialReference::create("epsg:3031");
+        osg::ref_ptr<const SpatialReference> psOGR = SpatialReference::create("+proj=stere +lat_0=-90 +lat_ts=-71 +lon_0=0 +k=1 +x_0=0 +y_0=0 +ellps=WGS84 +towgs84=0,0,0 +units=m +no_defs");
+        osg::Vec3d a, b;
+        bool okNative = wgs84->transform(osg::Vec3d(30.0, 45.0, 0.0), ps.get(), a);
+        bool okOGR = wgs84->transform(osg::Vec3d(30.0, 45.0, 0.0), psOGR.get(), b);
+        REQUIRE(okNative == okOGR);
+        if (okNative)
+        {
+            REQUIRE(fabs(a.x() - b.x()) < 1e-3);
+            REQUIRE(fabs(a.y() - b.y()) < 1e-3);
+        }
+    }
+}
+
+TEST_CASE("Equivalent output SRS instances share transform handles") {
+    // A fresh instance for each transform must give the same answer as the
+    // cached one; the per-thread handle is keyed by definition, not instance.
+    osg::ref_ptr<const SpatialReference> wgs84 = SpatialReference::create("wgs84");
+    osg::ref_ptr<const SpatialReference> cached = SpatialReference::create("+proj=utm +zone=33 +ellps=WGS84 +towgs84=0,0,0 +units=m +no_defs");
+    osg::Vec3d first;
+    for(unsigned i=0; i<10; ++i)
+    {
+        osg::ref_ptr<SpatialReference> out = SpatialReference::createFromHandle(cached->getHandle());
+        REQUIRE(out.valid());
+        osg::Vec3d p;
+        REQUIRE(wgs84->transform(osg::Vec3d(15.0, 45.0, 0.0), out.get(), p));
+        if (i == 0) first = p;
+        REQUIRE(p == first);
+    }
+}
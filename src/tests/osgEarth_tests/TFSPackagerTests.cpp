@@ -0,0 +1,128 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarthUtil/TFSPackager>
+#include <osgEarthFeatures/FeatureListSource>
+#include <osgEarth/JsonUtils>
+#include <osgEarth/SpatialReference>
+#include <osgDB/FileUtils>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+using namespace osgEarth;
+using namespace osgEarth::Features;
+using namespace osgEarth::Symbology;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // hands out copies, since the packager crops the features it gets.
+    class CopyingSource : public FeatureListSource
+    {
+    public:
+        Feature* getFeature(FeatureID fid) {
+            Feature* f = FeatureListSource::getFeature(fid);
+            return f ? new Feature(*f, osg::CopyOp::DEEP_COPY_ALL) : 0L;
+        }
+    };
+
+    // reads the feature IDs in a tile, or returns false if it wasn't written.
+    bool readTile(const std::string& dest, unsigned level, unsigned x, unsigned y, std::vector<unsigned>& ids)
+    {
+        std::stringstream path;
+        path << dest << "/" << level << "/" << x << "/" << y << ".json";
+        if (!osgDB::fileExists(path.str()))
+            return false;
+
+        std::ifstream in(path.str().c_str());
+        std::stringstream buf;
+        buf << in.rdbuf();
+        in.close();
+        ::remove(path.str().c_str());
+
+        Json::Value root;
+        if (!Json::Reader().parse(buf.str(), root))
+            return false;
+
+        const Json::Value& features = root["features"];
+        for (unsigned i = 0; i < features.size(); ++i)
+            ids.push_back(features[i]["id"].asUInt());
+        return true;
+    }
+}
+
+TEST_CASE( "TFSPackager bulk cropping keeps tiles under the feature cap" ) {
+
+    const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+
+    // every line crosses the vertical center line of the root tile.
+    osg::ref_ptr<CopyingSource> source = new CopyingSource();
+    source->setFeatureProfile(new FeatureProfile(GeoExtent(wgs84, -20, -20, 20, 20)));
+    const unsigned numLines = 19;
+    for (unsigned i = 0; i < numLines; ++i)
+    {
+        LineString* line = new LineString();
+        line->push_back(osg::Vec3d(-11, -9.5 + i, 0));
+        line->push_back(osg::Vec3d( 11, -9.5 + i, 0));
+        source->getFeatures().push_back(new Feature(line, wgs84, Style(), i+1));
+    }
+
+    const unsigned maxLevel = 4, maxFeatures = 3;
+    const std::string dest = "osgEarth_tests_tfs";
+
+    TFSPackager packager;
+    packager.setFirstLevel(0);
+    packager.setMaxLevel(maxLevel);
+    packager.setMaxFeatures(maxFeatures);
+    packager.setMethod(CropFilter::METHOD_CROPPING);
+    packager.setBulk(true);
+    packager.setNumThreads(2);
+    packager.package(source.get(), dest, "lines");
+
+    std::set<unsigned> written;
+    unsigned rootCount = 0;
+    for (unsigned level = 0; level <= maxLevel; ++level)
+    {
+        for (unsigned x = 0; x < (1u << level); ++x)
+        {
+            for (unsigned y = 0; y < (1u << level); ++y)
+            {
+                std::vector<unsigned> ids;
+                if (!readTile(dest, level, x, y, ids))
+                    continue;
+
+                if (level < maxLevel)
+                    REQUIRE(ids.size() <= maxFeatures);
+                if (level == 0)
+                    rootCount = (unsigned)ids.size();
+                written.insert(ids.begin(), ids.end());
+            }
+        }
+    }
+    ::remove((dest + "/tfs.xml").c_str());
+
+    REQUIRE(rootCount == maxFeatures);
+    REQUIRE(written.size() == numLines);
+}
@@ -0,0 +1,88 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarthUtil/TileIndex>
+#include <osgEarth/GeoData>
+#include <osgEarth/SpatialReference>
+#include <stdio.h>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    TileIndex::Entry makeEntry(const std::string& name, double xmin, double ymin, double xmax, double ymax, TimeStamp t)
+    {
+        TileIndex::Entry e;
+        e._filename = name;
+        e._xmin = xmin; e._ymin = ymin; e._xmax = xmax; e._ymax = ymax;
+        e._modified = t;
+        return e;
+    }
+}
+
+TEST_CASE( "TileIndex compact index round-trips and answers extent queries" ) {
+
+    const std::string filename = "osgEarth_tests_tileindex.idx";
+
+    TileIndex::EntryVector entries;
+    entries.push_back(makeEntry("a/west.tif", -10.0, -10.0, -1.0, 10.0, 1000));
+    entries.push_back(makeEntry("a/east.tif", 1.0, -10.0, 10.0, 10.0, 2000));
+    entries.push_back(makeEntry("north.tif", -5.0, 20.0, 5.0, 30.0, 3000));
+
+    REQUIRE(TileIndex::writeCompact(filename, entries));
+    REQUIRE(TileIndex::isCompact(filename));
+
+    SECTION("entries read back unchanged") {
+        TileIndex::EntryVector read;
+        REQUIRE(TileIndex::readCompact(filename, read));
+        REQUIRE(read.size() == 3);
+        for (unsigned i = 0; i < read.size(); ++i)
+        {
+            REQUIRE(read[i]._filename == entries[i]._filename);
+            REQUIRE(read[i]._xmin == entries[i]._xmin);
+            REQUIRE(read[i]._ymin == entries[i]._ymin);
+            REQUIRE(read[i]._xmax == entries[i]._xmax);
+            REQUIRE(read[i]._ymax == entries[i]._ymax);
+            REQUIRE(read[i]._modified == entries[i]._modified);
+        }
+    }
+
+    SECTION("queries return only intersecting files") {
+        osg::ref_ptr<TileIndex> index = TileIndex::load(filename);
+        REQUIRE(index.valid());
+
+        std::vector<std::string> files;
+        index->getFiles(GeoExtent(SpatialReference::get("wgs84"), 2.0, 0.0, 4.0, 25.0), files);
+        REQUIRE(files.size() == 2);
+        REQUIRE(files[0].find("east.tif") != std::string::npos);
+        REQUIRE(files[1].find("north.tif") != std::string::npos);
+
+        files.clear();
+        index->getFiles(GeoExtent(SpatialReference::get("wgs84"), 50.0, 50.0, 60.0, 60.0), files);
+        REQUIRE(files.empty());
+    }
+
+    ::remove(filename.c_str());
+}
@@ -0,0 +1,126 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/TileMemoryBudget>
+#include <osgEarth/Profile>
+
+using namespace osgEarth;
+
+namespace
+{
+    TileMemoryBudget::Candidate makeCandidate(const Profile* profile, unsigned x, unsigned lastFrame, float range, size_t bytes)
+    {
+        TileMemoryBudget::Candidate c;
+        c._key = TileKey(3, x, 0, profile);
+        c._lastFrame = lastFrame;
+        c._range = range;
+        c._bytes = bytes;
+        return c;
+    }
+}
+
+TEST_CASE( "TileMemoryBudget keeps count of resident bytes" ) {
+
+    TileMemoryBudget budget;
+    REQUIRE(budget.getResidentBytes() == 0u);
+    REQUIRE(budget.isOverBudget() == false);
+
+    budget.add(1000u);
+    budget.add(500u);
+    REQUIRE(budget.getResidentBytes() == 1500u);
+
+    SECTION("updates replace a tile's old size") {
+        budget.update(500u, 800u);
+        REQUIRE(budget.getResidentBytes() == 1800u);
+        budget.update(800u, 0u);
+        REQUIRE(budget.getResidentBytes() == 1000u);
+    }
+
+    SECTION("removals never wrap below zero") {
+        budget.remove(1000u);
+        REQUIRE(budget.getResidentBytes() == 500u);
+        budget.remove(600u);
+        REQUIRE(budget.getResidentBytes() == 0u);
+    }
+
+    SECTION("clear forgets everything") {
+        budget.clear();
+        REQUIRE(budget.getResidentBytes() == 0u);
+    }
+
+    SECTION("no limit means never over budget") {
+        budget.add(1000000u);
+        REQUIRE(budget.isOverBudget() == false);
+    }
+
+    SECTION("over budget only past the limit") {
+        budget.setMaxBytes(1500u);
+        REQUIRE(budget.isOverBudget() == false);
+        budget.add(1u);
+        REQUIRE(budget.isOverBudget() == true);
+    }
+}
+
+TEST_CASE( "TileMemoryBudget evicts least recent and farthest first" ) {
+
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+
+    TileMemoryBudget budget;
+    budget.setMaxBytes(1000u);
+    budget.add(1600u);
+
+    std::vector<TileMemoryBudget::Candidate> candidates;
+    candidates.push_back(makeCandidate(profile.get(), 0u, 20u, 100.0f, 200u));
+    candidates.push_back(makeCandidate(profile.get(), 1u, 10u, 100.0f, 200u));
+    candidates.push_back(makeCandidate(profile.get(), 2u, 10u, 900.0f, 200u));
+    candidates.push_back(makeCandidate(profile.get(), 3u, 30u, 900.0f, 200u));
+    candidates.push_back(makeCandidate(profile.get(), 4u, 20u, 500.0f, 200u));
+
+    SECTION("order and count") {
+        // 600 bytes over; three candidates of 200 bring it back to the limit.
+        REQUIRE(budget.selectEvictions(candidates) == 3u);
+        REQUIRE(candidates.size() == 3u);
+        REQUIRE(candidates[0]._key.getTileX() == 2u);
+        REQUIRE(candidates[1]._key.getTileX() == 1u);
+        REQUIRE(candidates[2]._key.getTileX() == 4u);
+    }
+
+    SECTION("stops as soon as the estimate is under budget") {
+        candidates[2]._bytes = 700u;
+        REQUIRE(budget.selectEvictions(candidates) == 1u);
+        REQUIRE(candidates[0]._key.getTileX() == 2u);
+    }
+
+    SECTION("keeps every candidate when they cannot free enough") {
+        budget.add(10000u);
+        REQUIRE(budget.selectEvictions(candidates) == 5u);
+        REQUIRE(candidates[4]._key.getTileX() == 3u);
+    }
+
+    SECTION("nothing to do within budget") {
+        budget.remove(600u);
+        REQUIRE(budget.selectEvictions(candidates) == 0u);
+        REQUIRE(candidates.empty());
+    }
+}
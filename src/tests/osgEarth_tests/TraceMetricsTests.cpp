@@ -0,0 +1,86 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/TraceMetrics>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace osgEarth;
+
+TEST_CASE( "TraceMetricsBackend" ) {
+
+    const std::string filename = "osgEarth_tests_trace.oetrace";
+
+    SECTION("Interns names") {
+        unsigned a = Metrics::intern("trace.test.a");
+        unsigned b = Metrics::intern("trace.test.b");
+        REQUIRE(a != 0u);
+        REQUIRE(a != b);
+        REQUIRE(Metrics::intern("trace.test.a") == a);
+        REQUIRE(Metrics::getEventName(b) == "trace.test.b");
+    }
+
+    SECTION("Converts to chrome tracing JSON") {
+        {
+            osg::ref_ptr<TraceMetricsBackend> trace = new TraceMetricsBackend(filename, 16u);
+            trace->beginEvent(Metrics::intern("trace.test.outer"));
+            trace->begin("trace.test.inner", Metrics::encodeArgs(1, "tiles", "12"));
+            trace->end("trace.test.inner");
+            trace->endEvent(Metrics::intern("trace.test.outer"));
+            trace->counter("trace.test.graph", "count", 3.0, "", 0.0, "", 0.0);
+            REQUIRE(trace->getNumDropped() == 0u);
+        }
+
+        std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+        std::stringstream json;
+        REQUIRE(TraceMetricsBackend::convertToChrome(in, json));
+        in.close();
+        ::remove(filename.c_str());
+
+        std::string s = json.str();
+        REQUIRE(s.find("\"ph\": \"B\",\"name\": \"trace.test.outer\"") != std::string::npos);
+        REQUIRE(s.find("\"ph\": \"E\",\"name\": \"trace.test.outer\"") != std::string::npos);
+        REQUIRE(s.find("\"name\": \"trace.test.inner\", \"args\": {\"tiles\": \"12\"}") != std::string::npos);
+        REQUIRE(s.find("\"ph\": \"C\",\"name\": \"trace.test.graph\", \"args\": {\"count\": 3}") != std::string::npos);
+    }
+
+    SECTION("Drops events when a buffer is full") {
+        {
+            osg::ref_ptr<TraceMetricsBackend> trace = new TraceMetricsBackend(filename, 4u);
+            unsigned id = Metrics::intern("trace.test.flood");
+            trace->flush();
+            for (unsigned i = 0; i < 100; ++i)
+                trace->beginEvent(id);
+            REQUIRE(trace->getNumDropped() > 0u);
+        }
+        ::remove(filename.c_str());
+    }
+
+    SECTION("Rejects files that are not traces") {
+        std::stringstream notATrace("[{\"ph\": \"B\"}]");
+        std::stringstream json;
+        REQUIRE_FALSE(TraceMetricsBackend::convertToChrome(notATrace, json));
+    }
+}
@@ -0,0 +1,79 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/TrajectoryPredictor>
+
+using namespace osgEarth;
+
+TEST_CASE( "TrajectoryPredictor" ) {
+
+    SECTION("No prediction until there is motion history") {
+        TrajectoryPredictor p;
+        osg::Vec3d eye;
+        REQUIRE(p.predict(1.0, eye) == false);
+        p.addSample(0.0, osg::Vec3d(0, 0, 0));
+        REQUIRE(p.predict(1.0, eye) == false);
+    }
+
+    SECTION("Constant velocity extrapolates linearly") {
+        TrajectoryPredictor p;
+        for (int i = 0; i <= 30; ++i)
+            p.addSample(i / 60.0, osg::Vec3d(i * 10.0, 0, 0));   // 600 m/s along X
+
+        osg::Vec3d eye;
+        REQUIRE(p.predict(2.0, eye));
+        REQUIRE(eye.x() == Approx(300.0 + 1200.0));
+        REQUIRE(eye.y() == Approx(0.0));
+    }
+
+    SECTION("Velocity follows the history window") {
+        TrajectoryPredictor p;
+        p.setHistory(0.25);
+        for (int i = 0; i <= 60; ++i)
+            p.addSample(i / 60.0, osg::Vec3d(i < 30 ? 0.0 : (i - 30) * 10.0, 0, 0));
+
+        // the stationary first half has aged out of the window
+        osg::Vec3d eye;
+        REQUIRE(p.predict(1.0, eye));
+        REQUIRE(eye.x() == Approx(300.0 + 600.0));
+    }
+
+    SECTION("Flight path overrides extrapolation") {
+        TrajectoryPredictor::Path path;
+        path.push_back(TrajectoryPredictor::Sample(0.0, osg::Vec3d(0, 0, 0)));
+        path.push_back(TrajectoryPredictor::Sample(10.0, osg::Vec3d(0, 1000, 0)));
+
+        TrajectoryPredictor p;
+        p.setFlightPath(path);
+        p.addSample(2.0, osg::Vec3d(0, 200, 0));
+
+        osg::Vec3d eye;
+        REQUIRE(p.predict(3.0, eye));
+        REQUIRE(eye.y() == Approx(500.0));
+
+        // clamped past the end
+        REQUIRE(p.predict(30.0, eye));
+        REQUIRE(eye.y() == Approx(1000.0));
+    }
+}